@@ -21,6 +21,8 @@
 #include <mirtkOptions.h>
 
 #include <mirtkImageIOConfig.h>
+#include <mirtkImageReader.h>
+#include <mirtkParallel.h>
 
 #include <mirtkMatrix.h>
 #include <mirtkGenericImage.h>
@@ -191,29 +193,62 @@ int read_image_list_file(const char        *image_list_name,
 
 // -----------------------------------------------------------------------------
 #ifdef HAVE_MIRTK_Transformation
+/// Read image-to-average transformation
+///
+/// When the transformation is linear, or when the global transformation of an
+/// inverted fluid transformation is linear, the linear part is returned as
+/// affine matrix instead which is applied to the image attributes directly.
+/// A linear transformation is deleted and NULL is returned in this case.
+Transformation *ReadTransformation(const string &imdof_name, Matrix &mat,
+                                   bool imdof_invert = false)
+{
+  mat.Initialize(4, 4);
+  mat.Ident();
+  if (imdof_name.empty()) return NULL;
+  Transformation *imdof = Transformation::New(imdof_name.c_str());
+  HomogeneousTransformation   *lin   = dynamic_cast<HomogeneousTransformation   *>(imdof);
+  FluidFreeFormTransformation *fluid = dynamic_cast<FluidFreeFormTransformation *>(imdof);
+  if (fluid && imdof_invert) lin = fluid->GetGlobalTransformation();
+  if (lin) {
+    mat = lin->GetMatrix();
+    if (imdof_invert) mat.Invert();
+    if (fluid) lin->Reset();
+    else       Delete(imdof);
+  }
+  return imdof;
+}
+
+// -----------------------------------------------------------------------------
 void Read(const string &image_name, const string    &imdof_name,
           InputImage   &image,      Transformation *&imdof,
           bool imdof_invert = false)
 {
+  Matrix mat;
   image.Read(image_name.c_str());
-  if (imdof_name.empty()) {
-    imdof = NULL;
-  } else {
-    imdof = Transformation::New(imdof_name.c_str());
-    HomogeneousTransformation   *lin   = dynamic_cast<HomogeneousTransformation   *>(imdof);
-    FluidFreeFormTransformation *fluid = dynamic_cast<FluidFreeFormTransformation *>(imdof);
-    if (fluid && imdof_invert) lin = fluid->GetGlobalTransformation();
-    if (lin) {
-      Matrix mat = lin->GetMatrix();
-      if (imdof_invert) mat.Invert();
-      image.PutAffineMatrix(mat, true);
-      Delete(imdof);
-    }
-    if (fluid && lin) fluid->GetGlobalTransformation()->Reset();
-  }
+  imdof = ReadTransformation(imdof_name, mat, imdof_invert);
+  if (!mat.IsIdentity()) image.PutAffineMatrix(mat, true);
 }
 #endif // HAVE_MIRTK_Transformation
 
+// -----------------------------------------------------------------------------
+/// Read attributes of (transformed) input image from image file header
+ImageAttributes ReadAttributes(const string &image_name
+                               #ifdef HAVE_MIRTK_Transformation
+                                 , const string &imdof_name, bool imdof_invert
+                               #endif // HAVE_MIRTK_Transformation
+                               )
+{
+  unique_ptr<ImageReader> reader(ImageReader::New(image_name.c_str()));
+  ImageAttributes attr = reader->Attributes();
+  #ifdef HAVE_MIRTK_Transformation
+    Matrix mat;
+    Transformation *imdof = ReadTransformation(imdof_name, mat, imdof_invert);
+    if (!mat.IsIdentity()) attr.PutAffineMatrix(mat, true);
+    Delete(imdof);
+  #endif // HAVE_MIRTK_Transformation
+  return attr;
+}
+
 // -----------------------------------------------------------------------------
 struct AddVoxelValueToAverage : public VoxelFunction
 {
@@ -291,6 +326,54 @@ void Add(OutputImage &average, InputImage &image, int label = -1,
   delete add._Image;
 }
 
+// -----------------------------------------------------------------------------
+/// Read next input image (and transformation) while previous image is added
+struct ReadInputImage
+{
+  const string   *_ImageName;
+  InputImage     *_Image;
+
+  #ifdef HAVE_MIRTK_Transformation
+    const string    *_TransformationName;
+    Transformation **_Transformation;
+    bool             _Invert;
+  #endif
+
+  void operator ()() const
+  {
+    #ifdef HAVE_MIRTK_Transformation
+      Read(*_ImageName, *_TransformationName, *_Image, *_Transformation, _Invert);
+    #else // HAVE_MIRTK_Transformation
+      _Image->Read(_ImageName->c_str());
+    #endif // HAVE_MIRTK_Transformation
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Add previously read input image to average
+struct AddInputImage
+{
+  OutputImage       *_Average;
+  InputImage        *_Image;
+  int                _Label;
+  OutputType         _Weight;
+  InterpolationMode  _Interpolation;
+
+  #ifdef HAVE_MIRTK_Transformation
+    Transformation *_Transformation;
+    bool            _Invert;
+  #endif
+
+  void operator ()() const
+  {
+    Add(*_Average, *_Image, _Label,
+        #ifdef HAVE_MIRTK_Transformation
+          _Transformation, _Invert,
+        #endif
+        _Weight, _Interpolation);
+  }
+};
+
 // =============================================================================
 // Main
 // =============================================================================
@@ -304,7 +387,6 @@ int main(int argc, char **argv)
   int               nimages;
 
   #ifdef HAVE_MIRTK_Transformation
-    Transformation *imdof = NULL;
     Array<string>   imdof_name;
     Array<bool>     imdof_invert;
   #endif // HAVE_MIRTK_Transformation
@@ -442,22 +524,25 @@ int main(int argc, char **argv)
   if (verbose) cout << "Determine field-of-view which contains all images...", cout.flush();
   ImageAttributes fov;
   if (reference_name) {
-    GreyImage reference(reference_name);
-    fov = reference.Attributes();
+    unique_ptr<ImageReader> reader(ImageReader::New(reference_name));
+    fov = reader->Attributes();
+  } else if (!sequence.IsEmpty()) {
+    fov = OrthogonalFieldOfView(sequence.Attributes());
+    fov._t = 1, fov._dt = .0;
   } else {
+    // Only image file headers are read to determine the field-of-view
     Array<ImageAttributes> attr;
     for (int n = 0; n < nimages; ++n) {
-      #ifdef HAVE_MIRTK_Transformation
-        Read(image_name[n], imdof_name[n], image, imdof, imdof_invert[n]);
-        Delete(imdof);
-      #else // HAVE_MIRTK_Transformation
-        image.Read(image_name[n].c_str());
-      #endif // HAVE_MIRTK_Transformation
-      if (image.T() > 1) {
+      ImageAttributes imattr = ReadAttributes(image_name[n]
+                                              #ifdef HAVE_MIRTK_Transformation
+                                                , imdof_name[n], imdof_invert[n]
+                                              #endif // HAVE_MIRTK_Transformation
+                                              );
+      if (imattr._t > 1) {
         if (verbose) cout << " failed" << endl;
         FatalError("Image " << (n+1) << " has four dimensions!");
       }
-      attr.push_back(OrthogonalFieldOfView(image.Attributes()));
+      attr.push_back(OrthogonalFieldOfView(imattr));
     }
     fov = OverallFieldOfView(attr);
   }
@@ -481,39 +566,69 @@ int main(int argc, char **argv)
   OutputImage average(fov);
   average = padding;
   average.PutBackgroundValueAsDouble(padding);
-  for (int n = 0; n < nimages; ++n) {
-    if (sequence.IsEmpty()) {
+  if (sequence.IsEmpty()) {
+    // Double buffer of input images such that the next image (and its
+    // transformation) is read while the current image is being added
+    InputImage      images[2];
+    ReadInputImage  read;
+    AddInputImage   add;
+    add._Average       = &average;
+    add._Label         = label;
+    add._Interpolation = interpolation;
+    #ifdef HAVE_MIRTK_Transformation
+      Transformation *imdofs[2] = {NULL, NULL};
+    #endif
+    read._ImageName = &image_name[0];
+    read._Image     = &images[0];
+    #ifdef HAVE_MIRTK_Transformation
+      read._TransformationName = &imdof_name[0];
+      read._Transformation     = &imdofs[0];
+      read._Invert             = imdof_invert[0];
+    #endif
+    read();
+    for (int n = 0; n < nimages; ++n) {
       if (verbose) {
         cout << "Add image " << setw(3) << (n+1) << " out of " << nimages << "... ";
         cout.flush();
       }
+      const int cur = n % 2, next = (n + 1) % 2;
+      add._Image  = &images[cur];
+      add._Weight = image_weight[n];
       #ifdef HAVE_MIRTK_Transformation
-        Read(image_name[n], imdof_name[n], image, imdof, imdof_invert[n]);
-      #else // HAVE_MIRTK_Transformation
-        image.Read(image_name[n].c_str());
-      #endif // HAVE_MIRTK_Transformation
-    } else {
+        add._Transformation = imdofs[cur];
+        add._Invert         = imdof_invert[n];
+      #endif
+      if (n + 1 < nimages) {
+        read._ImageName = &image_name[n+1];
+        read._Image     = &images[next];
+        #ifdef HAVE_MIRTK_Transformation
+          read._TransformationName = &imdof_name[n+1];
+          read._Transformation     = &imdofs[next];
+          read._Invert             = imdof_invert[n+1];
+        #endif
+        parallel_invoke(add, read);
+      } else {
+        add();
+      }
+      #ifdef HAVE_MIRTK_Transformation
+        Delete(imdofs[cur]);
+      #endif
+      if (verbose) cout << " done" << endl;
+    }
+  } else {
+    for (int n = 0; n < nimages; ++n) {
       if (verbose) {
         cout << "Add frame " << setw(3) << (n+1) << " out of " << nimages << "... ";
         cout.flush();
       }
       sequence.GetFrame(image, n);
-      #ifdef HAVE_MIRTK_Transformation
-        imdof = NULL;
-      #endif
+      Add(average, image, label,
+          #ifdef HAVE_MIRTK_Transformation
+            NULL, false,
+          #endif
+          image_weight[n], interpolation);
+      if (verbose) cout << " done" << endl;
     }
-
-    Add(average, image, label, 
-        #ifdef HAVE_MIRTK_Transformation
-          imdof, imdof_invert[n],
-        #endif
-        image_weight[n], interpolation);
-
-    #ifdef HAVE_MIRTK_Transformation
-      Delete(imdof);
-    #endif
-
-    if (verbose) cout << " done" << endl;
   }
   if (wsum > .0) average /= wsum;
 
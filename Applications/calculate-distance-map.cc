@@ -20,6 +20,7 @@
 
 #include <mirtkCommon.h>
 #include <mirtkOptions.h>
+#include <mirtkOrderedSet.h>
 
 #include <mirtkImageIOConfig.h>
 #include <mirtkResampling.h>
@@ -61,6 +62,11 @@ void PrintHelp(const char *name)
   cout << "  -isotropic [<s>]   Resample distance transform to isotropic voxel size,\n";
   cout << "                     where the voxel size is s times the minimum voxel size.\n";
   cout << "                     When no argument given, s defaults to 1. (default: 0/off)\n";
+  cout << "  -labels [<l>...]   Interpret input image as segmentation and compute signed\n";
+  cout << "                     distance maps of the specified labels one after another.\n";
+  cout << "                     The output image contains one distance map per label and\n";
+  cout << "                     input frame.\n";
+  cout << "                     When no labels are given, all non-zero labels are used.\n";
   PrintStandardOptions(cout);
   cout << "\n";
 }
@@ -137,6 +143,9 @@ int main(int argc, char *argv[])
   int    radial    = 0;
   double isotropic = .0;
 
+  OrderedSet<int> labels;
+  bool            segmentation = false;
+
   for (ALL_OPTIONS) {
     if (OPTION("-distance") || OPTION("-mode")) {
       PARSE_ARGUMENT(type);
@@ -157,12 +166,25 @@ int main(int argc, char *argv[])
       if (HAS_ARGUMENT) PARSE_ARGUMENT(isotropic);
       else isotropic = 1.0;
     }
+    else if (OPTION("-labels") || OPTION("-label")) {
+      segmentation = true;
+      while (HAS_ARGUMENT) {
+        int label;
+        PARSE_ARGUMENT(label);
+        labels.insert(label);
+      }
+    }
     else HANDLE_STANDARD_OR_UNKNOWN_OPTION();
   }
 
   // No linear isotropic resampling for city block distance
   if (type == DT_CityBlock) isotropic = .0;
 
+  // Signed distance maps of multiple labels only for Euclidean distance
+  if (segmentation && type != DT_Euclidean) {
+    FatalError("Option -labels only supported for Euclidean distance transform");
+  }
+
   // Read object image
   if (verbose) cout << "Reading image " << input_name << "...", cout.flush();
   RealImage image(input_name);
@@ -205,37 +227,71 @@ int main(int argc, char *argv[])
     // Euclidean distance transform
     case DT_Euclidean: {
       EuclideanDistanceTransformType edt(euclidean_mode);
-      RealImage &inputA  = image, inputB(image.Attributes());
-      RealImage &outputA = dmap,  outputB;
 
-      for (int idx = 0; idx < image.NumberOfVoxels(); ++idx) {
-        if (image(idx) > .5) {
-          inputA(idx) = 1.0;
-          inputB(idx) = 0.0;
-        } else {
-          inputA(idx) = 0.0;
-          inputB(idx) = 1.0;
+      // Number of input voxels, which may exceed the range of int
+      const int    nframes = image.T();
+      const size_t nvoxels = static_cast<size_t>(image.X()) * static_cast<size_t>(image.Y())
+                           * static_cast<size_t>(image.Z()) * static_cast<size_t>(nframes);
+      const RealPixel * const mask = image.Data();
+
+      // Use all non-zero labels of segmentation by default
+      if (segmentation && labels.empty()) {
+        for (size_t idx = 0; idx < nvoxels; ++idx) {
+          const int label = iround(mask[idx]);
+          if (label != 0) labels.insert(label);
+        }
+        if (labels.empty()) {
+          FatalError("Input segmentation contains no labels");
         }
       }
 
-      if (verbose) cout << "  Computing distance transform of interior...", cout.flush();
+      // Stack binary masks of interior and exterior of one segment as frames
+      // such that both distance transforms are computed in one parallel pass.
+      // Segments are processed one at a time to not allocate two additional
+      // volumes per label, only the output holds one distance map per label.
+      const int nsegments = (segmentation ? static_cast<int>(labels.size()) : 1);
+
+      ImageAttributes attr = image.Attributes();
+      attr._t = nsegments * nframes;
+      dmap.Initialize(attr);
+      attr._t = 2 * nframes;
+      RealImage input(attr), output;
+
+      if (verbose) {
+        cout << "  Computing distance transforms of interior and exterior";
+        if (segmentation) cout << " of " << nsegments << " segments";
+        cout << "...";
+        cout.flush();
+      }
 
-      edt.Input (& inputA);
-      edt.Output(&outputA);
-      edt.Run();
+      RealPixel * const interior = input.Data();
+      RealPixel * const exterior = interior + nvoxels;
+
+      OrderedSet<int>::const_iterator label = labels.begin();
+      for (int n = 0; n < nsegments; ++n) {
+        for (size_t idx = 0; idx < nvoxels; ++idx) {
+          bool inside;
+          if (segmentation) inside = (iround(mask[idx]) == *label);
+          else              inside = (mask[idx] > .5);
+          interior[idx] = (inside ? 1.0 : 0.0);
+          exterior[idx] = (inside ? 0.0 : 1.0);
+        }
+        if (segmentation) ++label;
 
-      if (verbose) cout << " done\n  Computing distance transform of exterior...", cout.flush();
+        edt.Input (&input);
+        edt.Output(&output);
+        edt.Run();
 
-      edt.Input (& inputB);
-      edt.Output(&outputB);
-      edt.Run();
+        const RealPixel *dinterior = output.Data();
+        const RealPixel *dexterior = dinterior + nvoxels;
+        RealPixel       *d         = dmap.Data() + static_cast<size_t>(n) * nvoxels;
+        for (size_t idx = 0; idx < nvoxels; ++idx) {
+          d[idx] = sqrt(dinterior[idx]) - sqrt(dexterior[idx]);
+        }
+      }
 
       if (verbose) cout << " done" << endl;
 
-      for (int idx = 0; idx < image.NumberOfVoxels(); ++idx) {
-        dmap(idx) = sqrt(outputA(idx)) - sqrt(outputB(idx));
-      }
-
       if (radial > 0) {
         edt.Input (&dmap);
         edt.Output(&dmap);
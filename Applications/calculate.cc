@@ -542,8 +542,28 @@ int main(int argc, char **argv)
     out << endl;
   }
 
-  // Process input data, either transform it or compute statistics from it
-  for (size_t i = 0; i < ops.size(); ++i) ops[i]->Process(n, data, mask);
+  // Process input data, either transform it or compute statistics from it,
+  // where consecutive element-wise operations and statistics which can be
+  // computed in a single pass are fused into one pass over the data, and
+  // the order statistics of consecutive percentile statistics are determined
+  // together without sorting the data
+  for (size_t i = 0; i < ops.size(); ) {
+    ElementWiseOpChain  chain;
+    Array<Percentile *> percentiles;
+    while (i < ops.size() && ElementWiseOpChain::IsFusable(ops[i].get())) {
+      chain.Push(ops[i++].get());
+    }
+    if (chain.NumberOfOps() == 0) {
+      Percentile *percentile;
+      while (i < ops.size() && (percentile = dynamic_cast<Percentile *>(ops[i].get()))) {
+        percentiles.push_back(percentile);
+        ++i;
+      }
+    }
+    if      (chain.NumberOfOps() > 0) chain.Process(n, data, mask);
+    else if (!percentiles.empty())    Percentile::EvaluateAll(percentiles, n, data, mask);
+    else                              ops[i++]->Process(n, data, mask);
+  }
   delete[] mask;
 
   // Print image statistics
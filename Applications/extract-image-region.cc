@@ -23,6 +23,7 @@
 
 #include <mirtkPointSet.h>
 #include <mirtkBaseImage.h>
+#include <mirtkImageReader.h>
 #include <mirtkImageIOConfig.h>
 
 using namespace mirtk;
@@ -146,9 +147,10 @@ int main(int argc, char **argv)
   const char *input_name  = POSARG(1);
   const char *output_name = POSARG(2);
 
-  // Read input image
+  // Read input image header
   InitializeImageIOLibrary();
-  unique_ptr<BaseImage> in(BaseImage::New(input_name));
+  unique_ptr<ImageReader> reader(ImageReader::New(input_name));
+  const ImageAttributes in = reader->Attributes();
 
   // Parse optional arguments and adjust image region accordingly
   int    xmargin = 0, ymargin = 0, zmargin = 0, tmargin = 0;
@@ -200,7 +202,7 @@ int main(int argc, char **argv)
         if (HAS_ARGUMENT) PARSE_ARGUMENT(nz);
         else              nz = 1;
       } else ny = nz = nx;
-      in->WorldToImage(x, y, z);
+      in.WorldToLattice(x, y, z);
       int i  = iround(x);
       int j  = iround(y);
       int k  = iround(z);
@@ -217,7 +219,7 @@ int main(int argc, char **argv)
         landmarks.Read(ARGUMENT);
         for (int i = 0; i < landmarks.Size(); ++i) {
           Point &p = landmarks(i);
-          in->WorldToImage(p);
+          in.WorldToLattice(p._x, p._y, p._z);
           x1 = MinIndex(x1, ifloor(p._x));
           x2 = MaxIndex(x2, iceil (p._x));
           y1 = MinIndex(y1, ifloor(p._y));
@@ -239,7 +241,7 @@ int main(int argc, char **argv)
             for (int i = 0; i < 2; ++i) {
               p._x = i * ref.X(), p._y = y, p._z = z;
               ref.ImageToWorld(p);
-              in->WorldToImage(p);
+              in.WorldToLattice(p._x, p._y, p._z);
               x1 = MinIndex(x1, ifloor(p._x));
               x2 = MaxIndex(x2, iceil (p._x));
               y1 = MinIndex(y1, ifloor(p._y));
@@ -275,13 +277,13 @@ int main(int argc, char **argv)
 
   // Full input image region by default
   if (x1 <= MIN_INDEX) x1 = 0;
-  if (x2 >= MAX_INDEX) x2 = in->X() - 1;
+  if (x2 >= MAX_INDEX) x2 = in._x - 1;
   if (y1 <= MIN_INDEX) y1 = 0;
-  if (y2 >= MAX_INDEX) y2 = in->Y() - 1;
+  if (y2 >= MAX_INDEX) y2 = in._y - 1;
   if (z1 <= MIN_INDEX) z1 = 0;
-  if (z2 >= MAX_INDEX) z2 = in->Z() - 1;
+  if (z2 >= MAX_INDEX) z2 = in._z - 1;
   if (t1 <= MIN_INDEX) t1 = 0;
-  if (t2 >= MAX_INDEX) t2 = in->T() - 1;
+  if (t2 >= MAX_INDEX) t2 = in._t - 1;
 
   // Add fixed-width margin
   x1 -= xmargin, x2 += xmargin;
@@ -307,10 +309,10 @@ int main(int argc, char **argv)
     y1 = max(y1, 0);
     z1 = max(z1, 0);
     t1 = max(t1, 0);
-    x2 = min(x2, in->X() - 1);
-    y2 = min(y2, in->Y() - 1);
-    z2 = min(z2, in->Z() - 1);
-    t2 = min(t2, in->T() - 1);
+    x2 = min(x2, in._x - 1);
+    y2 = min(y2, in._y - 1);
+    z2 = min(z2, in._z - 1);
+    t2 = min(t2, in._t - 1);
   }
 
   // Verbose reporting/logging of resulting region
@@ -321,7 +323,7 @@ int main(int argc, char **argv)
   }
 
   // Allocate output image
-  ImageAttributes attr = in->Attributes();
+  ImageAttributes attr = in;
   attr._x = abs(x2 - x1 + 1);
   attr._y = abs(y2 - y1 + 1);
   attr._z = abs(z2 - z1 + 1);
@@ -329,25 +331,36 @@ int main(int argc, char **argv)
   attr._xorigin = .0;
   attr._yorigin = .0;
   attr._zorigin = .0;
-  attr._torigin = in->ImageToTime(t1);
-  unique_ptr<BaseImage> out(BaseImage::New(in->GetDataType()));
+  attr._torigin = in.LatticeToTime(t1);
+  unique_ptr<BaseImage> out(BaseImage::New(reader->DataType()));
   out->Initialize(attr);
 
   // Adjust spatial origin (i.e., image center)
   double o1[3] = {.0};
   double o2[3] = {static_cast<double>(x1), static_cast<double>(y1), static_cast<double>(z1)};
   out->ImageToWorld(o1[0], o1[1], o1[2]);
-  in ->ImageToWorld(o2[0], o2[1], o2[2]);
+  in  .LatticeToWorld(o2[0], o2[1], o2[2]);
   out->PutOrigin(o2[0] - o1[0], o2[1] - o1[1], o2[2] - o1[2]);
 
+  // Read only part of input image which overlaps the output region
+  const int i1 = max(x1, 0), i2 = min(x2, in._x - 1);
+  const int j1 = max(y1, 0), j2 = min(y2, in._y - 1);
+  const int k1 = max(z1, 0), k2 = min(z2, in._z - 1);
+  const int l1 = max(t1, 0), l2 = min(t2, in._t - 1);
+  unique_ptr<BaseImage> roi;
+  if (i1 <= i2 && j1 <= j2 && k1 <= k2 && l1 <= l2) {
+    reader->Region(i1, j1, k1, l1, i2 + 1, j2 + 1, k2 + 1, l2 + 1);
+    roi.reset(reader->Run());
+  }
+
   // Copy image region
   int idx = 0;
   for (int l = t1; l <= t2; ++l)
   for (int k = z1; k <= z2; ++k)
   for (int j = y1; j <= y2; ++j)
   for (int i = x1; i <= x2; ++i, ++idx) {
-    if (in->IsInside(i, j, k, l)) {
-      out->PutAsDouble(idx, in->Get(i, j, k, l));
+    if (roi && i1 <= i && i <= i2 && j1 <= j && j <= j2 && k1 <= k && k <= k2 && l1 <= l && l <= l2) {
+      out->PutAsDouble(idx, roi->Get(i - i1, j - j1, k - k1, l - l1));
     } else {
       out->PutAsDouble(idx, padding_value);
     }
@@ -27,6 +27,7 @@
 #include <mirtkTransformation.h>
 #include <mirtkHomogeneousTransformation.h>
 #include <mirtkRigidTransformation.h>
+#include <mirtkMultiLevelFreeFormTransformation.h>
 #include <mirtkImageTransformation.h>
 #include <mirtkInterpolateImageFunction.h>
 
@@ -192,6 +193,10 @@ int main(int argc, char **argv)
   } else {
     // Read transformation
     transformation.reset(Transformation::New(dofin_name));
+    // Evaluate single local transformation instead of each level of MFFD
+    MultiLevelFreeFormTransformation *mffd;
+    mffd = dynamic_cast<MultiLevelFreeFormTransformation *>(transformation.get());
+    if (mffd) mffd->CompileLocalTransformation();
   }
 
   // Create image transformation filter
@@ -26,6 +26,7 @@
 #include <mirtkGenericImage.h>
 #include <mirtkPointSetUtils.h>
 #include <mirtkTransformation.h>
+#include <mirtkMultiLevelFreeFormTransformation.h>
 #include <mirtkPointSetUtils.h>
 
 #include <vtkSmartPointer.h>
@@ -216,6 +217,9 @@ int main(int argc, char **argv)
   // Transform first pnumber points
   for (size_t i = 0; i < dofin_name.size(); ++i) {
     unique_ptr<Transformation> dofin(Transformation::New(dofin_name[i]));
+    MultiLevelFreeFormTransformation *mffd;
+    mffd = dynamic_cast<MultiLevelFreeFormTransformation *>(dofin.get());
+    if (mffd) mffd->CompileLocalTransformation();
     if (dofin_invert[i]) {
       if (verbose) cout << "Apply inverse of " << dofin_name[i] << endl;
       for (int i = 0; i < pnumber; ++i) dofin->Inverse(points(i), ts, tt);
@@ -30,9 +30,12 @@ namespace mirtk {
 
 using std::sort;
 using std::partial_sort;
+using std::nth_element;
 using std::transform;
 using std::reverse;
 using std::shuffle;
+using std::lower_bound;
+using std::upper_bound;
 
 
 /**
@@ -22,11 +22,11 @@
 
 #include <mirtkObject.h>
 #include <mirtkCommonConfig.h>
+#include <mirtkArray.h>
 
+#include <cstdio>
 #if MIRTK_Common_WITH_ZLIB
 #  include <zlib.h>
-#else
-#  include <cstdio>
 #endif
 
 
@@ -38,6 +38,8 @@ namespace mirtk {
  *
  * This class defines and implements functions for reading compressed file
  * streams. The file streams can be either uncompressed or compressed.
+ * Larger chunks of files written by Cofstream as series of independently
+ * deflated blocks (BGZF) are inflated in parallel.
  */
 
 class Cifstream : public Object
@@ -51,6 +53,26 @@ class Cifstream : public Object
   FILE  *_File;
 #endif
 
+#if MIRTK_Common_WITH_ZLIB
+  /// File pointer used to read compressed blocks of BGZF file
+  FILE *_BlockFile;
+
+  /// Offsets of blocks in compressed BGZF file followed by file size
+  Array<long> _BlockOffset;
+
+  /// Uncompressed offsets of blocks followed by uncompressed file size
+  Array<long> _BlockStart;
+
+  /// Current position after reading blocks or -1 if given by \c _File
+  long _BlockPos;
+
+  /// Read index of compressed blocks
+  bool ReadBlockIndex();
+
+  /// Inflate compressed blocks overlapping the requested data in parallel
+  bool ReadBlocks(char *, long, long);
+#endif
+
   /// Flag indicating whether file bytes are swapped
   mirtkPublicAttributeMacro(bool, Swapped);
 
@@ -22,6 +22,7 @@
 
 #include <mirtkCommonConfig.h>
 #include <mirtkObject.h>
+#include <mirtkArray.h>
 
 #if MIRTK_Common_WITH_ZLIB
 #  include <zlib.h>
@@ -37,20 +38,29 @@ namespace mirtk {
  * Class for writing (compressed) file streams.
  *
  * This class defines and implements functions for writing compressed file
- * streams. At the moment only the writing of uncompressed file streams is
- * supported.
+ * streams. Files with extension .gz are written as series of independently
+ * deflated blocks of at most 64 kB each (BGZF), which are compressed in
+ * parallel. The resulting file is a valid multi-member gzip file which can
+ * be read by any gzip decompressor, while Cifstream inflates such blocks
+ * again in parallel.
  */
 
 class Cofstream : public Object
 {
   mirtkObjectMacro(Cofstream);
 
-  /// File pointer to uncompressed file
+  /// File pointer to output file
   FILE *_File;
 
-  /// File pointer to compressed file
 #if MIRTK_Common_WITH_ZLIB
-  gzFile _ZFile;
+  /// Uncompressed data of last incomplete block not yet written to file
+  Array<char> _Buffer;
+
+  /// Uncompressed size of data written so far, including buffered data
+  long _Pos;
+
+  /// Compress blocks of data in parallel and write them to file
+  bool WriteBlocks(const char *, long);
 #endif
 
   /// Flag whether file is compressed
@@ -34,6 +34,12 @@
 /// 0: single-precision 1: double-precision
 #define MIRTK_USE_FLOAT_BY_DEFAULT 0
 
+/// Precision of the channels of registered images used by image similarities
+/// 0: double-precision 1: single-precision
+#ifndef MIRTK_REGISTERED_IMAGE_USE_FLOAT
+#  define MIRTK_REGISTERED_IMAGE_USE_FLOAT 0
+#endif
+
 // ===========================================================================
 // CUDA
 // ===========================================================================
@@ -31,6 +31,7 @@
 #  include <tbb/blocked_range3d.h>
 #  include <tbb/parallel_for.h>
 #  include <tbb/parallel_reduce.h>
+#  include <tbb/parallel_invoke.h>
 #  include <tbb/concurrent_queue.h>
 #  include <tbb/mutex.h>
 #endif
@@ -89,6 +90,7 @@ using tbb::blocked_range2d;
 using tbb::blocked_range3d;
 using tbb::parallel_for;
 using tbb::parallel_reduce;
+using tbb::parallel_invoke;
 using tbb::concurrent_queue;
 using tbb::mutex;
 using tbb::split;
@@ -210,6 +212,29 @@ void parallel_reduce(const Range &range, Body &body) {
   body(range);
 }
 
+/// parallel_invoke dummy template function which executes the functions serially
+template <class Func0, class Func1>
+void parallel_invoke(const Func0 &f0, const Func1 &f1) {
+  f0();
+  f1();
+}
+
+/// Dummy mutex which is never locked as the code is executed serially
+class mutex
+{
+public:
+
+  /// Dummy scoped lock
+  class scoped_lock
+  {
+  public:
+    scoped_lock() {}
+    scoped_lock(mutex &) {}
+    void acquire(mutex &) {}
+    void release() {}
+  };
+};
+
 
 #endif // HAVE_TBB
 
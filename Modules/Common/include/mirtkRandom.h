@@ -32,6 +32,7 @@ using std::srand;
 using std::random_device;
 using std::mt19937;
 using std::uniform_int_distribution;
+using std::uniform_real_distribution;
 using std::random_shuffle;
 
 
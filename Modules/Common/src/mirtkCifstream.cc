@@ -21,15 +21,109 @@
 
 #include <mirtkCommonConfig.h>
 #include <mirtkMemory.h> // swap16, swap32
+#include <mirtkAlgorithm.h>
+#include <mirtkMath.h>
+#include <mirtkParallel.h>
 
 
 namespace mirtk {
 
 
+#if MIRTK_Common_WITH_ZLIB
+namespace CifstreamUtils {
+
+
+/// Maximum uncompressed size of each block
+const long MaxBlockSize = 0x10000;
+
+/// Size of gzip header of each block with BGZF extra subfield
+const int BlockHeaderSize = 18;
+
+/// Size of gzip footer of each block
+const int BlockFooterSize = 8;
+
+/// Minimum number of bytes to read for which blocks are inflated in parallel
+const long MinParallelReadSize = 2 * MaxBlockSize;
+
+// -----------------------------------------------------------------------------
+/// Get 16-bit/32-bit unsigned integer stored in little endian byte order
+inline long GetLittleEndian(const unsigned char *p, int nbytes)
+{
+  long v = 0;
+  for (int i = nbytes - 1; i >= 0; --i) v = (v << 8) | static_cast<long>(p[i]);
+  return v;
+}
+
+// -----------------------------------------------------------------------------
+/// Whether gzip member header has BGZF extra subfield
+///
+/// \returns Total size of compressed block or zero if not a BGZF block.
+inline long BlockSize(const unsigned char *p)
+{
+  if (p[0] != 0x1f || p[1] != 0x8b || p[2] != 0x08 || (p[3] & 0x04) == 0) return 0;
+  if (GetLittleEndian(p + 10, 2) != 6) return 0;
+  if (p[12] != 'B' || p[13] != 'C' || GetLittleEndian(p + 14, 2) != 2) return 0;
+  return GetLittleEndian(p + 16, 2) + 1;
+}
+
+// -----------------------------------------------------------------------------
+/// Inflate compressed blocks in parallel
+struct InflateBlocks
+{
+  const unsigned char *_Input;  ///< Compressed blocks
+  const long          *_Offset; ///< Offsets of compressed blocks
+  const long          *_Start;  ///< Uncompressed offsets of blocks
+  long                 _Begin;  ///< Uncompressed offset of first byte to read
+  long                 _End;    ///< Uncompressed offset after last byte to read
+  char                *_Output; ///< Output buffer for bytes [_Begin, _End)
+  char                *_Status; ///< Whether block was inflated successfully
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    Bytef buffer[MaxBlockSize];
+    z_stream zs;
+    zs.zalloc = Z_NULL;
+    zs.zfree  = Z_NULL;
+    zs.opaque = Z_NULL;
+    zs.next_in  = Z_NULL;
+    zs.avail_in = 0;
+    if (inflateInit2(&zs, -15) != Z_OK) {
+      for (int b = re.begin(); b != re.end(); ++b) _Status[b] = 0;
+      return;
+    }
+    for (int b = re.begin(); b != re.end(); ++b) {
+      const long size = _Start[b+1] - _Start[b];
+      const unsigned char *in = _Input + (_Offset[b] - _Offset[0]);
+      inflateReset(&zs);
+      zs.next_in   = const_cast<Bytef *>(in + BlockHeaderSize);
+      zs.avail_in  = static_cast<uInt>(_Offset[b+1] - _Offset[b] - BlockHeaderSize - BlockFooterSize);
+      zs.next_out  = buffer;
+      zs.avail_out = static_cast<uInt>(MaxBlockSize);
+      _Status[b] = (inflate(&zs, Z_FINISH) == Z_STREAM_END && static_cast<long>(zs.total_out) == size);
+      if (_Status[b]) {
+        const long i1 = max(_Begin, _Start[b]);
+        const long i2 = min(_End,   _Start[b+1]);
+        memcpy(_Output + (i1 - _Begin), buffer + (i1 - _Start[b]), i2 - i1);
+      }
+    }
+    inflateEnd(&zs);
+  }
+};
+
+
+} // namespace CifstreamUtils
+using namespace CifstreamUtils;
+#endif // MIRTK_Common_WITH_ZLIB
+
+
 // -----------------------------------------------------------------------------
 Cifstream::Cifstream(const char *fname)
 :
   _File(NULL)
+#if MIRTK_Common_WITH_ZLIB
+  , _BlockFile(NULL)
+  , _BlockPos(-1)
+#endif
 {
 #if MIRTK_Common_BIG_ENDIAN
   _Swapped = false;
@@ -57,6 +151,20 @@ void Cifstream::Open(const char *fname)
     cerr << "Cifstream::Open: Cannot open file " << fname << endl;
     exit(1);
   }
+#if MIRTK_Common_WITH_ZLIB
+  // Keep separate file pointer to read blocks of BGZF file in parallel
+  unsigned char header[BlockHeaderSize];
+  _BlockFile = fopen(fname, "rb");
+  if (_BlockFile) {
+    if (fread(header, BlockHeaderSize, 1, _BlockFile) != 1 || BlockSize(header) == 0) {
+      fclose(_BlockFile);
+      _BlockFile = NULL;
+    }
+  }
+  _BlockOffset.clear();
+  _BlockStart .clear();
+  _BlockPos = -1;
+#endif
 }
 
 // -----------------------------------------------------------------------------
@@ -70,6 +178,12 @@ void Cifstream::Close()
 #endif
     _File = NULL;
   }
+#if MIRTK_Common_WITH_ZLIB
+  if (_BlockFile != NULL) {
+    fclose(_BlockFile);
+    _BlockFile = NULL;
+  }
+#endif
 }
 
 // -----------------------------------------------------------------------------
@@ -88,6 +202,7 @@ void Cifstream::IsSwapped(int swapped)
 long Cifstream::Tell() const
 {
 #if MIRTK_Common_WITH_ZLIB
+  if (_BlockPos != -1) return _BlockPos;
   return gztell(_File);
 #else
   return ftell(_File);
@@ -99,15 +214,91 @@ void Cifstream::Seek(long offset)
 {
 #if MIRTK_Common_WITH_ZLIB
   gzseek(_File, offset, SEEK_SET);
+  _BlockPos = -1;
 #else
   fseek(_File, offset, SEEK_SET);
 #endif
 }
 
+#if MIRTK_Common_WITH_ZLIB
+// -----------------------------------------------------------------------------
+bool Cifstream::ReadBlockIndex()
+{
+  unsigned char header[BlockHeaderSize], footer[BlockFooterSize];
+  long offset = 0, start = 0, size;
+  _BlockOffset.clear();
+  _BlockStart .clear();
+  while (fseek(_BlockFile, offset, SEEK_SET) == 0 &&
+         fread(header, BlockHeaderSize, 1, _BlockFile) == 1) {
+    size = BlockSize(header);
+    if (size < BlockHeaderSize + BlockFooterSize) break;
+    if (fseek(_BlockFile, offset + size - BlockFooterSize, SEEK_SET) != 0 ||
+        fread(footer, BlockFooterSize, 1, _BlockFile) != 1) break;
+    _BlockOffset.push_back(offset);
+    _BlockStart .push_back(start);
+    offset += size;
+    start  += GetLittleEndian(footer + 4, 4);
+  }
+  _BlockOffset.push_back(offset);
+  _BlockStart .push_back(start);
+  // Not a BGZF file or file truncated, read file sequentially instead
+  if (!feof(_BlockFile) || _BlockOffset.size() < 2) {
+    fclose(_BlockFile);
+    _BlockFile = NULL;
+    return false;
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+bool Cifstream::ReadBlocks(char *mem, long start, long num)
+{
+  // Find blocks overlapping requested data
+  const long end = start + num;
+  if (end > _BlockStart.back()) return false;
+  const int nblocks = static_cast<int>(_BlockStart.size()) - 1;
+  int b1 = static_cast<int>(upper_bound(_BlockStart.begin(), _BlockStart.end(), start) - _BlockStart.begin()) - 1;
+  int b2 = static_cast<int>(lower_bound(_BlockStart.begin(), _BlockStart.end(), end)   - _BlockStart.begin());
+  if (b1 < 0) b1 = 0;
+  if (b2 > nblocks) b2 = nblocks;
+  // Read compressed blocks
+  const long offset = _BlockOffset[b1];
+  const long size   = _BlockOffset[b2] - offset;
+  Array<unsigned char> input(size);
+  if (fseek(_BlockFile, offset, SEEK_SET) != 0 ||
+      fread(input.data(), size, 1, _BlockFile) != 1) {
+    return false;
+  }
+  // Inflate blocks in parallel
+  Array<char> status(b2 - b1, 0);
+  InflateBlocks inflate;
+  inflate._Input  = input.data();
+  inflate._Offset = _BlockOffset.data() + b1;
+  inflate._Start  = _BlockStart .data() + b1;
+  inflate._Begin  = start;
+  inflate._End    = end;
+  inflate._Output = mem;
+  inflate._Status = status.data();
+  parallel_for(blocked_range<int>(0, b2 - b1), inflate);
+  for (size_t i = 0; i < status.size(); ++i) {
+    if (!status[i]) return false;
+  }
+  _BlockPos = end;
+  return true;
+}
+#endif // MIRTK_Common_WITH_ZLIB
+
 // -----------------------------------------------------------------------------
 bool Cifstream::Read(char *mem, long start, long num)
 {
 #if MIRTK_Common_WITH_ZLIB
+  if (start == -1 && _BlockPos != -1) start = _BlockPos;
+  if (_BlockFile && num >= MinParallelReadSize) {
+    if (start == -1) start = gztell(_File);
+    if (_BlockOffset.empty()) ReadBlockIndex();
+    if (_BlockFile && ReadBlocks(mem, start, num)) return true;
+  }
+  _BlockPos = -1;
   if (start != -1) gzseek(_File, start, SEEK_SET);
   return (gzread(_File, mem, num) == num);
 #else
@@ -181,6 +372,8 @@ bool Cifstream::ReadAsString(char *data, long length, long offset)
 {
   // Read string
 #if MIRTK_Common_WITH_ZLIB
+  if (offset == -1 && _BlockPos != -1) offset = _BlockPos;
+  _BlockPos = -1;
   if (offset != -1) gzseek(_File, offset, SEEK_SET);
   if (gzgets(_File, data, length) == Z_NULL) return false;
 #else
@@ -21,6 +21,8 @@
 
 #include <mirtkCommonConfig.h>
 #include <mirtkMemory.h> // swap16, swap32
+#include <mirtkMath.h>
+#include <mirtkParallel.h>
 
 #if MIRTK_Common_WITH_ZLIB
 #  include <zlib.h>
@@ -30,12 +32,104 @@
 namespace mirtk {
 
 
+#if MIRTK_Common_WITH_ZLIB
+namespace CofstreamUtils {
+
+
+/// Maximum uncompressed size of each block
+const long BlockSize = 0xff00;
+
+/// Maximum compressed size of each block, including gzip header and footer
+const long MaxBlockSize = 0x10000;
+
+/// Size of gzip header of each block with BGZF extra subfield
+const int BlockHeaderSize = 18;
+
+/// Size of gzip footer of each block
+const int BlockFooterSize = 8;
+
+/// Maximum number of blocks compressed at once
+const int MaxBlocksPerBatch = 256;
+
+/// Empty block marking the end of a BGZF file
+const unsigned char EndOfFileBlock[28] = {
+  0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00,
+  0x42, 0x43, 0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00
+};
+
+// -----------------------------------------------------------------------------
+/// Store 16-bit/32-bit unsigned integer in little endian byte order
+inline void PutLittleEndian(unsigned char *p, unsigned long v, int nbytes)
+{
+  for (int i = 0; i < nbytes; ++i, v >>= 8) p[i] = static_cast<unsigned char>(v & 0xff);
+}
+
+// -----------------------------------------------------------------------------
+/// Deflate data into gzip member with BGZF extra subfield
+///
+/// \returns Size of compressed block or zero on error.
+long CompressBlock(unsigned char *out, const char *in, long len, int level)
+{
+  z_stream zs;
+  zs.zalloc = Z_NULL;
+  zs.zfree  = Z_NULL;
+  zs.opaque = Z_NULL;
+  if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return 0;
+  }
+  zs.next_in   = reinterpret_cast<Bytef *>(const_cast<char *>(in));
+  zs.avail_in  = static_cast<uInt>(len);
+  zs.next_out  = out + BlockHeaderSize;
+  zs.avail_out = static_cast<uInt>(MaxBlockSize - BlockHeaderSize - BlockFooterSize);
+  const int  status = deflate(&zs, Z_FINISH);
+  const long csize  = static_cast<long>(zs.total_out);
+  deflateEnd(&zs);
+  if (status != Z_STREAM_END) {
+    // Incompressible data, store block without compression instead
+    if (level != 0) return CompressBlock(out, in, len, 0);
+    return 0;
+  }
+  const long size = BlockHeaderSize + csize + BlockFooterSize;
+  memcpy(out, EndOfFileBlock, BlockHeaderSize);
+  PutLittleEndian(out + 16, static_cast<unsigned long>(size - 1), 2);
+  const uLong crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef *>(in), static_cast<uInt>(len));
+  PutLittleEndian(out + BlockHeaderSize + csize,     crc, 4);
+  PutLittleEndian(out + BlockHeaderSize + csize + 4, static_cast<unsigned long>(len), 4);
+  return size;
+}
+
+// -----------------------------------------------------------------------------
+/// Compress consecutive blocks of data in parallel
+struct CompressBlocks
+{
+  const char    *_Input;
+  long           _Length;
+  unsigned char *_Output;
+  long          *_Size;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int b = re.begin(); b != re.end(); ++b) {
+      const long offset = b * BlockSize;
+      const long len    = min(BlockSize, _Length - offset);
+      _Size[b] = CompressBlock(_Output + b * MaxBlockSize, _Input + offset, len, Z_DEFAULT_COMPRESSION);
+    }
+  }
+};
+
+
+} // namespace CofstreamUtils
+using namespace CofstreamUtils;
+#endif // MIRTK_Common_WITH_ZLIB
+
+
 // -----------------------------------------------------------------------------
 Cofstream::Cofstream(const char *fname)
 {
   _File = NULL;
 #if MIRTK_Common_WITH_ZLIB
-  _ZFile = NULL;
+  _Pos = 0;
 #endif
 #if MIRTK_Common_BIG_ENDIAN
   _Swapped = false;
@@ -62,11 +156,13 @@ void Cofstream::Open(const char *fname)
   }
   if (len > 3 && (strncmp(fname + len-3, ".gz", 3) == 0 || strncmp(fname + len-3, ".GZ", 3) == 0)) {
 #if MIRTK_Common_WITH_ZLIB
-    _ZFile = gzopen(fname, "wb");
-    if (_ZFile == NULL) {
+    _File = fopen(fname, "wb");
+    if (_File == NULL) {
       cerr << "Cofstream::Open: Cannot open file " << fname << endl;
       exit(1);
     }
+    _Buffer.clear();
+    _Pos        = 0;
     _Compressed = true;
 #else // MIRTK_Common_WITH_ZLIB
     cerr << "Cofstream::Open: Cannot write compressed file when Common module not built WITH_ZLIB" << endl;
@@ -86,9 +182,14 @@ void Cofstream::Open(const char *fname)
 void Cofstream::Close()
 {
 #if MIRTK_Common_WITH_ZLIB
-  if (_ZFile) {
-    gzclose(_ZFile);
-    _ZFile = NULL;
+  if (_File && _Compressed) {
+    // Write last incomplete block and end-of-file marker
+    if (!_Buffer.empty() && !WriteBlocks(_Buffer.data(), static_cast<long>(_Buffer.size()))) {
+      cerr << "Cofstream::Close: Failed to write compressed data" << endl;
+    }
+    fwrite(EndOfFileBlock, sizeof(EndOfFileBlock), 1, _File);
+    _Buffer.clear();
+    _Pos = 0;
   }
 #endif // MIRTK_Common_WITH_ZLIB
   if (_File) {
@@ -121,20 +222,69 @@ void Cofstream::IsSwapped(int swapped)
   _Swapped = static_cast<bool>(swapped);
 }
 
+#if MIRTK_Common_WITH_ZLIB
+// -----------------------------------------------------------------------------
+bool Cofstream::WriteBlocks(const char *data, long length)
+{
+  const int nblocks = static_cast<int>((length + BlockSize - 1) / BlockSize);
+  const int nbatch  = min(nblocks, MaxBlocksPerBatch);
+  Array<unsigned char> output(nbatch * MaxBlockSize);
+  Array<long>          size  (nbatch);
+  CompressBlocks compress;
+  compress._Output = output.data();
+  compress._Size   = size.data();
+  for (int b = 0; b < nblocks; b += nbatch) {
+    const int n = min(nbatch, nblocks - b);
+    compress._Input  = data + b * BlockSize;
+    compress._Length = min(static_cast<long>(n) * BlockSize, length - b * BlockSize);
+    parallel_for(blocked_range<int>(0, n), compress);
+    for (int i = 0; i < n; ++i) {
+      if (size[i] == 0 || fwrite(output.data() + i * MaxBlockSize, size[i], 1, _File) != 1) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+#endif // MIRTK_Common_WITH_ZLIB
+
 // -----------------------------------------------------------------------------
 bool Cofstream::Write(const char *data, long offset, long length)
 {
 #if MIRTK_Common_WITH_ZLIB
   if (_Compressed) {
     if (offset != -1) {
-      if (gztell(_ZFile) > offset) {
+      if (_Pos > offset) {
         cerr << "Error: Writing compressed files only supports forward seek (pos="
-                  << gztell(_ZFile) << ", offset=" << offset << ")" << endl;
+                  << _Pos << ", offset=" << offset << ")" << endl;
         exit(1);
       }
-      gzseek(_ZFile, offset, SEEK_SET);
+      _Buffer.resize(_Buffer.size() + (offset - _Pos), '\0');
+      _Pos = offset;
+    }
+    _Pos += length;
+    // Complete previously buffered block
+    if (!_Buffer.empty()) {
+      const long n = min(length, BlockSize - static_cast<long>(_Buffer.size()));
+      if (n > 0) {
+        _Buffer.insert(_Buffer.end(), data, data + n);
+        data += n, length -= n;
+      }
+      if (static_cast<long>(_Buffer.size()) < BlockSize) return true;
+      // Buffer may exceed block size after a forward seek
+      const long m = (static_cast<long>(_Buffer.size()) / BlockSize) * BlockSize;
+      if (!WriteBlocks(_Buffer.data(), m)) return false;
+      _Buffer.erase(_Buffer.begin(), _Buffer.begin() + m);
+      if (!_Buffer.empty()) {
+        _Buffer.insert(_Buffer.end(), data, data + length);
+        return true;
+      }
     }
-    return (gzwrite(_ZFile, data, length) == length);
+    // Compress complete blocks and buffer remaining data
+    const long m = (length / BlockSize) * BlockSize;
+    if (m > 0 && !WriteBlocks(data, m)) return false;
+    _Buffer.assign(data + m, data + length);
+    return true;
   }
 #endif // MIRTK_Common_WITH_ZLIB
   if (offset != -1) fseek(_File, offset, SEEK_SET);
@@ -266,8 +416,8 @@ bool Cofstream::WriteAsString(const char *data, long offset)
 {
 #if MIRTK_Common_WITH_ZLIB
   if (_Compressed) {
-    if (offset != -1) gzseek(_ZFile, offset, SEEK_SET);
-    return (gzputs(_ZFile, data) > 0);
+    const long length = static_cast<long>(strlen(data));
+    return length > 0 && Write(data, offset, length);
   }
 #endif // MIRTK_Common_WITH_ZLIB
   if (offset != -1) fseek(_File, offset, SEEK_SET);
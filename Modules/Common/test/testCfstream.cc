@@ -0,0 +1,261 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mirtkCfstream.h>
+#include <mirtkArray.h>
+#include <mirtkMath.h>
+
+#include <zlib.h>
+#include <cstdio>
+#include <random>
+
+using namespace mirtk;
+
+
+// ===========================================================================
+// Helper
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Uncompressed size of BGZF blocks written by Cofstream
+static const long block_size = 0xff00;
+
+// ---------------------------------------------------------------------------
+/// Name of temporary test file
+static const char *fname = "testCfstream.gz";
+
+// ---------------------------------------------------------------------------
+/// Test data whose first half compresses well, while the second half is
+/// random and thus stored in blocks without compression
+Array<char> test_data(long n)
+{
+  Array<char> data(n);
+  std::mt19937 gen(static_cast<unsigned int>(n));
+  std::uniform_int_distribution<int> dist(0, 255);
+  for (long i = 0; i < n; ++i) {
+    if (i < n / 2) data[i] = static_cast<char>((i / 7) % 13 + 'a');
+    else           data[i] = static_cast<char>(dist(gen));
+  }
+  return data;
+}
+
+// ---------------------------------------------------------------------------
+/// Write data as compressed file in chunks of the given size
+void write_file(const Array<char> &data, long chunk)
+{
+  Cofstream to(fname);
+  ASSERT_TRUE(to.Compressed());
+  const long n = static_cast<long>(data.size());
+  for (long i = 0; i < n; i += chunk) {
+    ASSERT_TRUE(to.WriteAsChar(data.data() + i, min(chunk, n - i)));
+  }
+  to.Close();
+}
+
+// ---------------------------------------------------------------------------
+/// Read compressed file sequentially using zlib
+Array<char> read_with_zlib()
+{
+  Array<char> data;
+  gzFile file = gzopen(fname, "rb");
+  if (file == NULL) return data;
+  char buffer[4096];
+  int n;
+  while ((n = gzread(file, buffer, sizeof(buffer))) > 0) {
+    data.insert(data.end(), buffer, buffer + n);
+  }
+  gzclose(file);
+  return data;
+}
+
+// ---------------------------------------------------------------------------
+/// Expect uncompressed data to match
+void expect_equal_data(const Array<char> &a, const char *b, long offset, long n)
+{
+  long mismatch = -1;
+  for (long i = 0; i < n; ++i) {
+    if (a[offset + i] != b[i]) {
+      mismatch = offset + i;
+      break;
+    }
+  }
+  EXPECT_EQ(-1, mismatch) << "first mismatch at byte " << mismatch;
+}
+
+// ---------------------------------------------------------------------------
+/// Write data, read it back with zlib and Cifstream, and compare
+void test_round_trip(long n, long chunk)
+{
+  SCOPED_TRACE(string("size=") + ToString(n) + ", chunk=" + ToString(chunk));
+  const Array<char> data = test_data(n);
+  write_file(data, chunk);
+
+  // Valid multi-member gzip file
+  const Array<char> inflated = read_with_zlib();
+  ASSERT_EQ(data.size(), inflated.size());
+  expect_equal_data(data, inflated.data(), 0, n);
+
+  // Read all at once, i.e., inflate blocks in parallel
+  Array<char> buffer(n + 1, '\0');
+  {
+    Cifstream from(fname);
+    ASSERT_TRUE(from.ReadAsChar(buffer.data(), n));
+    expect_equal_data(data, buffer.data(), 0, n);
+    EXPECT_FALSE(from.ReadAsChar(buffer.data(), 1));
+  }
+
+  // Read sequentially in chunks not aligned with blocks
+  {
+    Cifstream from(fname);
+    const long m = 3 * block_size / 2 + 17;
+    for (long i = 0; i < n; i += m) {
+      const long len = min(m, n - i);
+      ASSERT_TRUE(from.ReadAsChar(buffer.data(), len));
+      expect_equal_data(data, buffer.data(), i, len);
+    }
+  }
+
+  // Read at offsets across block boundaries, backwards and forwards
+  {
+    Cifstream from(fname);
+    for (long b = n / block_size; b > 0; --b) {
+      const long offset = b * block_size - 5;
+      const long len    = min(3 * block_size, n - offset);
+      ASSERT_TRUE(from.ReadAsChar(buffer.data(), len, offset));
+      expect_equal_data(data, buffer.data(), offset, len);
+      ASSERT_TRUE(from.ReadAsChar(buffer.data(), min(10L, len), offset));
+      expect_equal_data(data, buffer.data(), offset, min(10L, len));
+    }
+  }
+
+  remove(fname);
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(Cfstream, BlockHeaderAndEndOfFile)
+{
+  const Array<char> data = test_data(3 * block_size);
+  write_file(data, static_cast<long>(data.size()));
+  FILE *fp = fopen(fname, "rb");
+  ASSERT_TRUE(fp != NULL);
+  unsigned char header[18], eof[28];
+  ASSERT_EQ(1u, fread(header, sizeof(header), 1, fp));
+  ASSERT_EQ(0, fseek(fp, -static_cast<long>(sizeof(eof)), SEEK_END));
+  ASSERT_EQ(1u, fread(eof, sizeof(eof), 1, fp));
+  fclose(fp);
+  remove(fname);
+  // gzip member with BGZF extra subfield "BC" of size 2
+  EXPECT_EQ(0x1f, header[0]);
+  EXPECT_EQ(0x8b, header[1]);
+  EXPECT_EQ(0x04, header[3] & 0x04);
+  EXPECT_EQ('B',  header[12]);
+  EXPECT_EQ('C',  header[13]);
+  EXPECT_EQ(2,    header[14]);
+  // Empty BGZF block at end of file
+  EXPECT_EQ(0x1f, eof[0]);
+  EXPECT_EQ(0x1b, eof[16]);
+  for (int i = 20; i < 28; ++i) EXPECT_EQ(0, eof[i]);
+}
+
+// ---------------------------------------------------------------------------
+TEST(Cfstream, RoundTripSmall)
+{
+  test_round_trip(1, 1);
+  test_round_trip(1000, 1000);
+  test_round_trip(1000, 7);
+}
+
+// ---------------------------------------------------------------------------
+TEST(Cfstream, RoundTripBlockBoundaries)
+{
+  for (long n = block_size - 1; n <= block_size + 1; ++n) {
+    test_round_trip(n, n);
+  }
+  test_round_trip(2 * block_size, block_size);
+  test_round_trip(5 * block_size + 123, 5 * block_size + 123);
+  test_round_trip(5 * block_size + 123, 1000);
+  test_round_trip(5 * block_size + 123, block_size + 1);
+}
+
+// ---------------------------------------------------------------------------
+TEST(Cfstream, RoundTripMultipleBatches)
+{
+  // More blocks than compressed at once by Cofstream
+  test_round_trip(300 * block_size + 1, 300 * block_size + 1);
+}
+
+// ---------------------------------------------------------------------------
+TEST(Cfstream, ForwardSeek)
+{
+  const long n = 4 * block_size;
+  Array<char> data = test_data(n);
+  {
+    Cofstream to(fname);
+    ASSERT_TRUE(to.WriteAsChar(data.data(), 100));
+    ASSERT_TRUE(to.WriteAsChar(data.data() + 2 * block_size + 10, n - 2 * block_size - 10, 2 * block_size + 10));
+  }
+  for (long i = 100; i < 2 * block_size + 10; ++i) data[i] = '\0';
+  const Array<char> inflated = read_with_zlib();
+  ASSERT_EQ(data.size(), inflated.size());
+  expect_equal_data(data, inflated.data(), 0, n);
+  Array<char> buffer(n);
+  Cifstream from(fname);
+  ASSERT_TRUE(from.ReadAsChar(buffer.data(), n));
+  expect_equal_data(data, buffer.data(), 0, n);
+  from.Close();
+  remove(fname);
+}
+
+// ---------------------------------------------------------------------------
+TEST(Cfstream, SwappedFloats)
+{
+  const long n = 3 * block_size / sizeof(float) + 11;
+  Array<float> data(n), buffer(n);
+  for (long i = 0; i < n; ++i) data[i] = .5f * static_cast<float>(i) - 1000.0f;
+  {
+    Cofstream to(fname);
+    to.Swapped(true);
+    ASSERT_TRUE(to.WriteAsFloat(data.data(), n));
+  }
+  Cifstream from(fname);
+  from.Swapped(true);
+  ASSERT_TRUE(from.ReadAsFloat(buffer.data(), n));
+  from.Close();
+  remove(fname);
+  for (long i = 0; i < n; ++i) {
+    ASSERT_EQ(data[i], buffer[i]) << "at index " << i;
+  }
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
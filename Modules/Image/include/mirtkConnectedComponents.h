@@ -44,6 +44,11 @@ enum ConnectedComponentsOrdering
  *
  * The components are sorted by decreasing size, i.e., the first
  * component is the largest connected component.
+ *
+ * The voxels are labeled using a two-pass union-find algorithm. Slabs of
+ * consecutive image slices are labeled in parallel, and the equivalent labels
+ * at the slab boundaries are merged afterwards. The frames of a 4D image
+ * are labeled independently of each other.
  */
 template <class VoxelType>
 class ConnectedComponents : public ImageToImage<VoxelType>
@@ -61,9 +66,6 @@ protected:
   /// What connectivity to assume when running the filter.
   mirtkPublicAttributeMacro(ConnectivityType, Connectivity);
 
-  /// List of voxel offsets of the neighborhood
-  mirtkAttributeMacro(NeighborhoodOffsets, Offsets);
-
   /// Number of connected components
   mirtkReadOnlyAttributeMacro(int, NumberOfComponents);
 
@@ -24,6 +24,8 @@
 #include <mirtkVoxelFunction.h>
 #include <mirtkBaseImage.h>
 #include <mirtkGenericImage.h>
+#include <mirtkParallel.h>
+#include <mirtkMemory.h>
 
 
 namespace mirtk {
@@ -1140,6 +1142,248 @@ struct DownsampleConvolvedExtendedForegroundInZ : public ConvolveExtendedForegro
 };
 
 
+// =============================================================================
+// Convolve blocks of consecutive image rows with 1D kernel
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Convolve image row with kernel along y, z, or t with truncation of kernel at boundary
+///
+/// Equivalent to ConvolveInY, ConvolveInZ, and ConvolveInT, respectively,
+/// but applies each kernel tap to an entire image row (i.e., a contiguous
+/// block of memory) instead of striding through memory for each voxel.
+template <class TKernel = double>
+struct ConvolveRow
+{
+  const TKernel *_Kernel;    ///< Convolution kernel
+  int            _Radius;    ///< Radius of kernel
+  bool           _Normalize; ///< Wether to divide by sum of kernel weights
+
+  ConvolveRow(const TKernel *kernel, int size, bool norm = true)
+  :
+    _Kernel(kernel), _Radius((size - 1) / 2), _Normalize(norm)
+  {}
+
+  /// Convolve image row
+  ///
+  /// \param[in]  in  Center input row.
+  /// \param[in]  c   Index of center input row along convolved dimension.
+  /// \param[in]  n   Number of input rows along convolved dimension.
+  /// \param[in]  s   Offset between adjacent input rows along convolved dimension.
+  /// \param[out] out Output row.
+  /// \param[in]  nx  Number of voxels in row.
+  /// \param[in]  buf Buffer of size 4 * nx.
+  template <class T1, class T2>
+  void operator ()(const T1 *in, int c, int n, int s, T2 *out, int nx, double *buf) const
+  {
+    double *acc = buf, sum = .0;
+    for (int x = 0; x < nx; ++x) acc[x] = .0;
+    const int d1 = min(_Radius, n - 1 - c);
+    for (int d = max(-_Radius, -c); d <= d1; ++d) {
+      const T1     *row = in + d * s;
+      const double  w   = static_cast<double>(_Kernel[_Radius - d]);
+      for (int x = 0; x < nx; ++x) acc[x] += w * static_cast<double>(row[x]);
+      sum += w;
+    }
+    if (_Normalize && sum != .0) {
+      for (int x = 0; x < nx; ++x) out[x] = static_cast<T2>(acc[x] / sum);
+    } else {
+      for (int x = 0; x < nx; ++x) out[x] = static_cast<T2>(acc[x]);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Convolve image row with kernel along y, z, or t with truncation of kernel at foreground boundary
+///
+/// Equivalent to ConvolveTruncatedForegroundInY, ConvolveTruncatedForegroundInZ,
+/// and ConvolveTruncatedForegroundInT, respectively, but applies each kernel
+/// tap to an entire image row.
+template <class TKernel = double>
+struct ConvolveTruncatedForegroundRow
+{
+  const TKernel *_Kernel;     ///< Convolution kernel
+  int            _Radius;     ///< Radius of kernel
+  bool           _Normalize;  ///< Whether to normalize by sum of overlapping kernel weights
+  double         _Background; ///< Background value (padding)
+
+  ConvolveTruncatedForegroundRow(double bg, const TKernel *kernel, int size, bool norm = true)
+  :
+    _Kernel(kernel), _Radius((size - 1) / 2), _Normalize(norm), _Background(bg)
+  {}
+
+  /// Apply kernel to neighboring rows in one direction until boundary/background is reached
+  template <class T>
+  void ConvolveNeighbors(const T *in, int c, int n, int s, int dir,
+                         double *acc, double *sum, const double *fg, double *active, int nx) const
+  {
+    for (int x = 0; x < nx; ++x) active[x] = fg[x];
+    for (int d = 1; d <= _Radius; ++d) {
+      const int i = c + dir * d;
+      if (i < 0 || i >= n) break;
+      const T      *row = in + dir * d * s;
+      const double  w   = static_cast<double>(_Kernel[_Radius - dir * d]);
+      for (int x = 0; x < nx; ++x) {
+        if (active[x] != .0) {
+          if (row[x] == _Background) {
+            active[x] = .0;
+          } else {
+            acc[x] += w * static_cast<double>(row[x]);
+            sum[x] += w;
+          }
+        }
+      }
+    }
+  }
+
+  /// Convolve image row, see ConvolveRow::operator()
+  template <class T1, class T2>
+  void operator ()(const T1 *in, int c, int n, int s, T2 *out, int nx, double *buf) const
+  {
+    double *acc = buf, *sum = buf + nx, *fg = buf + 2 * nx, *active = buf + 3 * nx;
+    const double w = static_cast<double>(_Kernel[_Radius]);
+    for (int x = 0; x < nx; ++x) {
+      if (in[x] == _Background) {
+        acc[x] = _Background, sum[x] = .0, fg[x] = .0;
+      } else {
+        acc[x] = w * static_cast<double>(in[x]), sum[x] = w, fg[x] = 1.0;
+      }
+    }
+    ConvolveNeighbors(in, c, n, s, -1, acc, sum, fg, active, nx);
+    ConvolveNeighbors(in, c, n, s, +1, acc, sum, fg, active, nx);
+    for (int x = 0; x < nx; ++x) {
+      if (_Normalize && sum[x] != .0) acc[x] /= sum[x];
+      out[x] = static_cast<T2>(acc[x]);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Convolve image row with kernel along y, z, or t with extension of foreground into background
+///
+/// Equivalent to ConvolveExtendedForegroundInY, ConvolveExtendedForegroundInZ,
+/// and ConvolveExtendedForegroundInT, respectively, but applies each kernel
+/// tap to an entire image row.
+template <class TKernel = double>
+struct ConvolveExtendedForegroundRow
+{
+  const TKernel *_Kernel;     ///< Convolution kernel
+  int            _Radius;     ///< Radius of kernel
+  double         _Norm;       ///< Normalization factor
+  double         _Background; ///< Background value (padding)
+
+  ConvolveExtendedForegroundRow(double bg, const TKernel *kernel, int size, double norm = 1.0)
+  :
+    _Kernel(kernel), _Radius((size - 1) / 2), _Norm(norm), _Background(bg)
+  {}
+
+  /// Apply kernel to neighboring rows in one direction, repeating the last
+  /// foreground value once the boundary/background is reached
+  template <class T>
+  void ConvolveNeighbors(const T *in, int c, int n, int s, int dir,
+                         double *acc, const double *fg, double *pos, double *stop, int nx) const
+  {
+    for (int x = 0; x < nx; ++x) pos[x] = .0, stop[x] = .0;
+    for (int d = 1; d <= _Radius; ++d) {
+      const double w = static_cast<double>(_Kernel[_Radius - dir * d]);
+      for (int x = 0; x < nx; ++x) {
+        if (fg[x] == .0) continue;
+        if (stop[x] == .0) {
+          const int i = c + static_cast<int>(pos[x]) + dir;
+          if (i < 0 || i >= n || in[(i - c) * s + x] == _Background) stop[x] = 1.0;
+          else pos[x] += dir;
+        }
+        acc[x] += static_cast<double>(in[static_cast<int>(pos[x]) * s + x]) * w;
+      }
+    }
+  }
+
+  /// Convolve image row, see ConvolveRow::operator()
+  template <class T1, class T2>
+  void operator ()(const T1 *in, int c, int n, int s, T2 *out, int nx, double *buf) const
+  {
+    double *acc = buf, *fg = buf + nx, *pos = buf + 2 * nx, *stop = buf + 3 * nx;
+    for (int x = 0; x < nx; ++x) {
+      if (in[x] == _Background) {
+        acc[x] = _Background / _Norm, fg[x] = .0;
+      } else {
+        acc[x] = in[x] * _Kernel[_Radius], fg[x] = 1.0;
+      }
+    }
+    ConvolveNeighbors(in, c, n, s, -1, acc, fg, pos, stop, nx);
+    ConvolveNeighbors(in, c, n, s, +1, acc, fg, pos, stop, nx);
+    for (int x = 0; x < nx; ++x) out[x] = static_cast<T2>(_Norm * acc[x]);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Parallel body of ConvolveRows
+template <class TIn, class TOut, class TRowFunction>
+struct ConvolveRowsBody
+{
+  const TIn    *_Input;    ///< Input image data
+  TOut         *_Output;   ///< Output image data
+  TRowFunction  _Function; ///< Row convolution function
+  int           _X;        ///< Number of voxels in image row
+  int           _Inner;    ///< Number of rows between adjacent rows along convolved dimension
+  int           _N;        ///< Number of input rows along convolved dimension
+  int           _M;        ///< Number of output rows along convolved dimension
+  int           _Offset;   ///< Index of input row corresponding to first output row
+  int           _Factor;   ///< Downsampling factor
+
+  ConvolveRowsBody(const TRowFunction &f) : _Function(f) {}
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int s   = _Inner * _X;
+    double   *buf = Allocate<double>(4 * _X);
+    for (int r = re.begin(); r != re.end(); ++r) {
+      const int i = r % _Inner;
+      const int j = (r / _Inner) % _M;
+      const int k = (r / _Inner) / _M;
+      const int c = _Offset + j * _Factor;
+      _Function(_Input  + (k * _N + c) * s + i * _X, c, _N, s,
+                _Output + (k * _M + j) * s + i * _X, _X, buf);
+    }
+    Deallocate(buf);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Convolve image along y (dim=1), z (dim=2), or t (dim=3) one row at a time
+///
+/// Blocks of consecutive output rows are processed in parallel. For each
+/// output row, the row convolution function is applied to the input rows
+/// within the kernel support, all of which are contiguous in memory. Unlike
+/// the convolution voxel functions, all frames/channels are processed.
+///
+/// \param[in]  input  Input image.
+/// \param[out] output Output image. Must have the same size as the input image
+///                    except for the convolved dimension when downsampling.
+/// \param[in]  dim    Convolved image dimension.
+/// \param[in]  f      Row convolution function, e.g., ConvolveRow.
+/// \param[in]  m      Downsampling factor.
+/// \param[in]  offset Index of input row corresponding to first output row.
+template <class TIn, class TOut, class TRowFunction>
+void ConvolveRows(const GenericImage<TIn> *input, GenericImage<TOut> *output,
+                  int dim, const TRowFunction &f, int m = 1, int offset = 0)
+{
+  const int size[4] = {input->X(), input->Y(), input->Z(), input->T()};
+  ConvolveRowsBody<TIn, TOut, TRowFunction> body(f);
+  body._Input  = input ->Data();
+  body._Output = output->Data();
+  body._X      = size[0];
+  body._Inner  = 1;
+  for (int d = 1; d < dim; ++d) body._Inner *= size[d];
+  body._N      = size[dim];
+  body._M      = (m == 1 ? size[dim] : size[dim] / m);
+  body._Offset = offset;
+  body._Factor = m;
+  const int nrows = output->NumberOfVoxels() / body._X;
+  if (nrows > 0) parallel_for(blocked_range<int>(0, nrows), body);
+}
+
+
 } } // namespace mirtk::VoxelConvolution
 
 #endif // MIRTK_ConvolutionFunction_H
@@ -28,9 +28,26 @@
 namespace mirtk { namespace data { namespace op {
 
 
+// -----------------------------------------------------------------------------
+/// Base class of data operations which transform each data value independently
+///
+/// The processing of the data is split into an initialization step and the
+/// processing of blocks of data, such that a sequence of element-wise operations
+/// can be applied to each block in turn (cf. ElementWiseOpChain).
+class ElementWiseOp : public Op
+{
+public:
+
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int n, double *data, bool *mask = NULL) = 0;
+
+  /// Process range of initialized data
+  virtual void operator()(const blocked_range<int> &) const = 0;
+};
+
 // -----------------------------------------------------------------------------
 /// Set value of unmasked data points
-class SetInsideValue : public Op
+class SetInsideValue : public ElementWiseOp
 {
 private:
 
@@ -58,18 +75,24 @@ public:
     }
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int n, double *data, bool *mask = NULL)
   {
     _Data = data;
     _Mask = mask;
+  }
+
+  /// Process given data (not thread-safe!)
+  virtual void Process(int n, double *data, bool *mask = NULL)
+  {
+    Initialize(n, data, mask);
     parallel_for(blocked_range<int>(0, n), *this);
   }
 };
 
 // -----------------------------------------------------------------------------
 /// Set value of masked data points
-class SetOutsideValue : public Op
+class SetOutsideValue : public ElementWiseOp
 {
 private:
 
@@ -84,6 +107,7 @@ public:
   // Called by TBB's parallel_for, for internal use only!
   void operator()(const blocked_range<int> &re) const
   {
+    if (!_Mask) return;
     double *data = _Data + re.begin();
     bool   *mask = _Mask + re.begin();
     for (int i = re.begin(); i != re.end(); ++i, ++data, ++mask) {
@@ -91,12 +115,18 @@ public:
     }
   }
 
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int n, double *data, bool *mask = NULL)
+  {
+    _Data = data;
+    _Mask = mask;
+  }
+
   /// Process given data (not thread-safe!)
   virtual void Process(int n, double *data, bool *mask = NULL)
   {
     if (mask) {
-      _Data = data;
-      _Mask = mask;
+      Initialize(n, data, mask);
       parallel_for(blocked_range<int>(0, n), *this);
     }
   }
@@ -104,7 +134,7 @@ public:
 
 // -----------------------------------------------------------------------------
 /// Base class of element-wise data transformations
-class ElementWiseUnaryOp : public Op
+class ElementWiseUnaryOp : public ElementWiseOp
 {
 private:
 
@@ -133,11 +163,17 @@ public:
   /// Transform data value and/or mask it by setting mask = false
   virtual double Op(double value, bool &) const = 0;
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int n, double *data, bool *mask = NULL)
   {
     _Data = data;
     _Mask = mask;
+  }
+
+  /// Process given data (not thread-safe!)
+  virtual void Process(int n, double *data, bool *mask = NULL)
+  {
+    Initialize(n, data, mask);
     // MUST be called in the base class which defines Op!
     //parallel_for(blocked_range<int>(0, n), *this);
   }
@@ -145,7 +181,7 @@ public:
 
 // -----------------------------------------------------------------------------
 /// Base class of element-wise data transformations
-class ElementWiseBinaryOp : public Op
+class ElementWiseBinaryOp : public ElementWiseOp
 {
   /// Constant value to add
   mirtkPublicAttributeMacro(double, Constant);
@@ -208,8 +244,8 @@ public:
   /// Transform data value and/or mask it by setting mask = false
   virtual double Op(double value, double, bool &) const = 0;
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int n, double *data, bool *mask = NULL)
   {
     _Data     = data;
     _Mask     = mask;
@@ -220,6 +256,12 @@ public:
         exit(1);
       }
     }
+  }
+
+  /// Process given data (not thread-safe!)
+  virtual void Process(int n, double *data, bool *mask = NULL)
+  {
+    Initialize(n, data, mask);
     // MUST be called in the base class which defines Op!
     //parallel_for(blocked_range<int>(0, n), *this);
   }
@@ -831,6 +873,116 @@ public:
 };
 
 
+// -----------------------------------------------------------------------------
+/// Fused single pass evaluation of a sequence of data operations
+///
+/// Instead of processing the entire data sequence by each operation in turn,
+/// all operations are applied to one block of data after the other while the
+/// block resides in the cache. Besides element-wise data operations, the chain
+/// may contain statistics which can be evaluated from the running moments of
+/// the data (cf. statistic::Statistic::IsSinglePass). These are computed as
+/// parallel reduction in the same pass over the data.
+class ElementWiseOpChain : public Op
+{
+  /// Number of data values processed by each operation in turn
+  mirtkPublicAttributeMacro(int, BlockSize);
+
+private:
+
+  Array<Op *>                      _Ops;     ///< Chained operations (not owned)
+  Array<ElementWiseOp *>           _Funcs;   ///< Element-wise operations or NULL
+  Array<statistic::RunningMoments> _Moments; ///< Running moments of statistics
+  double                          *_Data;
+  bool                            *_Mask;
+
+public:
+
+  /// Constructor
+  ElementWiseOpChain(int block_size = 4096)
+  :
+    _BlockSize(block_size), _Data(NULL), _Mask(NULL)
+  {}
+
+  /// Split constructor used by TBB's parallel_reduce, for internal use only!
+  ElementWiseOpChain(const ElementWiseOpChain &other, split)
+  :
+    _BlockSize(other._BlockSize),
+    _Ops(other._Ops),
+    _Funcs(other._Funcs),
+    _Moments(other._Ops.size()),
+    _Data(other._Data),
+    _Mask(other._Mask)
+  {}
+
+  /// Join results of parallel_reduce, for internal use only!
+  void join(const ElementWiseOpChain &other)
+  {
+    for (size_t k = 0; k < _Moments.size(); ++k) _Moments[k].Join(other._Moments[k]);
+  }
+
+  /// Whether given operation can be part of a fused chain of operations
+  static bool IsFusable(const Op *op)
+  {
+    if (dynamic_cast<const ElementWiseOp *>(op)) return true;
+    const statistic::Statistic *stat = dynamic_cast<const statistic::Statistic *>(op);
+    return stat && stat->IsSinglePass();
+  }
+
+  /// Append operation to chain
+  ///
+  /// \param[in] op Element-wise data operation or single pass statistic.
+  ///                The operation is not owned by the chain.
+  void Push(Op *op)
+  {
+    if (!IsFusable(op)) {
+      cerr << "ElementWiseOpChain::Push: Operation cannot be fused with other operations" << endl;
+      exit(1);
+    }
+    _Ops  .push_back(op);
+    _Funcs.push_back(dynamic_cast<ElementWiseOp *>(op));
+  }
+
+  /// Number of chained operations
+  int NumberOfOps() const
+  {
+    return static_cast<int>(_Ops.size());
+  }
+
+  // Called by TBB's parallel_reduce, for internal use only!
+  void operator()(const blocked_range<int> &re)
+  {
+    for (int i = re.begin(); i < re.end(); i += _BlockSize) {
+      const blocked_range<int> block(i, min(i + _BlockSize, re.end()));
+      for (size_t k = 0; k < _Ops.size(); ++k) {
+        if (_Funcs[k]) {
+          (*_Funcs[k])(block);
+        } else {
+          _Moments[k].Add(block.end() - block.begin(), _Data + block.begin(),
+                          _Mask ? _Mask + block.begin() : NULL);
+        }
+      }
+    }
+  }
+
+  /// Process given data (not thread-safe!)
+  virtual void Process(int n, double *data, bool *mask = NULL)
+  {
+    _Data = data;
+    _Mask = mask;
+    _Moments.clear();
+    _Moments.resize(_Ops.size());
+    for (size_t k = 0; k < _Ops.size(); ++k) {
+      if (_Funcs[k]) _Funcs[k]->Initialize(n, data, mask);
+    }
+    parallel_reduce(blocked_range<int>(0, n, _BlockSize), *this);
+    for (size_t k = 0; k < _Ops.size(); ++k) {
+      statistic::Statistic *stat = dynamic_cast<statistic::Statistic *>(_Ops[k]);
+      if (stat) stat->EvaluateMoments(_Moments[k]);
+    }
+  }
+};
+
+
 } } } // namespace mirtk::data::op
 
 #endif // MIRTK_DataFunctions_H
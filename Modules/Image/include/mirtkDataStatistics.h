@@ -26,12 +26,119 @@
 #include <mirtkString.h>
 #include <mirtkStream.h>
 #include <mirtkArray.h>
-#include <mirtkAlgorithm.h> // partial_sort
+#include <mirtkAlgorithm.h> // nth_element
+#include <mirtkParallel.h>
 
 
 namespace mirtk { namespace data { namespace statistic {
 
 
+// -----------------------------------------------------------------------------
+/// Running moments and extrema of a data sequence
+///
+/// Accumulates the number of unmasked data values, their extrema, mean and
+/// sum of squared deviations from the mean, from which simple statistics such
+/// as the mean, variance, and range of the data can be evaluated after a single
+/// pass over the data. The moments of blocks of data are accumulated in two
+/// passes over the block, first the sum and extrema, then the squared deviations,
+/// which allows the compiler to vectorize the inner loops. The moments of data
+/// blocks are merged using the pairwise update formula of Chan et al. (1979),
+/// which makes RunningMoments suitable for parallel reductions.
+struct RunningMoments
+{
+  int    _Count;  ///< Number of (unmasked) data values
+  double _Min;    ///< Minimum value
+  double _Max;    ///< Maximum value
+  double _MinAbs; ///< Minimum absolute value
+  double _MaxAbs; ///< Maximum absolute value
+  double _Mean;   ///< Mean value
+  double _M2;     ///< Sum of squared deviations from mean
+
+  /// Constructor
+  RunningMoments()
+  :
+    _Count(0),
+    _Min   (+numeric_limits<double>::infinity()),
+    _Max   (-numeric_limits<double>::infinity()),
+    _MinAbs(+numeric_limits<double>::infinity()),
+    _MaxAbs(.0),
+    _Mean(.0), _M2(.0)
+  {}
+
+  /// Merge moments of another disjoint set of data values
+  void Join(const RunningMoments &other)
+  {
+    if (other._Count == 0) return;
+    if (_Count == 0) {
+      *this = other;
+      return;
+    }
+    const double n     = static_cast<double>(_Count + other._Count);
+    const double delta = other._Mean - _Mean;
+    _Mean  += delta * other._Count / n;
+    _M2    += other._M2 + delta * delta * _Count * (other._Count / n);
+    _Count += other._Count;
+    if (other._Min    < _Min   ) _Min    = other._Min;
+    if (other._Max    > _Max   ) _Max    = other._Max;
+    if (other._MinAbs < _MinAbs) _MinAbs = other._MinAbs;
+    if (other._MaxAbs > _MaxAbs) _MaxAbs = other._MaxAbs;
+  }
+
+  /// Add block of data values
+  void Add(int n, const double *data, const bool *mask = NULL)
+  {
+    RunningMoments block;
+    double sum = .0, d;
+    if (mask) {
+      for (int i = 0; i < n; ++i) {
+        if (mask[i]) {
+          d = data[i];
+          sum += d;
+          block._Count += 1;
+          block._Min    = min(block._Min,    d);
+          block._Max    = max(block._Max,    d);
+          block._MinAbs = min(block._MinAbs, abs(d));
+          block._MaxAbs = max(block._MaxAbs, abs(d));
+        }
+      }
+    } else {
+      for (int i = 0; i < n; ++i) {
+        d = data[i];
+        sum += d;
+        block._Min    = min(block._Min,    d);
+        block._Max    = max(block._Max,    d);
+        block._MinAbs = min(block._MinAbs, abs(d));
+        block._MaxAbs = max(block._MaxAbs, abs(d));
+      }
+      block._Count = n;
+    }
+    if (block._Count == 0) return;
+    block._Mean = sum / block._Count;
+    if (mask) {
+      for (int i = 0; i < n; ++i) {
+        if (mask[i]) {
+          d = data[i] - block._Mean;
+          block._M2 += d * d;
+        }
+      }
+    } else {
+      for (int i = 0; i < n; ++i) {
+        d = data[i] - block._Mean;
+        block._M2 += d * d;
+      }
+    }
+    Join(block);
+  }
+
+  /// Sample variance
+  double Var() const
+  {
+    if (_Count < 1) return numeric_limits<double>::quiet_NaN();
+    if (_Count < 2) return .0;
+    return _M2 / (_Count - 1);
+  }
+};
+
 // -----------------------------------------------------------------------------
 /// Base class of all data statistics
 class Statistic : public Op
@@ -105,6 +212,22 @@ public:
   /// Evaluate statistic for given data
   virtual void Evaluate(int, const double *, const bool * = NULL) = 0;
 
+  /// Whether statistic can be evaluated from the RunningMoments of the data
+  ///
+  /// Such statistics can be computed in a single pass over the data,
+  /// fused with element-wise data operations (cf. op::ElementWiseOpChain).
+  virtual bool IsSinglePass() const
+  {
+    return false;
+  }
+
+  /// Evaluate statistic from running moments of the data
+  virtual void EvaluateMoments(const RunningMoments &)
+  {
+    cerr << "Data statistic \"" << _Description << "\" cannot be evaluated in a single pass" << endl;
+    exit(1);
+  }
+
   /// Print column names of statistic values to output stream
   virtual void PrintHeader(ostream &os = cout, const char *delimiter = ",") const
   {
@@ -185,6 +308,16 @@ public:
     Value(Calculate(n, data, mask));
   }
 
+  bool IsSinglePass() const
+  {
+    return true;
+  }
+
+  void EvaluateMoments(const RunningMoments &m)
+  {
+    Value(m._Count > 0 ? m._Min : numeric_limits<double>::quiet_NaN());
+  }
+
   // Add support for vtkDataArray argument
   mirtkCalculateVtkDataArray1();
 };
@@ -225,6 +358,16 @@ public:
     Value(Calculate(n, data, mask));
   }
 
+  bool IsSinglePass() const
+  {
+    return true;
+  }
+
+  void EvaluateMoments(const RunningMoments &m)
+  {
+    Value(m._Count > 0 ? m._MinAbs : numeric_limits<double>::quiet_NaN());
+  }
+
   // Add support for vtkDataArray argument
   mirtkCalculateVtkDataArray1();
 };
@@ -265,6 +408,16 @@ public:
     Value(Calculate(n, data, mask));
   }
 
+  bool IsSinglePass() const
+  {
+    return true;
+  }
+
+  void EvaluateMoments(const RunningMoments &m)
+  {
+    Value(m._Count > 0 ? m._Max : numeric_limits<double>::quiet_NaN());
+  }
+
   // Add support for vtkDataArray argument
   mirtkCalculateVtkDataArray1();
 };
@@ -305,6 +458,16 @@ public:
     Value(Calculate(n, data, mask));
   }
 
+  bool IsSinglePass() const
+  {
+    return true;
+  }
+
+  void EvaluateMoments(const RunningMoments &m)
+  {
+    Value(m._Count > 0 ? m._MaxAbs : numeric_limits<double>::quiet_NaN());
+  }
+
   // Add support for vtkDataArray argument
   mirtkCalculateVtkDataArray1();
 };
@@ -350,6 +513,22 @@ public:
     Calculate(_Values[0], _Values[1], n, data, mask);
   }
 
+  bool IsSinglePass() const
+  {
+    return true;
+  }
+
+  void EvaluateMoments(const RunningMoments &m)
+  {
+    _Values.resize(2);
+    if (m._Count > 0) {
+      _Values[0] = m._Min;
+      _Values[1] = m._Max;
+    } else {
+      _Values[0] = _Values[1] = numeric_limits<double>::quiet_NaN();
+    }
+  }
+
   double Min() const { return _Values[0]; }
   double Max() const { return _Values[1]; }
 
@@ -386,6 +565,16 @@ public:
     Value(Calculate(n, data, mask));
   }
 
+  bool IsSinglePass() const
+  {
+    return true;
+  }
+
+  void EvaluateMoments(const RunningMoments &m)
+  {
+    Value(m._Count > 0 ? m._Max - m._Min : numeric_limits<double>::quiet_NaN());
+  }
+
   // Add support for vtkDataArray argument
   mirtkCalculateVtkDataArray1();
 };
@@ -427,6 +616,16 @@ public:
     Value(Calculate(n, data, mask));
   }
 
+  bool IsSinglePass() const
+  {
+    return true;
+  }
+
+  void EvaluateMoments(const RunningMoments &m)
+  {
+    Value(m._Count > 0 ? m._Mean : numeric_limits<double>::quiet_NaN());
+  }
+
   // Add support for vtkDataArray argument
   mirtkCalculateVtkDataArray1();
 };
@@ -489,6 +688,17 @@ public:
     Calculate(_Mean, _Values[0], n, data, mask);
   }
 
+  bool IsSinglePass() const
+  {
+    return true;
+  }
+
+  void EvaluateMoments(const RunningMoments &m)
+  {
+    _Mean = (m._Count > 0 ? m._Mean : numeric_limits<double>::quiet_NaN());
+    Value(m.Var());
+  }
+
   // Add support for vtkDataArray argument
   mirtkCalculateVtkDataArray1();
   mirtkCalculateVtkDataArray2();
@@ -531,6 +741,12 @@ public:
     Value(sqrt(this->Value()));
   }
 
+  void EvaluateMoments(const RunningMoments &m)
+  {
+    Var::EvaluateMoments(m);
+    Value(sqrt(this->Value()));
+  }
+
   // Add support for vtkDataArray argument
   mirtkCalculateVtkDataArray1();
   mirtkCalculateVtkDataArray2();
@@ -561,10 +777,387 @@ public:
     _Values[0] = _Mean;
   }
 
+  void EvaluateMoments(const RunningMoments &m)
+  {
+    StDev::EvaluateMoments(m);
+    _Values.resize(2);
+    _Values[1] = _Values[0];
+    _Values[0] = _Mean;
+  }
+
   double Mean()  const { return _Values[0]; }
   double Sigma() const { return _Values[1]; }
 };
 
+// -----------------------------------------------------------------------------
+namespace OrderStatisticsUtils {
+
+
+/// Search interval of order statistics
+struct Interval
+{
+  double _Min;   ///< Smallest data value in interval
+  double _Max;   ///< Largest data value in interval
+  int    _Below; ///< Number of data values less than _Min
+  int    _Count; ///< Number of data values in [_Min, _Max]
+};
+
+/// Get (absolute) data value
+template <class T>
+inline double GetValue(const T *data, int i, bool absval)
+{
+  const double v = static_cast<double>(data[i]);
+  return (absval ? abs(v) : v);
+}
+
+/// Count unmasked finite data values and determine their range
+///
+/// NaN and infinite values are excluded from the order statistics. The search
+/// intervals are bounded by the finite range determined here, which ensures
+/// that each counted value falls into exactly one histogram bin.
+template <class T>
+struct CountValues
+{
+  const T    *_Data;
+  const bool *_Mask;
+  bool        _Abs;
+  int         _Count;
+  double      _Min;
+  double      _Max;
+
+  CountValues(const T *data, const bool *mask, bool absval)
+  :
+    _Data(data), _Mask(mask), _Abs(absval), _Count(0),
+    _Min(+numeric_limits<double>::infinity()),
+    _Max(-numeric_limits<double>::infinity())
+  {}
+
+  CountValues(const CountValues &other, split)
+  :
+    _Data(other._Data), _Mask(other._Mask), _Abs(other._Abs), _Count(0),
+    _Min(+numeric_limits<double>::infinity()),
+    _Max(-numeric_limits<double>::infinity())
+  {}
+
+  void join(const CountValues &other)
+  {
+    _Count += other._Count;
+    if (other._Min < _Min) _Min = other._Min;
+    if (other._Max > _Max) _Max = other._Max;
+  }
+
+  void operator ()(const blocked_range<int> &re)
+  {
+    double v;
+    for (int i = re.begin(); i != re.end(); ++i) {
+      if (!_Mask || _Mask[i]) {
+        v = GetValue(_Data, i, _Abs);
+        if (IsNaN(v) || IsInf(v)) continue;
+        if (v < _Min) _Min = v;
+        if (v > _Max) _Max = v;
+        ++_Count;
+      }
+    }
+  }
+};
+
+/// Compute histograms of data values within search intervals
+template <class T>
+struct HistogramOfValues
+{
+  const T               *_Data;
+  const bool            *_Mask;
+  bool                   _Abs;
+  const Array<Interval> *_Intervals;
+  int                    _Bins;
+  Array<double>          _Scale; ///< Bins per unit of each interval
+  Array<int>             _Count; ///< Number of values in each bin
+  Array<double>          _Min;   ///< Smallest value in each bin
+  Array<double>          _Max;   ///< Largest value in each bin
+
+  HistogramOfValues(const T *data, const bool *mask, bool absval,
+                    const Array<Interval> *intervals, int bins)
+  :
+    _Data(data), _Mask(mask), _Abs(absval), _Intervals(intervals), _Bins(bins)
+  {
+    _Scale.resize(intervals->size());
+    for (size_t j = 0; j < intervals->size(); ++j) {
+      const Interval &interval = (*intervals)[j];
+      _Scale[j] = bins / (interval._Max - interval._Min);
+    }
+    Reset();
+  }
+
+  HistogramOfValues(const HistogramOfValues &other, split)
+  :
+    _Data(other._Data), _Mask(other._Mask), _Abs(other._Abs),
+    _Intervals(other._Intervals), _Bins(other._Bins), _Scale(other._Scale)
+  {
+    Reset();
+  }
+
+  void Reset()
+  {
+    const size_t size = _Intervals->size() * _Bins;
+    _Count.assign(size, 0);
+    _Min  .assign(size, +numeric_limits<double>::infinity());
+    _Max  .assign(size, -numeric_limits<double>::infinity());
+  }
+
+  void join(const HistogramOfValues &other)
+  {
+    for (size_t b = 0; b < _Count.size(); ++b) {
+      _Count[b] += other._Count[b];
+      if (other._Min[b] < _Min[b]) _Min[b] = other._Min[b];
+      if (other._Max[b] > _Max[b]) _Max[b] = other._Max[b];
+    }
+  }
+
+  void operator ()(const blocked_range<int> &re)
+  {
+    double v;
+    int    b;
+    for (int i = re.begin(); i != re.end(); ++i) {
+      if (!_Mask || _Mask[i]) {
+        v = GetValue(_Data, i, _Abs);
+        for (size_t j = 0; j < _Intervals->size(); ++j) {
+          const Interval &interval = (*_Intervals)[j];
+          if (interval._Min <= v && v <= interval._Max) {
+            b = static_cast<int>((v - interval._Min) * _Scale[j]);
+            if (b >= _Bins) b = _Bins - 1;
+            b += static_cast<int>(j) * _Bins;
+            _Count[b] += 1;
+            if (v < _Min[b]) _Min[b] = v;
+            if (v > _Max[b]) _Max[b] = v;
+          }
+        }
+      }
+    }
+  }
+};
+
+/// Copy data values within search intervals
+template <class T>
+struct CopyValues
+{
+  const T                *_Data;
+  const bool             *_Mask;
+  bool                    _Abs;
+  const Array<Interval>  *_Intervals;
+  Array<Array<double> >   _Values;
+
+  CopyValues(const T *data, const bool *mask, bool absval, const Array<Interval> *intervals)
+  :
+    _Data(data), _Mask(mask), _Abs(absval), _Intervals(intervals),
+    _Values(intervals->size())
+  {}
+
+  CopyValues(const CopyValues &other, split)
+  :
+    _Data(other._Data), _Mask(other._Mask), _Abs(other._Abs),
+    _Intervals(other._Intervals), _Values(other._Intervals->size())
+  {}
+
+  void join(const CopyValues &other)
+  {
+    for (size_t j = 0; j < _Values.size(); ++j) {
+      _Values[j].insert(_Values[j].end(), other._Values[j].begin(), other._Values[j].end());
+    }
+  }
+
+  void operator ()(const blocked_range<int> &re)
+  {
+    double v;
+    for (int i = re.begin(); i != re.end(); ++i) {
+      if (!_Mask || _Mask[i]) {
+        v = GetValue(_Data, i, _Abs);
+        for (size_t j = 0; j < _Intervals->size(); ++j) {
+          const Interval &interval = (*_Intervals)[j];
+          if (interval._Min <= v && v <= interval._Max) _Values[j].push_back(v);
+        }
+      }
+    }
+  }
+};
+
+
+} // namespace OrderStatisticsUtils
+
+// -----------------------------------------------------------------------------
+/// Selection of order statistics of a data sequence
+///
+/// Determines the k-th smallest unmasked data values for any number of ranks k
+/// without sorting a copy of the entire data sequence. NaN and infinite values
+/// are ignored, i.e., treated as if they were masked. The interval of data
+/// values which contains an order statistic is narrowed down by histograms of
+/// the values inside the interval, which are computed in parallel passes over
+/// the data. Order statistics which fall into the same histogram bin share
+/// the subsequent search interval. Once an interval contains only a few
+/// values, these are copied and the order statistic is selected among them
+/// using nth_element. Usually, a handful of passes over the data suffice.
+template <class T>
+class OrderStatistics
+{
+  typedef OrderStatisticsUtils::Interval Interval;
+
+  const T    *_Data;
+  const bool *_Mask;
+  int         _Size;
+  bool        _Abs;
+  int         _Count;
+  double      _Min;
+  double      _Max;
+
+public:
+
+  /// Number of histogram bins used to narrow down the search intervals
+  static int NumberOfBins() { return 1024; }
+
+  /// Maximum number of values in search interval which are copied
+  static int MaximumCopySize() { return 65536; }
+
+  /// Maximum number of histogram refinements
+  static int MaximumNumberOfLevels() { return 4; }
+
+  /// Constructor, determines number of unmasked values and their range
+  ///
+  /// \param[in] n      Number of data values.
+  /// \param[in] data   Data values.
+  /// \param[in] mask   Mask of data values to consider or NULL.
+  /// \param[in] absval Whether to determine order statistics of absolute values.
+  OrderStatistics(int n, const T *data, const bool *mask = NULL, bool absval = false)
+  :
+    _Data(data), _Mask(mask), _Size(n), _Abs(absval)
+  {
+    OrderStatisticsUtils::CountValues<T> count(data, mask, absval);
+    parallel_reduce(blocked_range<int>(0, n), count);
+    _Count = count._Count;
+    _Min   = count._Min;
+    _Max   = count._Max;
+  }
+
+  /// Number of unmasked finite data values
+  int NumberOfValues() const { return _Count; }
+
+  /// Smallest unmasked finite data value
+  double Min() const { return _Count > 0 ? _Min : numeric_limits<double>::quiet_NaN(); }
+
+  /// Largest unmasked finite data value
+  double Max() const { return _Count > 0 ? _Max : numeric_limits<double>::quiet_NaN(); }
+
+  /// Select order statistics
+  ///
+  /// \param[in]  nk    Number of order statistics.
+  /// \param[in]  k     Zero-based ranks of order statistics in [0, NumberOfValues()).
+  /// \param[out] value Values of order statistics.
+  void Select(int nk, const int *k, double *value) const
+  {
+    if (nk <= 0) return;
+    if (_Count == 0) {
+      for (int r = 0; r < nk; ++r) value[r] = numeric_limits<double>::quiet_NaN();
+      return;
+    }
+
+    // Initial search interval containing all data values
+    Array<Interval> intervals(1);
+    intervals[0]._Min   = _Min;
+    intervals[0]._Max   = _Max;
+    intervals[0]._Below = 0;
+    intervals[0]._Count = _Count;
+    Array<int> target(nk, 0); // Search interval of each order statistic
+
+    for (int r = 0; r < nk; ++r) {
+      if (k[r] < 0 || k[r] >= _Count) {
+        cerr << "OrderStatistics::Select: Rank " << k[r] << " out of range [0, " << _Count << ")" << endl;
+        exit(1);
+      }
+    }
+
+    // Narrow down search intervals using histograms of values inside them
+    for (int level = 0; level < MaximumNumberOfLevels(); ++level) {
+      const int nbins = NumberOfBins();
+      Array<Interval> refine;
+      Array<int>      index(intervals.size(), -1);
+      for (size_t j = 0; j < intervals.size(); ++j) {
+        const Interval &interval = intervals[j];
+        if (interval._Count > MaximumCopySize() && interval._Min < interval._Max &&
+            !IsInf(nbins / (interval._Max - interval._Min))) {
+          index[j] = static_cast<int>(refine.size());
+          refine.push_back(interval);
+        }
+      }
+      if (refine.empty()) break;
+      OrderStatisticsUtils::HistogramOfValues<T> hist(_Data, _Mask, _Abs, &refine, nbins);
+      parallel_reduce(blocked_range<int>(0, _Size), hist);
+      // Assign order statistics to histogram bins, intervals which were
+      // not refined are kept as they are
+      Array<Interval> next;
+      Array<int>      kept    (intervals.size(), -1);
+      Array<int>      bin_index(refine.size() * nbins, -1);
+      for (int r = 0; r < nk; ++r) {
+        const Interval &interval = intervals[target[r]];
+        const int       j        = index[target[r]];
+        if (j < 0) {
+          int &idx = kept[target[r]];
+          if (idx < 0) {
+            idx = static_cast<int>(next.size());
+            next.push_back(interval);
+          }
+          target[r] = idx;
+          continue;
+        }
+        int b = j * nbins, below = interval._Below;
+        const int last = b + nbins - 1;
+        while (b < last && below + hist._Count[b] <= k[r]) below += hist._Count[b++];
+        int &idx = bin_index[b];
+        if (idx < 0) {
+          Interval bin;
+          bin._Min   = hist._Min[b];
+          bin._Max   = hist._Max[b];
+          bin._Below = below;
+          bin._Count = hist._Count[b];
+          idx = static_cast<int>(next.size());
+          next.push_back(bin);
+        }
+        target[r] = idx;
+      }
+      intervals.swap(next);
+    }
+
+    // Select order statistics among copied values of remaining intervals
+    Array<Interval> copy;
+    Array<int>      index(intervals.size(), -1);
+    for (size_t j = 0; j < intervals.size(); ++j) {
+      if (intervals[j]._Min < intervals[j]._Max) {
+        index[j] = static_cast<int>(copy.size());
+        copy.push_back(intervals[j]);
+      }
+    }
+    OrderStatisticsUtils::CopyValues<T> values(_Data, _Mask, _Abs, &copy);
+    if (!copy.empty()) parallel_reduce(blocked_range<int>(0, _Size), values);
+    for (int r = 0; r < nk; ++r) {
+      const Interval &interval = intervals[target[r]];
+      const int       j        = index[target[r]];
+      if (j < 0) {
+        value[r] = interval._Min;
+      } else {
+        Array<double> &v = values._Values[j];
+        Array<double>::iterator nth = v.begin() + (k[r] - interval._Below);
+        nth_element(v.begin(), nth, v.end());
+        value[r] = *nth;
+      }
+    }
+  }
+
+  /// Select order statistic
+  double Select(int k) const
+  {
+    double value;
+    Select(1, &k, &value);
+    return value;
+  }
+};
+
 // -----------------------------------------------------------------------------
 /// Percentile calculation
 class Percentile : public Statistic
@@ -602,58 +1195,61 @@ public:
   }
 
   template <class T>
-  static double Calculate(int p, double &rank, int n, const T *data, const bool *mask = NULL)
+  static void Calculate(int np, const int *p, double *rank, double *value,
+                        int n, const T *data, const bool *mask = NULL, bool absval = false)
   {
-    // Determine number of unmasked values
-    int m = n;
-    if (mask) {
-      m = 0;
-      for (int i = 0; i < n; ++i) {
-        if (mask[i]) ++m;
-      }
-    }
+    // Determine number of unmasked values and their range
+    OrderStatistics<T> stats(n, data, mask, absval);
+    const int m = stats.NumberOfValues();
 
     if (m == 0) {
-      rank = numeric_limits<double>::quiet_NaN();
-      return numeric_limits<double>::quiet_NaN();
+      for (int i = 0; i < np; ++i) {
+        rank [i] = numeric_limits<double>::quiet_NaN();
+        value[i] = numeric_limits<double>::quiet_NaN();
+      }
+      return;
     }
 
-    // Compute percentile rank
-    rank = (double(p) / 100.0) * double(m + 1);
+    // Compute percentile ranks and collect required order statistics
+    Array<int> k;
+    k.reserve(2 * np);
+    for (int i = 0; i < np; ++i) {
+      rank[i] = (double(p[i]) / 100.0) * double(m + 1);
+      const int ki = int(rank[i]);
+      if (0 < ki && ki < m) {
+        k.push_back(ki - 1);
+        k.push_back(ki);
+      }
+    }
 
-    // Split rank into integer and decimal components
-    int    k = int(rank);
-    double d = rank - k;
+    // Select order statistics of all percentiles at once
+    Array<double> v(k.size());
+    stats.Select(static_cast<int>(k.size()), k.data(), v.data());
 
-    // Compute percentile value according to NIST method
+    // Compute percentile values according to NIST method
     // (cf. http://en.wikipedia.org/wiki/Percentile#Definition_of_the_NIST_method )
-    if (k == 0) {
-      return Min::Calculate(n, data, mask);
-    } else if (k >= m) {
-      return Max::Calculate(n, data, mask);
-    } else {
-      // Copy unmasked data only
-      double *v = new double[m];
-      if (mask) {
-        m = 0;
-        for (int i = 0; i < n; ++i) {
-          if (mask[i]) v[m++] = static_cast<double>(data[i]);
-        }
+    for (int i = 0, j = 0; i < np; ++i) {
+      const int    ki = int(rank[i]);
+      const double d  = rank[i] - ki;
+      if (ki <= 0) {
+        value[i] = stats.Min();
+      } else if (ki >= m) {
+        value[i] = stats.Max();
       } else {
-        for (int i = 0; i < n; ++i) {
-          v[i] = static_cast<double>(data[i]);
-        }
+        value[i] = v[j] + d * (v[j + 1] - v[j]);
+        j += 2;
       }
-      // Sort data below k + 1
-      partial_sort(v, v + k + 1, v + m);
-      // Compute percentile value
-      double percentile = v[k - 1] + d * (v[k] - v[k - 1]);
-      // Free (partially) sorted data copy
-      delete[] v;
-      return percentile;
     }
   }
 
+  template <class T>
+  static double Calculate(int p, double &rank, int n, const T *data, const bool *mask = NULL)
+  {
+    double value;
+    Calculate(1, &p, &rank, &value, n, data, mask);
+    return value;
+  }
+
   template <class T>
   static double Calculate(int p, int n, const T *data, const bool *mask = NULL)
   {
@@ -661,9 +1257,43 @@ public:
     return Calculate(p, rank, n, data, mask);
   }
 
+  /// Evaluate percentile statistics of the same data in one go
+  ///
+  /// The order statistics required by all given percentile statistics are
+  /// determined at once without sorting (a copy of) the data.
+  static void EvaluateAll(const Array<Percentile *> &stats, int n, const double *data, const bool *mask = NULL)
+  {
+    Array<int>    p;
+    Array<size_t> offset(stats.size());
+    for (size_t i = 0; i < stats.size(); ++i) {
+      offset[i] = p.size();
+      stats[i]->Percentiles(p);
+    }
+    Array<double> rank(p.size()), value(p.size());
+    Calculate(static_cast<int>(p.size()), p.data(), rank.data(), value.data(), n, data, mask);
+    for (size_t i = 0; i < stats.size(); ++i) {
+      stats[i]->EvaluatePercentiles(n, data, mask, rank.data() + offset[i], value.data() + offset[i]);
+    }
+  }
+
+  /// Append percentages of percentiles required to evaluate this statistic
+  virtual void Percentiles(Array<int> &p) const
+  {
+    p.push_back(_P);
+  }
+
+  /// Evaluate statistic given the ranks and values of the percentiles
+  /// of the data which were requested by Percentiles
+  virtual void EvaluatePercentiles(int, const double *, const bool *,
+                                   const double *rank, const double *value)
+  {
+    _Rank = rank[0];
+    Value(value[0]);
+  }
+
   void Evaluate(int n, const double *data, const bool *mask = NULL)
   {
-    Value(Calculate(_P, _Rank, n, data, mask));
+    EvaluateAll(Array<Percentile *>(1, this), n, data, mask);
   }
 
   // Add support for vtkDataArray
@@ -733,54 +1363,9 @@ public:
   template <class T>
   static double Calculate(int p, double &rank, int n, const T *data, const bool *mask = NULL)
   {
-    // Determine number of unmasked values
-    int m = n;
-    if (mask) {
-      m = 0;
-      for (int i = 0; i < n; ++i) {
-        if (mask[i]) ++m;
-      }
-    }
-
-    if (m == 0) {
-      rank = numeric_limits<double>::quiet_NaN();
-      return numeric_limits<double>::quiet_NaN();
-    }
-
-    // Compute percentile rank
-    rank = (double(p) / 100.0) * double(m + 1);
-
-    // Split rank into integer and decimal components
-    int    k = int(rank);
-    double d = rank - k;
-
-    // Compute percentile value according to NIST method
-    // (cf. http://en.wikipedia.org/wiki/Percentile#Definition_of_the_NIST_method )
-    if (k == 0) {
-      return MinAbs::Calculate(n, data, mask);
-    } else if (k >= m) {
-      return MaxAbs::Calculate(n, data, mask);
-    } else {
-      // Copy unmasked data only
-      double *v = new double[m];
-      if (mask) {
-        m = 0;
-        for (int i = 0; i < n; ++i) {
-          if (mask[i]) v[m++] = abs(static_cast<double>(data[i]));
-        }
-      } else {
-        for (int i = 0; i < n; ++i) {
-          v[i] = abs(static_cast<double>(data[i]));
-        }
-      }
-      // Sort data below k + 1
-      partial_sort(v, v + k + 1, v + m);
-      // Compute percentile value
-      double percentile = v[k - 1] + d * (v[k] - v[k - 1]);
-      // Free (partially) sorted data copy
-      delete[] v;
-      return percentile;
-    }
+    double value;
+    Percentile::Calculate(1, &p, &rank, &value, n, data, mask, true);
+    return value;
   }
 
   template <class T>
@@ -859,13 +1444,11 @@ public:
   }
 
   template <class T>
-  static double Calculate(int p, int n, const T *data, const bool *mask = NULL)
+  static double CalculateMean(double threshold, int n, const T *data, const bool *mask = NULL)
   {
-    const double threshold = Percentile::Calculate(p, n, data, mask);
-
     int    m =  0;
     double v = .0, d;
-    
+
     for (int i = 0; i < n; ++i) {
       if (!mask || mask[i]) {
         d = static_cast<double>(data[i]);
@@ -880,9 +1463,18 @@ public:
     return v;
   }
 
-  void Evaluate(int n, const double *data, const bool *mask = NULL)
+  template <class T>
+  static double Calculate(int p, int n, const T *data, const bool *mask = NULL)
+  {
+    return CalculateMean(Percentile::Calculate(p, n, data, mask), n, data, mask);
+  }
+
+  void EvaluatePercentiles(int n, const double *data, const bool *mask,
+                           const double *rank, const double *value)
   {
-    Value(Calculate(_P, n, data, mask));
+    _Rank = rank[0];
+    _Mean = CalculateMean(value[0], n, data, mask);
+    Value(_Mean);
   }
 
   // Add support for vtkDataArray
@@ -942,13 +1534,11 @@ public:
   }
 
   template <class T>
-  static double Calculate(int p, int n, const T *data, const bool *mask = NULL)
+  static double CalculateMean(double threshold, int n, const T *data, const bool *mask = NULL)
   {
-    const double threshold = Percentile::Calculate(p, n, data, mask);
-
     int    m =  0;
     double v = .0, d;
-    
+
     for (int i = 0; i < n; ++i) {
       if (!mask || mask[i]) {
         d = static_cast<double>(data[i]);
@@ -963,9 +1553,18 @@ public:
     return v;
   }
 
-  void Evaluate(int n, const double *data, const bool *mask = NULL)
+  template <class T>
+  static double Calculate(int p, int n, const T *data, const bool *mask = NULL)
+  {
+    return CalculateMean(Percentile::Calculate(p, n, data, mask), n, data, mask);
+  }
+
+  void EvaluatePercentiles(int n, const double *data, const bool *mask,
+                           const double *rank, const double *value)
   {
-    Value(Calculate(_P, n, data, mask));
+    _Rank = rank[0];
+    _Mean = CalculateMean(value[0], n, data, mask);
+    Value(_Mean);
   }
 
   // Add support for vtkDataArray
@@ -1025,14 +1624,11 @@ public:
   }
 
   template <class T>
-  static double Calculate(int p, int n, const T *data, const bool *mask = NULL)
+  static double CalculateMean(double min, double max, int n, const T *data, const bool *mask = NULL)
   {
-    const double min = Percentile::Calculate(        p, n, data, mask);
-    const double max = Percentile::Calculate(100.0 - p, n, data, mask);
-
     int    m =  0;
     double v = .0, d;
-    
+
     for (int i = 0; i < n; ++i) {
       if (!mask || mask[i]) {
         d = static_cast<double>(data[i]);
@@ -1047,9 +1643,27 @@ public:
     return v;
   }
 
-  void Evaluate(int n, const double *data, const bool *mask = NULL)
+  template <class T>
+  static double Calculate(int p, int n, const T *data, const bool *mask = NULL)
+  {
+    const int pp[2] = {p, 100 - p};
+    double rank[2], value[2];
+    Percentile::Calculate(2, pp, rank, value, n, data, mask);
+    return CalculateMean(value[0], value[1], n, data, mask);
+  }
+
+  void Percentiles(Array<int> &p) const
+  {
+    p.push_back(_P);
+    p.push_back(100 - _P);
+  }
+
+  void EvaluatePercentiles(int n, const double *data, const bool *mask,
+                           const double *rank, const double *value)
   {
-    Value(Calculate(_P, n, data, mask));
+    _Rank = rank[0];
+    _Mean = CalculateMean(value[0], value[1], n, data, mask);
+    Value(_Mean);
   }
 
   // Add support for vtkDataArray
@@ -49,24 +49,32 @@ protected:
   /// Calculate 3D distance transform
   void edtComputeEDT_3D(char *, long *, long, long, long);
 
-  /// Calculate the Vornoi diagram for anisotripic voxel sizes
-  int edtVornoiEDT_anisotropic(VoxelType *, long, double);
-
-  /// Calculate 2D distance transform for anisotripic voxel sizes
-  void edtComputeEDT_2D_anisotropic(const VoxelType *, VoxelType *, long, long, double, double);
+  /// Calculate 2D distance transform of each slice for anisotripic voxel sizes
+  void edtComputeEDT_2D_anisotropic(const VoxelType *, VoxelType *, long, long, long, double, double);
 
-  /// Calculate 3D distance transform for anisotripic voxel sizes
-  void edtComputeEDT_3D_anisotropic(const VoxelType *, VoxelType *, long, long, long, double, double, double);
+  /// Calculate 3D distance transform of each volume for anisotripic voxel sizes
+  void edtComputeEDT_3D_anisotropic(const VoxelType *, VoxelType *, long, long, long, long, double, double, double);
 
 public:
 
+  /// Calculate the Vornoi diagram for anisotripic voxel sizes
+  ///
+  /// The last two arguments are scratch buffers of the same size as the
+  /// input scanline which are provided by the caller for thread-safety.
+  static int edtVornoiEDT_anisotropic(VoxelType *, long, double, float *, float *);
+
   /// Default constructor
   EuclideanDistanceTransform(Mode = DT_3D);
 
   /// Destructor (empty).
   ~EuclideanDistanceTransform() {};
 
-  // Run distance transform
+  /// Run distance transform
+  ///
+  /// The separable passes of the distance transform are executed in parallel
+  /// over all scanlines of all frames of the input image. Multiple distance
+  /// transforms, e.g., of the interior and exterior of several labels, are
+  /// thus best computed in one pass by stacking the binary images as frames.
   virtual void Run();
 
   // Get Radial
@@ -350,6 +350,28 @@ public:
   /// Get 1st order derivatives of given image at arbitrary location (in pixels)
   void EvaluateJacobian(Matrix &, double, double, double = 0, double = 0) const;
 
+  /// Get value and derivatives of given 2D image at arbitrary location (in pixels)
+  ///
+  /// The value and its 1st and 2nd order derivatives w.r.t. the lattice
+  /// coordinates are evaluated at once from a single coefficient neighbourhood.
+  ///
+  /// \param[out] v  Interpolated value.
+  /// \param[out] d1 1st order derivatives w.r.t. x and y.
+  /// \param[out] d2 2nd order derivatives w.r.t. xx, xy, and yy or \c NULL.
+  void EvaluateWithDerivatives2D(RealType &v, RealType d1[2], RealType *d2,
+                                 double, double, double = 0, double = 0) const;
+
+  /// Get value and derivatives of given 3D image at arbitrary location (in pixels)
+  ///
+  /// The value and its 1st and 2nd order derivatives w.r.t. the lattice
+  /// coordinates are evaluated at once from a single coefficient neighbourhood.
+  ///
+  /// \param[out] v  Interpolated value.
+  /// \param[out] d1 1st order derivatives w.r.t. x, y, and z.
+  /// \param[out] d2 2nd order derivatives w.r.t. xx, xy, xz, yy, yz, and zz or \c NULL.
+  void EvaluateWithDerivatives3D(RealType &v, RealType d1[3], RealType *d2,
+                                 double, double, double = 0, double = 0) const;
+
 };
 
 
@@ -1288,6 +1288,194 @@ void GenericFastCubicBSplineInterpolateImageFunction<TImage>
   else                            this->EvaluateJacobianOutside(jac, x, y, z, t);
 }
 
+// -----------------------------------------------------------------------------
+template <class TImage>
+void GenericFastCubicBSplineInterpolateImageFunction<TImage>
+::EvaluateWithDerivatives2D(RealType &v, RealType d1[2], RealType *d2,
+                            double x, double y, double z, double t) const
+{
+  v = d1[0] = d1[1] = voxel_cast<RealType>(0);
+  if (d2) d2[0] = d2[1] = d2[2] = voxel_cast<RealType>(0);
+
+  int i = static_cast<int>(floor(x));
+  int j = static_cast<int>(floor(y));
+  int k = static_cast<int>(round(z));
+  int l = static_cast<int>(round(t));
+
+  if (k < 0 || k >= _Coefficient.Z() ||
+      l < 0 || l >= _Coefficient.T()) {
+    v = voxel_cast<RealType>(this->DefaultValue());
+    return;
+  }
+
+  const int A = Kernel::VariableToIndex(x - i);
+  const int B = Kernel::VariableToIndex(y - j);
+
+  --i, --j;
+
+  // Whether entire coefficient neighbourhood is inside the image domain
+  const bool inside = (0 <= i && i + 3 < _Coefficient.X() &&
+                       0 <= j && j + 3 < _Coefficient.Y());
+
+  // Row sums of coefficients weighted by kernel and its derivatives in x
+  RealType s0, s1, s2;
+  Real     wx, nrm = .0, wsum;
+
+  int ia, jb;
+  for (int b = 0; b <= 3; ++b) {
+    jb = j + b;
+    if (inside || (0 <= jb && jb < _Coefficient.Y())) {
+      s0 = s1 = s2 = voxel_cast<RealType>(0);
+      wsum = .0;
+      for (int a = 0; a <= 3; ++a) {
+        ia = i + a;
+        if (inside || (0 <= ia && ia < _Coefficient.X())) {
+          const RealType &coeff = _Coefficient(ia, jb, k, l);
+          wx    = Kernel::LookupTable[A][a];
+          s0   += wx * coeff;
+          s1   += Kernel::LookupTable_I[A][a] * coeff;
+          if (d2) s2 += Kernel::LookupTable_II[A][a] * coeff;
+          wsum += wx;
+        }
+      }
+      v     += Kernel::LookupTable  [B][b] * s0;
+      d1[0] += Kernel::LookupTable  [B][b] * s1;
+      d1[1] += Kernel::LookupTable_I[B][b] * s0;
+      if (d2) {
+        d2[0] += Kernel::LookupTable   [B][b] * s2;
+        d2[1] += Kernel::LookupTable_I [B][b] * s1;
+        d2[2] += Kernel::LookupTable_II[B][b] * s0;
+      }
+      nrm += Kernel::LookupTable[B][b] * wsum;
+    }
+  }
+
+  // Normalize value at boundary as done by Get2D
+  if (!inside) {
+    if (nrm) v /= nrm;
+    else     v  = voxel_cast<RealType>(this->DefaultValue());
+  }
+}
+
+// -----------------------------------------------------------------------------
+template <class TImage>
+void GenericFastCubicBSplineInterpolateImageFunction<TImage>
+::EvaluateWithDerivatives3D(RealType &v, RealType d1[3], RealType *d2,
+                            double x, double y, double z, double t) const
+{
+  v = d1[0] = d1[1] = d1[2] = voxel_cast<RealType>(0);
+  if (d2) {
+    for (int n = 0; n < 6; ++n) d2[n] = voxel_cast<RealType>(0);
+  }
+
+  int i = static_cast<int>(floor(x));
+  int j = static_cast<int>(floor(y));
+  int k = static_cast<int>(floor(z));
+  int l = static_cast<int>(round(t));
+
+  if (l < 0 || l >= _Coefficient.T()) {
+    v = voxel_cast<RealType>(this->DefaultValue());
+    return;
+  }
+
+  const int A = Kernel::VariableToIndex(x - i);
+  const int B = Kernel::VariableToIndex(y - j);
+  const int C = Kernel::VariableToIndex(z - k);
+
+  --i, --j, --k;
+
+  // Whether entire coefficient neighbourhood is inside the image domain
+  const bool inside = (0 <= i && i + 3 < _Coefficient.X() &&
+                       0 <= j && j + 3 < _Coefficient.Y() &&
+                       0 <= k && k + 3 < _Coefficient.Z());
+
+  // Row sums of coefficients weighted by kernel and its derivatives in x
+  RealType s0, s1, s2;
+  Real     wx, wy[3], wz[3], wyz, nrm = .0, wsum;
+
+  if (inside) {
+    // Use faster coefficient iteration as done by GetInside3D
+    const RealType *coeff = _Coefficient.Data(i, j, k, l);
+    for (int c = 0; c <= 3; ++c, coeff += _s3) {
+      wz[0] = Kernel::LookupTable   [C][c];
+      wz[1] = Kernel::LookupTable_I [C][c];
+      wz[2] = Kernel::LookupTable_II[C][c];
+      for (int b = 0; b <= 3; ++b, coeff += _s2) {
+        wy[0] = Kernel::LookupTable   [B][b];
+        wy[1] = Kernel::LookupTable_I [B][b];
+        wy[2] = Kernel::LookupTable_II[B][b];
+        s0 = s1 = s2 = voxel_cast<RealType>(0);
+        for (int a = 0; a <= 3; ++a, ++coeff) {
+          s0 += Kernel::LookupTable  [A][a] * (*coeff);
+          s1 += Kernel::LookupTable_I[A][a] * (*coeff);
+          if (d2) s2 += Kernel::LookupTable_II[A][a] * (*coeff);
+        }
+        wyz    = wy[0] * wz[0];
+        v     += wyz * s0;
+        d1[0] += wyz * s1;
+        d1[1] += (wy[1] * wz[0]) * s0;
+        d1[2] += (wy[0] * wz[1]) * s0;
+        if (d2) {
+          d2[0] += wyz * s2;
+          d2[1] += (wy[1] * wz[0]) * s1;
+          d2[2] += (wy[0] * wz[1]) * s1;
+          d2[3] += (wy[2] * wz[0]) * s0;
+          d2[4] += (wy[1] * wz[1]) * s0;
+          d2[5] += (wy[0] * wz[2]) * s0;
+        }
+      }
+    }
+  } else {
+    int ia, jb, kc;
+    for (int c = 0; c <= 3; ++c) {
+      kc = k + c;
+      if (0 <= kc && kc < _Coefficient.Z()) {
+        wz[0] = Kernel::LookupTable   [C][c];
+        wz[1] = Kernel::LookupTable_I [C][c];
+        wz[2] = Kernel::LookupTable_II[C][c];
+        for (int b = 0; b <= 3; ++b) {
+          jb = j + b;
+          if (0 <= jb && jb < _Coefficient.Y()) {
+            wy[0] = Kernel::LookupTable   [B][b];
+            wy[1] = Kernel::LookupTable_I [B][b];
+            wy[2] = Kernel::LookupTable_II[B][b];
+            s0 = s1 = s2 = voxel_cast<RealType>(0);
+            wsum = .0;
+            for (int a = 0; a <= 3; ++a) {
+              ia = i + a;
+              if (0 <= ia && ia < _Coefficient.X()) {
+                const RealType &coeff = _Coefficient(ia, jb, kc, l);
+                wx    = Kernel::LookupTable[A][a];
+                s0   += wx * coeff;
+                s1   += Kernel::LookupTable_I[A][a] * coeff;
+                if (d2) s2 += Kernel::LookupTable_II[A][a] * coeff;
+                wsum += wx;
+              }
+            }
+            wyz    = wy[0] * wz[0];
+            v     += wyz * s0;
+            d1[0] += wyz * s1;
+            d1[1] += (wy[1] * wz[0]) * s0;
+            d1[2] += (wy[0] * wz[1]) * s0;
+            if (d2) {
+              d2[0] += wyz * s2;
+              d2[1] += (wy[1] * wz[0]) * s1;
+              d2[2] += (wy[0] * wz[1]) * s1;
+              d2[3] += (wy[2] * wz[0]) * s0;
+              d2[4] += (wy[1] * wz[1]) * s0;
+              d2[5] += (wy[0] * wz[2]) * s0;
+            }
+            nrm += wyz * wsum;
+          }
+        }
+      }
+    }
+    // Normalize value at boundary as done by Get3D
+    if (nrm) v /= nrm;
+    else     v  = voxel_cast<RealType>(this->DefaultValue());
+  }
+}
+
 
 } // namespace mirtk
 
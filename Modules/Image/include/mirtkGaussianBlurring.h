@@ -40,6 +40,11 @@ namespace mirtk {
  * the 1D convolution with a 1D Gaussian kernel is performed only for
  * dimensions of more than one voxel size and for which a non-zero
  * standard deviation for the Gaussian kernel has been set.
+ *
+ * For large standard deviations, the convolution with a truncated Gaussian
+ * kernel can be replaced by the recursive (IIR) approximation of the Gaussian
+ * implemented by RecursiveGaussianFilter, whose cost per voxel is independent
+ * of the standard deviation. See attributes Recursive and RecursiveThreshold.
  */
 template <class VoxelType>
 class GaussianBlurring : public ImageToImage<VoxelType>
@@ -58,6 +63,14 @@ class GaussianBlurring : public ImageToImage<VoxelType>
   /// Standard deviation of Gaussian kernel in t
   mirtkAttributeMacro(double, SigmaT);
 
+  /// Whether to use the recursive (IIR) filter regardless of sigma
+  mirtkPublicAttributeMacro(bool, Recursive);
+
+  /// Minimum standard deviation in voxel units from which on the recursive
+  /// (IIR) filter is used instead of the convolution with a truncated kernel
+  /// (default: infinity, i.e., only when Recursive is set)
+  mirtkPublicAttributeMacro(double, RecursiveThreshold);
+
 protected:
 
   /// Gaussian convolution kernel
@@ -69,6 +82,9 @@ protected:
   /// Initialize 1D Gaussian kernel with sigma given in voxel units
   virtual void InitializeKernel(double);
 
+  /// Whether to use recursive filter for given sigma in voxel units
+  bool UseRecursiveFilter(double) const;
+
   /// Finalize filter
   virtual void Finalize();
 
@@ -75,6 +75,10 @@ protected:
   /// Whether image data memory itself is owned by this instance
   bool _dataOwner;
 
+  /// Shared external memory which \c _data points into, e.g., a memory-mapped
+  /// image file, or \c nullptr if the image data is not backed by such memory
+  shared_ptr<void> _dataMemory;
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 
@@ -129,6 +133,12 @@ public:
   /// Initialize an image
   void Initialize(const ImageAttributes &, int);
 
+  /// Initialize an image whose data is stored in shared external memory
+  ///
+  /// The image keeps a reference to the given memory, e.g., a memory-mapped
+  /// image file, which is released when no longer referenced by any image.
+  void Initialize(const ImageAttributes &, int, VoxelType *, const shared_ptr<void> &);
+
   /// Initialize an image
   void Initialize(const ImageAttributes &, VoxelType *data = NULL);
 
@@ -278,6 +288,10 @@ public:
   /// Get raw pointer to contiguous image data
   virtual const void *GetDataPointer(int, int, int = 0, int = 0) const;
 
+  /// Shared external memory which the image data points into, e.g., a
+  /// memory-mapped image file, or \c nullptr if not backed by such memory
+  const shared_ptr<void> &DataMemory() const;
+
   /// Get enumeration value corresponding to voxel type
   virtual int GetDataType() const;
 
@@ -775,6 +789,13 @@ inline const void *GenericImage<VoxelType>::GetDataPointer(int x, int y, int z,
   return &_matrix[t][z][y][x];
 }
 
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+inline const shared_ptr<void> &GenericImage<VoxelType>::DataMemory() const
+{
+  return _dataMemory;
+}
+
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 inline int GenericImage<VoxelType>::GetDataType() const
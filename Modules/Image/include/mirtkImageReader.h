@@ -59,6 +59,15 @@ class ImageReader : protected Cifstream
   /// Intensity scaling parameter -  intercept (default: 0)
   mirtkReadOnlyAttributeMacro(double, Intercept);
 
+  /// Whether to memory-map the image data of uncompressed image files
+  ///
+  /// When enabled, the voxel data of the returned image references the
+  /// private file mapping directly. Pages are shared with other processes
+  /// reading the same file until they are modified, e.g., by byte swapping
+  /// or reflection of the image axes, in which case they are copied on write.
+  /// The image file must not be modified or truncated while it is mapped.
+  mirtkPublicAttributeMacro(bool, MemoryMap);
+
 protected:
 
   /// Flag whether to reflect X axis
@@ -73,10 +82,20 @@ protected:
   /// Start of image data
   int _Start;
 
+  /// First voxel index of region of interest to read along each dimension
+  int _RegionBegin[4];
+
+  /// Voxel index after the last of region of interest along each dimension,
+  /// where a non-positive value refers to the size of the image dimension
+  int _RegionEnd[4];
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 public:
 
+  /// Default value of MemoryMap attribute of newly constructed readers
+  static bool DefaultMemoryMap;
+
   /// Contructor
   ImageReader();
 
@@ -109,6 +128,30 @@ public:
   /// Print image header information
   virtual void Print() const;
 
+  /// Set region of interest to read from the image file
+  ///
+  /// Only the voxel data within the index ranges [i1, i2), [j1, j2), and
+  /// [k1, k2) of all frames is read from the file. For uncompressed files,
+  /// the file position is set to the start of each contiguous chunk of data
+  /// within the region, while compressed files are decompressed sequentially
+  /// without storing the data outside the region.
+  void Region(int i1, int j1, int k1, int i2, int j2, int k2);
+
+  /// Set region of interest to read from the image file
+  void Region(int i1, int j1, int k1, int l1, int i2, int j2, int k2, int l2);
+
+  /// Set range [l1, l2) of frames to read from the image file
+  void Frames(int l1, int l2);
+
+  /// Read entire image
+  void ResetRegion();
+
+  /// Whether only a region of interest of the image is read
+  bool HasRegion() const;
+
+  /// Attributes of image returned by Run
+  ImageAttributes RegionAttributes() const;
+
   /// Read image from file
   ///
   /// \returns Newly read image. Must be deleted by caller.
@@ -121,6 +164,21 @@ protected:
   /// of this class.
   virtual void ReadHeader() = 0;
 
+  /// Name of file containing the image data
+  virtual string DataFileName() const;
+
+  /// Read n voxels of the image data type starting at the given file offset
+  bool ReadVoxels(void *, long, long);
+
+  /// Read image data within the region of interest
+  bool ReadRegion(void *);
+
+  /// Memory-map image data instead of reading it into newly allocated memory
+  ///
+  /// \returns Image referencing the mapped image data or \c nullptr if the
+  ///          image data cannot be mapped, e.g., because the file is compressed.
+  virtual BaseImage *MapImageData();
+
 };
 
 
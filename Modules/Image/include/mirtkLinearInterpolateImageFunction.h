@@ -243,6 +243,16 @@ public:
   /// is returned.
   virtual VoxelType GetWithPaddingOutside(double, double, double = 0, double = 0) const;
 
+  // Import other overloads
+  using Superclass::EvaluateInside;
+
+  /// Evaluate multi-channel image without handling boundary conditions
+  ///
+  /// In case of a 3D multi-channel image, the interpolation weights and
+  /// offsets of the neighboring voxels are computed only once and applied
+  /// to all channels.
+  virtual void EvaluateInside(double *, double, double, double = 0, int = 1) const;
+
 };
 
 
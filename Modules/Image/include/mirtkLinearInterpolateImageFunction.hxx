@@ -781,6 +781,46 @@ GenericLinearInterpolateImageFunction<BaseImage>
   return Get(this->Input(), x, y, z, t);
 }
 
+// -----------------------------------------------------------------------------
+template <class TImage>
+inline void GenericLinearInterpolateImageFunction<TImage>
+::EvaluateInside(double *v, double x, double y, double z, int vt) const
+{
+  if (this->NumberOfDimensions() != 3) {
+    Superclass::EvaluateInside(v, x, y, z, vt);
+    return;
+  }
+
+  const int i = static_cast<int>(x);
+  const int j = static_cast<int>(y);
+  const int k = static_cast<int>(z);
+
+  const Real A = x - i;
+  const Real B = y - j;
+  const Real C = z - k;
+  const Real a = 1.0 - A;
+  const Real b = 1.0 - B;
+  const Real c = 1.0 - C;
+
+  const int        n   = this->Input()->NumberOfSpatialVoxels();
+  const VoxelType *img = reinterpret_cast<const VoxelType *>(this->Input()->GetDataPointer(i, j, k));
+  for (int l = 0; l < this->Input()->T(); ++l, img += n, v += vt) {
+    const VoxelType val = (c * (b * (a * img[_Offset[0]] + A * img[_Offset[1]])  +
+                                B * (a * img[_Offset[2]] + A * img[_Offset[3]])) +
+                           C * (b * (a * img[_Offset[4]] + A * img[_Offset[5]])  +
+                                B * (a * img[_Offset[6]] + A * img[_Offset[7]])));
+    (*v) = voxel_cast<double>(val);
+  }
+}
+
+// -----------------------------------------------------------------------------
+template <>
+inline void GenericLinearInterpolateImageFunction<BaseImage>
+::EvaluateInside(double *v, double x, double y, double z, int vt) const
+{
+  Superclass::EvaluateInside(v, x, y, z, vt);
+}
+
 // -----------------------------------------------------------------------------
 template <class TImage>
 inline typename GenericLinearInterpolateImageFunction<TImage>::VoxelType
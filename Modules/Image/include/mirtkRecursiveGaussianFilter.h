@@ -0,0 +1,193 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_RecursiveGaussianFilter_H
+#define MIRTK_RecursiveGaussianFilter_H
+
+#include <mirtkGenericImage.h>
+#include <mirtkParallel.h>
+#include <mirtkMemory.h>
+
+
+namespace mirtk {
+
+
+/**
+ * Recursive (IIR) approximation of the 1D Gaussian and its derivatives
+ *
+ * Implements the third order recursive Gaussian filter of Young and van Vliet
+ * (Signal Processing 82(2), 2002) with the boundary initialization of Triggs
+ * and Sdika (IEEE Trans. Signal Processing 54(6), 2006) for a signal which is
+ * constant beyond its first and last sample. The number of operations per
+ * sample is independent of the standard deviation of the Gaussian.
+ *
+ * First and second order derivatives are obtained by applying the central
+ * difference operators [1 0 -1]/2 and [1 -2 1] to the smoothed signal.
+ * Both the standard deviation and the derivatives are in units of samples.
+ */
+class RecursiveGaussianFilter
+{
+  /// Standard deviation of Gaussian in number of samples
+  double _Sigma;
+
+  /// Order of derivative (0, 1, or 2)
+  int _Order;
+
+  /// Normalization factor of causal/anti-causal recursions
+  double _B;
+
+  /// Feedback coefficients of causal/anti-causal recursions
+  double _A[3];
+
+  /// Matrix of Triggs and Sdika for initialization of anti-causal recursion
+  double _M[9];
+
+public:
+
+  /// Smallest standard deviation for which the filter approximates a Gaussian
+  static double MinimumSigma();
+
+  /// Constructor
+  RecursiveGaussianFilter(double sigma = 1.0, int order = 0);
+
+  /// Compute filter coefficients for given standard deviation and order
+  void Initialize(double sigma, int order = 0);
+
+  /// Standard deviation of Gaussian in number of samples
+  double Sigma() const;
+
+  /// Order of derivative
+  int Order() const;
+
+  /// Filter samples of a contiguous 1D signal in place
+  ///
+  /// \param[in,out] x Signal samples.
+  /// \param[in]     n Number of samples.
+  void Filter(double *x, int n) const;
+
+  /// Filter image along the specified dimension
+  ///
+  /// Each image line along the given dimension is filtered independently.
+  /// Image lines of all frames/channels are processed in parallel. The
+  /// input and output image may be the same. The output image must have
+  /// the same size as the input image.
+  ///
+  /// \param[in]  input  Input image.
+  /// \param[out] output Output image.
+  /// \param[in]  dim    Image dimension (0: x, 1: y, 2: z, 3: t).
+  template <class TIn, class TOut>
+  void Run(const GenericImage<TIn> *input, GenericImage<TOut> *output, int dim) const;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+////////////////////////////////////////////////////////////////////////////////
+
+// -----------------------------------------------------------------------------
+inline double RecursiveGaussianFilter::Sigma() const
+{
+  return _Sigma;
+}
+
+// -----------------------------------------------------------------------------
+inline int RecursiveGaussianFilter::Order() const
+{
+  return _Order;
+}
+
+// -----------------------------------------------------------------------------
+namespace RecursiveGaussianFilterUtils {
+
+
+/// Filter image lines along one dimension
+template <class TIn, class TOut>
+struct FilterImageLines
+{
+  const RecursiveGaussianFilter *_Filter;
+  const TIn                     *_Input;
+  TOut                          *_Output;
+  int                            _Size[4];    ///< Image size
+  int                            _Stride[4];  ///< Offset between adjacent voxels
+  int                            _Dimension;  ///< Dimension along which to filter
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    // Sizes and strides of the three dimensions orthogonal to the line
+    int n[3], s[3];
+    for (int d = 0, i = 0; d < 4; ++d) {
+      if (d != _Dimension) n[i] = _Size[d], s[i] = _Stride[d], ++i;
+    }
+    const int N      = _Size  [_Dimension];
+    const int stride = _Stride[_Dimension];
+
+    double *line = Allocate<double>(N);
+    for (int l = re.begin(); l != re.end(); ++l) {
+      // Offset of first voxel of image line
+      const int i = l % n[0];
+      const int j = (l / n[0]) % n[1];
+      const int k = (l / n[0]) / n[1];
+      const int offset = i * s[0] + j * s[1] + k * s[2];
+      // Filter image line
+      const TIn *in = _Input + offset;
+      for (int m = 0; m < N; ++m, in += stride) line[m] = static_cast<double>(*in);
+      _Filter->Filter(line, N);
+      TOut *out = _Output + offset;
+      for (int m = 0; m < N; ++m, out += stride) *out = voxel_cast<TOut>(line[m]);
+    }
+    Deallocate(line);
+  }
+};
+
+
+} // namespace RecursiveGaussianFilterUtils
+
+// -----------------------------------------------------------------------------
+template <class TIn, class TOut>
+void RecursiveGaussianFilter::Run(const GenericImage<TIn> *input, GenericImage<TOut> *output, int dim) const
+{
+  RecursiveGaussianFilterUtils::FilterImageLines<TIn, TOut> body;
+  body._Filter    = this;
+  body._Input     = input ->Data();
+  body._Output    = output->Data();
+  body._Size  [0] = input->X();
+  body._Size  [1] = input->Y();
+  body._Size  [2] = input->Z();
+  body._Size  [3] = input->T();
+  body._Stride[0] = 1;
+  body._Stride[1] = input->X();
+  body._Stride[2] = input->X() * input->Y();
+  body._Stride[3] = input->X() * input->Y() * input->Z();
+  body._Dimension = dim;
+  if (body._Size[dim] < 2) {
+    if (static_cast<const void *>(input) != static_cast<const void *>(output)) {
+      for (int idx = 0; idx < input->NumberOfVoxels(); ++idx) {
+        output->Put(idx, voxel_cast<TOut>(input->Get(idx)));
+      }
+    }
+    return;
+  }
+  const int nlines = input->NumberOfVoxels() / body._Size[dim];
+  parallel_for(blocked_range<int>(0, nlines), body);
+}
+
+
+} // namespace mirtk
+
+#endif // MIRTK_RecursiveGaussianFilter_H
@@ -77,6 +77,18 @@ private:
   // ---------------------------------------------------------------------------
   // Interim
 
+  /// Intermediate displacement field and requested derivatives stacked as
+  /// channels of a single image
+  ///
+  /// The separate intermediate images below wrap the channels of this image.
+  /// A squaring step thus interpolates all quantities at the transformed voxel
+  /// position at once using the same interpolation weights.
+  mirtkComponentMacro(ImageType, InterimChannels);
+
+  /// Output of squaring step whose memory is swapped with the intermediate
+  /// channels after each step instead of copying the updated values
+  mirtkComponentMacro(ImageType, InterimBuffer);
+
   /// Intermediate displacement field
   mirtkComponentMacro(ImageType, InterimDisplacement);
 
@@ -92,6 +104,9 @@ private:
   /// Intermediate Jacobian w.r.t. v
   mirtkComponentMacro(ImageType, InterimJacobianDOFs);
 
+  /// Interpolator of all intermediate channels used by squaring steps
+  mirtkComponentMacro(JacobianField, Channels);
+
   /// Interpolator of intermediate displacement field
   mirtkComponentMacro(DisplacementField, Displacement);
 
@@ -198,6 +213,9 @@ protected:
   /// Finalize filter
   virtual void Finalize();
 
+  /// (Re-)wrap channels of intermediate image by separate images
+  void WrapInterimChannels();
+
   /// Resample intermediate filter output
   template <class TInterpolator> void Resample(ImageType *, TInterpolator *);
 
@@ -19,11 +19,12 @@
 
 #include <mirtkConnectedComponents.h>
 
-#include <mirtkAssert.h>
-#include <mirtkQueue.h>
-#include <mirtkOrderedSet.h>
+#include <mirtkMath.h>
+#include <mirtkParallel.h>
 #include <mirtkAlgorithm.h>
 
+#include <atomic>
+
 
 namespace mirtk {
 
@@ -32,83 +33,250 @@ namespace mirtk {
 // Auxiliaries
 // =============================================================================
 
+namespace ConnectedComponentsUtils {
+
+
+/// Number of pages (slices) per slab labeled by one task of the first pass
+const int SlabSize = 8;
+
 // -----------------------------------------------------------------------------
-/// Marks all voxels as unvisited and collects set of unique segmentation labels
-template <class TLabel>
-void MarkUnvisited(const GenericImage<TLabel> &segmentation,
-                   GenericImage<TLabel>       &components)
+/// Offset of neighboring voxel
+struct NeighborOffset
 {
-  for (int idx = 0; idx < segmentation.NumberOfVoxels(); ++idx) {
-    if (segmentation(idx)) {
-      components(idx) = voxel_limits<TLabel>::max();
-    } else {
-      components(idx) = 0;
+  int di, dj, dk;
+};
+
+// -----------------------------------------------------------------------------
+/// Get offsets of neighbors which precede a voxel in raster scan order
+///
+/// For each connectivity type, the neighbors which have a lower linear index
+/// than the center voxel are visited before the voxel itself during the first
+/// pass of the two-pass labeling. The remaining neighbors are the same set
+/// of voxels mirrored about the center voxel.
+Array<NeighborOffset> PrecedingNeighbors(ConnectivityType connectivity)
+{
+  int max_dist;
+  switch (connectivity) {
+    case CONNECTIVITY_4:
+    case CONNECTIVITY_6:  max_dist = 1; break;
+    case CONNECTIVITY_18: max_dist = 2; break;
+    case CONNECTIVITY_26: max_dist = 3; break;
+    default:
+      cerr << "ConnectedComponents: Invalid connectivity type" << endl;
+      exit(1);
+  }
+  Array<NeighborOffset> offsets;
+  NeighborOffset offset;
+  for (offset.dk = -1; offset.dk <= 1; ++offset.dk)
+  for (offset.dj = -1; offset.dj <= 1; ++offset.dj)
+  for (offset.di = -1; offset.di <= 1; ++offset.di) {
+    if (connectivity == CONNECTIVITY_4 && offset.dk != 0) continue;
+    const int dist = abs(offset.di) + abs(offset.dj) + abs(offset.dk);
+    if (dist == 0 || dist > max_dist) continue;
+    if (offset.dk < 0 || (offset.dk == 0 && (offset.dj < 0 || (offset.dj == 0 && offset.di < 0)))) {
+      offsets.push_back(offset);
     }
   }
+  return offsets;
 }
 
 // -----------------------------------------------------------------------------
-/// Finds index of next unlabeled component voxel or -1 when done
+/// Disjoint-set forest of voxel indices with lock-free union operation
+///
+/// The root of each set is always the voxel with the lowest linear index,
+/// i.e., the voxel which is visited first in raster scan order. This is the
+/// same voxel which was used as seed by the previous region growing approach
+/// and hence the order of the final component labels is unchanged.
+class UnionFind
+{
+  Array<std::atomic<int> > _Parent;
+
+public:
+
+  /// Constructor
+  UnionFind(int n) : _Parent(n) {}
+
+  /// Make voxel the root of a new set
+  void MakeSet(int i)
+  {
+    _Parent[i].store(i, std::memory_order_relaxed);
+  }
+
+  /// Find root of set containing given voxel
+  ///
+  /// Uses path halving which is safe in the presence of concurrent unions,
+  /// because the parent of a non-root node is only replaced by one of its
+  /// other ancestors.
+  int Find(int i)
+  {
+    int p = _Parent[i].load();
+    while (p != i) {
+      const int gp = _Parent[p].load();
+      if (gp != p) _Parent[i].store(gp);
+      i = p, p = gp;
+    }
+    return i;
+  }
+
+  /// Merge sets containing the two given voxels
+  void Union(int a, int b)
+  {
+    while (true) {
+      a = Find(a);
+      b = Find(b);
+      if (a == b) return;
+      if (a < b) swap(a, b);
+      // Link root with higher index to root with lower index unless
+      // another thread modified the parent of the former in the meantime
+      int expected = a;
+      if (_Parent[a].compare_exchange_strong(expected, b)) return;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Base class of parallel labeling passes over slabs of image pages
 template <class TLabel>
-int NextSeed(const GenericImage<TLabel> &components)
+struct LabelingPass
 {
-  for (int idx = 0; idx < components.NumberOfVoxels(); ++idx) {
-    if (components(idx) == voxel_limits<TLabel>::max()) return idx;
+  const TLabel                *_Labels;
+  const NeighborOffset        *_Offsets;
+  int                          _NumberOfOffsets;
+  UnionFind                   *_Sets;
+  int                          _X, _Y, _Z;
+  int                          _NumberOfPages;
+
+  /// Merge voxel with preceding neighbors with the same label
+  ///
+  /// Only neighbors in pages [k1, k2] are considered, where the page index
+  /// runs over the slices of all frames. Slices of different frames are
+  /// not connected.
+  void Merge(int i, int j, int k, int idx, int k1, int k2) const
+  {
+    const int kz = k % _Z;
+    for (int n = 0; n < _NumberOfOffsets; ++n) {
+      const NeighborOffset &o = _Offsets[n];
+      const int ni = i + o.di, nj = j + o.dj, nk = kz + o.dk;
+      if (ni < 0 || ni >= _X || nj < 0 || nj >= _Y || nk < 0) continue;
+      if (k + o.dk < k1 || k + o.dk > k2) continue;
+      const int nidx = idx + o.di + _X * (o.dj + _Y * o.dk);
+      if (_Labels[nidx] == _Labels[idx]) _Sets->Union(idx, nidx);
+    }
   }
-  return -1;
-}
+};
 
 // -----------------------------------------------------------------------------
-/// Performs region growing for a specific input label and seed
+/// First pass: label each slab of pages independently
 template <class TLabel>
-int LabelComponent(const NeighborhoodOffsets  &offsets,
-                   const GenericImage<TLabel> &segmentation,
-                   GenericImage<TLabel>       &components,
-                   int                         seed,
-                   TLabel                      component_label)
+struct LabelSlabs : public LabelingPass<TLabel>
 {
-  const TLabel unvisited     = voxel_limits<TLabel>::max();
-  const TLabel current_label = segmentation(seed);
-  const TLabel * start_label = segmentation.Data();
-
-  int idx, neighbor_idx, num = 0;
-  Queue<int> active;
-  active.push(seed);
-
-  while (!active.empty()) {
-    idx = active.front();
-    active.pop();
-    if (components(idx) == unvisited) {
-      components(idx) = component_label, ++num;
-      if (segmentation.IsBoundary(idx)) {
-        const TLabel *neighbor_label, *label = segmentation.Data(idx);
-        const TLabel *neighbor_comp,  *comp  = components.Data(idx);
-        for (int n = 0; n < offsets.Size(); ++n) {
-          neighbor_label = label + offsets(n);
-          neighbor_idx   = static_cast<int>(neighbor_label - start_label);
-          if (0 <= neighbor_idx && neighbor_idx < segmentation.NumberOfVoxels()) {
-            neighbor_comp = comp + offsets(n);
-            if (*neighbor_label == current_label && *neighbor_comp == unvisited) {
-              active.push(neighbor_idx);
-            }
-          }
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int s = re.begin(); s != re.end(); ++s) {
+      const int k0 = s * SlabSize;
+      const int k1 = min(k0 + SlabSize, this->_NumberOfPages);
+      int idx = k0 * this->_X * this->_Y;
+      for (int k = k0; k < k1; ++k)
+      for (int j = 0; j < this->_Y; ++j)
+      for (int i = 0; i < this->_X; ++i, ++idx) {
+        if (this->_Labels[idx]) {
+          this->_Sets->MakeSet(idx);
+          this->Merge(i, j, k, idx, k0, k);
         }
-      } else {
-        const TLabel *neighbor_label, *label  = segmentation.Data(idx);
-        const TLabel *neighbor_comp,  *comp = components.Data(idx);
-        for (int n = 0; n < offsets.Size(); ++n) {
-          neighbor_label = label + offsets(n);
-          neighbor_comp  = comp  + offsets(n);
-          if (*neighbor_label == current_label && *neighbor_comp == unvisited) {
-            active.push(static_cast<int>(neighbor_label - start_label));
-          }
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Second pass: merge sets across the boundaries between adjacent slabs
+template <class TLabel>
+struct MergeSlabs : public LabelingPass<TLabel>
+{
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int s = re.begin(); s != re.end(); ++s) {
+      const int k = s * SlabSize;
+      if (k % this->_Z == 0) continue; // first page of a frame
+      int idx = k * this->_X * this->_Y;
+      for (int j = 0; j < this->_Y; ++j)
+      for (int i = 0; i < this->_X; ++i, ++idx) {
+        if (this->_Labels[idx]) this->Merge(i, j, k, idx, k - 1, k - 1);
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Count number of components whose root voxel is within each slab
+template <class TLabel>
+struct CountRoots : public LabelingPass<TLabel>
+{
+  int *_Count;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int s = re.begin(); s != re.end(); ++s) {
+      const int idx1 = s * SlabSize * this->_X * this->_Y;
+      const int idx2 = min((s + 1) * SlabSize, this->_NumberOfPages) * this->_X * this->_Y;
+      _Count[s] = 0;
+      for (int idx = idx1; idx < idx2; ++idx) {
+        if (this->_Labels[idx] && this->_Sets->Find(idx) == idx) ++_Count[s];
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Assign consecutive component labels to root voxels in raster scan order
+template <class TLabel>
+struct LabelRoots : public LabelingPass<TLabel>
+{
+  const int *_Offset;
+  TLabel    *_Components;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int s = re.begin(); s != re.end(); ++s) {
+      const int idx1 = s * SlabSize * this->_X * this->_Y;
+      const int idx2 = min((s + 1) * SlabSize, this->_NumberOfPages) * this->_X * this->_Y;
+      int c = _Offset[s];
+      for (int idx = idx1; idx < idx2; ++idx) {
+        if (this->_Labels[idx]) {
+          if (this->_Sets->Find(idx) == idx) _Components[idx] = voxel_cast<TLabel>(++c);
+        } else {
+          _Components[idx] = 0;
         }
       }
     }
   }
+};
 
-  return num;
-}
+// -----------------------------------------------------------------------------
+/// Final relabeling pass: assign label of root voxel to all other voxels
+template <class TLabel>
+struct LabelComponents : public LabelingPass<TLabel>
+{
+  TLabel *_Components;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int s = re.begin(); s != re.end(); ++s) {
+      const int idx1 = s * SlabSize * this->_X * this->_Y;
+      const int idx2 = min((s + 1) * SlabSize, this->_NumberOfPages) * this->_X * this->_Y;
+      for (int idx = idx1; idx < idx2; ++idx) {
+        if (this->_Labels[idx]) {
+          const int root = this->_Sets->Find(idx);
+          if (root != idx) _Components[idx] = _Components[root];
+        }
+      }
+    }
+  }
+};
+
+
+} // namespace ConnectedComponentsUtils
+using namespace ConnectedComponentsUtils;
 
 // =============================================================================
 // Construction/Destruction
@@ -142,9 +310,6 @@ void ConnectedComponents<VoxelType>::Initialize()
 
   _NumberOfComponents = 0;
   _ComponentSize.clear();
-
-  MarkUnvisited(*this->Input(), *this->Output());
-  _Offsets.Initialize(this->Input(), _Connectivity);
 }
 
 // -----------------------------------------------------------------------------
@@ -153,18 +318,71 @@ void ConnectedComponents<VoxelType>::Run()
 {
   this->Initialize();
 
-  int num, seed;
-  VoxelType c = 0;
-  while ((seed = NextSeed(*this->Output())) != -1) {
-    if (++c == voxel_limits<VoxelType>::max()) {
-      cerr << "ConnectedComponents::Run: No. of components exceeded maximum label value!" << endl;
-      exit(1);
-    }
-    num = LabelComponent(_Offsets, *this->Input(), *this->Output(), seed, c);
-    mirtkAssert(num > 0, "found seed must be valid and no. of unvisited voxels decrease");
-    _ComponentSize.push_back(num);
+  const GenericImage<VoxelType> &input  = *this->Input();
+  GenericImage<VoxelType>       &output = *this->Output();
+
+  // Union-find of voxels with non-zero label
+  UnionFind sets(input.NumberOfVoxels());
+  const Array<NeighborOffset> offsets = PrecedingNeighbors(_Connectivity);
+
+  // Pages of all frames are processed in slabs of SlabSize pages each
+  const int npages = input.Z() * input.T();
+  const int nslabs = (npages + SlabSize - 1) / SlabSize;
+
+  LabelingPass<VoxelType> pass;
+  pass._Labels          = input.Data();
+  pass._Offsets         = offsets.data();
+  pass._NumberOfOffsets = static_cast<int>(offsets.size());
+  pass._Sets            = &sets;
+  pass._X               = input.X();
+  pass._Y               = input.Y();
+  pass._Z               = input.Z();
+  pass._NumberOfPages   = npages;
+
+  // First pass: label each slab independently
+  LabelSlabs<VoxelType> label_slabs;
+  static_cast<LabelingPass<VoxelType> &>(label_slabs) = pass;
+  parallel_for(blocked_range<int>(0, nslabs), label_slabs);
+
+  // Merge labels of adjacent slabs
+  MergeSlabs<VoxelType> merge_slabs;
+  static_cast<LabelingPass<VoxelType> &>(merge_slabs) = pass;
+  parallel_for(blocked_range<int>(1, nslabs), merge_slabs);
+
+  // Number components in order of their first voxel in raster scan order
+  Array<int> count(nslabs), offset(nslabs);
+  CountRoots<VoxelType> count_roots;
+  static_cast<LabelingPass<VoxelType> &>(count_roots) = pass;
+  count_roots._Count = count.data();
+  parallel_for(blocked_range<int>(0, nslabs), count_roots);
+  int c = 0;
+  for (int s = 0; s < nslabs; ++s) {
+    offset[s] = c;
+    c += count[s];
+  }
+  if (c >= static_cast<int>(voxel_limits<VoxelType>::max())) {
+    cerr << "ConnectedComponents::Run: No. of components exceeded maximum label value!" << endl;
+    exit(1);
+  }
+  _NumberOfComponents = c;
+
+  LabelRoots<VoxelType> label_roots;
+  static_cast<LabelingPass<VoxelType> &>(label_roots) = pass;
+  label_roots._Offset     = offset.data();
+  label_roots._Components = output.Data();
+  parallel_for(blocked_range<int>(0, nslabs), label_roots);
+
+  // Final relabeling pass
+  LabelComponents<VoxelType> label_components;
+  static_cast<LabelingPass<VoxelType> &>(label_components) = pass;
+  label_components._Components = output.Data();
+  parallel_for(blocked_range<int>(0, nslabs), label_components);
+
+  // Determine sizes of components
+  _ComponentSize.resize(_NumberOfComponents, 0);
+  for (int idx = 0; idx < output.NumberOfVoxels(); ++idx) {
+    if (output(idx) > 0) ++_ComponentSize[output(idx) - 1];
   }
-  _NumberOfComponents = static_cast<int>(c);
 
   this->Finalize();
 }
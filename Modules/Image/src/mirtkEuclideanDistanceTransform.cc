@@ -18,9 +18,13 @@
 
 #include <mirtkEuclideanDistanceTransform.h>
 
+#include <mirtkMemory.h>
+#include <mirtkParallel.h>
+
 #include <cmath>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 
 #define EDT_MAX_IMAGE_DIMENSION 26754
 #define EDT_MAX_DISTANCE_SQUARED 2147329548
@@ -326,43 +330,16 @@ int EuclideanDistanceTransform<VoxelType>::edtVornoiEDT(long *f, long n)
 
 // -----------------------------------------------------------------------------
 // This is Procedure edtVornoiEDT() in tPAMI paper.
+//
+// In order to be thread-safe, the arrays g and h used to store the partial
+// Vornoi diagram must be provided by the caller. Each array must have
+// (at least) n elements.
 template <class VoxelType>
-int EuclideanDistanceTransform<VoxelType>::edtVornoiEDT_anisotropic(VoxelType *f, long n, double w)
+int EuclideanDistanceTransform<VoxelType>
+::edtVornoiEDT_anisotropic(VoxelType *f, long n, double w, float *g, float *h)
 {
   long i, l, n_S;
   float a, b, c, v, lhs, rhs;
-  static int firstCall = 1;
-  static long size_gh = 0;
-  static float *g, *h;
-
-  /* this procedure is called often */
-  /* we keep static arrays to avoid frequent calls to malloc() */
-  /* the downside is that this memory is never freed, */
-  /* but it is not so much memory: max(nX,nY,nZ)*sizeof(long) */
-  /* need to check if arrays are sufficiently large */
-  if (n > size_gh && !firstCall) {
-    free(g);
-    free(h);
-    firstCall = 1;
-  }
-  /* malloc arrays if this is first call to procedure, or if arrays */
-  /* are too small and need to be reallocated */
-  if (firstCall) {
-    g = (float *)malloc(n * sizeof(float));
-    if (g == NULL) {
-      fprintf(stderr, "Error in edtVornoiEDT()\n");
-      fprintf(stderr, "Cannot malloc g\n");
-      exit(EXIT_FAILURE);
-    }
-    h = (float *)malloc(n * sizeof(float));
-    if (h == NULL) {
-      fprintf(stderr, "Error in edtVornoiEDT()\n");
-      fprintf(stderr, "Cannot malloc h\n");
-      exit(EXIT_FAILURE);
-    }
-    size_gh = n;
-    firstCall = 0;
-  }
 
   /* construct partial Vornoi diagram */
   /* this loop is lines 1-14 in Procedure edtVornoiEDT() in tPAMI paper */
@@ -434,173 +411,197 @@ int EuclideanDistanceTransform<VoxelType>::edtVornoiEDT_anisotropic(VoxelType *f
   return (1);
 } /* edtVornoiEDT_anisotropic */
 
-// -----------------------------------------------------------------------------
-// This procedure computes the squared EDT of a 2D binary image with anisotropic
-// voxels. See notes for edtComputeEDT_2D. The difference relative to edtComputeEDT_2D
-// is that the edt is a float array instead of a long array, and there are
-// additional parameters for the image voxel dimensions wX and wY.
-template <class VoxelType>
-void EuclideanDistanceTransform<VoxelType>
-::edtComputeEDT_2D_anisotropic(const VoxelType *img, VoxelType *edt, long nX, long nY, double wX, double wY)
-{
-  const VoxelType *c;
-  long i, j, nXY;
-  VoxelType d, *p, *q, *f;
+// =============================================================================
+// Parallel separable passes of anisotropic distance transform
+// =============================================================================
 
-  /* nXY is number of voxels in 2D image */
-  nXY = nX * nY;
+namespace EuclideanDistanceTransformUtils {
 
-  /* if binary image is provided in the array img, copy it to the arry edt */
-  /* this is effectively equivalent to computing D_0 */
-  if (img != NULL) {
-    c = img;
-    p = edt;
-    for (i = 0; i < nXY; i++, c++, p++) {
-      *p = *c;
-    }
-  }
 
-  /* compute D_1 as simple forward-and-reverse distance propagation */
-  /* (instead of calling edtVornoiEDT) */
-  /* D_1 is distance to closest feature voxel in row (x direction) */
-  /* it is possible to use a simple distance propagation for D_1  because */
-  /* L_1 and L_2 norms are equivalent for 1D case */
-  for (j = 0; j < nY; j++) {
-    /* forward pass */
-    p = edt + j * nX;
-    d = EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC;
-    for (i = 0; i < nX; i++, p++) {
-      /* set d = 0 when we encounter a feature voxel */
-      if (*p) {
-        *p = d = 0;
-      }
-      /* increment distance ... */
-      else if (d != EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC) {
-        *p = ++d;
-      }
-      /* ... unless we haven't encountered a feature voxel yet */
-      else {
-        *p = EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC;
-      }
-    }
-    /* reverse pass */
-    if (*(--p) != EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC) {
+// -----------------------------------------------------------------------------
+/// Compute D_1 as simple forward-and-reverse distance propagation along each
+/// row (x direction) of the image. The range is over all rows of all slices.
+template <class VoxelType>
+struct ComputeRowDistances
+{
+  VoxelType *_Data;
+  long       _nX;
+  double     _wX;
+
+  void operator ()(const blocked_range<long> &re) const
+  {
+    long i;
+    VoxelType d, *p;
+    for (long r = re.begin(); r != re.end(); ++r) {
+      /* forward pass */
+      p = _Data + r * _nX;
       d = EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC;
-      for (i = nX - 1; i >= 0; i--, p--) {
+      for (i = 0; i < _nX; i++, p++) {
         /* set d = 0 when we encounter a feature voxel */
-        if (*p == 0) {
-          d = 0;
+        if (*p) {
+          *p = d = 0;
         }
-        /* increment distance after encountering a feature voxel */
+        /* increment distance ... */
         else if (d != EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC) {
-          /* compare forward and reverse distances */
-          if (++d < *p) {
-            *p = d;
+          *p = ++d;
+        }
+        /* ... unless we haven't encountered a feature voxel yet */
+        else {
+          *p = EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC;
+        }
+      }
+      /* reverse pass */
+      if (*(--p) != EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC) {
+        d = EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC;
+        for (i = _nX - 1; i >= 0; i--, p--) {
+          /* set d = 0 when we encounter a feature voxel */
+          if (*p == 0) {
+            d = 0;
+          }
+          /* increment distance after encountering a feature voxel */
+          else if (d != EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC) {
+            /* compare forward and reverse distances */
+            if (++d < *p) {
+              *p = d;
+            }
           }
+          /* square distance */
+          /* (we use squared distance in rest of algorithm) */
+          *p *= _wX;
+          *p *= *p;
         }
-        /* square distance */
-        /* (we use squared distance in rest of algorithm) */
-        *p *= wX;
-        *p *= *p;
       }
     }
   }
+};
 
-  /* compute D_2 = squared EDT */
-  /* solve 1D problem for each column (y direction) */
-  f = (VoxelType *)malloc(nY * sizeof(VoxelType));
-  if (f == NULL) {
-    fprintf(stderr, "Error in edtComputeEDT_2D()\n");
-    fprintf(stderr, "Cannot malloc f\n");
-    exit(EXIT_FAILURE);
-  }
-  for (i = 0; i < nX; i++) {
-    /* fill array f with D_1 distances in column */
-    /* this is essentially line 4 in Procedure VoronoiEDT() in tPAMI paper */
-    p = edt + i;
-    q = f;
-    for (j = 0; j < nY; j++, p += nX, q++) {
-      *q = *p;
-    }
-    /* call edtVornoiEDT */
-    if (edtVornoiEDT_anisotropic(f, nY, wY)) {
-      p = edt + i;
+// -----------------------------------------------------------------------------
+/// Solve 1D problem for each scanline along the y or z direction
+///
+/// The range is over all scanlines, where the first voxel of scanline l is at
+/// offset (l % _M) + (l / _M) * _Step, i.e., _M is the number of scanlines per
+/// slice (y direction) or volume (z direction) and _Step the number of voxels
+/// between consecutive slices or volumes, respectively. The scratch buffers
+/// needed by edtVornoiEDT_anisotropic are allocated once per subrange.
+template <class VoxelType>
+struct ComputeScanlineDistances
+{
+  VoxelType *_Data;
+  long       _N;       ///< Length of each scanline
+  long       _Stride;  ///< Offset between consecutive voxels of a scanline
+  long       _M;       ///< Number of scanlines per slice/volume
+  long       _Step;    ///< Offset between consecutive slices/volumes
+  double     _W;       ///< Voxel size along scanline direction
+
+  void operator ()(const blocked_range<long> &re) const
+  {
+    long       k;
+    VoxelType *p, *q;
+    VoxelType *f = Allocate<VoxelType>(_N);
+    float     *g = Allocate<float>(_N);
+    float     *h = Allocate<float>(_N);
+    for (long l = re.begin(); l != re.end(); ++l) {
+      /* fill array f with distances in scanline */
+      /* this is essentially line 4 in Procedure VoronoiEDT() in tPAMI paper */
+      p = _Data + (l % _M) + (l / _M) * _Step;
       q = f;
-      for (j = 0; j < nY; j++, p += nX, q++) {
-        *p = *q;
+      for (k = 0; k < _N; k++, p += _Stride, q++) {
+        *q = *p;
+      }
+      /* call edtVornoiEDT */
+      if (EuclideanDistanceTransform<VoxelType>::edtVornoiEDT_anisotropic(f, _N, _W, g, h)) {
+        p = _Data + (l % _M) + (l / _M) * _Step;
+        q = f;
+        for (k = 0; k < _N; k++, p += _Stride, q++) {
+          *p = *q;
+        }
       }
     }
+    Deallocate(f);
+    Deallocate(g);
+    Deallocate(h);
   }
-  free(f);
-} /* edtComputeEDT_2D_anisotropic */
+};
+
+
+} // namespace EuclideanDistanceTransformUtils
+using namespace EuclideanDistanceTransformUtils;
 
 // -----------------------------------------------------------------------------
-// This procedure computes the squared EDT of a 3D binary image with anisotropic
-// voxels. See notes for edtComputeEDT_2D_anisotropic.
+// This procedure computes the squared EDT of each of nZ 2D binary images with
+// anisotropic voxels. See notes for edtComputeEDT_2D. The difference relative
+// to edtComputeEDT_2D is that the edt is a float array instead of a long array,
+// and there are additional parameters for the image voxel dimensions wX and wY.
+// The separable passes are executed in parallel over all rows and columns of
+// all slices at once.
 template <class VoxelType>
 void EuclideanDistanceTransform<VoxelType>
-::edtComputeEDT_3D_anisotropic(const VoxelType *img, VoxelType *edt,
-                               long nX, long nY, long nZ, double wX, double wY, double wZ)
+::edtComputeEDT_2D_anisotropic(const VoxelType *img, VoxelType *edt,
+                               long nX, long nY, long nZ, double wX, double wY)
 {
-  const VoxelType *c;
-  long i, k, nXY, nXYZ;
-  VoxelType *p, *q, *f;
-
-  /* nXY is number of voxels in each plane (xy) */
-  /* nXYZ is number of voxels in 3D image */
-  nXY = nX * nY;
-  nXYZ = nX * nY * nZ;
-
   /* if binary image is provided in the array img, copy it to the arry edt */
   /* this is effectively equivalent to computing D_0 */
-  if (img != NULL) {
-    c = img;
-    p = edt;
-    for (i = 0; i < nXYZ; i++, c++, p++) {
-      *p = *c;
-    }
+  if (img != NULL && img != edt) {
+    memcpy(edt, img, nX * nY * nZ * sizeof(VoxelType));
   }
 
-  /* compute D_2 */
-  /* call edtComputeEDT_2D for each plane */
-  p = edt;
-  for (k = 0; k < nZ; k++, p += nXY) {
-    edtComputeEDT_2D_anisotropic(NULL, p, nX, nY, wX, wY);
+  /* compute D_1 as simple forward-and-reverse distance propagation */
+  /* (instead of calling edtVornoiEDT) */
+  /* D_1 is distance to closest feature voxel in row (x direction) */
+  /* it is possible to use a simple distance propagation for D_1  because */
+  /* L_1 and L_2 norms are equivalent for 1D case */
+  ComputeRowDistances<VoxelType> rows;
+  rows._Data = edt;
+  rows._nX   = nX;
+  rows._wX   = wX;
+  parallel_for(blocked_range<long>(0, nY * nZ), rows);
+
+  /* compute D_2 = squared EDT */
+  /* solve 1D problem for each column (y direction) */
+  if (nY > 1) {
+    ComputeScanlineDistances<VoxelType> cols;
+    cols._Data   = edt;
+    cols._N      = nY;
+    cols._Stride = nX;
+    cols._M      = nX;
+    cols._Step   = nX * nY;
+    cols._W      = wY;
+    parallel_for(blocked_range<long>(0, nX * nZ), cols);
   }
+} /* edtComputeEDT_2D_anisotropic */
+
+// -----------------------------------------------------------------------------
+// This procedure computes the squared EDT of each of nT 3D binary images with
+// anisotropic voxels. See notes for edtComputeEDT_2D_anisotropic.
+template <class VoxelType>
+void EuclideanDistanceTransform<VoxelType>
+::edtComputeEDT_3D_anisotropic(const VoxelType *img, VoxelType *edt,
+                               long nX, long nY, long nZ, long nT,
+                               double wX, double wY, double wZ)
+{
+  /* compute D_2 */
+  /* compute 2D EDT of all planes of all volumes */
+  edtComputeEDT_2D_anisotropic(img, edt, nX, nY, nZ * nT, wX, wY);
 
   /* compute D_3 */
   /* solve 1D problem for each column (z direction) */
-  f = (VoxelType *)malloc(nZ * sizeof(VoxelType));
-  if (f == NULL) {
-    fprintf(stderr, "Error in edtComputeEDT_3D()\n");
-    fprintf(stderr, "Cannot malloc f\n");
-    exit(EXIT_FAILURE);
+  if (nZ > 1) {
+    ComputeScanlineDistances<VoxelType> cols;
+    cols._Data   = edt;
+    cols._N      = nZ;
+    cols._Stride = nX * nY;
+    cols._M      = nX * nY;
+    cols._Step   = nX * nY * nZ;
+    cols._W      = wZ;
+    parallel_for(blocked_range<long>(0, nX * nY * nT), cols);
   }
-  for (i = 0; i < nXY; i++) {
-    /* fill array f with D_2 distances in column */
-    /* this is essentially line 4 in Procedure VoronoiEDT() in tPAMI paper */
-    p = edt + i;
-    q = f;
-    for (k = 0; k < nZ; k++, p += nXY, q++) {
-      *q = *p;
-    }
-    /* call edtVornoiEDT */
-    if (edtVornoiEDT_anisotropic(f, nZ, wZ)) {
-      p = edt + i;
-      q = f;
-      for (k = 0; k < nZ; k++, p += nXY, q++) {
-	*p = *q;
-      }
-    }
-  }
-  free(f);
 } /* edtComputeEDT_3D_anisotropic */
 
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 void EuclideanDistanceTransform<VoxelType>::Run()
 {
-  int nx, ny, nz, nt, z, t;
+  long nx, ny, nz, nt;
   double wx, wy, wz;
 
   // Do the initial set up
@@ -614,22 +615,16 @@ void EuclideanDistanceTransform<VoxelType>::Run()
 
   // Calculate voxel size
   this->_Input->GetPixelSize(&wx, &wy, &wz);
-  for ( t = 0; t < nt; t++){
-	  if (this->_distanceTransformMode == EuclideanDistanceTransform::DT_3D) {
-		  // Calculate 3D distance transform
-		  edtComputeEDT_3D_anisotropic(
-        this->_Input ->Data(0,0,0,t),
-			  this->_Output->Data(0,0,0,t),
-			  nx, ny, nz, wx, wy, wz);
-	  } else {
-		  for (z = 0; z < nz; z++) {
-			  // Calculate 2D distance transform slice by slice
-			  edtComputeEDT_2D_anisotropic(
-          this->_Input ->Data(0, 0, z, t),
-				  this->_Output->Data(0, 0, z, t),
-				  nx, ny, wx, wy);
-		  }
-	  }
+
+  // Compute distance transforms of all frames at once
+  if (this->_distanceTransformMode == EuclideanDistanceTransform::DT_3D) {
+    edtComputeEDT_3D_anisotropic(this->_Input ->Data(),
+                                 this->_Output->Data(),
+                                 nx, ny, nz, nt, wx, wy, wz);
+  } else {
+    edtComputeEDT_2D_anisotropic(this->_Input ->Data(),
+                                 this->_Output->Data(),
+                                 nx, ny, nz * nt, wx, wy);
   }
 
   // Do the final cleaning up
@@ -24,6 +24,7 @@
 #include <mirtkMemory.h>
 #include <mirtkGenericImage.h>
 #include <mirtkConvolutionFunction.h>
+#include <mirtkRecursiveGaussianFilter.h>
 #include <mirtkScalarFunctionToImage.h>
 #include <mirtkScalarGaussian.h>
 #include <mirtkProfiling.h>
@@ -41,6 +42,8 @@ GaussianBlurring<VoxelType>::GaussianBlurring(double sigma)
   _SigmaY(sigma),
   _SigmaZ(sigma),
   _SigmaT(.0),
+  _Recursive(false),
+  _RecursiveThreshold(numeric_limits<double>::infinity()),
   _Kernel(NULL)
 {
 }
@@ -53,6 +56,8 @@ GaussianBlurring<VoxelType>::GaussianBlurring(double xsigma, double ysigma, doub
   _SigmaY(ysigma),
   _SigmaZ(zsigma),
   _SigmaT(tsigma),
+  _Recursive(false),
+  _RecursiveThreshold(numeric_limits<double>::infinity()),
   _Kernel(NULL)
 {
 }
@@ -118,6 +123,14 @@ void GaussianBlurring<VoxelType>::InitializeKernel(double sigma)
   }
 }
 
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+bool GaussianBlurring<VoxelType>::UseRecursiveFilter(double sigma) const
+{
+  if (sigma < RecursiveGaussianFilter::MinimumSigma()) return false;
+  return _Recursive || sigma >= _RecursiveThreshold;
+}
+
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 void GaussianBlurring<VoxelType>::Run()
@@ -136,11 +149,16 @@ void GaussianBlurring<VoxelType>::Run()
   // Blur along x axis
   if (_SigmaX != .0 && input->X() > 1) {
     if (output == this->Input()) output = new GenericImage<VoxelType>(attr);
-    this->InitializeKernel(_SigmaX / input->GetXSize());
-    for (int n = 0; n < N; ++n) {
-      using ConvolutionFunction::ConvolveInX;
-      ConvolveInX<RealPixel> conv(input, _Kernel->Data(), _Kernel->X(), true, n);
-      ParallelForEachVoxel(attr, input, output, conv);
+    const double sigma = _SigmaX / input->GetXSize();
+    if (this->UseRecursiveFilter(sigma)) {
+      RecursiveGaussianFilter(sigma).Run(input, output, 0);
+    } else {
+      this->InitializeKernel(sigma);
+      for (int n = 0; n < N; ++n) {
+        using ConvolutionFunction::ConvolveInX;
+        ConvolveInX<RealPixel> conv(input, _Kernel->Data(), _Kernel->X(), true, n);
+        ParallelForEachVoxel(attr, input, output, conv);
+      }
     }
     swap(input, output);
   }
@@ -148,11 +166,15 @@ void GaussianBlurring<VoxelType>::Run()
   // Blur along y axis
   if (_SigmaY != .0 && input->Y() > 1) {
     if (output == this->Input()) output = new GenericImage<VoxelType>(attr);
-    this->InitializeKernel(_SigmaY / input->GetYSize());
-    for (int n = 0; n < N; ++n) {
-      using ConvolutionFunction::ConvolveInY;
-      ConvolveInY<RealPixel> conv(input, _Kernel->Data(), _Kernel->X(), true, n);
-      ParallelForEachVoxel(attr, input, output, conv);
+    const double sigma = _SigmaY / input->GetYSize();
+    if (this->UseRecursiveFilter(sigma)) {
+      RecursiveGaussianFilter(sigma).Run(input, output, 1);
+    } else {
+      this->InitializeKernel(sigma);
+      using ConvolutionFunction::ConvolveRow;
+      using ConvolutionFunction::ConvolveRows;
+      ConvolveRow<RealPixel> conv(_Kernel->Data(), _Kernel->X(), true);
+      ConvolveRows(input, output, 1, conv);
     }
     swap(input, output);
   }
@@ -160,11 +182,15 @@ void GaussianBlurring<VoxelType>::Run()
   // Blur along z axis
   if (_SigmaZ != .0 && input->Z() > 1) {
     if (output == this->Input()) output = new GenericImage<VoxelType>(attr);
-    this->InitializeKernel(_SigmaZ / input->GetZSize());
-    for (int n = 0; n < N; ++n) {
-      using ConvolutionFunction::ConvolveInZ;
-      ConvolveInZ<RealPixel> conv(input, _Kernel->Data(), _Kernel->X(), true, n);
-      ParallelForEachVoxel(attr, input, output, conv);
+    const double sigma = _SigmaZ / input->GetZSize();
+    if (this->UseRecursiveFilter(sigma)) {
+      RecursiveGaussianFilter(sigma).Run(input, output, 2);
+    } else {
+      this->InitializeKernel(sigma);
+      using ConvolutionFunction::ConvolveRow;
+      using ConvolutionFunction::ConvolveRows;
+      ConvolveRow<RealPixel> conv(_Kernel->Data(), _Kernel->X(), true);
+      ConvolveRows(input, output, 2, conv);
     }
     swap(input, output);
   }
@@ -172,10 +198,15 @@ void GaussianBlurring<VoxelType>::Run()
   // Blur along t axis
   if (_SigmaT != .0 && input->T() > 1) {
     if (output == this->Input()) output = new GenericImage<VoxelType>(attr);
-    this->InitializeKernel(_SigmaT / input->GetTSize());
-    using ConvolutionFunction::ConvolveInT;
-    ConvolveInT<RealPixel> conv(input, _Kernel->Data(), _Kernel->X(), true);
-    ParallelForEachVoxel(attr, input, output, conv);
+    const double sigma = _SigmaT / input->GetTSize();
+    if (this->UseRecursiveFilter(sigma)) {
+      RecursiveGaussianFilter(sigma).Run(input, output, 3);
+    } else {
+      this->InitializeKernel(sigma);
+      using ConvolutionFunction::ConvolveInT;
+      ConvolveInT<RealPixel> conv(input, _Kernel->Data(), _Kernel->X(), true);
+      ParallelForEachVoxel(attr, input, output, conv);
+    }
     swap(input, output);
   }
 
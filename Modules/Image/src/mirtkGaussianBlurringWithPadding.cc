@@ -105,11 +105,9 @@ void GaussianBlurringWithPadding<VoxelType>::Run()
   if (this->_SigmaY != .0 && input->Y() > 1) {
     if (output == this->Input()) output = new GenericImage<VoxelType>(attr);
     this->InitializeKernel(this->_SigmaY / input->GetYSize());
-    typedef ConvolutionFunction::ConvolveTruncatedForegroundInY<RealPixel> Conv;
-    for (int n = 0; n < N; ++n) {
-      Conv conv(input, _PaddingValue, this->_Kernel->Data(), this->_Kernel->X(), true, n);
-      ParallelForEachVoxel(attr, input, output, conv);
-    }
+    typedef ConvolutionFunction::ConvolveTruncatedForegroundRow<RealPixel> Conv;
+    Conv conv(_PaddingValue, this->_Kernel->Data(), this->_Kernel->X(), true);
+    ConvolutionFunction::ConvolveRows(input, output, 1, conv);
     swap(input, output);
   }
 
@@ -117,11 +115,9 @@ void GaussianBlurringWithPadding<VoxelType>::Run()
   if (this->_SigmaZ != .0 && input->Z() > 1) {
     if (output == this->Input()) output = new GenericImage<VoxelType>(attr);
     this->InitializeKernel(this->_SigmaZ / input->GetZSize());
-    typedef ConvolutionFunction::ConvolveTruncatedForegroundInZ<RealPixel> Conv;
-    for (int n = 0; n < N; ++n) {
-      Conv conv(input, _PaddingValue, this->_Kernel->Data(), this->_Kernel->X(), true, n);
-      ParallelForEachVoxel(attr, input, output, conv);
-    }
+    typedef ConvolutionFunction::ConvolveTruncatedForegroundRow<RealPixel> Conv;
+    Conv conv(_PaddingValue, this->_Kernel->Data(), this->_Kernel->X(), true);
+    ConvolutionFunction::ConvolveRows(input, output, 2, conv);
     swap(input, output);
   }
 
@@ -83,8 +83,7 @@ void GaussianPyramidFilter<VoxelType>::Downsample()
 
   // Type of downsampling voxel function
   typedef DownsampleConvolvedExtendedForegroundInX<VoxelType, RealPixel> DownsampleInX;
-  typedef DownsampleConvolvedExtendedForegroundInY<VoxelType, RealPixel> DownsampleInY;
-  typedef DownsampleConvolvedExtendedForegroundInZ<VoxelType, RealPixel> DownsampleInZ;
+  typedef ConvolveExtendedForegroundRow<RealPixel>                        DownsampleRow;
 
   // FIXME: The GaussianPyramidFilter shifts the image origin incorrectly!
   cerr << "WARNING: The GaussianPyramidFilter shifts the image origin" << endl;
@@ -120,26 +119,28 @@ void GaussianPyramidFilter<VoxelType>::Downsample()
 
     // Downsample y dimension
     if (attr._y > 1) {
-      DownsampleInY downsampleY(output, 2, kernel, size, norm);
+      DownsampleRow downsampleY(output->GetBackgroundValueAsDouble(), kernel, size, norm);
+      const int offset = (attr._y % 2 + 1) / 2;
       attr._y  /= 2;
       attr._dy *= 2;
-      attr._xorigin += attr._xaxis[1] * downsampleY._Offset * attr._dy;
-      attr._yorigin += attr._yaxis[1] * downsampleY._Offset * attr._dy;
-      attr._zorigin += attr._zaxis[1] * downsampleY._Offset * attr._dy;
+      attr._xorigin += attr._xaxis[1] * offset * attr._dy;
+      attr._yorigin += attr._yaxis[1] * offset * attr._dy;
+      attr._zorigin += attr._zaxis[1] * offset * attr._dy;
       temp->Initialize(attr, n);
-      ParallelForEachVoxel(attr, temp, downsampleY);
+      ConvolveRows(output, temp, 1, downsampleY, 2, offset);
     }
 
     // Downsample z dimension
     if (attr._z > 1) {
-      DownsampleInZ downsampleZ(temp, 2, kernel, size, norm);
+      DownsampleRow downsampleZ(temp->GetBackgroundValueAsDouble(), kernel, size, norm);
+      const int offset = (attr._z % 2 + 1) / 2;
       attr._z  /= 2;
       attr._dz *= 2;
-      attr._xorigin += attr._xaxis[2] * downsampleZ._Offset * attr._dz;
-      attr._yorigin += attr._yaxis[2] * downsampleZ._Offset * attr._dz;
-      attr._zorigin += attr._zaxis[2] * downsampleZ._Offset * attr._dz;
+      attr._xorigin += attr._xaxis[2] * offset * attr._dz;
+      attr._yorigin += attr._yaxis[2] * offset * attr._dz;
+      attr._zorigin += attr._zaxis[2] * offset * attr._dz;
       output->Initialize(attr, n);
-      ParallelForEachVoxel(attr, output, downsampleZ);
+      ConvolveRows(temp, output, 2, downsampleZ, 2, offset);
     }
 
     // Delete intermediate input
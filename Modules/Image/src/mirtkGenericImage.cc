@@ -61,6 +61,7 @@ void GenericImage<VoxelType>::AllocateImage(VoxelType *data)
   Deallocate(_matrix, _data);
   if (_dataOwner) Deallocate(_data);
   _dataOwner = false;
+  _dataMemory.reset();
   // Initialize memory
   const int nvox = _attr.NumberOfLatticePoints();
   if (nvox > 0) {
@@ -186,7 +187,7 @@ GenericImage<VoxelType>::GenericImage(const GenericImage &image)
   _data     (NULL),
   _dataOwner(false)
 {
-  if (image._dataOwner) {
+  if (image._dataOwner || image._dataMemory) {
     AllocateImage();
     memcpy(_data, image._data, _NumberOfVoxels * sizeof(VoxelType));
   } else {
@@ -261,6 +262,18 @@ void GenericImage<VoxelType>::Initialize(const ImageAttributes &attr, int n)
   this->Initialize(attr, n, NULL);
 }
 
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void GenericImage<VoxelType>::Initialize(const ImageAttributes &a, int n, VoxelType *data,
+                                         const shared_ptr<void> &memory)
+{
+  ImageAttributes attr(a);
+  if (n >= 1) attr._t = n, attr._dt = .0;
+  PutAttributes(attr);
+  AllocateImage(data);
+  _dataMemory = memory;
+}
+
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 void GenericImage<VoxelType>::Initialize(const ImageAttributes &attr, VoxelType *data)
@@ -375,6 +388,7 @@ template <class VoxelType> void GenericImage<VoxelType>::Clear()
 {
   Deallocate(_matrix, _data);
   if (_dataOwner) Deallocate(_data);
+  _dataMemory.reset();
   if (_maskOwner) Delete(_mask);
   _attr = ImageAttributes();
 }
@@ -1829,30 +1843,39 @@ void GenericImage<VoxelType>::Read(const char *fname)
   // Read image
   unique_ptr<ImageReader> reader(ImageReader::New(fname));
   unique_ptr<BaseImage>   image(reader->Run());
-  // Convert image
-  switch (image->GetDataType()) {
-    case MIRTK_VOXEL_CHAR:           { *this = *(dynamic_cast<GenericImage<char>           *>(image.get())); } break;
-    case MIRTK_VOXEL_UNSIGNED_CHAR:  { *this = *(dynamic_cast<GenericImage<unsigned char>  *>(image.get())); } break;
-    case MIRTK_VOXEL_SHORT:          { *this = *(dynamic_cast<GenericImage<short>          *>(image.get())); } break;
-    case MIRTK_VOXEL_UNSIGNED_SHORT: { *this = *(dynamic_cast<GenericImage<unsigned short> *>(image.get())); } break;
-    case MIRTK_VOXEL_INT:            { *this = *(dynamic_cast<GenericImage<int>            *>(image.get())); } break;
-    case MIRTK_VOXEL_FLOAT:          { *this = *(dynamic_cast<GenericImage<float>          *>(image.get())); } break;
-    case MIRTK_VOXEL_DOUBLE:         { *this = *(dynamic_cast<GenericImage<double>         *>(image.get())); } break;
-    default:
-      cerr << this->NameOfClass() << "::Read: Unknown data type: " << image->GetDataType() << endl;
-      exit(1);
+  // Reference memory-mapped image data of same type instead of copying it
+  GenericImage *mapped = dynamic_cast<GenericImage *>(image.get());
+  if (mapped && mapped->_dataMemory) {
+    this->Initialize(mapped->Attributes(), -1, mapped->_data, mapped->_dataMemory);
+    if (mapped->HasBackgroundValue()) {
+      this->PutBackgroundValueAsDouble(mapped->GetBackgroundValueAsDouble());
+    }
+  } else {
+    // Convert image
+    switch (image->GetDataType()) {
+      case MIRTK_VOXEL_CHAR:           { *this = *(dynamic_cast<GenericImage<char>           *>(image.get())); } break;
+      case MIRTK_VOXEL_UNSIGNED_CHAR:  { *this = *(dynamic_cast<GenericImage<unsigned char>  *>(image.get())); } break;
+      case MIRTK_VOXEL_SHORT:          { *this = *(dynamic_cast<GenericImage<short>          *>(image.get())); } break;
+      case MIRTK_VOXEL_UNSIGNED_SHORT: { *this = *(dynamic_cast<GenericImage<unsigned short> *>(image.get())); } break;
+      case MIRTK_VOXEL_INT:            { *this = *(dynamic_cast<GenericImage<int>            *>(image.get())); } break;
+      case MIRTK_VOXEL_FLOAT:          { *this = *(dynamic_cast<GenericImage<float>          *>(image.get())); } break;
+      case MIRTK_VOXEL_DOUBLE:         { *this = *(dynamic_cast<GenericImage<double>         *>(image.get())); } break;
+      default:
+        cerr << this->NameOfClass() << "::Read: Unknown data type: " << image->GetDataType() << endl;
+        exit(1);
+    }
   }
   // Apply rescaling function
   if (reader->Slope() != .0) {
     switch (this->GetScalarType()) {
       case MIRTK_VOXEL_FLOAT: {
-        *this *= static_cast<float>(reader->Slope());
-        *this += static_cast<float>(reader->Intercept());
+        if (reader->Slope()     != 1.0) *this *= static_cast<float>(reader->Slope());
+        if (reader->Intercept() != .0)  *this += static_cast<float>(reader->Intercept());
         break;
       }
       case MIRTK_VOXEL_DOUBLE: {
-        *this *= static_cast<double>(reader->Slope());
-        *this += static_cast<double>(reader->Intercept());
+        if (reader->Slope()     != 1.0) *this *= static_cast<double>(reader->Slope());
+        if (reader->Intercept() != .0)  *this += static_cast<double>(reader->Intercept());
         break;
       }
       default: {
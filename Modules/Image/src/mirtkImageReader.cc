@@ -21,12 +21,89 @@
 #include <mirtkImageReaderFactory.h>
 
 #include <mirtkVoxel.h>
+#include <mirtkMemory.h> // swap16, swap32, swap64
 #include <mirtkGenericImage.h>
 
+#if !WINDOWS
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
 
 namespace mirtk {
 
 
+// =============================================================================
+// Auxiliary functions
+// =============================================================================
+
+namespace ImageReaderUtils {
+
+
+#if !WINDOWS
+
+// -----------------------------------------------------------------------------
+/// Unmaps memory-mapped file region when no longer referenced by any image
+struct UnmapFileRegion
+{
+  size_t _Size;
+
+  void operator ()(void *addr) const
+  {
+    munmap(addr, _Size);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Create image referencing memory-mapped image data
+template <class VoxelType>
+BaseImage *NewMappedImage(const ImageAttributes &attr, char *data, const shared_ptr<void> &mem)
+{
+  GenericImage<VoxelType> *image = new GenericImage<VoxelType>();
+  image->Initialize(attr, -1, reinterpret_cast<VoxelType *>(data), mem);
+  return image;
+}
+
+#endif // !WINDOWS
+
+// -----------------------------------------------------------------------------
+/// Get index ranges of region of interest, using full range for unset bounds
+void GetRegionBounds(const ImageAttributes &attr, const int *b, const int *e, int *begin, int *end)
+{
+  const int n[4] = {attr._x, attr._y, attr._z, attr._t};
+  for (int d = 0; d < 4; ++d) {
+    begin[d] = b[d];
+    end  [d] = (e[d] > 0 ? e[d] : n[d]);
+    if (begin[d] < 0 || begin[d] >= end[d] || end[d] > n[d]) {
+      cerr << "ImageReader: Region of interest out of range" << endl;
+      exit(1);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Set background value to NaN if image contains NaNs
+template <class VoxelType>
+void SetNaNBackground(BaseImage *image)
+{
+  const int  n = image->NumberOfVoxels();
+  VoxelType *p = reinterpret_cast<VoxelType *>(image->GetDataPointer());
+  for (int i = 0; i < n; ++i, ++p) {
+    if (IsNaN(*p)) {
+      image->PutBackgroundValueAsDouble(numeric_limits<VoxelType>::quiet_NaN());
+      break;
+    }
+  }
+}
+
+
+} // namespace ImageReaderUtils
+
+using namespace ImageReaderUtils;
+
+
 // =============================================================================
 // Factory method
 // =============================================================================
@@ -57,9 +134,13 @@ ImageReader *ImageReader::New(const char *fname)
 // Construction/Destruction
 // =============================================================================
 
+// -----------------------------------------------------------------------------
+bool ImageReader::DefaultMemoryMap = false;
+
 // -----------------------------------------------------------------------------
 ImageReader::ImageReader()
 {
+  _MemoryMap = DefaultMemoryMap;
   _DataType  = MIRTK_VOXEL_UNKNOWN;
   _Slope     = 1.;
   _Intercept = 0.;
@@ -68,6 +149,7 @@ ImageReader::ImageReader()
   _ReflectZ  = false;
   _Start     = 0;
   _Bytes     = 0;
+  ResetRegion();
 }
 
 // -----------------------------------------------------------------------------
@@ -93,69 +175,218 @@ void ImageReader::Initialize()
 }
 
 // -----------------------------------------------------------------------------
-BaseImage *ImageReader::Run()
+string ImageReader::DataFileName() const
 {
-  const int n = _Attributes.NumberOfLatticePoints();
-  BaseImage *output = NULL;
+  return _FileName;
+}
 
+// -----------------------------------------------------------------------------
+BaseImage *ImageReader::MapImageData()
+{
+#if WINDOWS
+  return nullptr;
+#else
+  const long n    = static_cast<long>(_Attributes.NumberOfLatticePoints());
+  const long size = n * _Bytes;
+  if (n <= 0 || _Bytes <= 0 || _Start < 0 || _Start % _Bytes != 0) {
+    return nullptr;
+  }
+
+  // Open uncompressed image data file
+  const int fd = open(DataFileName().c_str(), O_RDONLY);
+  if (fd == -1) return nullptr;
+  struct stat info;
+  unsigned char magic[2] = {0, 0};
+  if (fstat(fd, &info) != 0 || info.st_size < _Start + size ||
+      pread(fd, magic, 2, 0) != 2 || (magic[0] == 0x1f && magic[1] == 0x8b)) {
+    close(fd);
+    return nullptr;
+  }
+
+  // Map private copy-on-write file region starting at page boundary
+  const long  page   = sysconf(_SC_PAGESIZE);
+  const off_t offset = (_Start / page) * page;
+  const size_t len   = static_cast<size_t>(_Start - offset + size);
+  void *addr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, offset);
+  close(fd);
+  if (addr == MAP_FAILED) return nullptr;
+  UnmapFileRegion unmap;
+  unmap._Size = len;
+  shared_ptr<void> mem(addr, unmap);
+  char *data = reinterpret_cast<char *>(addr) + (_Start - offset);
+
+  // Swap bytes in place, copies affected pages
+  if (_Swapped) {
+    switch (_Bytes) {
+      case 2: swap16(data, data, n); break;
+      case 4: swap32(data, data, n); break;
+      case 8: swap64(data, data, n); break;
+    }
+  }
+
+  // Wrap mapped image data
   switch (_DataType) {
-    case MIRTK_VOXEL_CHAR: {
-        output = new GenericImage<char>(_Attributes);
-        this->ReadAsChar((char *)output->GetDataPointer(), n, _Start);
-      } break;
-
-    case MIRTK_VOXEL_UNSIGNED_CHAR: {
-        output = new GenericImage<unsigned char>(_Attributes);
-        this->ReadAsUChar((unsigned char *)output->GetDataPointer(), n, _Start);
-      } break;
-
-    case MIRTK_VOXEL_SHORT: {
-        output = new GenericImage<short>(_Attributes);
-        this->ReadAsShort((short *)output->GetDataPointer(), n, _Start);
-      } break;
-
-    case MIRTK_VOXEL_UNSIGNED_SHORT: {
-        output = new GenericImage<unsigned short>(_Attributes);
-        this->ReadAsUShort((unsigned short *)output->GetDataPointer(), n, _Start);
-      } break;
-
-    case MIRTK_VOXEL_INT: {
-        output = new GenericImage<int>(_Attributes);
-        this->ReadAsInt((int *)output->GetDataPointer(), n, _Start);
-      } break;
-
-    case MIRTK_VOXEL_FLOAT: {
-        output = new GenericImage<float>(_Attributes);
-        this->ReadAsFloat((float *)output->GetDataPointer(), n, _Start);
-
-        // Set background value to NaN if image contains NaNs
-        float *p = reinterpret_cast<float *>(output->GetDataPointer());
-        for (int i = 0; i < n; ++i, ++p) {
-          if (IsNaN(*p)) {
-            output->PutBackgroundValueAsDouble(numeric_limits<float>::quiet_NaN());
-            break;
-          }
-        }
-      } break;
-
-    case MIRTK_VOXEL_DOUBLE: {
-        output = new GenericImage<double>(_Attributes);
-        this->ReadAsDouble((double *)output->GetDataPointer(), n, _Start);
-
-        // Set background value to NaN if image contains NaNs
-        double *p = reinterpret_cast<double *>(output->GetDataPointer());
-        for (int i = 0; i < n; ++i, ++p) {
-          if (IsNaN(*p)) {
-            output->PutBackgroundValueAsDouble(numeric_limits<double>::quiet_NaN());
-            break;
-          }
-        }
-      } break;
+    case MIRTK_VOXEL_CHAR:           return NewMappedImage<char          >(_Attributes, data, mem);
+    case MIRTK_VOXEL_UNSIGNED_CHAR:  return NewMappedImage<unsigned char >(_Attributes, data, mem);
+    case MIRTK_VOXEL_SHORT:          return NewMappedImage<short         >(_Attributes, data, mem);
+    case MIRTK_VOXEL_UNSIGNED_SHORT: return NewMappedImage<unsigned short>(_Attributes, data, mem);
+    case MIRTK_VOXEL_INT:            return NewMappedImage<int           >(_Attributes, data, mem);
+    case MIRTK_VOXEL_FLOAT:          return NewMappedImage<float         >(_Attributes, data, mem);
+    case MIRTK_VOXEL_DOUBLE:         return NewMappedImage<double        >(_Attributes, data, mem);
+    default:                         return nullptr;
+  }
+#endif // WINDOWS
+}
+
+// -----------------------------------------------------------------------------
+void ImageReader::Region(int i1, int j1, int k1, int i2, int j2, int k2)
+{
+  _RegionBegin[0] = i1, _RegionEnd[0] = i2;
+  _RegionBegin[1] = j1, _RegionEnd[1] = j2;
+  _RegionBegin[2] = k1, _RegionEnd[2] = k2;
+}
+
+// -----------------------------------------------------------------------------
+void ImageReader::Region(int i1, int j1, int k1, int l1, int i2, int j2, int k2, int l2)
+{
+  Region(i1, j1, k1, i2, j2, k2);
+  Frames(l1, l2);
+}
+
+// -----------------------------------------------------------------------------
+void ImageReader::Frames(int l1, int l2)
+{
+  _RegionBegin[3] = l1, _RegionEnd[3] = l2;
+}
+
+// -----------------------------------------------------------------------------
+void ImageReader::ResetRegion()
+{
+  for (int d = 0; d < 4; ++d) {
+    _RegionBegin[d] = 0;
+    _RegionEnd  [d] = 0;
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool ImageReader::HasRegion() const
+{
+  int begin[4], end[4];
+  GetRegionBounds(_Attributes, _RegionBegin, _RegionEnd, begin, end);
+  return begin[0] != 0 || end[0] != _Attributes._x ||
+         begin[1] != 0 || end[1] != _Attributes._y ||
+         begin[2] != 0 || end[2] != _Attributes._z ||
+         begin[3] != 0 || end[3] != _Attributes._t;
+}
+
+// -----------------------------------------------------------------------------
+ImageAttributes ImageReader::RegionAttributes() const
+{
+  int begin[4], end[4];
+  GetRegionBounds(_Attributes, _RegionBegin, _RegionEnd, begin, end);
+
+  ImageAttributes attr = _Attributes;
+  attr._x = end[0] - begin[0];
+  attr._y = end[1] - begin[1];
+  attr._z = end[2] - begin[2];
+  attr._t = end[3] - begin[3];
+  attr._torigin = _Attributes.LatticeToTime(begin[3]);
+  attr._xorigin = attr._yorigin = attr._zorigin = .0;
+
+  // Shift origin such that first voxel of region is at the same position
+  double x1 = begin[0], y1 = begin[1], z1 = begin[2];
+  double x2 = .0,       y2 = .0,       z2 = .0;
+  _Attributes.LatticeToWorld(x1, y1, z1);
+  attr       .LatticeToWorld(x2, y2, z2);
+  attr._xorigin = x1 - x2;
+  attr._yorigin = y1 - y2;
+  attr._zorigin = z1 - z2;
+  return attr;
+}
 
+// -----------------------------------------------------------------------------
+bool ImageReader::ReadVoxels(void *data, long n, long offset)
+{
+  switch (_DataType) {
+    case MIRTK_VOXEL_CHAR:           return this->ReadAsChar  (reinterpret_cast<char           *>(data), n, offset);
+    case MIRTK_VOXEL_UNSIGNED_CHAR:  return this->ReadAsUChar (reinterpret_cast<unsigned char  *>(data), n, offset);
+    case MIRTK_VOXEL_SHORT:          return this->ReadAsShort (reinterpret_cast<short          *>(data), n, offset);
+    case MIRTK_VOXEL_UNSIGNED_SHORT: return this->ReadAsUShort(reinterpret_cast<unsigned short *>(data), n, offset);
+    case MIRTK_VOXEL_INT:            return this->ReadAsInt   (reinterpret_cast<int            *>(data), n, offset);
+    case MIRTK_VOXEL_FLOAT:          return this->ReadAsFloat (reinterpret_cast<float          *>(data), n, offset);
+    case MIRTK_VOXEL_DOUBLE:         return this->ReadAsDouble(reinterpret_cast<double         *>(data), n, offset);
     default:
       cerr << "FileToImage::Run: Unknown voxel type" << endl;
       exit(1);
   }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+bool ImageReader::ReadRegion(void *data)
+{
+  int begin[4], end[4];
+  GetRegionBounds(_Attributes, _RegionBegin, _RegionEnd, begin, end);
+
+  // Index range of voxel data in file, which is reflected after reading
+  const int n[4] = {_Attributes._x, _Attributes._y, _Attributes._z, _Attributes._t};
+  const int reflect[3] = {_ReflectX, _ReflectY, _ReflectZ};
+  for (int d = 0; d < 3; ++d) {
+    if (reflect[d]) {
+      const int b = begin[d];
+      begin[d] = n[d] - end[d];
+      end  [d] = n[d] - b;
+    }
+  }
+
+  // Merge dimensions which are read entirely into contiguous chunks
+  long chunk = end[0] - begin[0];
+  int  m     = 1;
+  while (m < 4 && begin[m-1] == 0 && end[m-1] == n[m-1]) {
+    chunk *= end[m] - begin[m];
+    ++m;
+  }
+  const int nj = (m > 1 ? 1 : end[1] - begin[1]);
+  const int nk = (m > 2 ? 1 : end[2] - begin[2]);
+  const int nl = (m > 3 ? 1 : end[3] - begin[3]);
+
+  // Read chunks in order of increasing file offset
+  char *ptr = reinterpret_cast<char *>(data);
+  long  idx;
+  for (int l = 0; l < nl; ++l)
+  for (int k = 0; k < nk; ++k)
+  for (int j = 0; j < nj; ++j) {
+    idx = begin[0] + static_cast<long>(n[0]) * (begin[1] + j + static_cast<long>(n[1]) * (begin[2] + k + static_cast<long>(n[2]) * (begin[3] + l)));
+    if (!ReadVoxels(ptr, chunk, _Start + idx * _Bytes)) return false;
+    ptr += chunk * _Bytes;
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+BaseImage *ImageReader::Run()
+{
+  BaseImage *output = NULL;
+
+  if (HasRegion()) {
+    output = BaseImage::New(_DataType);
+    output->Initialize(RegionAttributes());
+    this->ReadRegion(output->GetDataPointer());
+  } else {
+    if (_MemoryMap) output = this->MapImageData();
+    if (output == NULL) {
+      output = BaseImage::New(_DataType);
+      output->Initialize(_Attributes);
+      this->ReadVoxels(output->GetDataPointer(), _Attributes.NumberOfLatticePoints(), _Start);
+    }
+  }
+
+  // Set background value to NaN if image contains NaNs
+  switch (_DataType) {
+    case MIRTK_VOXEL_FLOAT:  SetNaNBackground<float >(output); break;
+    case MIRTK_VOXEL_DOUBLE: SetNaNBackground<double>(output); break;
+    default: break;
+  }
 
   if (_ReflectX) output->ReflectX();
   if (_ReflectY) output->ReflectY();
@@ -0,0 +1,129 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mirtkRecursiveGaussianFilter.h>
+
+#include <mirtkMath.h>
+
+
+namespace mirtk {
+
+
+// -----------------------------------------------------------------------------
+double RecursiveGaussianFilter::MinimumSigma()
+{
+  return .5;
+}
+
+// -----------------------------------------------------------------------------
+RecursiveGaussianFilter::RecursiveGaussianFilter(double sigma, int order)
+{
+  Initialize(sigma, order);
+}
+
+// -----------------------------------------------------------------------------
+void RecursiveGaussianFilter::Initialize(double sigma, int order)
+{
+  if (sigma < MinimumSigma()) {
+    cerr << "RecursiveGaussianFilter::Initialize: Standard deviation must be at least "
+         << MinimumSigma() << " samples" << endl;
+    exit(1);
+  }
+  if (order < 0 || order > 2) {
+    cerr << "RecursiveGaussianFilter::Initialize: Invalid derivative order: " << order << endl;
+    exit(1);
+  }
+  _Sigma = sigma;
+  _Order = order;
+
+  // Filter coefficients (Young and van Vliet, 2002)
+  const double m0 = 1.16680, m1 = 1.10783, m2 = 1.40586;
+  const double q  = (sigma < 3.556) ? -.2568 + .5784 * sigma + .0561 * sigma * sigma
+                                    : 2.5091 + .9804 * (sigma - 3.556);
+  const double scale = (m0 + q) * (m1 * m1 + m2 * m2 + 2. * m1 * q + q * q);
+
+  _A[0] = q * (2. * m0 * m1 + m1 * m1 + m2 * m2 + (2. * m0 + 4. * m1) * q + 3. * q * q) / scale;
+  _A[1] = - q * q * (m0 + 2. * m1 + 3. * q) / scale;
+  _A[2] = q * q * q / scale;
+  _B    = 1. - _A[0] - _A[1] - _A[2];
+
+  // Initial conditions of anti-causal recursion (Triggs and Sdika, 2006)
+  const double a1 = _A[0], a2 = _A[1], a3 = _A[2];
+  const double s  = 1. / ((1. + a1 - a2 + a3) * (1. - a1 - a2 - a3) * (1. + a2 + (a1 - a3) * a3));
+  _M[0] =   s * (1. - a2 - a1 * a3 - a3 * a3);
+  _M[1] =   s * (a3 + a1) * (a2 + a1 * a3);
+  _M[2] =   s * a3 * (a1 + a2 * a3);
+  _M[3] =   s * (a1 + a2 * a3);
+  _M[4] = - s * (a2 - 1.) * (a2 + a1 * a3);
+  _M[5] = - s * a3 * (a1 * a3 + a3 * a3 + a2 - 1.);
+  _M[6] =   s * (a1 * a3 + a2 + a1 * a1 - a2 * a2);
+  _M[7] =   s * (a1 * a2 + a3 * a2 * a2 - a1 * a3 * a3 - a3 * a3 * a3 - a3 * a2 + a3);
+  _M[8] =   s * a3 * (a1 + a2 * a3);
+}
+
+// -----------------------------------------------------------------------------
+void RecursiveGaussianFilter::Filter(double *x, int n) const
+{
+  if (n < 2) return;
+
+  const double a1 = _A[0], a2 = _A[1], a3 = _A[2];
+  const double xn = x[n - 1];
+
+  // Causal recursion, signal replicated before first sample
+  double w1 = x[0], w2 = x[0], w3 = x[0];
+  for (int i = 0; i < n; ++i) {
+    x[i] = _B * x[i] + a1 * w1 + a2 * w2 + a3 * w3;
+    w3 = w2, w2 = w1, w1 = x[i];
+  }
+
+  // Anti-causal recursion, signal replicated after last sample
+  const double u1 = w1 - xn, u2 = w2 - xn, u3 = w3 - xn;
+  double y1 = xn + _B * (_M[0] * u1 + _M[1] * u2 + _M[2] * u3);
+  double y2 = xn + _B * (_M[3] * u1 + _M[4] * u2 + _M[5] * u3);
+  double y3 = xn + _B * (_M[6] * u1 + _M[7] * u2 + _M[8] * u3);
+  x[n - 1] = y1;
+  for (int i = n - 2; i >= 0; --i) {
+    x[i] = _B * x[i] + a1 * y1 + a2 * y2 + a3 * y3;
+    y3 = y2, y2 = y1, y1 = x[i];
+  }
+
+  // Derivatives of smoothed signal
+  if (_Order == 1) {
+    double prev = x[0];
+    x[0] = .5 * (x[1] - x[0]);
+    for (int i = 1; i < n - 1; ++i) {
+      const double cur = x[i];
+      x[i] = .5 * (x[i + 1] - prev);
+      prev = cur;
+    }
+    x[n - 1] = .5 * (x[n - 1] - prev);
+  } else if (_Order == 2) {
+    double prev = x[0];
+    x[0] = x[1] - x[0];
+    for (int i = 1; i < n - 1; ++i) {
+      const double cur = x[i];
+      x[i] = x[i + 1] - 2. * cur + prev;
+      prev = cur;
+    }
+    x[n - 1] = prev - x[n - 1];
+  }
+}
+
+
+} // namespace mirtk
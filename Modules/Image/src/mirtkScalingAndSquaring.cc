@@ -314,274 +314,122 @@ struct EvaluateJacobianAndDetAndLog : public EvaluateJacobianBase<TReal>
 };
 
 // -----------------------------------------------------------------------------
-/// Voxel function for update of displacement field at each squaring step
+/// Voxel function for update of all intermediate channels at each squaring step
+///
+/// The displacement field and the requested derivatives are interpolated at
+/// the transformed voxel position by a single evaluation of the interpolator
+/// of the stacked intermediate channels, i.e., the interpolation weights are
+/// computed once per voxel instead of once per quantity.
 template <class TInterpolator>
-struct UpdateDisplacement : public VoxelFunction
+struct UpdateChannels : public VoxelFunction
 {
   typedef typename TInterpolator::VoxelType TReal;
 
-  const int            _x, _y, _z;
-  const TInterpolator *_Displacement;
-
-  UpdateDisplacement(const TInterpolator *f)
-  :
-    _x(0), _y(f->Input()->NumberOfSpatialVoxels()), _z(2 * _y),
-    _Displacement(f)
-  {}
-
-  void operator()(int i, int j, int k, int, const TReal *in, TReal *out)
-  {
-    double u[3] = {.0, .0, .0};
-    _Displacement->Evaluate(u, i + in[_x], j + in[_y], k + in[_z]);
-    out[_x] = in[_x] + u[0];
-    out[_y] = in[_y] + u[1];
-    out[_z] = in[_z] + u[2];
-  }
-};
-
-// -----------------------------------------------------------------------------
-/// Voxel function for update of Jacobian w.r.t. x at each squaring step
-template <class TInterpolator>
-struct UpdateJacobianBase : public VoxelFunction
-{
-  typedef typename TInterpolator::VoxelType TReal;
+  /// Maximum number of channels, i.e., 3 + 9 + 1 + 1 + 9
+  static const int MaxNumberOfChannels = 23;
 
   static const int     _x = 0, _xx = 0;
   int                  _y, _z, _xy, _xz, _yx, _yy, _yz, _zx, _zy, _zz;
-  const TInterpolator *_Jacobian;
-  const TInterpolator *_DetJacobian;
-  const TInterpolator *_LogJacobian;
+  int                  _Jac, _Det, _Log, _DOFs; ///< First channel of quantity or -1
+  int                  _jac, _det, _log, _dofs; ///< Offsets of first channel
+  const TInterpolator *_Channels;
 
-  inline void Initialize(const TInterpolator *j,
-                         const TInterpolator *dj,
-                         const TInterpolator *lj)
+  UpdateChannels(const TInterpolator *f, int j, int dj, int lj, int dv)
+  :
+    _Jac(j), _Det(dj), _Log(lj), _DOFs(dv), _Channels(f)
   {
-    // number of voxels
-    int n = 0;
-    if (j ) n = j ->Input()->NumberOfSpatialVoxels();
-    if (dj) n = dj->Input()->NumberOfSpatialVoxels();
-    if (lj) n = lj->Input()->NumberOfSpatialVoxels();
+    const int n = f->Input()->NumberOfSpatialVoxels();
     // vector element offsets
     /* _x  = 0 */_y  = 1 * n; _z  = 2 * n;
     // matrix element offsets
     /* _xx = 0 */_xy = 1 * n; _xz = 2 * n;
     _yx = 3 * n; _yy = 4 * n; _yz = 5 * n;
     _zx = 6 * n; _zy = 7 * n; _zz = 8 * n;
-    // interpolators
-    _Jacobian    = j;
-    _DetJacobian = dj;
-    _LogJacobian = lj;
+    // channel offsets
+    _jac  = _Jac  * n;
+    _det  = _Det  * n;
+    _log  = _Log  * n;
+    _dofs = _DOFs * n;
   }
 
   // ---------------------------------------------------------------------------
-  inline void Transform(double &x, double &y, double &z, const TReal *u)
+  inline void MultiplyJacobian(const double *jac, const TReal *in, TReal *out)
   {
-    x += u[_x], y += u[_y], z += u[_z];
+    out[_xx] = jac[0] * in[_xx] + jac[1] * in[_yx] + jac[2] * in[_zx];
+    out[_xy] = jac[0] * in[_xy] + jac[1] * in[_yy] + jac[2] * in[_zy];
+    out[_xz] = jac[0] * in[_xz] + jac[1] * in[_yz] + jac[2] * in[_zz];
+    out[_yx] = jac[3] * in[_xx] + jac[4] * in[_yx] + jac[5] * in[_zx];
+    out[_yy] = jac[3] * in[_xy] + jac[4] * in[_yy] + jac[5] * in[_zy];
+    out[_yz] = jac[3] * in[_xz] + jac[4] * in[_yz] + jac[5] * in[_zz];
+    out[_zx] = jac[6] * in[_xx] + jac[7] * in[_yx] + jac[8] * in[_zx];
+    out[_zy] = jac[6] * in[_xy] + jac[7] * in[_yy] + jac[8] * in[_zy];
+    out[_zz] = jac[6] * in[_xz] + jac[7] * in[_yz] + jac[8] * in[_zz];
   }
 
   // ---------------------------------------------------------------------------
-  inline void UpdateJac(double x, double y, double z, const TReal *in, TReal *out)
+  inline void CopyJacobian(const TReal *in, TReal *out)
   {
-    if (_Jacobian->IsInside(x, y, z)) {
-      double jac[9];
-      _Jacobian->EvaluateInside(jac, x, y, z);
-      out[_xx] = jac[0] * in[_xx] + jac[1] * in[_yx] + jac[2] * in[_zx];
-      out[_xy] = jac[0] * in[_xy] + jac[1] * in[_yy] + jac[2] * in[_zy];
-      out[_xz] = jac[0] * in[_xz] + jac[1] * in[_yz] + jac[2] * in[_zz];
-      out[_yx] = jac[3] * in[_xx] + jac[4] * in[_yx] + jac[5] * in[_zx];
-      out[_yy] = jac[3] * in[_xy] + jac[4] * in[_yy] + jac[5] * in[_zy];
-      out[_yz] = jac[3] * in[_xz] + jac[4] * in[_yz] + jac[5] * in[_zz];
-      out[_zx] = jac[6] * in[_xx] + jac[7] * in[_yx] + jac[8] * in[_zx];
-      out[_zy] = jac[6] * in[_xy] + jac[7] * in[_yy] + jac[8] * in[_zy];
-      out[_zz] = jac[6] * in[_xz] + jac[7] * in[_yz] + jac[8] * in[_zz];
-    } else {
-      out[_xx] = in[_xx]; out[_xy] = in[_xy]; out[_xz] = in[_xz];
-      out[_yx] = in[_yx]; out[_yy] = in[_yy]; out[_yz] = in[_yz];
-      out[_zx] = in[_zx]; out[_zy] = in[_zy]; out[_zz] = in[_zz];
-    }
+    out[_xx] = in[_xx]; out[_xy] = in[_xy]; out[_xz] = in[_xz];
+    out[_yx] = in[_yx]; out[_yy] = in[_yy]; out[_yz] = in[_yz];
+    out[_zx] = in[_zx]; out[_zy] = in[_zy]; out[_zz] = in[_zz];
   }
 
   // ---------------------------------------------------------------------------
-  inline void UpdateDet(double x, double y, double z, const TReal *dj_in, TReal *dj_out)
+  void operator()(int i, int j, int k, int, const TReal *in, TReal *out)
   {
-    if (_DetJacobian->IsInside(x, y, z)) {
-      (*dj_out) = (*dj_in) * max(.0001, _DetJacobian->EvaluateInside(x, y, z));
-    } else {
-      (*dj_out) = (*dj_in);
+    // Interpolate all channels at transformed voxel position
+    double v[MaxNumberOfChannels], x = i, y = j, z = k;
+    x += in[_x], y += in[_y], z += in[_z];
+    const bool inside = _Channels->IsInside(x, y, z);
+    if (inside) _Channels->EvaluateInside (v, x, y, z);
+    else        _Channels->EvaluateOutside(v, x, y, z);
+    // Update displacement
+    out[_x] = in[_x] + v[0];
+    out[_y] = in[_y] + v[1];
+    out[_z] = in[_z] + v[2];
+    // Update Jacobian w.r.t. x
+    if (_Jac >= 0) {
+      if (inside) MultiplyJacobian(v + _Jac, in + _jac, out + _jac);
+      else        CopyJacobian    (          in + _jac, out + _jac);
     }
-  }
-
-  // ---------------------------------------------------------------------------
-  inline void UpdateLog(double x, double y, double z, const TReal *lj_in, TReal *lj_out)
-  {
-    if (_LogJacobian->IsInside(x, y, z)) {
-      (*lj_out) = (*lj_in) + max(/*log(.0001)=*/-4.0, _LogJacobian->EvaluateInside(x, y, z));
-    } else {
-      (*lj_out) = (*lj_in);
+    // Update determinant and/or log of determinant of Jacobian w.r.t. x
+    if (_Det >= 0 && _Log >= 0) {
+      // Lorenzi, M., Ayache, N., Frisoni, G. B., & Pennec, X. (2013).
+      // LCC-Demons: a robust and accurate symmetric diffeomorphic registration algorithm.
+      // NeuroImage, 81, 470–83. doi:10.1016/j.neuroimage.2013.04.114
+      if (inside) {
+        out[_log] = in[_log] + log(max(.0001, v[_Det]));
+        out[_det] = exp(out[_log]);
+      } else {
+        out[_log] = in[_log];
+        out[_det] = in[_det];
+      }
+    } else if (_Det >= 0) {
+      if (inside) out[_det] = in[_det] * max(.0001, v[_Det]);
+      else        out[_det] = in[_det];
+    } else if (_Log >= 0) {
+      if (inside) out[_log] = in[_log] + max(/*log(.0001)=*/-4.0, v[_Log]);
+      else        out[_log] = in[_log];
     }
-  }
-
-  // ---------------------------------------------------------------------------
-  // Lorenzi, M., Ayache, N., Frisoni, G. B., & Pennec, X. (2013).
-  // LCC-Demons: a robust and accurate symmetric diffeomorphic registration algorithm.
-  // NeuroImage, 81, 470–83. doi:10.1016/j.neuroimage.2013.04.114
-  inline void UpdateDetAndLog(double x, double y, double z,
-                              const TReal *dj_in, const TReal *lj_in,
-                              TReal *dj_out, TReal *lj_out)
-  {
-    if (_DetJacobian->IsInside(x, y, z)) {
-      (*lj_out) = (*lj_in) + log(max(.0001, _DetJacobian->EvaluateInside(x, y, z)));
-      (*dj_out) = exp(*lj_out);
-    } else {
-      (*lj_out) = (*lj_in);
-      (*dj_out) = (*dj_in);
+    // Update Jacobian w.r.t. v using extrapolated Jacobian w.r.t. x
+    if (_DOFs >= 0) {
+      const double *jac    = v + _Jac;
+      const double *jacdof = v + _DOFs;
+      const TReal  *a      = in  + _dofs;
+      TReal        *b      = out + _dofs;
+      b[_xx] = jac[0] * a[_xx] + jac[1] * a[_yx] + jac[2] * a[_zx] + jacdof[0];
+      b[_xy] = jac[0] * a[_xy] + jac[1] * a[_yy] + jac[2] * a[_zy] + jacdof[1];
+      b[_xz] = jac[0] * a[_xz] + jac[1] * a[_yz] + jac[2] * a[_zz] + jacdof[2];
+      b[_yx] = jac[3] * a[_xx] + jac[4] * a[_yx] + jac[5] * a[_zx] + jacdof[3];
+      b[_yy] = jac[3] * a[_xy] + jac[4] * a[_yy] + jac[5] * a[_zy] + jacdof[4];
+      b[_yz] = jac[3] * a[_xz] + jac[4] * a[_yz] + jac[5] * a[_zz] + jacdof[5];
+      b[_zx] = jac[6] * a[_xx] + jac[7] * a[_yx] + jac[8] * a[_zx] + jacdof[6];
+      b[_zy] = jac[6] * a[_xy] + jac[7] * a[_yy] + jac[8] * a[_zy] + jacdof[7];
+      b[_zz] = jac[6] * a[_xz] + jac[7] * a[_yz] + jac[8] * a[_zz] + jacdof[8];
     }
   }
 };
 
-// -----------------------------------------------------------------------------
-template <class TInterpolator>
-struct UpdateJacobian : public UpdateJacobianBase<TInterpolator>
-{
-  typedef typename TInterpolator::VoxelType TReal;
-  void operator()(int i, int j, int k, int,
-                  const TReal *u, const TReal *in, TReal *out)
-  {
-    double x = i, y = j, z = k;
-    this->Transform(x, y, z, u);
-    this->UpdateJac(x, y, z, in, out);
-  }
-};
-
-// -----------------------------------------------------------------------------
-template <class TInterpolator>
-struct UpdateDetJacobian : public UpdateJacobianBase<TInterpolator>
-{
-  typedef typename TInterpolator::VoxelType TReal;
-  void operator()(int i, int j, int k, int,
-                  const TReal *u, const TReal *dj_in, TReal *dj_out)
-  {
-    double x = i, y = j, z = k;
-    this->Transform(x, y, z, u);
-    this->UpdateDet(x, y, z, dj_in, dj_out);
-  }
-};
-
-// -----------------------------------------------------------------------------
-template <class TInterpolator>
-struct UpdateLogJacobian : public UpdateJacobianBase<TInterpolator>
-{
-  typedef typename TInterpolator::VoxelType TReal;
-  void operator()(int i, int j, int k, int,
-                  const TReal *u, const TReal *lj_in, TReal *lj_out)
-  {
-    double x = i, y = j, z = k;
-    this->Transform(x, y, z, u);
-    this->UpdateLog(x, y, z, lj_in, lj_out);
-  }
-};
-
-// -----------------------------------------------------------------------------
-template <class TInterpolator>
-struct UpdateDetJacobianAndLog : public UpdateJacobianBase<TInterpolator>
-{
-  typedef typename TInterpolator::VoxelType TReal;
-  void operator()(int i, int j, int k, int, const TReal *u,
-                  const TReal *dj_in,  const TReal *lj_in,
-                  const TReal *dj_out, TReal       *lj_out)
-  {
-    double x = i, y = j, z = k;
-    this->Transform(x, y, z, u);
-    this->UpdateDetAndLog(x, y, z, dj_in, lj_in, const_cast<TReal *>(dj_out), lj_out);
-  }
-};
-
-// -----------------------------------------------------------------------------
-template <class TInterpolator>
-struct UpdateJacobianAndDet : public UpdateJacobianBase<TInterpolator>
-{
-  typedef typename TInterpolator::VoxelType TReal;
-  void operator()(int i, int j, int k, int, const TReal *u,
-                  const TReal *in,  const TReal *dj_in,
-                  const TReal *out, TReal       *dj_out)
-  {
-    double x = i, y = j, z = k;
-    this->Transform(x, y, z, u);
-    this->UpdateJac(x, y, z, in, const_cast<TReal *>(out));
-    this->UpdateDet(x, y, z, dj_in, dj_out);
-  }
-};
-
-// -----------------------------------------------------------------------------
-template <class TInterpolator>
-struct UpdateJacobianAndLog : public UpdateJacobianBase<TInterpolator>
-{
-  typedef typename TInterpolator::VoxelType TReal;
-  void operator()(int i, int j, int k, int, const TReal *u,
-                  const TReal *in,  const TReal *lj_in,
-                  const TReal *out, TReal       *lj_out)
-  {
-    double x = i, y = j, z = k;
-    this->Transform(x, y, z, u);
-    this->UpdateJac(x, y, z, in, const_cast<TReal *>(out));
-    this->UpdateLog(x, y, z, lj_in, lj_out);
-  }
-};
-
-// -----------------------------------------------------------------------------
-template <class TInterpolator>
-struct UpdateJacobianAndDetAndLog : public UpdateJacobianBase<TInterpolator>
-{
-  typedef typename TInterpolator::VoxelType TReal;
-  void operator()(int i, int j, int k, int, const TReal *u,
-                  const TReal *in,  const TReal *dj_in,  const TReal *lj_in,
-                  const TReal *out, const TReal *dj_out, TReal       *lj_out)
-  {
-    double x = i, y = j, z = k;
-    this->Transform(x, y, z, u);
-    this->UpdateJac(x, y, z, in, const_cast<TReal *>(out));
-    this->UpdateDetAndLog(x, y, z, dj_in, lj_in, const_cast<TReal *>(dj_out), lj_out);
-  }
-};
-
-// -----------------------------------------------------------------------------
-/// Voxel function for update of Jacobian w.r.t. v at each squaring step
-template <class TInterpolator>
-struct UpdateJacobianDOFs : public VoxelFunction
-{
-  typedef typename TInterpolator::VoxelType TReal;
-
-  const int            _x, _y, _z;
-  const int            _xx, _xy, _xz, _yx, _yy, _yz, _zx, _zy, _zz;
-  const TInterpolator *_Jacobian;
-  const TInterpolator *_JacobianDOFs;
-
-  UpdateJacobianDOFs(const TInterpolator *f, const TInterpolator *g)
-  :
-    _x(0), _y(f->Input()->NumberOfSpatialVoxels()), _z(2 * _y),
-    _xx(0      ), _xy(     _y), _xz(2 * _xy),
-    _yx(3 * _xy), _yy(4 * _xy), _yz(5 * _xy),
-    _zx(6 * _xy), _zy(7 * _xy), _zz(8 * _xy),
-    _Jacobian(f), _JacobianDOFs(g)
-  {}
-
-  void operator()(int i, int j, int k, int, const TReal *u, const TReal *in, TReal *out)
-  {
-    double x = i + u[_x], y = j + u[_y], z = k + u[_z], jac[9], jacdof[9];
-    _Jacobian    ->Evaluate(jac,    x, y, z);
-    _JacobianDOFs->Evaluate(jacdof, x, y, z);
-    out[_xx] = jac[0] * in[_xx] + jac[1] * in[_yx] + jac[2] * in[_zx] + jacdof[0];
-    out[_xy] = jac[0] * in[_xy] + jac[1] * in[_yy] + jac[2] * in[_zy] + jacdof[1];
-    out[_xz] = jac[0] * in[_xz] + jac[1] * in[_yz] + jac[2] * in[_zz] + jacdof[2];
-    out[_yx] = jac[3] * in[_xx] + jac[4] * in[_yx] + jac[5] * in[_zx] + jacdof[3];
-    out[_yy] = jac[3] * in[_xy] + jac[4] * in[_yy] + jac[5] * in[_zy] + jacdof[4];
-    out[_yz] = jac[3] * in[_xz] + jac[4] * in[_yz] + jac[5] * in[_zz] + jacdof[5];
-    out[_zx] = jac[6] * in[_xx] + jac[7] * in[_yx] + jac[8] * in[_zx] + jacdof[6];
-    out[_zy] = jac[6] * in[_xy] + jac[7] * in[_yy] + jac[8] * in[_zy] + jacdof[7];
-    out[_zz] = jac[6] * in[_xz] + jac[7] * in[_yz] + jac[8] * in[_zz] + jacdof[8];
-  }
-};
-
 // -----------------------------------------------------------------------------
 /// Voxel function for composition of output displacement with input displacement
 template <class TInterpolator>
@@ -684,11 +532,14 @@ ScalingAndSquaring<TReal>::ScalingAndSquaring()
   _InputVelocity(NULL),
   _InputDisplacement(NULL),
   _InputDeformation(NULL),
+  _InterimChannels(NULL),
+  _InterimBuffer(NULL),
   _InterimDisplacement(NULL),
   _InterimJacobian(NULL),
   _InterimDetJacobian(NULL),
   _InterimLogJacobian(NULL),
   _InterimJacobianDOFs(NULL),
+  _Channels(NULL),
   _Displacement(NULL),
   _Jacobian(NULL),
   _DetJacobian(NULL),
@@ -716,6 +567,7 @@ ScalingAndSquaring<TReal>::ScalingAndSquaring()
 template <class TReal>
 void ScalingAndSquaring<TReal>::Clear()
 {
+  Delete(_Channels);
   Delete(_Displacement);
   Delete(_Jacobian);
   Delete(_DetJacobian);
@@ -726,6 +578,8 @@ void ScalingAndSquaring<TReal>::Clear()
   Delete(_InterimDetJacobian);
   Delete(_InterimLogJacobian);
   Delete(_InterimJacobianDOFs);
+  Delete(_InterimChannels);
+  Delete(_InterimBuffer);
 }
 
 // -----------------------------------------------------------------------------
@@ -808,9 +662,23 @@ void ScalingAndSquaring<TReal>::Initialize()
     _NumberOfSquaringSteps = 0; // i.e., 1 integration step only
   }
 
+  // Requested derivatives of the exponential map w.r.t. x
+  int jac_mode = 0;
+  if (_OutputJacobian || _OutputJacobianDOFs) jac_mode += 1;
+  if (_OutputDetJacobian                    ) jac_mode += 2;
+  if (_OutputLogJacobian                    ) jac_mode += 4;
+
+  // Allocate intermediate images as channels of a single image
+  int nchannels = 3;
+  if (jac_mode & 1       ) nchannels += 9;
+  if (jac_mode & 2       ) nchannels += 1;
+  if (jac_mode & 4       ) nchannels += 1;
+  if (_OutputJacobianDOFs) nchannels += 9;
+  _InterimChannels = new ImageType(attr, nchannels);
+  WrapInterimChannels();
+
   // Initialize deformation field and increase number of squaring steps if needed
   // Note that input image may contain precomputed interpolation coefficients!
-  _InterimDisplacement = new ImageType(attr, 3);
   velocity.Evaluate(*_InterimDisplacement);
 
   TReal  vmax  = .0;
@@ -841,15 +709,6 @@ void ScalingAndSquaring<TReal>::Initialize()
   _NumberOfSteps = pow(2.0, _NumberOfSquaringSteps);
 
   // Compute derivatives of initial deformation w.r.t. x and/or its (log) determinant
-  int jac_mode = 0;
-  if (_OutputJacobian || _OutputJacobianDOFs) jac_mode += 1;
-  if (_OutputDetJacobian                    ) jac_mode += 2;
-  if (_OutputLogJacobian                    ) jac_mode += 4;
-
-  if (jac_mode & 1) _InterimJacobian    = new ImageType(attr, 9);
-  if (jac_mode & 2) _InterimDetJacobian = new ImageType(attr);
-  if (jac_mode & 4) _InterimLogJacobian = new ImageType(attr);
-
   switch (jac_mode) {
     case 1: {
       EvaluateJacobian<TReal> eval;
@@ -890,8 +749,6 @@ void ScalingAndSquaring<TReal>::Initialize()
 
   // Compute derivatives of initial deformation w.r.t. v
   if (_OutputJacobianDOFs) {
-    _InterimJacobianDOFs = new ImageType;
-    _InterimJacobianDOFs->Initialize(attr, 9);
     TReal *dxx = _InterimJacobianDOFs->Data(0, 0, 0, 0);
     TReal *dyy = _InterimJacobianDOFs->Data(0, 0, 0, 4);
     TReal *dzz = _InterimJacobianDOFs->Data(0, 0, 0, 8);
@@ -907,6 +764,7 @@ void ScalingAndSquaring<TReal>::Initialize()
                              imode == Interpolation_CubicBSpline ||
                              imode == Interpolation_FastCubicBSpline)
                             ? Extrapolation_Mirror : Extrapolation_NN;
+  _Channels     = JacobianField    ::New(imode, emode, _InterimChannels);
   _Displacement = DisplacementField::New(imode, emode, _InterimDisplacement);
   if (_InterimJacobian    ) _Jacobian     = JacobianField::New(imode, emode, _InterimJacobian);
   if (_InterimDetJacobian ) _DetJacobian  = JacobianField::New(imode, emode, _InterimDetJacobian);
@@ -919,6 +777,43 @@ void ScalingAndSquaring<TReal>::Initialize()
   MIRTK_DEBUG_TIMING(5, "scaling step");
 }
 
+// -----------------------------------------------------------------------------
+template <class TReal>
+void ScalingAndSquaring<TReal>::WrapInterimChannels()
+{
+  ImageAttributes attr = _InterimChannels->Attributes();
+  attr._t = 1, attr._dt = .0;
+  const int n    = attr.NumberOfSpatialPoints();
+  TReal    *data = _InterimChannels->Data();
+
+  Delete(_InterimDisplacement);
+  Delete(_InterimJacobian);
+  Delete(_InterimDetJacobian);
+  Delete(_InterimLogJacobian);
+  Delete(_InterimJacobianDOFs);
+
+  // Note: Order of channels must match the one assumed by UpdateChannels
+  _InterimDisplacement = new ImageType(attr, 3, data), data += 3 * n;
+  if (_OutputJacobian || _OutputJacobianDOFs) {
+    _InterimJacobian = new ImageType(attr, 9, data), data += 9 * n;
+  }
+  if (_OutputDetJacobian) {
+    _InterimDetJacobian = new ImageType(attr, 1, data), data += n;
+  }
+  if (_OutputLogJacobian) {
+    _InterimLogJacobian = new ImageType(attr, 1, data), data += n;
+  }
+  if (_OutputJacobianDOFs) {
+    _InterimJacobianDOFs = new ImageType(attr, 9, data), data += 9 * n;
+  }
+
+  if (_Displacement) _Displacement->Input(_InterimDisplacement);
+  if (_Jacobian    ) _Jacobian    ->Input(_InterimJacobian);
+  if (_DetJacobian ) _DetJacobian ->Input(_InterimDetJacobian);
+  if (_LogJacobian ) _LogJacobian ->Input(_InterimLogJacobian);
+  if (_JacobianDOFs) _JacobianDOFs->Input(_InterimJacobianDOFs);
+}
+
 // -----------------------------------------------------------------------------
 template <class TReal> template <class TInterpolator>
 void ScalingAndSquaring<TReal>
@@ -1014,110 +909,36 @@ void ScalingAndSquaring<TReal>::Run()
   MIRTK_START_TIMING();
 
   // Get common attributes of intermediate images
-  const ImageAttributes &attr = _InterimDisplacement->Attributes();
+  const ImageAttributes attr = _InterimDisplacement->Attributes();
 
-  int jac_mode = 0;
-  if (_InterimJacobian   ) jac_mode += 1;
-  if (_InterimDetJacobian) jac_mode += 2;
-  if (_InterimLogJacobian) jac_mode += 4;
-
-  // Either allocate required temporary images or use provided output
-  ImageType *disp   = _OutputDisplacement;
-  ImageType *jac3x3 = NULL;
-  ImageType *detjac = NULL;
-  ImageType *logjac = NULL;
-  ImageType *dofjac = NULL;
-
-  if (!disp) disp = new ImageType;
-  disp->Initialize(attr, 3);
-
-  if (_InterimJacobian) {
-    if (_OutputJacobian) jac3x3 = _OutputJacobian;
-    else                 jac3x3 = new ImageType;
-    jac3x3->Initialize(attr, 9);
-  }
-  if (_InterimDetJacobian) {
-    if (_OutputDetJacobian) detjac = _OutputDetJacobian;
-    else                    detjac = new ImageType;
-    detjac->Initialize(attr, 1);
-  }
-  if (_InterimLogJacobian) {
-    if (_OutputLogJacobian) logjac = _OutputLogJacobian;
-    else                    logjac = new ImageType;
-    logjac->Initialize(attr, 1);
-  }
-  if (_InterimJacobianDOFs) {
-    if (_OutputJacobianDOFs) dofjac = _OutputJacobianDOFs;
-    else                     dofjac = new ImageType;
-    dofjac->Initialize(attr, 9);
-  }
+  // First channel of each intermediate quantity or -1 if not computed
+  int c = 3, j = -1, dj = -1, lj = -1, dv = -1;
+  if (_InterimJacobian    ) j  = c, c += 9;
+  if (_InterimDetJacobian ) dj = c, c += 1;
+  if (_InterimLogJacobian ) lj = c, c += 1;
+  if (_InterimJacobianDOFs) dv = c, c += 9;
+
+  // Allocate output buffer of squaring steps
+  _InterimBuffer = new ImageType(attr, _InterimChannels->T());
 
   // Convert scaled displacements to voxel units
   ConvertToVoxelUnits3D<TReal> w2i(attr);
   ParallelForEachVoxel(attr, _InterimDisplacement, _InterimDisplacement, w2i);
 
-  // Do the squaring steps
-  int n = _NumberOfSquaringSteps;
+  // Do the squaring steps, where the output of each step becomes the input
+  // of the next step by swapping the buffers instead of copying the values
+  bool swapped = false;
+  int  n       = _NumberOfSquaringSteps;
   while (n--) {
-    // (Re-)initialize interpolators
-    _Displacement                   ->Initialize();
-    if (_Jacobian    ) _Jacobian    ->Initialize();
-    if (_DetJacobian ) _DetJacobian ->Initialize();
-    if (_LogJacobian ) _LogJacobian ->Initialize();
-    if (_JacobianDOFs) _JacobianDOFs->Initialize();
-    // Compute updates
-    {
-      UpdateDisplacement<DisplacementField> update(_Displacement);
-      ParallelForEachVoxel(attr, _InterimDisplacement, disp, update);
-    }
-    switch (jac_mode) {
-      case 1: {
-        UpdateJacobian<JacobianField> update;
-        update.Initialize(_Jacobian, NULL, NULL);
-        ParallelForEachVoxel(attr, _InterimDisplacement, _InterimJacobian, jac3x3, update);
-      } break;
-      case 2: {
-        UpdateDetJacobian<JacobianField> update;
-        update.Initialize(NULL, _DetJacobian, NULL);
-        ParallelForEachVoxel(attr, _InterimDisplacement, _InterimDetJacobian, detjac, update);
-      } break;
-      case 3: {
-        UpdateJacobianAndDet<JacobianField> update;
-        update.Initialize(_Jacobian, _DetJacobian, NULL);
-        ParallelForEachVoxel(attr, _InterimDisplacement, _InterimJacobian, _InterimDetJacobian, jac3x3, detjac, update);
-      } break;
-      case 4: {
-        UpdateLogJacobian<JacobianField> update;
-        update.Initialize(NULL, NULL, _LogJacobian);
-        ParallelForEachVoxel(attr, _InterimDisplacement, _InterimLogJacobian, logjac, update);
-      } break;
-      case 5: {
-        UpdateJacobianAndLog<JacobianField> update;
-        update.Initialize(_Jacobian, NULL, _LogJacobian);
-        ParallelForEachVoxel(attr, _InterimDisplacement, _InterimJacobian, _InterimLogJacobian, jac3x3, logjac, update);
-      } break;
-      case 6: {
-        UpdateDetJacobianAndLog<JacobianField> update;
-        update.Initialize(NULL, _DetJacobian, _LogJacobian);
-        ParallelForEachVoxel(attr, _InterimDisplacement, _InterimDetJacobian, _InterimLogJacobian, detjac, logjac, update);
-      } break;
-      case 7: {
-        UpdateJacobianAndDetAndLog<JacobianField> update;
-        update.Initialize(_Jacobian, _DetJacobian, _LogJacobian);
-        ParallelForEachVoxel(attr, _InterimDisplacement, _InterimJacobian, _InterimDetJacobian, _InterimLogJacobian, jac3x3, detjac, logjac, update);
-      } break;
-    }
-    if (_InterimJacobianDOFs) {
-      UpdateJacobianDOFs<JacobianField> update(_Jacobian, _JacobianDOFs);
-      ParallelForEachVoxel(attr, _InterimDisplacement, _InterimJacobianDOFs, dofjac, update);
-    }
-    // Update intermediate output images
-    _InterimDisplacement                          ->CopyFrom(disp  ->Data());
-    if (_InterimJacobian    ) _InterimJacobian    ->CopyFrom(jac3x3->Data());
-    if (_InterimDetJacobian ) _InterimDetJacobian ->CopyFrom(detjac->Data());
-    if (_InterimLogJacobian ) _InterimLogJacobian ->CopyFrom(logjac->Data());
-    if (_InterimJacobianDOFs) _InterimJacobianDOFs->CopyFrom(dofjac->Data());
+    _Channels->Input(_InterimChannels);
+    _Channels->Initialize();
+    UpdateChannels<JacobianField> update(_Channels, j, dj, lj, dv);
+    ParallelForEachVoxel(attr, _InterimChannels, _InterimBuffer, update);
+    swap(_InterimChannels, _InterimBuffer);
+    swapped = !swapped;
   }
+  if (swapped) WrapInterimChannels();
+  Delete(_InterimBuffer);
 
   // Convert final displacements back to world units if output requested
   if (_OutputDisplacement) {
@@ -1125,13 +946,6 @@ void ScalingAndSquaring<TReal>::Run()
     ParallelForEachVoxel(attr, _InterimDisplacement, _InterimDisplacement, i2w);
   }
 
-  // Do the final cleaning up
-  if (disp   != _OutputDisplacement) Delete(disp);
-  if (jac3x3 != _OutputJacobian    ) Delete(jac3x3);
-  if (detjac != _OutputDetJacobian ) Delete(detjac);
-  if (logjac != _OutputLogJacobian ) Delete(logjac);
-  if (dofjac != _OutputJacobianDOFs) Delete(dofjac);
-
   MIRTK_DEBUG_TIMING(5, "squaring steps"
                            " (d="    << (_OutputDisplacement ? "on" : "off")
                         << ", J="    << (_OutputJacobian     ? "on" : "off")
@@ -0,0 +1,289 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mirtkMath.h>
+#include <mirtkMemory.h>
+#include <mirtkAlgorithm.h>
+#include <mirtkDataFunctions.h>
+
+using namespace mirtk;
+using namespace mirtk::data;
+using namespace mirtk::data::op;
+using namespace mirtk::data::statistic;
+
+// ===========================================================================
+// Auxiliaries
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Sequence of data operations whose result is independent of fusion
+void MakeOps(Array<unique_ptr<Op> > &ops)
+{
+  ops.clear();
+  ops.push_back(unique_ptr<Op>(new Extrema()));
+  ops.push_back(unique_ptr<Op>(new MaskOutsideInterval(-80.0, 90.0)));
+  ops.push_back(unique_ptr<Op>(new Clamp(-50.0, 70.0)));
+  ops.push_back(unique_ptr<Op>(new Mul(.5)));
+  ops.push_back(unique_ptr<Op>(new NormalDistribution()));
+  ops.push_back(unique_ptr<Op>(new Add(10.0)));
+  ops.push_back(unique_ptr<Op>(new MaskOddValues()));
+  ops.push_back(unique_ptr<Op>(new Range()));
+  ops.push_back(unique_ptr<Op>(new MaxAbs()));
+  ops.push_back(unique_ptr<Op>(new SetOutsideValue(-1.0)));
+  ops.push_back(unique_ptr<Op>(new Var()));
+  ops.push_back(unique_ptr<Op>(new MinAbs()));
+}
+
+// ---------------------------------------------------------------------------
+/// Test data sequence
+void MakeData(int n, double *data, bool *mask)
+{
+  for (int i = 0; i < n; ++i) {
+    data[i] = 100.0 * sin(.01 * i) + 3.0 * cos(.7 * i);
+    mask[i] = (i % 17 != 0);
+  }
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(DataFunctions, ElementWiseOpChain)
+{
+  const int n = 100003;
+  double *data1 = Allocate<double>(n), *data2 = Allocate<double>(n);
+  bool   *mask1 = Allocate<bool>  (n), *mask2 = Allocate<bool>  (n);
+  MakeData(n, data1, mask1);
+  MakeData(n, data2, mask2);
+
+  Array<unique_ptr<Op> > ops1, ops2;
+  MakeOps(ops1);
+  MakeOps(ops2);
+
+  for (size_t i = 0; i < ops1.size(); ++i) ops1[i]->Process(n, data1, mask1);
+
+  ElementWiseOpChain chain(1000);
+  for (size_t i = 0; i < ops2.size(); ++i) {
+    ASSERT_TRUE(ElementWiseOpChain::IsFusable(ops2[i].get()));
+    chain.Push(ops2[i].get());
+  }
+  chain.Process(n, data2, mask2);
+
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(data1[i], data2[i]) << "i=" << i;
+    EXPECT_EQ(mask1[i], mask2[i]) << "i=" << i;
+  }
+  for (size_t i = 0; i < ops1.size(); ++i) {
+    Statistic *stat1 = dynamic_cast<Statistic *>(ops1[i].get());
+    Statistic *stat2 = dynamic_cast<Statistic *>(ops2[i].get());
+    if (stat1) {
+      ASSERT_TRUE(stat2 != NULL);
+      ASSERT_EQ(stat1->Values().size(), stat2->Values().size());
+      for (size_t j = 0; j < stat1->Values().size(); ++j) {
+        const double v = stat1->Values()[j];
+        EXPECT_NEAR(stat2->Values()[j], v, 1e-9 * max(1.0, abs(v))) << stat1->Description();
+      }
+    }
+  }
+
+  Deallocate(data1);
+  Deallocate(data2);
+  Deallocate(mask1);
+  Deallocate(mask2);
+}
+
+// ---------------------------------------------------------------------------
+TEST(DataStatistics, RunningMoments)
+{
+  const int n = 1234;
+  double *data = Allocate<double>(n);
+  bool   *mask = Allocate<bool>  (n);
+  MakeData(n, data, mask);
+
+  RunningMoments moments;
+  for (int i = 0; i < n; i += 100) {
+    moments.Add(min(100, n - i), data + i, mask + i);
+  }
+  double mean, var, vmin, vmax;
+  Var::Calculate(mean, var, n, data, mask);
+  Extrema::Calculate(vmin, vmax, n, data, mask);
+  EXPECT_NEAR(moments._Mean, mean, 1e-9);
+  EXPECT_NEAR(moments.Var(), var, 1e-9 * var);
+  EXPECT_EQ(moments._Min, vmin);
+  EXPECT_EQ(moments._Max, vmax);
+  EXPECT_EQ(moments._MinAbs, MinAbs::Calculate(n, data, mask));
+  EXPECT_EQ(moments._MaxAbs, MaxAbs::Calculate(n, data, mask));
+
+  Deallocate(data);
+  Deallocate(mask);
+}
+
+// ---------------------------------------------------------------------------
+TEST(DataStatistics, OrderStatistics)
+{
+  // Enough values to require refinement of the histogram search intervals,
+  // including many duplicate values
+  const int n = 300007;
+  double *data = Allocate<double>(n);
+  bool   *mask = Allocate<bool>  (n);
+  MakeData(n, data, mask);
+  for (int i = 0; i < n; i += 3) data[i] = 7.0;
+
+  Array<double> sorted;
+  for (int i = 0; i < n; ++i) {
+    if (mask[i]) sorted.push_back(data[i]);
+  }
+  sort(sorted.begin(), sorted.end());
+  const int m = static_cast<int>(sorted.size());
+
+  OrderStatistics<double> stats(n, data, mask);
+  ASSERT_EQ(stats.NumberOfValues(), m);
+  EXPECT_EQ(stats.Min(), sorted.front());
+  EXPECT_EQ(stats.Max(), sorted.back());
+
+  const int k[] = {0, 1, m / 100, m / 3, m / 3 + 1, m / 2, m - m / 100, m - 2, m - 1};
+  const int nk  = static_cast<int>(sizeof(k) / sizeof(k[0]));
+  double value[nk];
+  stats.Select(nk, k, value);
+  for (int r = 0; r < nk; ++r) {
+    EXPECT_EQ(value[r], sorted[k[r]]) << "k=" << k[r];
+  }
+  EXPECT_EQ(stats.Select(m / 7), sorted[m / 7]);
+
+  Deallocate(data);
+  Deallocate(mask);
+}
+
+// ---------------------------------------------------------------------------
+TEST(DataStatistics, OrderStatisticsOfNonFiniteValues)
+{
+  const double nan = numeric_limits<double>::quiet_NaN();
+  const double inf = numeric_limits<double>::infinity();
+  const int n = 200003;
+  double *data = Allocate<double>(n);
+  bool   *mask = Allocate<bool>  (n);
+  MakeData(n, data, mask);
+  for (int i = 0; i < n; i += 5) data[i] = nan;
+  for (int i = 1; i < n; i += 7) data[i] = (i % 2 == 0 ? +inf : -inf);
+
+  Array<double> sorted;
+  for (int i = 0; i < n; ++i) {
+    if (mask[i] && !IsNaN(data[i]) && !IsInf(data[i])) sorted.push_back(data[i]);
+  }
+  sort(sorted.begin(), sorted.end());
+  const int m = static_cast<int>(sorted.size());
+
+  for (int absval = 0; absval < 2; ++absval) {
+    Array<double> expected(sorted);
+    if (absval) {
+      for (int i = 0; i < m; ++i) expected[i] = abs(expected[i]);
+      sort(expected.begin(), expected.end());
+    }
+    OrderStatistics<double> stats(n, data, mask, absval != 0);
+    ASSERT_EQ(stats.NumberOfValues(), m);
+    EXPECT_EQ(stats.Min(), expected.front());
+    EXPECT_EQ(stats.Max(), expected.back());
+    const int k[] = {0, m / 4, m / 2, m - 1};
+    const int nk  = static_cast<int>(sizeof(k) / sizeof(k[0]));
+    double value[nk];
+    stats.Select(nk, k, value);
+    for (int r = 0; r < nk; ++r) {
+      EXPECT_EQ(value[r], expected[k[r]]) << "absval=" << absval << ", k=" << k[r];
+    }
+  }
+  EXPECT_EQ(Percentile::Calculate(50, n, data, mask), Percentile::Calculate(50, m, sorted.data()));
+
+  // Only non-finite values
+  for (int i = 0; i < n; ++i) data[i] = (i % 3 == 0 ? nan : inf);
+  OrderStatistics<double> none(n, data);
+  EXPECT_EQ(none.NumberOfValues(), 0);
+  EXPECT_TRUE(IsNaN(none.Select(0)));
+  EXPECT_TRUE(IsNaN(Percentile::Calculate(50, n, data)));
+
+  Deallocate(data);
+  Deallocate(mask);
+}
+
+// ---------------------------------------------------------------------------
+TEST(DataStatistics, Percentiles)
+{
+  const int n = 100003;
+  double *data = Allocate<double>(n);
+  bool   *mask = Allocate<bool>  (n);
+  MakeData(n, data, mask);
+
+  Array<double> sorted;
+  for (int i = 0; i < n; ++i) {
+    if (mask[i]) sorted.push_back(data[i]);
+  }
+  sort(sorted.begin(), sorted.end());
+  const int m = static_cast<int>(sorted.size());
+
+  const int p[] = {0, 1, 5, 25, 50, 95, 99, 100};
+  for (size_t i = 0; i < sizeof(p) / sizeof(p[0]); ++i) {
+    const double rank = (double(p[i]) / 100.0) * double(m + 1);
+    const int    k    = int(rank);
+    double expected;
+    if      (k <= 0) expected = sorted.front();
+    else if (k >= m) expected = sorted.back();
+    else             expected = sorted[k - 1] + (rank - k) * (sorted[k] - sorted[k - 1]);
+    EXPECT_DOUBLE_EQ(Percentile::Calculate(p[i], n, data, mask), expected) << "p=" << p[i];
+  }
+
+  // Percentile statistics evaluated together or separately
+  Percentile          p1(1), p99(99);
+  RobustMean          rmean(5);
+  LowerPercentileMean lmean(25);
+  Array<Percentile *> stats;
+  stats.push_back(&p1);
+  stats.push_back(&rmean);
+  stats.push_back(&p99);
+  stats.push_back(&lmean);
+  Percentile::EvaluateAll(stats, n, data, mask);
+  EXPECT_EQ(p1   .Value(), Percentile         ::Calculate( 1, n, data, mask));
+  EXPECT_EQ(p99  .Value(), Percentile         ::Calculate(99, n, data, mask));
+  EXPECT_EQ(rmean.Value(), RobustMean         ::Calculate( 5, n, data, mask));
+  EXPECT_EQ(lmean.Value(), LowerPercentileMean::Calculate(25, n, data, mask));
+
+  const double lower = Percentile::Calculate( 5, n, data, mask);
+  const double upper = Percentile::Calculate(95, n, data, mask);
+  int    count = 0;
+  double mean  = .0;
+  for (int i = 0; i < m; ++i) {
+    if (lower <= sorted[i] && sorted[i] <= upper) mean += sorted[i], ++count;
+  }
+  EXPECT_NEAR(rmean.Value(), mean / count, 1e-9);
+
+  Deallocate(data);
+  Deallocate(mask);
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
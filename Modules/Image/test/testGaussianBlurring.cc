@@ -0,0 +1,235 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mirtkMath.h>
+#include <mirtkGenericImage.h>
+#include <mirtkGaussianBlurring.h>
+#include <mirtkRecursiveGaussianFilter.h>
+#include <mirtkConvolutionFunction.h>
+
+using namespace mirtk;
+using namespace mirtk::ConvolutionFunction;
+
+// ===========================================================================
+// Auxiliaries
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Multi-channel test image with some background voxels
+GenericImage<RealPixel> ConvolutionTestImage(double bg)
+{
+  ImageAttributes attr;
+  attr._x = 23, attr._y = 17, attr._z = 13, attr._t = 2, attr._dt = .0;
+  GenericImage<RealPixel> image(attr);
+  for (int l = 0; l < attr._t; ++l)
+  for (int k = 0; k < attr._z; ++k)
+  for (int j = 0; j < attr._y; ++j)
+  for (int i = 0; i < attr._x; ++i) {
+    const int v = (i * 7 + j * 13 + k * 29 + l * 3) % 17;
+    image(i, j, k, l) = static_cast<RealPixel>(v == 5 ? bg : v - 8.);
+  }
+  image.PutBackgroundValueAsDouble(bg);
+  return image;
+}
+
+// ---------------------------------------------------------------------------
+/// Check that two images are identical
+void ExpectEqualImages(const GenericImage<RealPixel> &a, const GenericImage<RealPixel> &b)
+{
+  ASSERT_EQ(a.NumberOfVoxels(), b.NumberOfVoxels());
+  for (int idx = 0; idx < a.NumberOfVoxels(); ++idx) {
+    EXPECT_EQ(a.Get(idx), b.Get(idx));
+  }
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(RecursiveGaussianFilter, ImpulseResponse)
+{
+  const int    n     = 201;
+  const double sigma = 8.0;
+  double x[n];
+  for (int i = 0; i < n; ++i) x[i] = .0;
+  x[n/2] = 1.0;
+  RecursiveGaussianFilter(sigma).Filter(x, n);
+  const double norm = 1.0 / (sqrt(2.0 * M_PI) * sigma);
+  double sum = .0;
+  for (int i = 0; i < n; ++i) {
+    const double d = i - n/2;
+    EXPECT_NEAR(norm * exp(-.5 * d * d / (sigma * sigma)), x[i], 3e-2 * norm);
+    sum += x[i];
+  }
+  EXPECT_NEAR(1.0, sum, 1e-6);
+}
+
+// ---------------------------------------------------------------------------
+TEST(RecursiveGaussianFilter, Derivatives)
+{
+  const int    n     = 400;
+  const double sigma = 5.0;
+  double x[n], y[n];
+  for (int i = 0; i < n; ++i) x[i] = 3.0 * i - 7.0;
+  RecursiveGaussianFilter(sigma, 1).Filter(x, n);
+  for (int i = 0; i < n; ++i) y[i] = .25 * i * i;
+  RecursiveGaussianFilter(sigma, 2).Filter(y, n);
+  // Boundary transients decay slowly, compare only far away from boundary
+  for (int i = 10 * static_cast<int>(sigma); i < n - 10 * static_cast<int>(sigma); ++i) {
+    EXPECT_NEAR(3.0, x[i], 1e-4);
+    EXPECT_NEAR(0.5, y[i], 1e-4);
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(RecursiveGaussianFilter, ConstantBoundary)
+{
+  const int n = 64;
+  double x[n];
+  for (int i = 0; i < n; ++i) x[i] = 42.0;
+  RecursiveGaussianFilter(10.0).Filter(x, n);
+  for (int i = 0; i < n; ++i) EXPECT_NEAR(42.0, x[i], 1e-9);
+}
+
+// ---------------------------------------------------------------------------
+TEST(GaussianBlurring, Recursive)
+{
+  ImageAttributes attr;
+  attr._x  = 64, attr._y  = 48, attr._z  = 40;
+  attr._dx = 1., attr._dy = 1.5, attr._dz = 2.;
+  GenericImage<RealPixel> image(attr), explicit_result, recursive_result;
+  for (int k = 0; k < attr._z; ++k)
+  for (int j = 0; j < attr._y; ++j)
+  for (int i = 0; i < attr._x; ++i) {
+    image(i, j, k) = static_cast<RealPixel>(((i * 7 + j * 13 + k * 29) % 17) - 8);
+  }
+  const double sigma = 6.0;
+
+  GaussianBlurring<RealPixel> blur(sigma);
+  blur.Input (&image);
+  blur.Output(&explicit_result);
+  blur.Run();
+
+  blur.Recursive(true);
+  blur.Output(&recursive_result);
+  blur.Run();
+
+  // Compare away from boundary where truncated kernel is renormalized
+  const int margin[3] = {18, 12, 9};
+  for (int k = margin[2]; k < attr._z - margin[2]; ++k)
+  for (int j = margin[1]; j < attr._y - margin[1]; ++j)
+  for (int i = margin[0]; i < attr._x - margin[0]; ++i) {
+    EXPECT_NEAR(explicit_result(i, j, k), recursive_result(i, j, k), 2e-2);
+  }
+
+  // Select recursive filter by threshold on sigma in voxel units
+  GenericImage<RealPixel> threshold_result;
+  blur.Recursive(false);
+  blur.RecursiveThreshold(2.0);
+  blur.Output(&threshold_result);
+  blur.Run();
+  for (int idx = 0; idx < image.NumberOfVoxels(); ++idx) {
+    EXPECT_EQ(recursive_result.Get(idx), threshold_result.Get(idx));
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(ConvolveRows, ConvolveRow)
+{
+  GenericImage<RealPixel> image = ConvolutionTestImage(.0);
+  const RealPixel kernel[7] = {.05f, .1f, .2f, .3f, .2f, .1f, .05f};
+  GenericImage<RealPixel> expected(image.Attributes()), result(image.Attributes());
+  for (int dim = 1; dim <= 2; ++dim) {
+    for (int l = 0; l < image.T(); ++l) {
+      if (dim == 1) {
+        ConvolveInY<RealPixel> conv(&image, kernel, 7, true, l);
+        ParallelForEachVoxel(image.Attributes(), &image, &expected, conv);
+      } else {
+        ConvolveInZ<RealPixel> conv(&image, kernel, 7, true, l);
+        ParallelForEachVoxel(image.Attributes(), &image, &expected, conv);
+      }
+    }
+    ConvolveRows(&image, &result, dim, ConvolveRow<RealPixel>(kernel, 7, true));
+    ExpectEqualImages(expected, result);
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(ConvolveRows, ConvolveTruncatedForegroundRow)
+{
+  const double bg = -1.0;
+  GenericImage<RealPixel> image = ConvolutionTestImage(bg);
+  const RealPixel kernel[7] = {.05f, .1f, .2f, .3f, .2f, .1f, .05f};
+  GenericImage<RealPixel> expected(image.Attributes()), result(image.Attributes());
+  for (int dim = 1; dim <= 2; ++dim) {
+    for (int l = 0; l < image.T(); ++l) {
+      if (dim == 1) {
+        ConvolveTruncatedForegroundInY<RealPixel> conv(&image, bg, kernel, 7, true, l);
+        ParallelForEachVoxel(image.Attributes(), &image, &expected, conv);
+      } else {
+        ConvolveTruncatedForegroundInZ<RealPixel> conv(&image, bg, kernel, 7, true, l);
+        ParallelForEachVoxel(image.Attributes(), &image, &expected, conv);
+      }
+    }
+    ConvolveRows(&image, &result, dim, ConvolveTruncatedForegroundRow<RealPixel>(bg, kernel, 7, true));
+    ExpectEqualImages(expected, result);
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(ConvolveRows, DownsampleConvolvedExtendedForegroundRow)
+{
+  const double bg = -1.0;
+  GenericImage<RealPixel> image = ConvolutionTestImage(bg);
+  const RealPixel kernel[5] = {1, 4, 6, 4, 1};
+  const double    norm      = 1.0 / 16.0;
+  for (int dim = 1; dim <= 2; ++dim) {
+    ImageAttributes attr = image.Attributes();
+    attr._dt = 1.0;
+    int offset;
+    GenericImage<RealPixel> expected, result;
+    if (dim == 1) {
+      DownsampleConvolvedExtendedForegroundInY<RealPixel, RealPixel> conv(&image, 2, kernel, 5, norm);
+      offset = conv._Offset, attr._y /= 2;
+      expected.Initialize(attr), result.Initialize(attr);
+      ParallelForEachVoxel(attr, &expected, conv);
+    } else {
+      DownsampleConvolvedExtendedForegroundInZ<RealPixel, RealPixel> conv(&image, 2, kernel, 5, norm);
+      offset = conv._Offset, attr._z /= 2;
+      expected.Initialize(attr), result.Initialize(attr);
+      ParallelForEachVoxel(attr, &expected, conv);
+    }
+    ConvolveRows(&image, &result, dim, ConvolveExtendedForegroundRow<RealPixel>(bg, kernel, 5, norm), 2, offset);
+    ExpectEqualImages(expected, result);
+  }
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,275 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mirtkMath.h>
+#include <mirtkGenericImage.h>
+#include <mirtkInterpolateImageFunction.h>
+#include <mirtkScalingAndSquaring.h>
+
+using namespace mirtk;
+
+
+// ===========================================================================
+// Auxiliaries
+// ===========================================================================
+
+typedef GenericImage<double>                        ImageType;
+typedef GenericInterpolateImageFunction<ImageType> InterpolatorType;
+
+// ---------------------------------------------------------------------------
+/// Output quantities of scaling and squaring
+enum Output
+{
+  DISP = 1, ///< Displacement field
+  JAC  = 2, ///< Jacobian w.r.t. x
+  DET  = 4, ///< Determinant of Jacobian w.r.t. x
+  LOG  = 8, ///< Log of determinant of Jacobian w.r.t. x
+  DOFS = 16 ///< Jacobian w.r.t. v
+};
+
+// ---------------------------------------------------------------------------
+/// Output images of scaling and squaring
+struct Outputs
+{
+  ImageType disp, jac, det, log, dofs;
+};
+
+// ---------------------------------------------------------------------------
+/// Smooth velocity field with unit voxel size, whose exponential maps voxels
+/// near the boundary outside the image domain
+ImageType VelocityField()
+{
+  ImageAttributes attr(16, 14, 12);
+  ImageType v(attr, 3);
+  for (int k = 0; k < attr._z; ++k)
+  for (int j = 0; j < attr._y; ++j)
+  for (int i = 0; i < attr._x; ++i) {
+    v(i, j, k, 0) = 3.0 * sin(.30 * j + .20 * k + .5);
+    v(i, j, k, 1) = 2.5 * cos(.25 * i - .15 * k);
+    v(i, j, k, 2) = 2.0 * sin(.20 * i + .35 * j - .3);
+  }
+  return v;
+}
+
+// ---------------------------------------------------------------------------
+/// Run scaling and squaring with the given number of squaring steps and
+/// upper integration limit, where only the outputs selected by mask are set
+void Exponentiate(const ImageType &v, int mask, int steps, double t, Outputs &out)
+{
+  ScalingAndSquaring<double> exp;
+  exp.InputVelocity(&v);
+  exp.Interpolation(Interpolation_Linear);
+  exp.UpperIntegrationLimit(t);
+  exp.NumberOfSteps(1);
+  exp.NumberOfSquaringSteps(steps);
+  if (mask & DISP) exp.OutputDisplacement(&out.disp);
+  if (mask & JAC ) exp.OutputJacobian    (&out.jac);
+  if (mask & DET ) exp.OutputDetJacobian (&out.det);
+  if (mask & LOG ) exp.OutputLogJacobian (&out.log);
+  if (mask & DOFS) exp.OutputJacobianDOFs(&out.dofs);
+  exp.Run();
+}
+
+// ---------------------------------------------------------------------------
+/// Interpolator of the given image as used by the squaring steps
+InterpolatorType *NewInterpolator(ImageType &image)
+{
+  InterpolatorType *f = InterpolatorType::New(Interpolation_Linear, Extrapolation_NN, &image);
+  f->Initialize();
+  return f;
+}
+
+// ---------------------------------------------------------------------------
+/// Reference implementation of one squaring step, where each quantity is
+/// interpolated separately, one channel at a time, and the output of the step
+/// is copied to new images
+///
+/// The displacement field is in voxel units, which equal world units given
+/// the unit voxel size and orientation of the test velocity field.
+void SquaringStep(Outputs &s)
+{
+  const bool jac  = !s.jac .IsEmpty();
+  const bool det  = !s.det .IsEmpty();
+  const bool log  = !s.log .IsEmpty();
+  const bool dofs = !s.dofs.IsEmpty();
+
+  InterpolatorType *fd = NewInterpolator(s.disp);
+  InterpolatorType *fj = jac  ? NewInterpolator(s.jac)  : NULL;
+  InterpolatorType *fl = log  ? NewInterpolator(s.log)  : NULL;
+  InterpolatorType *fv = dofs ? NewInterpolator(s.dofs) : NULL;
+  InterpolatorType *fdet = det ? NewInterpolator(s.det) : NULL;
+
+  Outputs out = s;
+  double a[9], b[9];
+  for (int k = 0; k < s.disp.Z(); ++k)
+  for (int j = 0; j < s.disp.Y(); ++j)
+  for (int i = 0; i < s.disp.X(); ++i) {
+    const double x = i + s.disp(i, j, k, 0);
+    const double y = j + s.disp(i, j, k, 1);
+    const double z = k + s.disp(i, j, k, 2);
+    const bool inside = fd->IsInside(x, y, z);
+    for (int l = 0; l < 3; ++l) {
+      out.disp(i, j, k, l) = s.disp(i, j, k, l) + fd->Evaluate(x, y, z, l);
+    }
+    if (jac) {
+      for (int l = 0; l < 9; ++l) a[l] = fj->Evaluate(x, y, z, l);
+      if (inside) {
+        for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c) {
+          double value = .0;
+          for (int m = 0; m < 3; ++m) value += a[3*r+m] * s.jac(i, j, k, 3*m+c);
+          out.jac(i, j, k, 3*r+c) = value;
+        }
+      }
+    }
+    if (det && log) {
+      if (inside) {
+        out.log(i, j, k) = s.log(i, j, k) + std::log(max(.0001, fdet->EvaluateInside(x, y, z)));
+        out.det(i, j, k) = exp(out.log(i, j, k));
+      }
+    } else if (det) {
+      if (inside) out.det(i, j, k) = s.det(i, j, k) * max(.0001, fdet->EvaluateInside(x, y, z));
+    } else if (log) {
+      if (inside) out.log(i, j, k) = s.log(i, j, k) + max(-4.0, fl->EvaluateInside(x, y, z));
+    }
+    if (dofs) {
+      for (int l = 0; l < 9; ++l) b[l] = fv->Evaluate(x, y, z, l);
+      for (int r = 0; r < 3; ++r)
+      for (int c = 0; c < 3; ++c) {
+        double value = b[3*r+c];
+        for (int m = 0; m < 3; ++m) value += a[3*r+m] * s.dofs(i, j, k, 3*m+c);
+        out.dofs(i, j, k, 3*r+c) = value;
+      }
+    }
+  }
+  s = out;
+
+  delete fd;
+  delete fj;
+  delete fdet;
+  delete fl;
+  delete fv;
+}
+
+// ---------------------------------------------------------------------------
+/// Compute reference outputs of scaling and squaring
+///
+/// The scaled velocities and their derivatives are those of the filter with
+/// no squaring steps and the upper integration limit divided by 2^steps.
+/// Note that the Jacobian w.r.t. x is required for the update of the Jacobian
+/// w.r.t. v and thus always computed in this case.
+Outputs Reference(const ImageType &v, int mask, int steps)
+{
+  Outputs s;
+  if (mask & DOFS) mask |= JAC;
+  Exponentiate(v, mask | DISP, 0, 1.0 / pow(2.0, steps), s);
+  for (int n = 0; n < steps; ++n) SquaringStep(s);
+  return s;
+}
+
+// ---------------------------------------------------------------------------
+/// Expect output image to match reference
+void ExpectNear(const ImageType &ref, const ImageType &out, int nchannels, double tol)
+{
+  ASSERT_EQ(ref.X(), out.X());
+  ASSERT_EQ(ref.Y(), out.Y());
+  ASSERT_EQ(ref.Z(), out.Z());
+  ASSERT_EQ(nchannels, out.T());
+  ASSERT_EQ(ref.NumberOfVoxels(), out.NumberOfVoxels());
+  double max_error = .0;
+  for (int idx = 0; idx < ref.NumberOfVoxels(); ++idx) {
+    max_error = max(max_error, abs(ref.Get(idx) - out.Get(idx)));
+  }
+  EXPECT_LE(max_error, tol);
+}
+
+// ---------------------------------------------------------------------------
+/// Compare outputs for all combinations of requested outputs
+void CompareToReference(int steps)
+{
+  const double tol = 1e-9;
+  const ImageType v = VelocityField();
+  for (int mask = 1; mask < 32; ++mask) {
+    SCOPED_TRACE(string("disp=") + ((mask & DISP) ? "on" : "off") +
+                 ", J="    + ((mask & JAC ) ? "on" : "off") +
+                 ", detJ=" + ((mask & DET ) ? "on" : "off") +
+                 ", logJ=" + ((mask & LOG ) ? "on" : "off") +
+                 ", dv="   + ((mask & DOFS) ? "on" : "off"));
+    Outputs out;
+    Exponentiate(v, mask, steps, 1.0, out);
+    const Outputs ref = Reference(v, mask, steps);
+    if (mask & DISP) ExpectNear(ref.disp, out.disp, 3, tol);
+    if (mask & JAC ) ExpectNear(ref.jac,  out.jac,  9, tol);
+    if (mask & DET ) ExpectNear(ref.det,  out.det,  1, tol);
+    if (mask & LOG ) ExpectNear(ref.log,  out.log,  1, tol);
+    if (mask & DOFS) ExpectNear(ref.dofs, out.dofs, 9, tol);
+  }
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(ScalingAndSquaring, ReferenceDisplacement)
+{
+  // Exponential is non-trivial and maps voxels outside the image domain
+  const ImageType v = VelocityField();
+  const Outputs   s = Reference(v, DISP, 4);
+  int outside = 0;
+  double max_disp = .0;
+  for (int k = 0; k < s.disp.Z(); ++k)
+  for (int j = 0; j < s.disp.Y(); ++j)
+  for (int i = 0; i < s.disp.X(); ++i) {
+    const double x = i + s.disp(i, j, k, 0);
+    const double y = j + s.disp(i, j, k, 1);
+    const double z = k + s.disp(i, j, k, 2);
+    if (x < 0 || x > s.disp.X() - 1 ||
+        y < 0 || y > s.disp.Y() - 1 ||
+        z < 0 || z > s.disp.Z() - 1) ++outside;
+    for (int l = 0; l < 3; ++l) max_disp = max(max_disp, abs(s.disp(i, j, k, l)));
+  }
+  EXPECT_GT(outside, 0);
+  EXPECT_GT(max_disp, 1.0);
+}
+
+// ---------------------------------------------------------------------------
+TEST(ScalingAndSquaring, OddNumberOfSquaringSteps)
+{
+  CompareToReference(3);
+}
+
+// ---------------------------------------------------------------------------
+TEST(ScalingAndSquaring, EvenNumberOfSquaringSteps)
+{
+  CompareToReference(4);
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
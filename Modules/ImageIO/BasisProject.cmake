@@ -61,6 +61,7 @@ basis_project (
     ZLIB # for NiftiCLib
     #<optional-dependency>
   TEST_DEPENDS
+    GTest
     #<test-dependency>
   OPTIONAL_TEST_DEPENDS
     #<optional-test-dependency>
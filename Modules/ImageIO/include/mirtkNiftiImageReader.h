@@ -73,6 +73,9 @@ protected:
   /// Read header of NIFTI file
   virtual void ReadHeader();
 
+  /// Name of .nii or .img file containing the image data
+  virtual string DataFileName() const;
+
 };
 
 
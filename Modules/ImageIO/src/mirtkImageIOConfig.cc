@@ -19,6 +19,11 @@
 
 #include <mirtkImageIOConfig.h>
 
+#include <mirtkString.h>
+#include <mirtkImageReader.h>
+
+#include <cstdlib>
+
 #if !defined(MIRTK_AUTO_REGISTER)
   #include <mirtkImageReaderFactory.h>
   #include <mirtkImageWriterFactory.h>
@@ -65,6 +70,22 @@ static void RegisterImageWriters()
   #endif
 }
 
+// -----------------------------------------------------------------------------
+static void InitializeImageReaderDefaults()
+{
+  // Memory-map uncompressed image files when MIRTK_MEMORY_MAP is set to a
+  // boolean value such as "on" or "yes" (cf. ImageReader::MemoryMap)
+  const char *memory_map = getenv("MIRTK_MEMORY_MAP");
+  if (memory_map && memory_map[0] != '\0') {
+    bool enable;
+    if (FromString(memory_map, enable)) {
+      ImageReader::DefaultMemoryMap = enable;
+    } else {
+      cerr << "Warning: Ignoring invalid MIRTK_MEMORY_MAP value: " << memory_map << endl;
+    }
+  }
+}
+
 // -----------------------------------------------------------------------------
 void InitializeImageIOLibrary()
 {
@@ -72,6 +93,7 @@ void InitializeImageIOLibrary()
   if (!initialized) {
     RegisterImageReaders();
     RegisterImageWriters();
+    InitializeImageReaderDefaults();
     initialized = true;
   }
 }
@@ -145,6 +145,12 @@ void NiftiImageReader::Initialize()
   this->Open(_ImageName.c_str());
 }
 
+// -----------------------------------------------------------------------------
+string NiftiImageReader::DataFileName() const
+{
+  return _ImageName;
+}
+
 // -----------------------------------------------------------------------------
 void NiftiImageReader::ReadHeader()
 {
@@ -21,6 +21,7 @@
 #include <mirtkNiftiImageWriter.h>
 
 #include <mirtkVoxel.h>
+#include <mirtkCofstream.h>
 #include <mirtkImageWriterFactory.h>
 #include "mirtkNiftiImage.h"
 
@@ -212,7 +213,24 @@ void NiftiImageWriter::Run()
   _Nifti->nim->data         = data;      // Restore data pointer
 
   // Write hdr and data
-  nifti_image_write(_Nifti->nim);
+  if (_Nifti->nim->nifti_type == NIFTI_FTYPE_NIFTI1_1 && _Nifti->nim->num_ext == 0 &&
+      nifti_is_gzfile(_FileName.c_str())) {
+    // Compress .nii.gz file in independent blocks using multiple threads
+    nifti_set_iname_offset(_Nifti->nim);
+    nhdr = nifti_convert_nim2nhdr(_Nifti->nim);
+    const char extender[4] = {0, 0, 0, 0};
+    const long size = static_cast<long>(nifti_get_volsize(_Nifti->nim));
+    Cofstream to(_FileName.c_str());
+    if (!to.Write(reinterpret_cast<const char *>(&nhdr), 0, sizeof(nhdr)) ||
+        !to.Write(extender, -1, 4) ||
+        !to.Write(reinterpret_cast<const char *>(data), _Nifti->nim->iname_offset, size)) {
+      cerr << this->NameOfClass() << "::Run: Failed to write image to " << _FileName << endl;
+      exit(1);
+    }
+    to.Close();
+  } else {
+    nifti_image_write(_Nifti->nim);
+  }
 
   // Finalize filter
   this->Finalize();
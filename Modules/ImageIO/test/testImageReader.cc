@@ -0,0 +1,130 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mirtkImageIOConfig.h>
+#include <mirtkImageReader.h>
+#include <mirtkGenericImage.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace mirtk;
+
+
+// ===========================================================================
+// Helper
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Byte offset of the voxel data in a NIfTI-1 single file without extensions
+static const long nifti_vox_offset = 352;
+
+// ---------------------------------------------------------------------------
+/// Image with distinct voxel values
+void fill_image(GenericImage<float> &image)
+{
+  for (int k = 0; k < image.Z(); ++k)
+  for (int j = 0; j < image.Y(); ++j)
+  for (int i = 0; i < image.X(); ++i) {
+    image(i, j, k) = .5f * static_cast<float>(i + 10 * j + 100 * k) - 3.0f;
+  }
+}
+
+// ---------------------------------------------------------------------------
+/// Expect voxel values of images to be identical
+void expect_equal_values(const GenericImage<float> &a, const GenericImage<float> &b)
+{
+  ASSERT_EQ(a.X(), b.X());
+  ASSERT_EQ(a.Y(), b.Y());
+  ASSERT_EQ(a.Z(), b.Z());
+  for (int k = 0; k < a.Z(); ++k)
+  for (int j = 0; j < a.Y(); ++j)
+  for (int i = 0; i < a.X(); ++i) {
+    EXPECT_EQ(a(i, j, k), b(i, j, k));
+  }
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(ImageReader, MemoryMappedNifti)
+{
+  ASSERT_TRUE(ImageReader::DefaultMemoryMap);
+
+  const char *fname = "testImageReader.nii";
+  GenericImage<float> image(ImageAttributes(10, 9, 8));
+  fill_image(image);
+  image.Write(fname);
+
+  unique_ptr<ImageReader> reader(ImageReader::New(fname));
+  EXPECT_TRUE(reader->MemoryMap());
+
+  // Voxel data references the file mapping at the offset of the data
+  GenericImage<float> mapped(fname);
+  ASSERT_TRUE(mapped.DataMemory() != nullptr);
+  const char *base = static_cast<const char *>(mapped.DataMemory().get());
+  EXPECT_EQ(base + nifti_vox_offset, reinterpret_cast<const char *>(mapped.Data()));
+  expect_equal_values(image, mapped);
+
+  // Copies of mapped images own their data
+  GenericImage<float> copy(mapped);
+  EXPECT_TRUE(copy.DataMemory() == nullptr);
+  EXPECT_NE(mapped.Data(), copy.Data());
+  expect_equal_values(image, copy);
+
+  // Modification of mapped image does not change the file
+  mapped(1, 2, 3) = -100.0f;
+  GenericImage<float> reread(fname);
+  expect_equal_values(image, reread);
+
+  remove(fname);
+}
+
+// ---------------------------------------------------------------------------
+TEST(ImageReader, CompressedNiftiNotMapped)
+{
+  const char *fname = "testImageReader.nii.gz";
+  GenericImage<float> image(ImageAttributes(10, 9, 8));
+  fill_image(image);
+  image.Write(fname);
+
+  GenericImage<float> read(fname);
+  EXPECT_TRUE(read.DataMemory() == nullptr);
+  expect_equal_values(image, read);
+
+  remove(fname);
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  // Enable memory mapping as a user would via the environment
+  setenv("MIRTK_MEMORY_MAP", "on", 1);
+  InitializeImageIOLibrary();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,71 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_Assignment_H
+#define MIRTK_Assignment_H
+
+#include <mirtkArray.h>
+#include <mirtkMatrix.h>
+#include <mirtkSparseMatrix.h>
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Linear assignment problem / Minimum cost bipartite matching
+// =============================================================================
+
+/// Find assignment of rows to columns with minimum total cost
+///
+/// Solves the linear assignment problem given a dense cost matrix using the
+/// shortest augmenting path method of Jonker and Volgenant (Computing 38(4),
+/// 1987), which maintains dual variables of rows and columns as in the
+/// Hungarian method and has O(m^2 n) time complexity for m <= n. If the
+/// matrix has more rows than columns, only as many rows as there are
+/// columns are assigned.
+///
+/// \param[in] cost Cost of assigning the i-th row to the j-th column.
+///
+/// \returns Index of column assigned to each row or -1 if row is unassigned.
+Array<int> MinimumCostAssignment(const Matrix &cost);
+
+/// Find assignment of rows to columns with minimum total cost
+///
+/// Solves the linear assignment problem given a sparse square cost matrix
+/// using the forward auction algorithm of Bertsekas with epsilon scaling
+/// (Annals of Operations Research 14(1), 1988). Only the non-zero entries of
+/// the sparse matrix are admissible assignments. As adding a constant to all
+/// costs does not change the optimal assignment, zero costs can be avoided
+/// by an offset. The time and memory requirements depend on the number of
+/// admissible assignments only, which makes this solver more efficient for
+/// large problems where each row has only few candidate columns.
+///
+/// \param[in] cost Cost of assigning the i-th row to the j-th column.
+/// \param[in] eps  Minimum bid increment of final auction. The total cost of
+///                 the assignment is at most n * eps above the optimum.
+///                 By default, 1e-9 / n times the range of costs.
+///
+/// \returns Index of column assigned to each row.
+Array<int> MinimumCostAssignment(const GenericSparseMatrix<double> &cost, double eps = .0);
+
+
+} // namespace mirtk
+
+#endif // MIRTK_Assignment_H
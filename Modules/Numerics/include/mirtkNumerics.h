@@ -41,5 +41,8 @@
 // Regression models
 #include <mirtkPolynomial.h>
 
+// Combinatorial optimization
+#include <mirtkAssignment.h>
+
 
 #endif // MIRTK_Numerics_H
@@ -32,6 +32,7 @@
 #include <mirtkArray.h>
 #include <mirtkAlgorithm.h>
 #include <mirtkProfiling.h>
+#include <mirtkParallel.h>
 
 #include <mirtkNumericsConfig.h>
 #if MIRTK_Numerics_WITH_MATLAB && defined(HAVE_MATLAB)
@@ -309,7 +310,12 @@ public:
   /// \note This function is most efficient when the CCS layout is used.
   EntryType ColumnSum(int) const;
 
-  /// Multiply matrix by vector, used to interface with ARPACK
+  /// Multiply matrix by vector, used by iterative eigen solvers
+  ///
+  /// Blocks of consecutive rows (CRS) or columns (CCS) are processed in
+  /// parallel. In case of the CCS layout, each thread accumulates the
+  /// products of its columns in a private output vector.
+  ///
   /// \note This function is most efficient when the CRS layout is used.
   void MultAv(EntryType [], EntryType []) const;
 
@@ -360,6 +366,10 @@ public:
   /// magnitude to the specified \p sigma value. Uses the Implicitly Restarted
   /// Arnoldi Method implemented by ARPACK. The LU factorization used for the
   /// shift-and-invert mode is computed using UMFPACK.
+  /// Without ARPACK and UMFPACK, the eigenvalues of a symmetric matrix are
+  /// computed by a built-in thick-restart Lanczos method, where the smallest
+  /// eigenvalues are found by shift-and-invert with a conjugate gradient solver,
+  /// and those closest to \p sigma by folding the spectrum about \p sigma.
   ///
   /// \param[out] v     Converged eigenvalues.
   /// \param[in]  k     Number of requested eigenvalues.
@@ -373,7 +383,7 @@ public:
   /// \returns Number of converged eigenvalues.
   ///
   /// \note Only implemented for real double precision sparse matrices.
-  ///       Use only when MIRTK_Numerics_WITH_eigs is 1.
+  ///       Non-symmetric matrices require MIRTK_Numerics_WITH_eigs to be 1.
   int Eigenvalues(Vector &v, int k, const char *sigma = "LM",
                   int p = 0, double tol = .0, int maxit = 0, Vector *v0 = NULL) const;
 
@@ -384,6 +394,10 @@ public:
   /// respectively, or are closest in magnitude to the specified \p sigma value.
   /// Uses the Implicitly Restarted Arnoldi Method (IRAM) implemented by ARPACK.
   /// The LU factorization for the shift-and-invert mode is computed using UMFPACK.
+  /// Without ARPACK and UMFPACK, the eigenvectors of a symmetric matrix are
+  /// computed by a built-in thick-restart Lanczos method, where the smallest
+  /// eigenvalues are found by shift-and-invert with a conjugate gradient solver,
+  /// and those closest to \p sigma by folding the spectrum about \p sigma.
   ///
   /// \param[out]    E     Matrix of eigenvectors in columns.
   /// \param[in]     k     Number of requested eigenvalues.
@@ -398,7 +412,7 @@ public:
   /// \returns Number of converged eigenvalues.
   ///
   /// \note Only implemented for real double precision sparse matrices.
-  ///       Use only when MIRTK_Numerics_WITH_eigs is 1.
+  ///       Non-symmetric matrices require MIRTK_Numerics_WITH_eigs to be 1.
   int Eigenvectors(Matrix &E, int k, const char *sigma = "LM",
                    int p = 0, double tol = .0, int maxit = 0, Vector *v0 = NULL) const;
 
@@ -409,6 +423,10 @@ public:
   /// magnitude to the specified \p sigma value. Uses the Implicitly Restarted
   /// Arnoldi Method implemented by ARPACK. The LU factorization used for the
   /// shift-and-invert mode is computed using UMFPACK.
+  /// Without ARPACK and UMFPACK, the eigenvalues of a symmetric matrix are
+  /// computed by a built-in thick-restart Lanczos method, where the smallest
+  /// eigenvalues are found by shift-and-invert with a conjugate gradient solver,
+  /// and those closest to \p sigma by folding the spectrum about \p sigma.
   ///
   /// \param[out] E     Matrix of eigenvectors in columns.
   /// \param[out] v     Converged eigenvalues.
@@ -423,7 +441,7 @@ public:
   /// \returns Number of converged eigenvalues.
   ///
   /// \note Only implemented for real double precision sparse matrices.
-  ///       Use only when MIRTK_Numerics_WITH_eigs is 1.
+  ///       Non-symmetric matrices require MIRTK_Numerics_WITH_eigs to be 1.
   int Eigenvectors(Matrix &E, Vector &v, int k, const char *sigma = "LM",
                    int p = 0, double tol = .0, int maxit = 0, Vector *v0 = NULL) const;
 
@@ -1629,34 +1647,97 @@ TEntry GenericSparseMatrix<TEntry>::ColumnSum(int c) const
   return ColSum(c);
 }
 
+// -----------------------------------------------------------------------------
+namespace SparseMatrixUtils {
+
+
+/// Multiply compressed rows of sparse matrix by vector
+template <class TEntry>
+struct MultiplyCompressedRows
+{
+  const int    *_Row;    ///< Offsets of first entry in each row
+  const int    *_Col;    ///< Column indices of non-zero entries
+  const TEntry *_Data;   ///< Values of non-zero entries
+  const TEntry *_Input;  ///< Input vector
+  TEntry       *_Output; ///< Output vector
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int r = re.begin(); r != re.end(); ++r) {
+      TEntry s(0);
+      for (int i = _Row[r]; i != _Row[r+1]; ++i) s += _Data[i] * _Input[_Col[i]];
+      _Output[r] = s;
+    }
+  }
+};
+
+/// Multiply compressed columns of sparse matrix by vector
+///
+/// Each split body accumulates the products of its range of columns in a
+/// private output vector, which is added to the output vector of the body
+/// it was split from when joined.
+template <class TEntry>
+struct MultiplyCompressedColumns
+{
+  const int    *_Row;    ///< Row indices of non-zero entries
+  const int    *_Col;    ///< Offsets of first entry in each column
+  const TEntry *_Data;   ///< Values of non-zero entries
+  const TEntry *_Input;  ///< Input vector
+  TEntry       *_Output; ///< Output vector
+  int           _Rows;   ///< Number of rows
+  bool          _Owner;  ///< Whether output vector is private to this body
+
+  MultiplyCompressedColumns(const int *row, const int *col, const TEntry *data,
+                            const TEntry *v, TEntry *w, int rows)
+  :
+    _Row(row), _Col(col), _Data(data), _Input(v), _Output(w), _Rows(rows), _Owner(false)
+  {
+    for (int r = 0; r < _Rows; ++r) _Output[r] = TEntry(0);
+  }
+
+  MultiplyCompressedColumns(const MultiplyCompressedColumns &lhs, split)
+  :
+    _Row(lhs._Row), _Col(lhs._Col), _Data(lhs._Data), _Input(lhs._Input),
+    _Output(CAllocate<TEntry>(lhs._Rows)), _Rows(lhs._Rows), _Owner(true)
+  {}
+
+  ~MultiplyCompressedColumns()
+  {
+    if (_Owner) Deallocate(_Output);
+  }
+
+  void join(const MultiplyCompressedColumns &rhs)
+  {
+    for (int r = 0; r < _Rows; ++r) _Output[r] += rhs._Output[r];
+  }
+
+  void operator ()(const blocked_range<int> &re)
+  {
+    for (int c = re.begin(); c != re.end(); ++c) {
+      const TEntry v = _Input[c];
+      for (int i = _Col[c]; i != _Col[c+1]; ++i) _Output[_Row[i]] += _Data[i] * v;
+    }
+  }
+};
+
+
+} // namespace SparseMatrixUtils
+
 // -----------------------------------------------------------------------------
 template <class TEntry>
 void GenericSparseMatrix<TEntry>::MultAv(TEntry v[], TEntry w[]) const
 {
-  const TEntry zero(0);
   if (_Layout == CRS) {
-    for (int r = 0; r < _Rows; ++r) {
-      w[r] = zero;
-      for (int i = _Row[r]; i != _Row[r+1]; ++i) w[r] += _Data[i] * v[_Col[i]];
-    }
+    SparseMatrixUtils::MultiplyCompressedRows<TEntry> body;
+    body._Row    = _Row;
+    body._Col    = _Col;
+    body._Data   = _Data;
+    body._Input  = v;
+    body._Output = w;
+    parallel_for(blocked_range<int>(0, _Rows, 256), body);
   } else {
-    if (_Index) {
-      int i;
-      for (int r = 0; r < _Rows; ++r) {
-        w[r] = zero;
-        for (size_t c = 0; c < _Index[r].size(); ++c) {
-          i = _Index[r][c];
-          w[r] += _Data[i] * v[_Col[i]];
-        }
-      }
-    } else {
-      for (int r = 0; r < _Rows; ++r) w[r] = zero;
-      for (int c = 0; c < _Cols; ++c) {
-        for (int i = _Col[c]; i != _Col[c+1]; ++i) {
-          w[_Row[c]] += _Data[i] * v[c];
-        }
-      }
-    }
+    SparseMatrixUtils::MultiplyCompressedColumns<TEntry> body(_Row, _Col, _Data, v, w, _Rows);
+    parallel_reduce(blocked_range<int>(0, _Cols, max(256, _Cols / 64)), body);
   }
 }
 
@@ -0,0 +1,199 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mirtkAssignment.h>
+
+#include <mirtkMath.h>
+#include <mirtkMemory.h>
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Dense cost matrix
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+Array<int> MinimumCostAssignment(const Matrix &cost)
+{
+  // Assign columns to rows of transposed problem when there are more rows
+  if (cost.Rows() > cost.Cols()) {
+    Array<int> col = MinimumCostAssignment(cost.Transposed());
+    Array<int> row(cost.Rows(), -1);
+    for (int c = 0; c < cost.Cols(); ++c) {
+      if (col[c] >= 0) row[col[c]] = c;
+    }
+    return row;
+  }
+
+  const int    m   = cost.Rows();
+  const int    n   = cost.Cols();
+  const double inf = numeric_limits<double>::infinity();
+
+  // Copy costs to row-major array for contiguous access to the rows
+  double *a = Allocate<double>(m * n);
+  for (int i = 0; i < m; ++i)
+  for (int j = 0; j < n; ++j) {
+    a[i * n + j] = cost(i, j);
+  }
+
+  // Dual variables of rows and columns, where index n denotes the virtual
+  // column from which the shortest augmenting path of a free row starts
+  Array<double> u(m, .0), v(n + 1, .0), minv(n + 1);
+  Array<int>    row(n + 1, -1), prev(n + 1);
+  Array<bool>   done(n + 1);
+
+  for (int i = 0; i < m; ++i) {
+    // Grow tree of shortest alternating paths until a free column is reached
+    int j0 = n;
+    row[n] = i;
+    fill(minv.begin(), minv.end(), inf);
+    fill(done.begin(), done.end(), false);
+    do {
+      done[j0] = true;
+      const int     i0 = row[j0];
+      const double *ai = a + i0 * n;
+      double delta = inf;
+      int    j1    = -1;
+      for (int j = 0; j < n; ++j) {
+        if (done[j]) continue;
+        const double reduced = ai[j] - u[i0] - v[j];
+        if (reduced < minv[j]) minv[j] = reduced, prev[j] = j0;
+        if (minv[j] < delta) delta = minv[j], j1 = j;
+      }
+      if (j1 == -1) {
+        cerr << "MinimumCostAssignment: No assignment with finite cost exists" << endl;
+        exit(1);
+      }
+      // Update dual variables such that reduced costs on tree remain zero
+      for (int j = 0; j <= n; ++j) {
+        if (done[j]) u[row[j]] += delta, v[j] -= delta;
+        else         minv[j]   -= delta;
+      }
+      j0 = j1;
+    } while (row[j0] != -1);
+    // Augment matching along shortest path
+    do {
+      const int j1 = prev[j0];
+      row[j0] = row[j1];
+      j0 = j1;
+    } while (j0 != n);
+  }
+  Deallocate(a);
+
+  Array<int> match(m, -1);
+  for (int j = 0; j < n; ++j) {
+    if (row[j] >= 0) match[row[j]] = j;
+  }
+  return match;
+}
+
+// =============================================================================
+// Sparse cost matrix
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+Array<int> MinimumCostAssignment(const GenericSparseMatrix<double> &cost, double eps)
+{
+  typedef GenericSparseMatrix<double>::Entries Entries;
+
+  const int    n   = cost.Rows();
+  const double inf = numeric_limits<double>::infinity();
+  if (cost.Cols() != n) {
+    cerr << "MinimumCostAssignment: Sparse cost matrix must be square" << endl;
+    exit(1);
+  }
+
+  // Admissible columns of each row and benefits of assignment, i.e.,
+  // negated costs as the auction maximizes the total benefit
+  Array<int>    offset(n + 1, 0);
+  Array<int>    column;
+  Array<double> benefit;
+  column .reserve(cost.NNZ());
+  benefit.reserve(cost.NNZ());
+  double amin = + inf, amax = - inf;
+  Entries entries;
+  for (int i = 0; i < n; ++i) {
+    cost.GetRow(i, entries);
+    if (entries.empty()) {
+      cerr << "MinimumCostAssignment: Row " << i << " has no admissible assignment" << endl;
+      exit(1);
+    }
+    for (size_t k = 0; k < entries.size(); ++k) {
+      column .push_back(entries[k].first);
+      benefit.push_back(-entries[k].second);
+      amin = min(amin, benefit.back());
+      amax = max(amax, benefit.back());
+    }
+    offset[i + 1] = static_cast<int>(column.size());
+  }
+  double range = amax - amin;
+  if (range <= .0) range = max(abs(amax), 1.0);
+  if (eps   <= .0) eps   = 1e-9 * range / n;
+
+  // Auction with decreasing minimum bid increment
+  Array<double> price(n, .0);
+  Array<int>    owner(n), match(n), queue;
+  queue.reserve(n);
+
+  double epsilon = max(.25 * range, eps);
+  while (true) {
+    fill(owner.begin(), owner.end(), -1);
+    fill(match.begin(), match.end(), -1);
+    queue.resize(n);
+    for (int i = 0; i < n; ++i) queue[i] = n - 1 - i;
+    // Upper bound of price increase during auction of a feasible problem
+    const double pmin  = *min_element(price.begin(), price.end());
+    const double pmax  = *max_element(price.begin(), price.end());
+    const double bound = pmax + 2.0 * n * (range + epsilon + pmax - pmin);
+    while (!queue.empty()) {
+      const int i = queue.back();
+      queue.pop_back();
+      // Find best and second best column for bidder
+      int    j1 = -1;
+      double v1 = - inf, v2 = - inf;
+      for (int k = offset[i]; k < offset[i + 1]; ++k) {
+        const double value = benefit[k] - price[column[k]];
+        if (value > v1) v2 = v1, v1 = value, j1 = column[k];
+        else if (value > v2) v2 = value;
+      }
+      if (v2 == - inf) v2 = v1 - range;
+      // Bid for best column and assign it to bidder
+      price[j1] += v1 - v2 + epsilon;
+      if (price[j1] > bound) {
+        cerr << "MinimumCostAssignment: No assignment of all rows exists" << endl;
+        exit(1);
+      }
+      if (owner[j1] != -1) {
+        match[owner[j1]] = -1;
+        queue.push_back(owner[j1]);
+      }
+      owner[j1] = i;
+      match[i]  = j1;
+    }
+    if (epsilon <= eps) break;
+    epsilon = max(.25 * epsilon, eps);
+  }
+
+  return match;
+}
+
+
+} // namespace mirtk
@@ -19,6 +19,9 @@
 
 #include <mirtkSparseMatrix.h>
 
+#include <mirtkParallel.h>
+#include <mirtkRandom.h>
+
 #if MIRTK_Numerics_WITH_eigs
 #  include <mirtkArpack.h>
 #  include <mirtkUmfpack.h>
@@ -32,6 +35,546 @@
 namespace mirtk {
 
 
+// =============================================================================
+// Thick-restart Lanczos method
+// =============================================================================
+
+namespace SparseMatrixUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Multiply symmetric sparse matrix by vector and add scaled input vector,
+/// i.e., y = a A x + b x, given the compressed rows or columns of A
+struct MultiplyShiftedMatrix
+{
+  const int    *_Row;    ///< Offsets of first entry in each row
+  const int    *_Col;    ///< Column indices of non-zero entries
+  const double *_Data;   ///< Values of non-zero entries
+  const double *_Input;  ///< Input vector
+  double       *_Output; ///< Output vector
+  double        _Scale;  ///< Factor of matrix-vector product
+  double        _Shift;  ///< Factor of input vector
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int r = re.begin(); r != re.end(); ++r) {
+      double s = .0;
+      for (int i = _Row[r]; i != _Row[r+1]; ++i) s += _Data[i] * _Input[_Col[i]];
+      _Output[r] = _Scale * s + _Shift * _Input[r];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Compute dot products of a vector with the first m basis vectors
+struct ProjectOntoBasis
+{
+  const double *_Basis;  ///< Basis vectors stored one after another
+  const double *_Vector; ///< Vector to project onto basis vectors
+  int           _Size;   ///< Length of vectors
+  Array<double> _Dot;    ///< Dot products with basis vectors
+
+  ProjectOntoBasis(const double *basis, const double *w, int n, int m)
+  :
+    _Basis(basis), _Vector(w), _Size(n), _Dot(m, .0)
+  {}
+
+  ProjectOntoBasis(const ProjectOntoBasis &lhs, split)
+  :
+    _Basis(lhs._Basis), _Vector(lhs._Vector), _Size(lhs._Size), _Dot(lhs._Dot.size(), .0)
+  {}
+
+  void join(const ProjectOntoBasis &rhs)
+  {
+    for (size_t j = 0; j < _Dot.size(); ++j) _Dot[j] += rhs._Dot[j];
+  }
+
+  void operator ()(const blocked_range<int> &re)
+  {
+    const double *v = _Basis;
+    for (size_t j = 0; j < _Dot.size(); ++j, v += _Size) {
+      double d = .0;
+      for (int i = re.begin(); i != re.end(); ++i) d += v[i] * _Vector[i];
+      _Dot[j] += d;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Compute linear combinations of the first m basis vectors, i.e.,
+/// x_l = b x_l + sum_j c_jl v_j for each output vector x_l
+struct CombineBasisVectors
+{
+  const double *_Basis;  ///< Basis vectors stored one after another
+  const double *_Coeff;  ///< Coefficients c_jl stored column by column
+  double       *_Output; ///< Output vectors stored one after another
+  int           _Size;   ///< Length of vectors
+  int           _Number; ///< Number m of basis vectors
+  int           _Count;  ///< Number of output vectors
+  double        _Keep;   ///< Factor b of previous output vectors
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const double *c = _Coeff;
+    double       *x = _Output;
+    for (int l = 0; l < _Count; ++l, c += _Number, x += _Size) {
+      for (int i = re.begin(); i != re.end(); ++i) {
+        double s = .0;
+        for (int j = 0; j < _Number; ++j) s += c[j] * _Basis[j * _Size + i];
+        x[i] = _Keep * x[i] + s;
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Linear operator whose largest eigenvalues are computed by Lanczos iterations
+///
+/// Eigenvalues of the symmetric matrix A at the upper end of its spectrum are
+/// the largest eigenvalues of OP = A itself. Those at the lower end are the
+/// largest eigenvalues of the shift-and-invert operator OP = (A - sigma I)^-1,
+/// where sigma is below the Gershgorin bound of the smallest eigenvalue of A.
+/// The linear system is solved matrix-free by the conjugate gradient method,
+/// because A - sigma I is positive definite. The eigenvalues closest to a given
+/// sigma value inside the spectrum, for which A - sigma I is indefinite, are
+/// the largest eigenvalues of the folded spectrum OP = -(A - sigma I)^2.
+class LanczosOperator
+{
+public:
+
+  /// Spectral transformation
+  enum Mode { Identity, Invert, Fold };
+
+  LanczosOperator(const GenericSparseMatrix<double> &A, Mode mode, double shift, double tol = .0)
+  :
+    _Size(A.Rows()), _Mode(mode), _Shift(shift), _Temp(NULL),
+    _Residual(NULL), _Direction(NULL), _Tolerance(tol),
+    _MaxIterations(max(10 * A.Rows(), 100)), _Iterations(0)
+  {
+    int *row, *col;
+    double *data;
+    A.GetRawData(row, col, data);
+    // CCS of symmetric matrix is equivalent to its CRS
+    if (A.Layout() == GenericSparseMatrix<double>::CCS) swap(row, col);
+    _Mult._Row  = row;
+    _Mult._Col  = col;
+    _Mult._Data = data;
+    if (_Mode != Identity) _Temp = Allocate<double>(_Size);
+    if (_Mode == Invert) {
+      _Residual  = Allocate<double>(_Size);
+      _Direction = Allocate<double>(_Size);
+    }
+  }
+
+  ~LanczosOperator()
+  {
+    Deallocate(_Temp);
+    Deallocate(_Residual);
+    Deallocate(_Direction);
+  }
+
+  /// Compute y = OP x
+  void operator ()(const double *x, double *y)
+  {
+    switch (_Mode) {
+      case Identity: Mult(x, y,  1.0, .0); break;
+      case Invert:   Solve(x, y);          break;
+      case Fold:
+        Mult(x, _Temp, 1.0, -_Shift);
+        Mult(_Temp, y, -1.0, _Shift);
+        break;
+    }
+  }
+
+  /// Compute y = a A x + b x
+  void Mult(const double *x, double *y, double a, double b)
+  {
+    _Mult._Input  = x;
+    _Mult._Output = y;
+    _Mult._Scale  = a;
+    _Mult._Shift  = b;
+    parallel_for(blocked_range<int>(0, _Size, 256), _Mult);
+  }
+
+  /// Solve (A - sigma I) y = x using the conjugate gradient method
+  void Solve(const double *x, double *y)
+  {
+    double * const r = _Residual;
+    double * const d = _Direction;
+    double * const q = _Temp;
+    memset(y, 0, _Size * sizeof(double));
+    memcpy(r, x, _Size * sizeof(double));
+    memcpy(d, x, _Size * sizeof(double));
+    double rr = Dot(r, r);
+    const double maxrr = _Tolerance * _Tolerance * rr;
+    for (int iter = 0; iter < _MaxIterations && rr > maxrr; ++iter) {
+      Mult(d, q, 1.0, -_Shift);
+      const double alpha = rr / Dot(d, q);
+      for (int i = 0; i < _Size; ++i) {
+        y[i] += alpha * d[i];
+        r[i] -= alpha * q[i];
+      }
+      const double rr_new = Dot(r, r);
+      const double beta   = rr_new / rr;
+      for (int i = 0; i < _Size; ++i) d[i] = r[i] + beta * d[i];
+      rr = rr_new;
+      ++_Iterations;
+    }
+  }
+
+  /// Dot product of two vectors
+  double Dot(const double *a, const double *b) const
+  {
+    ProjectOntoBasis proj(a, b, _Size, 1);
+    parallel_reduce(blocked_range<int>(0, _Size, 1024), proj);
+    return proj._Dot[0];
+  }
+
+  /// Mode of spectral transformation
+  Mode Transformation() const
+  {
+    return _Mode;
+  }
+
+  /// Total number of conjugate gradient iterations
+  int Iterations() const
+  {
+    return _Iterations;
+  }
+
+  /// Get eigenvalue of A given eigenvalue of OP
+  ///
+  /// \note Eigenvalues of the folded spectrum are ambiguous and
+  ///       must be computed from the Rayleigh quotient instead.
+  double Eigenvalue(double theta) const
+  {
+    return (_Mode == Invert ? _Shift + 1.0 / theta : theta);
+  }
+
+  /// Get Rayleigh quotient x' A x of unit length vector x
+  double RayleighQuotient(const double *x)
+  {
+    Mult(x, _Temp, 1.0, .0);
+    double d = .0;
+    for (int i = 0; i < _Size; ++i) d += x[i] * _Temp[i];
+    return d;
+  }
+
+private:
+
+  int                   _Size;
+  Mode                  _Mode;
+  double                _Shift;
+  double               *_Temp;
+  double               *_Residual;
+  double               *_Direction;
+  double                _Tolerance;
+  int                   _MaxIterations;
+  int                   _Iterations;
+  MultiplyShiftedMatrix _Mult;
+};
+
+// -----------------------------------------------------------------------------
+/// Compare Ritz values such that wanted ones come first
+struct CompareRitzValues
+{
+  const Vector *_Values;    ///< Ritz values
+  bool          _Magnitude; ///< Whether Ritz values of largest magnitude are wanted
+
+  bool operator ()(int a, int b) const
+  {
+    if (_Magnitude) return abs(_Values->Get(a)) > abs(_Values->Get(b));
+    return _Values->Get(a) > _Values->Get(b);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Gershgorin bounds of the eigenvalues of a symmetric sparse matrix
+void GershgorinBounds(const GenericSparseMatrix<double> &A, double &lower, double &upper)
+{
+  int *row, *col;
+  double *data;
+  A.GetRawData(row, col, data);
+  if (A.Layout() == GenericSparseMatrix<double>::CCS) swap(row, col);
+  lower = + numeric_limits<double>::infinity();
+  upper = - numeric_limits<double>::infinity();
+  for (int r = 0; r < A.Rows(); ++r) {
+    double d = .0, s = .0;
+    for (int i = row[r]; i != row[r+1]; ++i) {
+      if (col[i] == r) d += data[i];
+      else             s += abs(data[i]);
+    }
+    lower = min(lower, d - s);
+    upper = max(upper, d + s);
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Orthogonalize vector w against the first m basis vectors
+///
+/// Uses classical Gram-Schmidt with one step of reorthogonalization.
+///
+/// \returns Dot product of w with m-th basis vector before orthogonalization.
+double Orthogonalize(const double *basis, double *w, int n, int m)
+{
+  double alpha = .0;
+  CombineBasisVectors sub;
+  sub._Basis  = basis;
+  sub._Output = w;
+  sub._Size   = n;
+  sub._Number = m;
+  sub._Count  = 1;
+  sub._Keep   = 1.0;
+  for (int pass = 0; pass < 2; ++pass) {
+    ProjectOntoBasis proj(basis, w, n, m);
+    parallel_reduce(blocked_range<int>(0, n, 1024), proj);
+    alpha += proj._Dot[m-1];
+    for (int j = 0; j < m; ++j) proj._Dot[j] = - proj._Dot[j];
+    sub._Coeff = proj._Dot.data();
+    parallel_for(blocked_range<int>(0, n, 1024), sub);
+  }
+  return alpha;
+}
+
+// -----------------------------------------------------------------------------
+/// Euclidean norm of vector
+double Norm(const double *w, int n)
+{
+  ProjectOntoBasis proj(w, w, n, 1);
+  parallel_reduce(blocked_range<int>(0, n, 1024), proj);
+  return sqrt(proj._Dot[0]);
+}
+
+
+} // namespace SparseMatrixUtils
+using namespace SparseMatrixUtils;
+
+// -----------------------------------------------------------------------------
+/// Compute eigenvalues and -vectors of symmetric sparse matrix using the
+/// thick-restart Lanczos method with full reorthogonalization
+///
+/// After each restart, the Ritz vectors of the wanted Ritz values are kept
+/// as the first vectors of the new Lanczos basis, which is extended by the
+/// last Lanczos vector (Wu and Simon, SIAM J. Matrix Anal. Appl. 22(2), 2000).
+/// The spectrum of the matrix is transformed such that the wanted eigenvalues
+/// are always the largest eigenvalues of the linear Lanczos operator.
+///
+/// Full reorthogonalization costs O(n p^2) operations per restart, which is
+/// why the basis is kept small unless the spectrum is folded, and maxit is
+/// the maximum number of restarts.
+int lanczos(const GenericSparseMatrix<double> &A, Matrix *E, Vector &v,
+            int k, const char *eigs_sigma, int p, double tol, int maxit, Vector *v0)
+{
+  if (A.Cols() != A.Rows()) {
+    cerr << "eigs: Matrix must be square" << endl;
+    exit(1);
+  }
+  if (!A.IsSymmetric()) {
+    cerr << "eigs: Only symmetric matrices supported when Numerics module was"
+            " built without ARPACK and UMFPACK" << endl;
+    exit(1);
+  }
+  const int n = A.Rows();
+
+  // Choose spectral transformation
+  LanczosOperator::Mode mode  = LanczosOperator::Identity;
+  double                shift = .0;
+  bool                  magn  = false;
+
+  double lower, upper;
+  GershgorinBounds(A, lower, upper);
+
+  char which[3] = { "LM" };
+  if (strlen(eigs_sigma) == 2 && (!isdigit(eigs_sigma[0]) || !isdigit(eigs_sigma[1]))) {
+    which[0] = toupper(eigs_sigma[0]);
+    which[1] = toupper(eigs_sigma[1]);
+    if (strcmp(which, "LM") == 0) {
+      magn = true;
+    } else if (strcmp(which, "SA") == 0 || (strcmp(which, "SM") == 0 && lower >= .0)) {
+      // Shift just below the spectrum such that A - sigma I is positive
+      // definite. The distance must be small compared to the gaps between the
+      // smallest eigenvalues, which for the Laplacian of a mesh with n nodes
+      // are in the order of 1/n, for the inverse to separate the wanted
+      // eigenvalues within few restarts. CG needs only few more iterations
+      // for the then isolated smallest eigenvalue of A - sigma I.
+      mode  = LanczosOperator::Invert;
+      shift = lower - max(min(1e-3, 1e-2 / n) * (upper - lower), 1e-12);
+    } else if (strcmp(which, "SM") == 0 && upper > .0) {
+      mode  = LanczosOperator::Fold;
+    } else if (strcmp(which, "SM") != 0 && strcmp(which, "LA") != 0) {
+      cerr << "eigs: Invalid sigma string: " << eigs_sigma << endl;
+      exit(1);
+    }
+  } else {
+    if (!FromString(eigs_sigma, shift)) {
+      cerr << "eigs: Invalid sigma string or value: " << eigs_sigma << endl;
+      exit(1);
+    }
+    mode = LanczosOperator::Fold;
+  }
+  // Check input and derive (default) parameters
+  k = min(k, n);
+  if (p     <= 0 ) p     = (mode == LanczosOperator::Fold ? max(4 * k, 64) : max(2 * k, 20));
+  if (tol   <= .0) tol   = 1e-10;
+  if (maxit <= 0 ) maxit = max(300.0, ceil(2 * n / max(p, 1)));
+  p = min(max(p, k + 1), n);
+  if (k <= 0) {
+    v.Initialize(0);
+    if (E) E->Clear();
+    return 0;
+  }
+
+  // Inner linear systems are solved more accurately than the Ritz residuals
+  LanczosOperator op(A, mode, shift, max(1e-2 * tol, 1e-14));
+
+  // Lanczos basis vectors stored one after another
+  double *V = Allocate<double>(n * (p + 1));
+
+  mt19937 gen;
+  uniform_real_distribution<double> dist(-1.0, 1.0);
+  if (v0 && v0->Rows() != 0) {
+    if (v0->Rows() != n) {
+      cerr << "eigs: Initial vector v0 must have " << n << " rows" << endl;
+      exit(1);
+    }
+    for (int i = 0; i < n; ++i) V[i] = v0->Get(i);
+  } else {
+    for (int i = 0; i < n; ++i) V[i] = dist(gen);
+  }
+  double norm = Norm(V, n);
+  for (int i = 0; i < n; ++i) V[i] /= norm;
+
+  // Projection of Lanczos operator onto Lanczos basis, i.e., tridiagonal
+  // matrix extended by coupling of the kept Ritz vectors after restart
+  Matrix T(p, p), Y;
+  Vector theta;
+  Array<int>    order(p);
+  Array<double> coeff;
+
+  CompareRitzValues compare;
+  compare._Values    = &theta;
+  compare._Magnitude = magn;
+
+  const double eps23 = pow(numeric_limits<double>::epsilon(), 2.0 / 3.0);
+
+  int    l     = 0;   // Number of kept Ritz vectors
+  int    nconv = 0;   // Number of converged wanted Ritz values
+  double beta  = .0;  // Norm of residual of last Lanczos vector
+
+  for (int iter = 0; iter < maxit; ++iter) {
+
+    // Extend Lanczos basis
+    for (int j = l; j < p; ++j) {
+      double *w = V + (j + 1) * n;
+      op(V + j * n, w);
+      T(j, j) = Orthogonalize(V, w, n, j + 1);
+      beta = Norm(w, n);
+      if (beta <= eps23 * max(abs(T(j, j)), beta)) {
+        // Invariant subspace found, continue with random orthogonal vector
+        beta = .0;
+        if (j + 1 < n) {
+          for (int i = 0; i < n; ++i) w[i] = dist(gen);
+          Orthogonalize(V, w, n, j + 1);
+          norm = Norm(w, n);
+          for (int i = 0; i < n; ++i) w[i] /= norm;
+        } else {
+          memset(w, 0, n * sizeof(double));
+        }
+      } else {
+        for (int i = 0; i < n; ++i) w[i] /= beta;
+      }
+      if (j + 1 < p) T(j, j + 1) = T(j + 1, j) = beta;
+    }
+
+    // Rayleigh-Ritz: Order Ritz values such that wanted ones come first
+    T.SymmetricEigen(Y, theta);
+    for (int i = 0; i < p; ++i) order[i] = i;
+    sort(order.begin(), order.end(), compare);
+
+    // Check convergence of wanted Ritz values
+    double anorm = eps23;
+    for (int i = 0; i < p; ++i) anorm = max(anorm, abs(theta(i)));
+    nconv = 0;
+    while (nconv < k && abs(beta * Y(p - 1, order[nconv])) <= tol * anorm) ++nconv;
+    if (nconv == k || iter + 1 == maxit) break;
+
+    // Thick restart with Ritz vectors of wanted Ritz values
+    l = min(k + (p - k) / 2, p - 1);
+    coeff.resize(l * p);
+    for (int c = 0; c < l; ++c) {
+      for (int j = 0; j < p; ++j) coeff[c * p + j] = Y(j, order[c]);
+    }
+    double *X = Allocate<double>(n * l);
+    CombineBasisVectors comb;
+    comb._Basis  = V;
+    comb._Coeff  = coeff.data();
+    comb._Output = X;
+    comb._Size   = n;
+    comb._Number = p;
+    comb._Count  = l;
+    comb._Keep   = .0;
+    parallel_for(blocked_range<int>(0, n, 1024), comb);
+    memcpy(V,         X,         n * l * sizeof(double));
+    memcpy(V + l * n, V + p * n, n     * sizeof(double));
+    Deallocate(X);
+
+    T.Initialize(p, p);
+    for (int c = 0; c < l; ++c) {
+      T(c, c) = theta(order[c]);
+      T(c, l) = T(l, c) = beta * Y(p - 1, order[c]);
+    }
+  }
+
+  // Optionally return final residual vector
+  if (v0) {
+    v0->Resize(n);
+    const double *r = V + p * n;
+    for (int i = 0; i < n; ++i) v0->Put(i, beta * r[i]);
+  }
+
+  // Compute eigenvalues (and -vectors) of converged Ritz pairs
+  v.Initialize(nconv);
+  if (E) {
+    if (nconv > 0) E->Initialize(n, nconv);
+    else           E->Clear();
+  }
+  if (E || op.Transformation() == LanczosOperator::Fold) {
+    coeff.resize(nconv * p);
+    for (int c = 0; c < nconv; ++c) {
+      for (int j = 0; j < p; ++j) coeff[c * p + j] = Y(j, order[c]);
+    }
+    double *X = Allocate<double>(n * nconv);
+    CombineBasisVectors comb;
+    comb._Basis  = V;
+    comb._Coeff  = coeff.data();
+    comb._Output = X;
+    comb._Size   = n;
+    comb._Number = p;
+    comb._Count  = nconv;
+    comb._Keep   = .0;
+    parallel_for(blocked_range<int>(0, n, 1024), comb);
+    for (int c = 0; c < nconv; ++c) {
+      const double *x = X + c * n;
+      if (op.Transformation() == LanczosOperator::Fold) {
+        v(c) = op.RayleighQuotient(x);
+      } else {
+        v(c) = op.Eigenvalue(theta(order[c]));
+      }
+      if (E) {
+        for (int r = 0; r < n; ++r) E->Put(r, c, x[r]);
+      }
+    }
+    Deallocate(X);
+  } else {
+    for (int c = 0; c < nconv; ++c) {
+      v(c) = op.Eigenvalue(theta(order[c]));
+    }
+  }
+
+  Deallocate(V);
+  return nconv;
+}
+
 // =============================================================================
 // Eigen decomposition
 // =============================================================================
@@ -293,8 +836,7 @@ int eigs(const GenericSparseMatrix<double> &A, Matrix *E, Vector &v,
   Deallocate(basis);
 
 #else // MIRTK_Numerics_WITH_eigs
-  cerr << "eigs: Only available when Numerics module was built WITH_ARPACK and WITH_UMFPACK" << endl;
-  exit(1);
+  nconv = lanczos(A, E, v, k, eigs_sigma, p, tol, maxit, v0);
 #endif // MIRTK_Numerics_WITH_eigs
 
   return nconv;
@@ -0,0 +1,147 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtkNumericsTest.h"
+
+#include <mirtkAssignment.h>
+#include <mirtkAlgorithm.h>
+using namespace mirtk;
+
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Cost matrix with pseudo-random integral entries in [1, 100]
+Matrix AssignmentTestCosts(int m, int n, int seed)
+{
+  Matrix cost(m, n);
+  for (int i = 0; i < m; ++i)
+  for (int j = 0; j < n; ++j) {
+    cost(i, j) = 1 + (seed + 37 * i + 101 * j + 7 * i * j * j) % 100;
+  }
+  return cost;
+}
+
+// -----------------------------------------------------------------------------
+/// Minimum total cost of assigning each row to a distinct column (m <= n)
+double BruteForceMinimumCost(const Matrix &cost)
+{
+  Array<int> col(cost.Cols());
+  for (int j = 0; j < cost.Cols(); ++j) col[j] = j;
+  double min_cost = numeric_limits<double>::infinity();
+  do {
+    double sum = .0;
+    for (int i = 0; i < cost.Rows(); ++i) sum += cost(i, col[i]);
+    min_cost = min(min_cost, sum);
+  } while (next_permutation(col.begin(), col.end()));
+  return min_cost;
+}
+
+// -----------------------------------------------------------------------------
+/// Total cost of assignment, checking that no column is assigned twice
+double TotalCost(const Matrix &cost, const Array<int> &match)
+{
+  Array<bool> used(cost.Cols(), false);
+  double sum = .0;
+  for (int i = 0; i < cost.Rows(); ++i) {
+    if (match[i] < 0) continue;
+    EXPECT_LT(match[i], cost.Cols());
+    EXPECT_FALSE(used[match[i]]);
+    used[match[i]] = true;
+    sum += cost(i, match[i]);
+  }
+  return sum;
+}
+
+// =============================================================================
+// Tests
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+TEST(Assignment, DenseSquare)
+{
+  for (int seed = 0; seed < 5; ++seed) {
+    Matrix cost = AssignmentTestCosts(7, 7, seed);
+    Array<int> match = MinimumCostAssignment(cost);
+    ASSERT_EQ(7u, match.size());
+    for (int i = 0; i < 7; ++i) EXPECT_GE(match[i], 0);
+    EXPECT_DOUBLE_EQ(BruteForceMinimumCost(cost), TotalCost(cost, match));
+  }
+}
+
+// -----------------------------------------------------------------------------
+TEST(Assignment, DenseRectangular)
+{
+  Matrix cost = AssignmentTestCosts(4, 7, 3);
+  Array<int> match = MinimumCostAssignment(cost);
+  ASSERT_EQ(4u, match.size());
+  EXPECT_DOUBLE_EQ(BruteForceMinimumCost(cost), TotalCost(cost, match));
+
+  Matrix transposed = cost.Transposed();
+  Array<int> tmatch = MinimumCostAssignment(transposed);
+  ASSERT_EQ(7u, tmatch.size());
+  int nassigned = 0;
+  for (int i = 0; i < 7; ++i) {
+    if (tmatch[i] >= 0) ++nassigned;
+  }
+  EXPECT_EQ(4, nassigned);
+  EXPECT_DOUBLE_EQ(BruteForceMinimumCost(cost), TotalCost(transposed, tmatch));
+}
+
+// -----------------------------------------------------------------------------
+TEST(Assignment, SparseAuction)
+{
+  const int n = 200;
+  const double inadmissible = 1e6;
+  // Sparse costs with admissible diagonal such that an assignment exists
+  Matrix dense(n, n);
+  SparseDoubleMatrix::Entries *entries = new SparseDoubleMatrix::Entries[n];
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      dense(i, j) = inadmissible;
+      if (i == j || (11 * i + 17 * j) % 13 == 0) {
+        dense(i, j) = 1 + (3 * i + 5 * j + i * j) % 50;
+        entries[i].push_back(MakePair(j, dense(i, j)));
+      }
+    }
+  }
+  SparseDoubleMatrix cost(SparseDoubleMatrix::CRS);
+  cost.Initialize(n, n, entries);
+  delete[] entries;
+
+  Array<int> match = MinimumCostAssignment(cost);
+  ASSERT_EQ(static_cast<size_t>(n), match.size());
+  for (int i = 0; i < n; ++i) ASSERT_GE(match[i], 0);
+  const double auction = TotalCost(dense, match);
+  const double optimum = TotalCost(dense, MinimumCostAssignment(dense));
+  EXPECT_LT(auction, inadmissible);
+  EXPECT_NEAR(optimum, auction, 1e-6);
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,228 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtkNumericsTest.h"
+
+#include <mirtkSparseMatrix.h>
+using namespace mirtk;
+
+// =============================================================================
+// Test matrices
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Non-symmetric test matrix with a few non-zero entries per row
+double NonSymmetricTestEntry(int r, int c)
+{
+  return (c % 7 == r % 3 ? sin(.1 * r + .3 * c) + .5 : .0);
+}
+
+// -----------------------------------------------------------------------------
+/// Non-symmetric test matrix given compressed rows or columns, respectively
+SparseDoubleMatrix NonSymmetricTestMatrix(int m, int n, SparseDoubleMatrix::StorageLayout layout)
+{
+  const int l = (layout == SparseDoubleMatrix::CRS ? m : n);
+  SparseDoubleMatrix::Entries *entries = new SparseDoubleMatrix::Entries[l];
+  for (int r = 0; r < m; ++r)
+  for (int c = 0; c < n; ++c) {
+    const double value = NonSymmetricTestEntry(r, c);
+    if (value == .0) continue;
+    if (layout == SparseDoubleMatrix::CRS) entries[r].push_back(MakePair(c, value));
+    else                                   entries[c].push_back(MakePair(r, value));
+  }
+  SparseDoubleMatrix A(layout);
+  A.Initialize(m, n, entries);
+  delete[] entries;
+  return A;
+}
+
+// -----------------------------------------------------------------------------
+/// Graph Laplacian of path graph, i.e., symmetric positive semi-definite
+/// tridiagonal matrix with eigenvalues 2 - 2 cos(pi i / n), i = 0, ..., n-1
+SparseDoubleMatrix PathGraphLaplacian(int n, SparseDoubleMatrix::StorageLayout layout)
+{
+  SparseDoubleMatrix::Entries *entries = new SparseDoubleMatrix::Entries[n];
+  for (int r = 0; r < n; ++r) {
+    if (r > 0) entries[r].push_back(MakePair(r - 1, -1.0));
+    entries[r].push_back(MakePair(r, (r == 0 || r == n - 1) ? 1.0 : 2.0));
+    if (r < n - 1) entries[r].push_back(MakePair(r + 1, -1.0));
+  }
+  SparseDoubleMatrix L(SparseDoubleMatrix::CRS);
+  L.Initialize(n, n, entries);
+  L.Layout(layout);
+  delete[] entries;
+  return L;
+}
+
+// -----------------------------------------------------------------------------
+/// Graph Laplacian of 4-connected nx x ny grid graph, whose eigenvalues are the
+/// sums of the eigenvalues of the Laplacians of the path graphs along x and y
+SparseDoubleMatrix GridGraphLaplacian(int nx, int ny)
+{
+  const int n = nx * ny;
+  SparseDoubleMatrix::Entries *entries = new SparseDoubleMatrix::Entries[n];
+  for (int j = 0; j < ny; ++j)
+  for (int i = 0; i < nx; ++i) {
+    const int r = i + j * nx;
+    int degree = 0;
+    if (j > 0)      entries[r].push_back(MakePair(r - nx, -1.0)), ++degree;
+    if (i > 0)      entries[r].push_back(MakePair(r -  1, -1.0)), ++degree;
+    if (i < nx - 1) entries[r].push_back(MakePair(r +  1, -1.0)), ++degree;
+    if (j < ny - 1) entries[r].push_back(MakePair(r + nx, -1.0)), ++degree;
+    entries[r].push_back(MakePair(r, static_cast<double>(degree)));
+  }
+  SparseDoubleMatrix L(SparseDoubleMatrix::CRS);
+  L.Initialize(n, n, entries);
+  delete[] entries;
+  return L;
+}
+
+// -----------------------------------------------------------------------------
+/// Check that columns of E are unit length eigenvectors of A with eigenvalues v
+void ExpectEigenvectors(const SparseDoubleMatrix &A, const Matrix &E, const Vector &v)
+{
+  const int n = A.Rows();
+  double *x = new double[n];
+  double *y = new double[n];
+  for (int c = 0; c < E.Cols(); ++c) {
+    double norm = .0, res = .0;
+    for (int r = 0; r < n; ++r) x[r] = E(r, c), norm += x[r] * x[r];
+    A.MultAv(x, y);
+    for (int r = 0; r < n; ++r) res += pow(y[r] - v(c) * x[r], 2);
+    EXPECT_NEAR(1.0, sqrt(norm), 1e-8);
+    EXPECT_NEAR(0.0, sqrt(res),  1e-6);
+  }
+  delete[] x;
+  delete[] y;
+}
+
+// =============================================================================
+// Matrix-vector product
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+TEST(SparseMatrix, MultAv)
+{
+  const int m = 1500, n = 1100;
+  SparseDoubleMatrix crs = NonSymmetricTestMatrix(m, n, SparseDoubleMatrix::CRS);
+  SparseDoubleMatrix ccs = NonSymmetricTestMatrix(m, n, SparseDoubleMatrix::CCS);
+  double *v  = new double[n];
+  double *w1 = new double[m];
+  double *w2 = new double[m];
+  for (int c = 0; c < n; ++c) v[c] = cos(.2 * c);
+  crs.MultAv(v, w1);
+  ccs.MultAv(v, w2);
+  for (int r = 0; r < m; ++r) {
+    double w = .0;
+    for (int c = 0; c < n; ++c) w += NonSymmetricTestEntry(r, c) * v[c];
+    EXPECT_NEAR(w, w1[r], 1e-9);
+    EXPECT_NEAR(w, w2[r], 1e-9);
+  }
+  delete[] v;
+  delete[] w1;
+  delete[] w2;
+}
+
+// =============================================================================
+// Eigen decomposition
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+TEST(SparseMatrix, SmallestEigenvalues)
+{
+  const int n = 60, k = 5;
+  for (int layout = 0; layout < 2; ++layout) {
+    SparseDoubleMatrix L = PathGraphLaplacian(n, SparseDoubleMatrix::StorageLayout(layout));
+    Matrix E;
+    Vector v;
+    ASSERT_EQ(k, L.Eigenvectors(E, v, k, "sm"));
+    for (int i = 0; i < k; ++i) {
+      EXPECT_NEAR(2.0 - 2.0 * cos(M_PI * i / n), v(i), 1e-8);
+    }
+    ExpectEigenvectors(L, E, v);
+  }
+}
+
+// -----------------------------------------------------------------------------
+TEST(SparseMatrix, SmallestEigenvaluesConvergence)
+{
+  // Smallest eigenvalues of a larger Laplacian are clustered near zero and
+  // must be found within few restarts using shift-and-invert
+  const int nx = 40, ny = 30, k = 6, maxit = 5;
+  SparseDoubleMatrix L = GridGraphLaplacian(nx, ny);
+  Array<double> d;
+  for (int j = 0; j < ny; ++j)
+  for (int i = 0; i < nx; ++i) {
+    d.push_back(4.0 - 2.0 * cos(M_PI * i / nx) - 2.0 * cos(M_PI * j / ny));
+  }
+  sort(d.begin(), d.end());
+  Matrix E;
+  Vector v;
+  ASSERT_EQ(k, L.Eigenvectors(E, v, k, "sm", 0, .0, maxit));
+  for (int i = 0; i < k; ++i) {
+    EXPECT_NEAR(d[i], v(i), 1e-8);
+  }
+  ExpectEigenvectors(L, E, v);
+}
+
+// -----------------------------------------------------------------------------
+TEST(SparseMatrix, LargestEigenvalues)
+{
+  const int n = 60, k = 3;
+  SparseDoubleMatrix L = PathGraphLaplacian(n, SparseDoubleMatrix::CRS);
+  Matrix E;
+  Vector v;
+  ASSERT_EQ(k, L.Eigenvectors(E, v, k, "LA"));
+  for (int i = 0; i < k; ++i) {
+    EXPECT_NEAR(2.0 - 2.0 * cos(M_PI * (n - 1 - i) / n), v(i), 1e-8);
+  }
+  ExpectEigenvectors(L, E, v);
+}
+
+// -----------------------------------------------------------------------------
+TEST(SparseMatrix, EigenvaluesClosestToSigma)
+{
+  const int n = 30, k = 2;
+  SparseDoubleMatrix L = PathGraphLaplacian(n, SparseDoubleMatrix::CCS);
+  Matrix E;
+  Vector v;
+  ASSERT_EQ(k, L.Eigenvectors(E, v, k, "1.05"));
+  Array<double> d(n);
+  for (int i = 0; i < n; ++i) d[i] = 2.0 - 2.0 * cos(M_PI * i / n);
+  for (int i = 0; i < k; ++i) {
+    int closest = 0;
+    for (int j = 1; j < n; ++j) {
+      if (abs(d[j] - 1.05) < abs(d[closest] - 1.05)) closest = j;
+    }
+    EXPECT_NEAR(d[closest], v(i), 1e-8);
+    d[closest] = numeric_limits<double>::infinity();
+  }
+  ExpectEigenvectors(L, E, v);
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
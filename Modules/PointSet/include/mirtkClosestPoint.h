@@ -62,6 +62,12 @@ protected:
   /// Distance of closest source points from target samples
   mirtkAttributeMacro(Array<double>, SourceDistance);
 
+  /// Point locator of target points, refit after each update of the target
+  PointLocator *_TargetLocator;
+
+  /// Point locator of source points, refit after each update of the source
+  PointLocator *_SourceLocator;
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 public:
@@ -32,13 +32,12 @@
 #include <vtkDataArray.h>
 
 
-// Forward declaration of implementation using VTK point locator
-class vtkOctreePointLocator;
-
-
 namespace mirtk {
 
 
+// Forward declaration of native k-d tree implementation
+class KdTreePointLocator;
+
 // Forward declaration of implementation using FLANN (if available)
 class FlannPointLocator;
 
@@ -51,12 +50,11 @@ class FlannPointLocator;
  * nearest neighbors within the n-dimensional feature space spanned by the
  * feature Arrays used to establish point correspondences.
  *
- * The implementation uses either VTK for point search in three dimensions or
- * FLANN for higher dimensional feature spaces if available. Alternatively,
- * an ITK Kd tree is used if the library is available. As last resort, a brute
- * force search without actual Kd tree search structure is performed.
- *
- * \todo Consider actual implementation of own thread-safe N-dimensional Kd tree?
+ * The implementation uses a native thread-safe k-d tree stored in flat arrays.
+ * For higher dimensional feature spaces, FLANN is used instead if available.
+ * After the points of the dataset moved, the search structure can be updated
+ * by refitting the bounding boxes of the k-d tree nodes, which is much cheaper
+ * than rebuilding the tree from scratch.
  */
 class PointLocator : public Object
 {
@@ -194,8 +192,8 @@ public:
   /// Dimension of feature Arrays/points
   mirtkReadOnlyAttributeMacro(int, PointDimension);
 
-  /// VTK point locator used for three-dimensional feature spaces
-  vtkSmartPointer<vtkOctreePointLocator> _VtkLocator;
+  /// Native k-d tree used unless FLANN is used for a higher-dimensional feature space
+  KdTreePointLocator *_KdTreeLocator;
 
   /// FLANN point locator used for higher-dimensional feature spaces when available
   FlannPointLocator *_FlannLocator;
@@ -232,9 +230,29 @@ public:
                            const Array<int>  *sample  = NULL,
                            const FeatureList *feature = NULL);
 
+  /// Update existing point locator or construct new one for search in given dataset
+  ///
+  /// \param[in,out] locator Point locator built for the same dataset and sample
+  ///                        is updated, otherwise it is replaced by a new one.
+  /// \param[in]     dataset Dataset in which points are searched.
+  /// \param[in]     sample  Indices of points in \p dataset to consider only or NULL for all.
+  /// \param[in]     feature Indices and weights of point data in \p dataset to use.
+  static void Update(PointLocator      *&locator,
+                     vtkPointSet       *dataset,
+                     const Array<int>  *sample  = NULL,
+                     const FeatureList *feature = NULL);
+
   /// Destructor
   virtual ~PointLocator();
 
+  /// Update search structure after the points or features of the dataset changed
+  ///
+  /// The native k-d tree is refit to the new feature vectors, i.e., only the
+  /// bounding boxes of its nodes are recomputed. The tree is rebuilt instead
+  /// when the number of points changed, or when the points moved so much that
+  /// the refit tree would no longer be efficient.
+  void Update();
+
   // ---------------------------------------------------------------------------
   // Closest point
 
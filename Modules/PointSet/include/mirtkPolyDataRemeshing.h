@@ -25,10 +25,10 @@
 #include <mirtkArray.h>
 #include <mirtkPoint.h>
 
+#include <vtkIdList.h>
 #include <vtkPriorityQueue.h>
 
 class vtkCellArray;
-class vtkIdList;
 class vtkPoints;
 
 
@@ -44,6 +44,11 @@ class Transformation;
  * Park et al., A non-self-intersecting adaptive deformable surface for
  * complex boundary extraction from volumetric images, 25, 421–440 (2001).
  *
+ * When the lengths of all (transformed) edges of the input mesh are within the
+ * desired range, the remeshing passes are skipped and the output is the input.
+ * Otherwise, only cells with edges outside this range are modified and the IDs
+ * of the affected output points are reported (cf. ChangedPoints).
+ *
  * \todo Interpolate cell data during remeshing. The current implementation only
  *       preserves and interpolates point data arrays. Cell attributes are discarded.
  */
@@ -183,6 +188,25 @@ protected:
   /// Number of quadsections
   mirtkReadOnlyAttributeMacro(int, NumberOfQuadsections);
 
+  /// IDs of output points which were inserted or moved by the remeshing,
+  /// or whose adjacent cells were modified. Empty if the output is the input.
+  mirtkReadOnlyAttributeMacro(vtkSmartPointer<vtkIdList>, ChangedPoints);
+
+  /// Transformed points of triangulated input mesh
+  ///
+  /// The transformation is evaluated only once for each input point instead
+  /// of each time a point is visited by one of the remeshing passes. Points
+  /// which are inserted or moved by the remeshing are transformed on demand.
+  Array<Point> _TransformedPoints;
+
+  /// Marks of output points modified by the remeshing
+  ///
+  /// A value of 1 denotes that the cells adjacent to the point were modified,
+  /// and a value of 2 that the point was inserted or moved. This output point
+  /// data array is passed on by the clean-up filters executed by Finalize,
+  /// which renumber the points, and removed afterwards (cf. ChangedPoints).
+  vtkSmartPointer<vtkDataArray> _PointMarks;
+
   /// Copy attributes of this class from another instance
   void CopyAttributes(const PolyDataRemeshing &);
 
@@ -211,6 +235,12 @@ protected:
   /// Get (transformed) surface point
   void GetPoint(vtkIdType, double [3]) const;
 
+  /// Mark output point as modified (cf. _PointMarks)
+  void MarkPoint(vtkIdType, int);
+
+  /// Mark points of output cell as modified (cf. _PointMarks)
+  void MarkCellPoints(vtkIdType, int);
+
   /// Get (transformed) surface point normal
   void GetNormal(vtkIdType, double [3]) const;
 
@@ -313,6 +343,17 @@ protected:
   /// Initialize edge length range for each node
   void InitializeEdgeLengthRange();
 
+  /// Transform points of triangulated input mesh (cf. _TransformedPoints)
+  void InitializeTransformedPoints();
+
+  /// Whether any (transformed) edge of the triangulated input mesh has a
+  /// length outside the desired edge length range
+  ///
+  /// This check uses the precomputed edge table of the input mesh when set
+  /// (cf. PolyDataFilter::EdgeTable), such that a table which is kept alive
+  /// by the caller between successive executions of this filter is reused.
+  bool HasEdgesOutsideRange();
+
   /// Perform local remeshing passes
   virtual void Execute();
 
@@ -53,6 +53,12 @@ protected:
   /// for outlier rejection during (iterative) closest point matching
   mirtkPublicAttributeMacro(double, Sigma);
 
+  /// Point locator of target points, refit after each update of the target
+  PointLocator *_TargetLocator;
+
+  /// Point locator of source points, refit after each update of the source
+  PointLocator *_SourceLocator;
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 public:
@@ -54,6 +54,8 @@ extern const double EPSILON;
 // =============================================================================
 
 /// Find optimal assignment given cost matrix using the Hungarian method
+///
+/// \sa MinimumCostAssignment
 Array<int> WeightedMatching(const Matrix &cost);
 
 // =============================================================================
@@ -21,6 +21,7 @@
 
 #include <mirtkMath.h>
 #include <mirtkArray.h>
+#include <mirtkMemory.h>
 
 
 namespace mirtk {
@@ -35,7 +36,9 @@ ClosestPoint::ClosestPoint()
 :
   _Sigma(-1.0),
   _MaxDistance(numeric_limits<double>::infinity()),
-  _MaxSquaredDistance(numeric_limits<double>::infinity())
+  _MaxSquaredDistance(numeric_limits<double>::infinity()),
+  _TargetLocator(NULL),
+  _SourceLocator(NULL)
 {
 }
 
@@ -47,7 +50,9 @@ ClosestPoint::ClosestPoint(const ClosestPoint &other)
   _MaxDistance(other._MaxDistance),
   _MaxSquaredDistance(other._MaxSquaredDistance),
   _TargetIndex(other._TargetIndex),
-  _SourceIndex(other._SourceIndex)
+  _SourceIndex(other._SourceIndex),
+  _TargetLocator(NULL),
+  _SourceLocator(NULL)
 {
 }
 
@@ -60,6 +65,8 @@ PointCorrespondence *ClosestPoint::NewInstance() const
 // -----------------------------------------------------------------------------
 ClosestPoint::~ClosestPoint()
 {
+  Delete(_TargetLocator);
+  Delete(_SourceLocator);
 }
 
 // -----------------------------------------------------------------------------
@@ -124,18 +131,16 @@ void ClosestPoint::Update()
 
   // Find closest points
   if (_FromTargetToSource) {
-    PointLocator *locator = PointLocator::New(_Source->PointSet(), _SourceSample, &_SourceFeatures);
-    _SourceIndex = locator->FindClosestPoint(_Target->PointSet(), _TargetSample, &_TargetFeatures, &_SourceDistance);
-    delete locator;
+    PointLocator::Update(_SourceLocator, _Source->PointSet(), _SourceSample, &_SourceFeatures);
+    _SourceIndex = _SourceLocator->FindClosestPoint(_Target->PointSet(), _TargetSample, &_TargetFeatures, &_SourceDistance);
   } else {
     _SourceIndex   .clear();
     _SourceDistance.clear();
   }
 
   if (_FromSourceToTarget) {
-    PointLocator *locator = PointLocator::New(_Target->PointSet(), _TargetSample, &_TargetFeatures);
-    _TargetIndex = locator->FindClosestPoint(_Source->PointSet(), _SourceSample, &_SourceFeatures, &_TargetDistance);
-    delete locator;
+    PointLocator::Update(_TargetLocator, _Target->PointSet(), _TargetSample, &_TargetFeatures);
+    _TargetIndex = _TargetLocator->FindClosestPoint(_Source->PointSet(), _SourceSample, &_SourceFeatures, &_TargetDistance);
   } else {
     _TargetIndex   .clear();
     _TargetDistance.clear();
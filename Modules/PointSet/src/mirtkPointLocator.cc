@@ -21,18 +21,14 @@
 
 #include <mirtkAssert.h>
 #include <mirtkArray.h>
-#include <mirtkArrayHeap.h>
+#include <mirtkAlgorithm.h>
 #include <mirtkPair.h>
 #include <mirtkAllocate.h>
 #include <mirtkDeallocate.h>
 #include <mirtkParallel.h>
 
 #include <vtkSmartPointer.h>
-#include <vtkPoints.h>
 #include <vtkPointSet.h>
-#include <vtkPolyData.h>
-#include <vtkIdList.h>
-#include <vtkOctreePointLocator.h>
 
 
 #ifdef HAVE_FLANN
@@ -343,6 +339,460 @@ Array<Array<int> > FlannPointLocator
 }
 
 #endif // HAVE_FLANN
+////////////////////////////////////////////////////////////////////////////////
+// class: KdTreePointLocator
+////////////////////////////////////////////////////////////////////////////////
+
+namespace PointLocatorUtils {
+
+// -----------------------------------------------------------------------------
+/// Compare points by their coordinate along the given dimension
+struct ComparePointCoordinates
+{
+  const double *_Points;
+  int           _Dimension;
+  int           _Axis;
+
+  bool operator ()(int a, int b) const
+  {
+    return _Points[a * _Dimension + _Axis] < _Points[b * _Dimension + _Axis];
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Copy feature vectors of points into contiguous array in tree order
+struct CopyFeatureVectors
+{
+  vtkPointSet                     *_DataSet;
+  const Array<int>                *_Sample;
+  const PointLocator::FeatureList *_Features;
+  const int                       *_Index;
+  double                          *_Points;
+  int                              _Dimension;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      PointLocator::GetPoint(_Points + i * _Dimension, _DataSet, _Sample, _Index[i], _Features);
+    }
+  }
+};
+
+} // namespace PointLocatorUtils
+
+/**
+ * Native thread-safe k-d tree for N-dimensional feature vectors
+ *
+ * The tree is stored in flat arrays. The feature vectors are stored
+ * contiguously in tree order such that the points of each leaf are scanned
+ * sequentially. Instead of splitting planes, the search uses the bounding
+ * boxes of the nodes for pruning. The tree can therefore be refit to moved
+ * points by recomputing only these boxes while the search remains exact.
+ */
+class KdTreePointLocator
+{
+public:
+
+  /// List of point features to use for nearest neighbor search
+  typedef PointLocator::FeatureList FeatureList;
+
+  /// Maximum number of points in a leaf node
+  static const int LeafSize = 8;
+
+  /// Maximum depth of the tree
+  static const int MaxDepth = 64;
+
+  /// Node of the tree, where the children of a node are stored consecutively
+  struct Node
+  {
+    int _Begin; ///< Index of first point of node in tree order
+    int _End;   ///< Index one past the last point of node
+    int _Child; ///< Index of first child node or -1 if node is a leaf
+  };
+
+protected:
+
+  /// Dataset for which search structure is build
+  mirtkPublicAggregateMacro(vtkPointSet, DataSet);
+
+  /// Indices of points to consider only or NULL
+  mirtkPublicAggregateMacro(const Array<int>, Sample);
+
+  /// Indices/names and rescaling parameters of point data arrays
+  mirtkPublicAttributeMacro(FeatureList, Features);
+
+  /// Dimension of feature Arrays/points
+  mirtkPublicAttributeMacro(int, PointDimension);
+
+  /// Number of points in search structure
+  int _NumberOfPoints;
+
+  /// Feature vectors of points in tree order
+  Array<double> _Points;
+
+  /// Index of point/sample corresponding to each point in tree order
+  Array<int> _Index;
+
+  /// Nodes of the tree, where the first node is the root
+  Array<Node> _Nodes;
+
+  /// Lower and upper bounds of each node, 2 * _PointDimension values per node
+  Array<double> _Bounds;
+
+  /// Sum of bounding box extents of all leaves after the tree was built
+  double _LeafExtent;
+
+public:
+
+  /// Constructor
+  KdTreePointLocator();
+
+  /// Destructor
+  virtual ~KdTreePointLocator();
+
+  /// Build tree for current feature vectors of points
+  void Initialize();
+
+  /// Refit bounding boxes of nodes to current feature vectors of points
+  ///
+  /// \returns Whether the search remains efficient with the refit tree.
+  bool Refit();
+
+  /// Find nearest neighbor
+  int FindClosestPoint(const double *, double *) const;
+
+  /// Find nearest neighbors
+  Array<int> FindClosestNPoints(int, const double *, Array<double> *) const;
+
+  /// Find points within radius
+  Array<int> FindPointsWithinRadius(double, const double *, Array<double> *) const;
+
+protected:
+
+  /// Copy feature vectors of points in tree order
+  void CopyPoints();
+
+  /// Compute bounds of node from its points or children, respectively
+  void ComputeBounds(int);
+
+  /// Split node and its children recursively
+  void Split(int, int);
+
+  /// Squared distance of point from bounding box of node
+  double BoxDistance2(int, const double *) const;
+
+  /// Squared distance of point from the i-th point in tree order
+  double PointDistance2(int, const double *) const;
+
+  /// Sum of bounding box extents of all leaves
+  double LeafExtent() const;
+};
+
+// =============================================================================
+// Construction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+KdTreePointLocator::KdTreePointLocator()
+:
+  _DataSet(NULL),
+  _Sample(NULL),
+  _PointDimension(0),
+  _NumberOfPoints(0),
+  _LeafExtent(.0)
+{
+}
+
+// -----------------------------------------------------------------------------
+KdTreePointLocator::~KdTreePointLocator()
+{
+}
+
+// -----------------------------------------------------------------------------
+void KdTreePointLocator::CopyPoints()
+{
+  PointLocatorUtils::CopyFeatureVectors copy;
+  copy._DataSet   = _DataSet;
+  copy._Sample    = _Sample;
+  copy._Features  = &_Features;
+  copy._Index     = _Index.data();
+  copy._Points    = _Points.data();
+  copy._Dimension = _PointDimension;
+  parallel_for(blocked_range<int>(0, _NumberOfPoints), copy);
+}
+
+// -----------------------------------------------------------------------------
+void KdTreePointLocator::ComputeBounds(int n)
+{
+  const int  d    = _PointDimension;
+  const Node &node = _Nodes[n];
+  double *lower = _Bounds.data() + 2 * d * n;
+  double *upper = lower + d;
+  if (node._Child == -1) {
+    for (int j = 0; j < d; ++j) {
+      lower[j] = + numeric_limits<double>::infinity();
+      upper[j] = - numeric_limits<double>::infinity();
+    }
+    const double *p = _Points.data() + node._Begin * d;
+    for (int i = node._Begin; i < node._End; ++i) {
+      for (int j = 0; j < d; ++j, ++p) {
+        if (*p < lower[j]) lower[j] = *p;
+        if (*p > upper[j]) upper[j] = *p;
+      }
+    }
+  } else {
+    const double *a = _Bounds.data() + 2 * d * node._Child;
+    const double *b = a + 2 * d;
+    for (int j = 0; j < 2 * d; ++j) {
+      lower[j] = (j < d ? min(a[j], b[j]) : max(a[j], b[j]));
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void KdTreePointLocator::Split(int n, int depth)
+{
+  const int d     = _PointDimension;
+  const int begin = _Nodes[n]._Begin;
+  const int end   = _Nodes[n]._End;
+  if (end - begin <= LeafSize || depth >= MaxDepth) return;
+  // Split at median along dimension of largest extent
+  int    axis   = 0;
+  double extent = -1.0;
+  for (int j = 0; j < d; ++j) {
+    double lower = + numeric_limits<double>::infinity();
+    double upper = - numeric_limits<double>::infinity();
+    for (int i = begin; i < end; ++i) {
+      const double x = _Points[_Index[i] * d + j];
+      if (x < lower) lower = x;
+      if (x > upper) upper = x;
+    }
+    if (upper - lower > extent) extent = upper - lower, axis = j;
+  }
+  PointLocatorUtils::ComparePointCoordinates comp;
+  comp._Points    = _Points.data();
+  comp._Dimension = d;
+  comp._Axis      = axis;
+  const int mid = begin + (end - begin) / 2;
+  nth_element(_Index.begin() + begin, _Index.begin() + mid, _Index.begin() + end, comp);
+  // Append children and split them recursively
+  const int child = static_cast<int>(_Nodes.size());
+  Node node;
+  node._Child = -1;
+  node._Begin = begin, node._End = mid, _Nodes.push_back(node);
+  node._Begin = mid,   node._End = end, _Nodes.push_back(node);
+  _Nodes[n]._Child = child;
+  Split(child,     depth + 1);
+  Split(child + 1, depth + 1);
+}
+
+// -----------------------------------------------------------------------------
+void KdTreePointLocator::Initialize()
+{
+  const int d = _PointDimension;
+  _NumberOfPoints = PointLocator::GetNumberOfPoints(_DataSet, _Sample);
+  // Get feature vectors in sample order
+  _Index.resize(_NumberOfPoints);
+  for (int i = 0; i < _NumberOfPoints; ++i) _Index[i] = i;
+  _Points.resize(_NumberOfPoints * d);
+  CopyPoints();
+  // Build tree topology by permuting the indices
+  Node root;
+  root._Begin = 0;
+  root._End   = _NumberOfPoints;
+  root._Child = -1;
+  _Nodes.clear();
+  _Nodes.reserve(2 * (_NumberOfPoints / LeafSize + 1));
+  _Nodes.push_back(root);
+  Split(0, 0);
+  // Reorder feature vectors such that the points of each leaf are contiguous
+  CopyPoints();
+  // Compute bounds bottom-up as children are stored after their parent
+  _Bounds.resize(2 * d * _Nodes.size());
+  for (int n = static_cast<int>(_Nodes.size()) - 1; n >= 0; --n) {
+    ComputeBounds(n);
+  }
+  _LeafExtent = LeafExtent();
+}
+
+// -----------------------------------------------------------------------------
+double KdTreePointLocator::LeafExtent() const
+{
+  const int d = _PointDimension;
+  double sum = .0;
+  for (size_t n = 0; n < _Nodes.size(); ++n) {
+    if (_Nodes[n]._Child != -1) continue;
+    const double *lower = _Bounds.data() + 2 * d * n;
+    const double *upper = lower + d;
+    for (int j = 0; j < d; ++j) sum += upper[j] - lower[j];
+  }
+  return sum;
+}
+
+// -----------------------------------------------------------------------------
+bool KdTreePointLocator::Refit()
+{
+  CopyPoints();
+  // Children are stored after their parent
+  for (int n = static_cast<int>(_Nodes.size()) - 1; n >= 0; --n) {
+    ComputeBounds(n);
+  }
+  // Rebuild tree when leaves overlap considerably due to the point movement
+  return LeafExtent() <= 2.0 * _LeafExtent;
+}
+
+// =============================================================================
+// Distances
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+inline double KdTreePointLocator::BoxDistance2(int n, const double *p) const
+{
+  const double *lower = _Bounds.data() + 2 * _PointDimension * n;
+  const double *upper = lower + _PointDimension;
+  double dist2 = .0, delta;
+  for (int j = 0; j < _PointDimension; ++j) {
+    if      (p[j] < lower[j]) delta = lower[j] - p[j];
+    else if (p[j] > upper[j]) delta = p[j] - upper[j];
+    else continue;
+    dist2 += delta * delta;
+  }
+  return dist2;
+}
+
+// -----------------------------------------------------------------------------
+inline double KdTreePointLocator::PointDistance2(int i, const double *p) const
+{
+  const double *q = _Points.data() + i * _PointDimension;
+  if (_PointDimension == 3) {
+    const double dx = q[0] - p[0], dy = q[1] - p[1], dz = q[2] - p[2];
+    return dx * dx + dy * dy + dz * dz;
+  }
+  return PointLocator::Distance2BetweenPoints(q, p, _PointDimension);
+}
+
+// =============================================================================
+// Search
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+int KdTreePointLocator::FindClosestPoint(const double *point, double *dist2) const
+{
+  Pair<int, double> stack[2 * MaxDepth + 2];
+  int    size  = 0;
+  int    index = -1;
+  double mind2 = numeric_limits<double>::infinity();
+  stack[size++] = MakePair(0, BoxDistance2(0, point));
+  while (size > 0) {
+    const Pair<int, double> top = stack[--size];
+    if (top.second >= mind2) continue;
+    const Node &node = _Nodes[top.first];
+    if (node._Child == -1) {
+      for (int i = node._Begin; i < node._End; ++i) {
+        const double d2 = PointDistance2(i, point);
+        if (d2 < mind2) mind2 = d2, index = i;
+      }
+    } else {
+      // Visit nearer child first
+      const double d1 = BoxDistance2(node._Child,     point);
+      const double d2 = BoxDistance2(node._Child + 1, point);
+      if (d1 <= d2) {
+        stack[size++] = MakePair(node._Child + 1, d2);
+        stack[size++] = MakePair(node._Child,     d1);
+      } else {
+        stack[size++] = MakePair(node._Child,     d1);
+        stack[size++] = MakePair(node._Child + 1, d2);
+      }
+    }
+  }
+  if (dist2) *dist2 = mind2;
+  return _Index[index];
+}
+
+// -----------------------------------------------------------------------------
+Array<int> KdTreePointLocator
+::FindClosestNPoints(int k, const double *point, Array<double> *dist2) const
+{
+  k = min(k, _NumberOfPoints);
+  // Max-heap of k nearest neighbors found so far
+  Array<Pair<double, int> > heap;
+  heap.reserve(k);
+  Pair<int, double> stack[2 * MaxDepth + 2];
+  int size = 0;
+  double maxd2 = numeric_limits<double>::infinity();
+  stack[size++] = MakePair(0, BoxDistance2(0, point));
+  while (size > 0) {
+    const Pair<int, double> top = stack[--size];
+    if (top.second >= maxd2) continue;
+    const Node &node = _Nodes[top.first];
+    if (node._Child == -1) {
+      for (int i = node._Begin; i < node._End; ++i) {
+        const double d2 = PointDistance2(i, point);
+        if (static_cast<int>(heap.size()) < k) {
+          heap.push_back(MakePair(d2, i));
+          push_heap(heap.begin(), heap.end());
+        } else if (d2 < heap.front().first) {
+          pop_heap(heap.begin(), heap.end());
+          heap.back() = MakePair(d2, i);
+          push_heap(heap.begin(), heap.end());
+        }
+        if (static_cast<int>(heap.size()) == k) maxd2 = heap.front().first;
+      }
+    } else {
+      const double d1 = BoxDistance2(node._Child,     point);
+      const double d2 = BoxDistance2(node._Child + 1, point);
+      if (d1 <= d2) {
+        stack[size++] = MakePair(node._Child + 1, d2);
+        stack[size++] = MakePair(node._Child,     d1);
+      } else {
+        stack[size++] = MakePair(node._Child,     d1);
+        stack[size++] = MakePair(node._Child + 1, d2);
+      }
+    }
+  }
+  sort_heap(heap.begin(), heap.end());
+  Array<int> indices(heap.size());
+  if (dist2) dist2->resize(heap.size());
+  for (size_t i = 0; i < heap.size(); ++i) {
+    indices[i] = _Index[heap[i].second];
+    if (dist2) (*dist2)[i] = heap[i].first;
+  }
+  return indices;
+}
+
+// -----------------------------------------------------------------------------
+Array<int> KdTreePointLocator
+::FindPointsWithinRadius(double radius, const double *point, Array<double> *dist2) const
+{
+  const double maxd2 = radius * radius;
+  Array<Pair<double, int> > found;
+  Pair<int, double> stack[2 * MaxDepth + 2];
+  int size = 0;
+  stack[size++] = MakePair(0, BoxDistance2(0, point));
+  while (size > 0) {
+    const Pair<int, double> top = stack[--size];
+    if (top.second > maxd2) continue;
+    const Node &node = _Nodes[top.first];
+    if (node._Child == -1) {
+      for (int i = node._Begin; i < node._End; ++i) {
+        const double d2 = PointDistance2(i, point);
+        if (d2 <= maxd2) found.push_back(MakePair(d2, i));
+      }
+    } else {
+      stack[size++] = MakePair(node._Child,     BoxDistance2(node._Child,     point));
+      stack[size++] = MakePair(node._Child + 1, BoxDistance2(node._Child + 1, point));
+    }
+  }
+  sort(found.begin(), found.end());
+  Array<int> indices(found.size());
+  if (dist2) dist2->resize(found.size());
+  for (size_t i = 0; i < found.size(); ++i) {
+    indices[i] = _Index[found[i].second];
+    if (dist2) (*dist2)[i] = found[i].first;
+  }
+  return indices;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // class: PointLocator
 ////////////////////////////////////////////////////////////////////////////////
@@ -358,6 +808,7 @@ PointLocator::PointLocator()
   _Sample(NULL),
   _NumberOfPoints(0),
   _PointDimension(0),
+  _KdTreeLocator(nullptr),
   _FlannLocator(nullptr)
 {
 }
@@ -365,6 +816,7 @@ PointLocator::PointLocator()
 // -----------------------------------------------------------------------------
 PointLocator::~PointLocator()
 {
+  delete _KdTreeLocator;
 #ifdef HAVE_FLANN
   delete _FlannLocator;
 #endif
@@ -374,7 +826,8 @@ PointLocator::~PointLocator()
 void PointLocator::Initialize()
 {
   // Destruct previous internal locator(s)
-  _VtkLocator = NULL;
+  delete _KdTreeLocator;
+  _KdTreeLocator = nullptr;
 #ifdef HAVE_FLANN
   delete _FlannLocator;
   _FlannLocator = nullptr;
@@ -394,34 +847,53 @@ void PointLocator::Initialize()
     cerr << "PointLocator: Point feature vector size is zero!" << endl;
     exit(1);
   }
-  // Build VTK locator for 3-D feature vectors
-  if (_PointDimension <= 3) {
-    // Dataset of 2/3-D sample feature points
-    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
-    points->SetNumberOfPoints(_NumberOfPoints);
-    double point[3] = {0};
-    for (int i = 0; i < _NumberOfPoints; ++i) {
-      GetPoint(point, _DataSet, _Sample, i, &_Features);
-      points->SetPoint(i, point);
-    }
-    vtkSmartPointer<vtkPolyData> dataset = vtkSmartPointer<vtkPolyData>::New();
-    dataset->SetPoints(points);
-    // Note: vtkOctreeLocator preferred over vtkKdTree because the
-    //       latter is not thread safe even after BuildLocator was called!
-    _VtkLocator = vtkSmartPointer<vtkOctreePointLocator>::New();
-    _VtkLocator->SetDataSet(dataset);
-    _VtkLocator->BuildLocator();
-  } else {
 #ifdef HAVE_FLANN
-    // Build FLANN tree for N-D feature vectors
+  // Build FLANN tree for N-D feature vectors
+  if (_PointDimension > 3) {
     _FlannLocator = new FlannPointLocator();
     _FlannLocator->DataSet(_DataSet);
     _FlannLocator->Sample(_Sample);
     _FlannLocator->Features(_Features);
     _FlannLocator->PointDimension(_PointDimension);
     _FlannLocator->Initialize();
+    return;
+  }
 #endif
+  // Build native k-d tree
+  _KdTreeLocator = new KdTreePointLocator();
+  _KdTreeLocator->DataSet(_DataSet);
+  _KdTreeLocator->Sample(_Sample);
+  _KdTreeLocator->Features(_Features);
+  _KdTreeLocator->PointDimension(_PointDimension);
+  _KdTreeLocator->Initialize();
+}
+
+// -----------------------------------------------------------------------------
+void PointLocator::Update(PointLocator      *&locator,
+                          vtkPointSet       *dataset,
+                          const Array<int>  *sample,
+                          const FeatureList *features)
+{
+  if (locator && locator->DataSet() == dataset && locator->Sample() == sample) {
+    if (features) locator->Features(*features);
+    else          locator->Features(FeatureList());
+    locator->Update();
+  } else {
+    delete locator;
+    locator = New(dataset, sample, features);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void PointLocator::Update()
+{
+  if (_KdTreeLocator &&
+      GetNumberOfPoints(_DataSet, _Sample)     == _NumberOfPoints &&
+      GetPointDimension(_DataSet, &_Features) == _PointDimension) {
+    _KdTreeLocator->Features(_Features);
+    if (_KdTreeLocator->Refit()) return;
   }
+  Initialize();
 }
 
 // -----------------------------------------------------------------------------
@@ -444,43 +916,12 @@ PointLocator *PointLocator::New(vtkPointSet       *dataset,
 // -----------------------------------------------------------------------------
 int PointLocator::FindClosestPoint(double *point, double *dist2)
 {
-  // ---------------------------------------------------------------------------
-  // Using VTK
-  if (_VtkLocator) {
-    vtkIdType j = _VtkLocator->FindClosestPoint(point);
-    if (dist2) {
-      double p[3] = {0};
-      _DataSet->GetPoint(j, p);
-      *dist2 = Distance2BetweenPoints(p, point);
-    }
-    return static_cast<int>(j);
-  }
-
-  // ---------------------------------------------------------------------------
-  // Using FLANN
 #ifdef HAVE_FLANN
   if (_FlannLocator) {
     return _FlannLocator->FindClosestPoint(point, dist2);
   }
 #endif
-
-  // ---------------------------------------------------------------------------
-  // Brute force
-  double *p = new double[_PointDimension];
-  int    idx, index = -1;
-  double d2, mind2 = numeric_limits<double>::infinity();
-  for (int i = 0; i < _NumberOfPoints; ++i) {
-    idx = GetPointIndex(_DataSet, _Sample, i);
-    GetPoint(p, _DataSet, idx, &_Features);
-    d2 = Distance2BetweenPoints(p, point, _PointDimension);
-    if (d2 < mind2) {
-      index = idx;
-      mind2 = d2;
-    }
-  }
-  delete[] p;
-  if (dist2) (*dist2) = mind2;
-  return index;
+  return _KdTreeLocator->FindClosestPoint(point, dist2);
 }
 
 // -----------------------------------------------------------------------------
@@ -496,14 +937,10 @@ struct FindClosestPoint
 
   void operator ()(const blocked_range<int> &idx) const
   {
-    if (_Dist2) {
-      for (int i = idx.begin(); i != idx.end(); ++i) {
-        (*_Index)[i] = _Locator->FindClosestPoint(_DataSet, _Sample, i, _Features, &((*_Dist2)[i]));
-      }
-    } else {
-      for (int i = idx.begin(); i != idx.end(); ++i) {
-        (*_Index)[i] = _Locator->FindClosestPoint(_DataSet, _Sample, i, _Features);
-      }
+    Array<double> point(_Locator->PointDimension());
+    for (int i = idx.begin(); i != idx.end(); ++i) {
+      PointLocator::GetPoint(point.data(), _DataSet, _Sample, i, _Features);
+      (*_Index)[i] = _Locator->FindClosestPoint(point.data(), _Dist2 ? &((*_Dist2)[i]) : NULL);
     }
   }
 };
@@ -515,7 +952,7 @@ Array<int> PointLocator
                    const FeatureList *features, Array<double> *dist2)
 {
 #ifdef HAVE_FLANN
-  if (!_VtkLocator && _FlannLocator) {
+  if (_FlannLocator) {
     return _FlannLocator->FindClosestPoint(dataset, sample, features, dist2);
   }
 #endif
@@ -540,60 +977,12 @@ Array<int> PointLocator
 // -----------------------------------------------------------------------------
 Array<int> PointLocator::FindClosestNPoints(int k, double *point, Array<double> *dist2)
 {
-  // ---------------------------------------------------------------------------
-  // Using VTK
-  if (_VtkLocator) {
-    double p[3];
-    vtkSmartPointer<vtkIdList> ids = vtkSmartPointer<vtkIdList>::New();
-    _VtkLocator->FindClosestNPoints(k, point, ids);
-    Array<int> indices(ids->GetNumberOfIds());
-    if (dist2) dist2->resize(ids->GetNumberOfIds());
-    for (vtkIdType i = 0; i < ids->GetNumberOfIds(); ++i) {
-      indices[i] = ids->GetId(i);
-      if (dist2) {
-        _VtkLocator->GetDataSet()->GetPoint(indices[i], p);
-        (*dist2)[i] = Distance2BetweenPoints(point, p);
-      }
-    }
-    return indices;
-  }
-
-  // ---------------------------------------------------------------------------
-  // Using FLANN
 #ifdef HAVE_FLANN
   if (_FlannLocator) {
     return _FlannLocator->FindClosestNPoints(k, point, dist2);
   }
 #endif
-
-  // ---------------------------------------------------------------------------
-  // Brute force
-  struct Comp
-  {
-    bool operator()(const Pair<double, int> &a, const Pair<double, int> &b)
-    {
-      return a.first > b.first;
-    }
-  } comp;
-
-  double *p = Allocate<double>(_PointDimension);
-  Array<Pair<double, int> > dists(_NumberOfPoints);
-  for (int i = 0; i < _NumberOfPoints; ++i) {
-    int idx = GetPointIndex(_DataSet, _Sample, i);
-    GetPoint(p, _DataSet, idx, &_Features);
-    dists[i] = MakePair(Distance2BetweenPoints(point, p, _PointDimension), idx);
-  }
-  make_heap(dists.begin(), dists.end(), comp);
-  Array<int> indices(k);
-  for (int i = 0; i < k; ++i) {
-    Pair<double, int> &min = dists.front();
-    if (dist2) (*dist2)[i] = min.first;
-    indices[i] = min.second;
-    pop_heap(dists.begin(), dists.end(), comp);
-    dists.pop_back();
-  }
-  Deallocate(p);
-  return indices;
+  return _KdTreeLocator->FindClosestNPoints(k, point, dist2);
 }
 
 // -----------------------------------------------------------------------------
@@ -610,14 +999,10 @@ struct FindClosestNPoints
 
   void operator ()(const blocked_range<int> &idx) const
   {
-    if (_Dist2) {
-      for (int i = idx.begin(); i != idx.end(); ++i) {
-        (*_Indices)[i] = _Locator->FindClosestNPoints(_K, _DataSet, _Sample, i, _Features, &((*_Dist2)[i]));
-      }
-    } else {
-      for (int i = idx.begin(); i != idx.end(); ++i) {
-        (*_Indices)[i] = _Locator->FindClosestNPoints(_K, _DataSet, _Sample, i, _Features);
-      }
+    Array<double> point(_Locator->PointDimension());
+    for (int i = idx.begin(); i != idx.end(); ++i) {
+      PointLocator::GetPoint(point.data(), _DataSet, _Sample, i, _Features);
+      (*_Indices)[i] = _Locator->FindClosestNPoints(_K, point.data(), _Dist2 ? &((*_Dist2)[i]) : NULL);
     }
   }
 };
@@ -637,7 +1022,7 @@ Array<Array<int> > PointLocator
   }
 
 #ifdef HAVE_FLANN
-  if (!_VtkLocator && _FlannLocator) {
+  if (_FlannLocator) {
     return _FlannLocator->FindClosestNPoints(k, dataset, sample, features, dist2);
   }
 #endif
@@ -664,64 +1049,12 @@ Array<Array<int> > PointLocator
 Array<int> PointLocator
 ::FindPointsWithinRadius(double radius, double *point, Array<double> *dist2)
 {
-  // ---------------------------------------------------------------------------
-  // Using VTK
-  if (_VtkLocator) {
-    double p[3] = {0};
-    vtkSmartPointer<vtkIdList> ids = vtkSmartPointer<vtkIdList>::New();
-    _VtkLocator->FindPointsWithinRadius(radius, point, ids);
-    Array<int> indices(ids->GetNumberOfIds());
-    if (dist2) dist2->resize(ids->GetNumberOfIds());
-    for (vtkIdType i = 0; i < ids->GetNumberOfIds(); ++i) {
-      indices[i] = ids->GetId(i);
-      if (dist2) {
-        _VtkLocator->GetDataSet()->GetPoint(indices[i], p);
-        (*dist2)[i] = Distance2BetweenPoints(point, p);
-      }
-    }
-    return indices;
-  }
-
-  // ---------------------------------------------------------------------------
-  // Using FLANN
 #ifdef HAVE_FLANN
   if (_FlannLocator) {
     return _FlannLocator->FindPointsWithinRadius(radius, point, dist2);
   }
 #endif
-
-  // ---------------------------------------------------------------------------
-  // Brute force
-  struct Comp
-  {
-    bool operator()(const Pair<double, int> &a, const Pair<double, int> &b)
-    {
-      return a.first > b.first;
-    }
-  } comp;
-
-  const double maxdist2 = radius * radius;
-  double *p = Allocate<double>(_PointDimension);
-  Array<Pair<double, int> > dists(_NumberOfPoints);
-  int idx, k = 0;
-  for (int i = 0; i < _NumberOfPoints; ++i) {
-    idx = GetPointIndex(_DataSet, _Sample, i);
-    GetPoint(p, _DataSet, idx, &_Features);
-    dists[i] = MakePair(Distance2BetweenPoints(point, p, _PointDimension), idx);
-    if (dists[i].first <= maxdist2) ++k;
-  }
-  make_heap(dists.begin(), dists.end(), comp);
-  Array<int> indices(k);
-  if (dist2) dist2->resize(k);
-  for (int i = 0; i < k; ++i) {
-    Pair<double, int> &min = dists.front();
-    if (dist2) (*dist2)[i] = min.first;
-    indices[i] = min.second;
-    pop_heap(dists.begin(), dists.end(), comp);
-    dists.pop_back();
-  }
-  Deallocate(p);
-  return indices;
+  return _KdTreeLocator->FindPointsWithinRadius(radius, point, dist2);
 }
 
 // -----------------------------------------------------------------------------
@@ -738,14 +1071,10 @@ struct FindPointsWithinRadius
 
   void operator ()(const blocked_range<int> &idx) const
   {
-    if (_Dist2) {
-      for (int i = idx.begin(); i != idx.end(); ++i) {
-        (*_Indices)[i] = _Locator->FindPointsWithinRadius(_Radius, _DataSet, _Sample, i, _Features, &((*_Dist2)[i]));
-      }
-    } else {
-      for (int i = idx.begin(); i != idx.end(); ++i) {
-        (*_Indices)[i] = _Locator->FindPointsWithinRadius(_Radius, _DataSet, _Sample, i, _Features);
-      }
+    Array<double> point(_Locator->PointDimension());
+    for (int i = idx.begin(); i != idx.end(); ++i) {
+      PointLocator::GetPoint(point.data(), _DataSet, _Sample, i, _Features);
+      (*_Indices)[i] = _Locator->FindPointsWithinRadius(_Radius, point.data(), _Dist2 ? &((*_Dist2)[i]) : NULL);
     }
   }
 };
@@ -762,7 +1091,7 @@ Array<Array<int> > PointLocator
               "Query points must have same dimension as feature points");
 
 #ifdef HAVE_FLANN
-  if (!_VtkLocator && _FlannLocator) {
+  if (_FlannLocator) {
     return _FlannLocator->FindPointsWithinRadius(radius, dataset, sample, features, dist2);
   }
 #endif
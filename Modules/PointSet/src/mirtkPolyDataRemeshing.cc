@@ -22,6 +22,7 @@
 #include <mirtkVtk.h>
 #include <mirtkAssert.h>
 #include <mirtkMath.h>
+#include <mirtkParallel.h>
 #include <mirtkProfiling.h>
 #include <mirtkEdgeTable.h>
 #include <mirtkPolyDataSmoothing.h>
@@ -41,12 +42,44 @@
 #include <vtkMergePoints.h>
 #include <vtkPriorityQueue.h>
 #include <vtkFloatArray.h>
+#include <vtkUnsignedCharArray.h>
 #include <vtkCellDataToPointData.h>
 
 
 namespace mirtk {
 
 
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace PolyDataRemeshingUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Transform points of input surface mesh
+struct TransformPoints
+{
+  vtkPoints                  *_Points;
+  const class Transformation *_Transformation;
+  Point                      *_Output;
+
+  void operator ()(const blocked_range<vtkIdType> &ptIds) const
+  {
+    double p[3];
+    for (vtkIdType ptId = ptIds.begin(); ptId != ptIds.end(); ++ptId) {
+      _Points->GetPoint(ptId, p);
+      if (_Transformation) _Transformation->Transform(p[0], p[1], p[2]);
+      _Output[ptId] = p;
+    }
+  }
+};
+
+
+} // namespace PolyDataRemeshingUtils
+
+using namespace PolyDataRemeshingUtils;
+
 // =============================================================================
 // Construction/Destruction
 // =============================================================================
@@ -74,6 +107,10 @@ void PolyDataRemeshing::CopyAttributes(const PolyDataRemeshing &other)
   _NumberOfBisections      = other._NumberOfBisections;
   _NumberOfTrisections     = other._NumberOfTrisections;
   _NumberOfQuadsections    = other._NumberOfQuadsections;
+  _ChangedPoints           = vtkSmartPointer<vtkIdList>::New();
+  _ChangedPoints->DeepCopy(other._ChangedPoints);
+  _TransformedPoints.clear();
+  _PointMarks              = NULL;
 
   // Get output point labels from _Output (copied by PolyDataFilter::Copy)
   if (_Output) {
@@ -108,7 +145,8 @@ PolyDataRemeshing::PolyDataRemeshing()
   _NumberOfInversions(0),
   _NumberOfBisections(0),
   _NumberOfTrisections(0),
-  _NumberOfQuadsections(0)
+  _NumberOfQuadsections(0),
+  _ChangedPoints(vtkSmartPointer<vtkIdList>::New())
 {
 }
 
@@ -142,8 +180,32 @@ PolyDataRemeshing::~PolyDataRemeshing()
 // -----------------------------------------------------------------------------
 inline void PolyDataRemeshing::GetPoint(vtkIdType ptId, double p[3]) const
 {
-  _Output->GetPoint(ptId, p);
-  if (_Transformation) _Transformation->Transform(p[0], p[1], p[2]);
+  if (ptId < static_cast<vtkIdType>(_TransformedPoints.size()) &&
+      (!_PointMarks || _PointMarks->GetComponent(ptId, 0) < 2.0)) {
+    const Point &q = _TransformedPoints[ptId];
+    p[0] = q._x, p[1] = q._y, p[2] = q._z;
+  } else {
+    _Output->GetPoint(ptId, p);
+    if (_Transformation) _Transformation->Transform(p[0], p[1], p[2]);
+  }
+}
+
+// -----------------------------------------------------------------------------
+inline void PolyDataRemeshing::MarkPoint(vtkIdType ptId, int mark)
+{
+  if (_PointMarks && _PointMarks->GetComponent(ptId, 0) < mark) {
+    _PointMarks->SetComponent(ptId, 0, mark);
+  }
+}
+
+// -----------------------------------------------------------------------------
+inline void PolyDataRemeshing::MarkCellPoints(vtkIdType cellId, int mark)
+{
+  if (_PointMarks) {
+    vtkIdType npts, *pts;
+    _Output->GetCellPoints(cellId, npts, pts);
+    for (vtkIdType i = 0; i < npts; ++i) MarkPoint(pts[i], mark);
+  }
 }
 
 // -----------------------------------------------------------------------------
@@ -197,6 +259,7 @@ inline int PolyDataRemeshing::NodeConnectivity(vtkIdType ptId) const
 // -----------------------------------------------------------------------------
 inline void PolyDataRemeshing::DeleteCell(vtkIdType cellId)
 {
+  MarkCellPoints(cellId, 1);
   _Output->RemoveCellReference(cellId); // before marking it as deleted!
   _Output->DeleteCell(cellId);
 }
@@ -218,6 +281,8 @@ inline void PolyDataRemeshing::ReplaceCellPoint(vtkIdType cellId, vtkIdType oldP
   _Output->RemoveReferenceToCell(oldPtId, cellId); // NOT THREAD SAFE!
   _Output->ResizeCellList(newPtId, 1);
   _Output->AddReferenceToCell(newPtId, cellId);
+  MarkPoint(oldPtId, 1);
+  MarkCellPoints(cellId, 1);
   // Note: Not necessary as we manipulated the pts array directly!
   //_Output->ReplaceCell(cellId, npts, pts);
 }
@@ -404,6 +469,7 @@ inline void PolyDataRemeshing
   } else {
     pd->InterpolateEdge(pd, newId, ptId1, ptId2, .5);
   }
+  if (_PointMarks) _PointMarks->InsertComponent(newId, 0, 2.0);
 }
 
 // -----------------------------------------------------------------------------
@@ -419,6 +485,7 @@ inline void PolyDataRemeshing
   } else {
     pd->InterpolatePoint(pd, newId, ptIds, weights);
   }
+  if (_PointMarks) _PointMarks->InsertComponent(newId, 0, 2.0);
 }
 
 // -----------------------------------------------------------------------------
@@ -711,6 +778,9 @@ void PolyDataRemeshing
   vtkIdType       pts[3];
 
   InterpolatePointData(midPtId, ptId1, ptId2);
+  MarkPoint(ptId1, 1);
+  MarkPoint(ptId2, 1);
+  MarkPoint(ptId3, 1);
 
   pts[0] = ptId1;
   pts[1] = midPtId;
@@ -738,6 +808,9 @@ void PolyDataRemeshing
 
   InterpolatePointData(midPtId1, ptId1, ptId2);
   InterpolatePointData(midPtId2, ptId2, ptId3);
+  MarkPoint(ptId1, 1);
+  MarkPoint(ptId2, 1);
+  MarkPoint(ptId3, 1);
 
   pts[0] = ptId1;
   pts[1] = midPtId1;
@@ -773,6 +846,9 @@ void PolyDataRemeshing
   InterpolatePointData(midPtId1, ptId1, ptId2);
   InterpolatePointData(midPtId2, ptId2, ptId3);
   InterpolatePointData(midPtId3, ptId3, ptId1);
+  MarkPoint(ptId1, 1);
+  MarkPoint(ptId2, 1);
+  MarkPoint(ptId3, 1);
 
   pts[0] = ptId1;
   pts[1] = midPtId1;
@@ -854,6 +930,27 @@ void PolyDataRemeshing::Initialize()
   _MaxEdgeLengthSquared = _MaxEdgeLength * _MaxEdgeLength;
   this->InitializeEdgeLengthRange();
 
+  // Reset counters
+  _NumberOfMeltedNodes  = 0;
+  _NumberOfMeltedEdges  = 0;
+  _NumberOfMeltedCells  = 0;
+  _NumberOfInversions   = 0;
+  _NumberOfBisections   = 0;
+  _NumberOfTrisections  = 0;
+  _NumberOfQuadsections = 0;
+  _ChangedPoints->Reset();
+  _PointMarks = NULL;
+
+  // Transform input points only once
+  this->InitializeTransformedPoints();
+
+  // Skip remeshing passes when all edges are within the desired range,
+  // e.g., when the surface deformed only little since it was last remeshed
+  if (!this->HasEdgesOutsideRange()) {
+    _Output = _Input;
+    return;
+  }
+
   // Initialize output
   _Output = vtkSmartPointer<vtkPolyData>::New();
   _Output->DeepCopy(_TriangulatedInput);
@@ -871,16 +968,61 @@ void PolyDataRemeshing::Initialize()
   _OutputPointLabels = GetArrayByCaseInsensitiveName(_Output->GetPointData(), "labels", &idx);
   if (_OutputPointLabels) _Output->GetPointData()->SetCopyAttribute(idx, 2);
 
+  // Add marks of modified points, which are removed again by Finalize
+  _PointMarks = vtkSmartPointer<vtkUnsignedCharArray>::New();
+  _PointMarks->SetName("RemeshingPointMarks");
+  _PointMarks->SetNumberOfComponents(1);
+  _PointMarks->SetNumberOfTuples(_Output->GetNumberOfPoints());
+  _PointMarks->FillComponent(0, .0);
+  outputPD->AddArray(_PointMarks);
+
   // Build links
   _Output->BuildLinks();
+}
 
-  // Reset counters
-  _NumberOfMeltedEdges  = 0;
-  _NumberOfMeltedCells  = 0;
-  _NumberOfInversions   = 0;
-  _NumberOfBisections   = 0;
-  _NumberOfTrisections  = 0;
-  _NumberOfQuadsections = 0;
+// -----------------------------------------------------------------------------
+void PolyDataRemeshing::InitializeTransformedPoints()
+{
+  MIRTK_START_TIMING();
+  const vtkIdType npoints = _TriangulatedInput->GetNumberOfPoints();
+  _TransformedPoints.resize(npoints);
+  TransformPoints transform;
+  transform._Points         = _TriangulatedInput->GetPoints();
+  transform._Transformation = _Transformation;
+  transform._Output         = (npoints > 0 ? &_TransformedPoints[0] : NULL);
+  parallel_for(blocked_range<vtkIdType>(0, npoints), transform);
+  MIRTK_DEBUG_TIMING(2, "transforming input points");
+}
+
+// -----------------------------------------------------------------------------
+bool PolyDataRemeshing::HasEdgesOutsideRange()
+{
+  // Edges may be subdivided based on the normals of their end points
+  if (_MaxFeatureAngle < 180.0) return true;
+
+  // Precomputed edge table of input mesh cannot be used when the
+  // triangulation of the input mesh inserted additional edges
+  class EdgeTable           edgeTable;
+  const class EdgeTable    *edges = _EdgeTable;
+  if (edges == NULL || !IsTriangularMesh(_Input)) {
+    edgeTable.Initialize(_TriangulatedInput);
+    edges = &edgeTable;
+  }
+
+  double    p1[3], p2[3], length2;
+  vtkIdType ptId1, ptId2;
+
+  mirtk::EdgeIterator it(*edges);
+  for (it.InitTraversal(); it.GetNextEdge(ptId1, ptId2) != -1;) {
+    GetPoint(ptId1, p1);
+    GetPoint(ptId2, p2);
+    length2 = vtkMath::Distance2BetweenPoints(p1, p2);
+    if (length2 < SquaredMinEdgeLength(ptId1, ptId2) ||
+        length2 > SquaredMaxEdgeLength(ptId1, ptId2)) {
+      return true;
+    }
+  }
+  return false;
 }
 
 // -----------------------------------------------------------------------------
@@ -975,6 +1117,9 @@ void PolyDataRemeshing::InitializeEdgeLengthRange()
 // -----------------------------------------------------------------------------
 void PolyDataRemeshing::Execute()
 {
+  // Nothing to do when all edges are within range (cf. Initialize)
+  if (_Output == _Input) return;
+
   // Melting pass
   Melting();
 
@@ -1210,7 +1355,8 @@ void PolyDataRemeshing::Finalize()
   if (_NumberOfMeltedNodes + _NumberOfMeltedEdges + _NumberOfMeltedCells +
       _NumberOfInversions  +
       _NumberOfBisections  + _NumberOfTrisections +_NumberOfQuadsections == 0) {
-    _Output = _Input;
+    _Output     = _Input;
+    _PointMarks = NULL;
     return;
   }
 
@@ -1257,6 +1403,17 @@ void PolyDataRemeshing::Finalize()
   normals->NonManifoldTraversalOn();
   normals->Update();
   _Output = normals->GetOutput();
+
+  // Get IDs of modified output points and remove their marks
+  vtkPointData * const outputPD = _Output->GetPointData();
+  vtkDataArray * const marks    = outputPD->GetArray("RemeshingPointMarks");
+  if (marks) {
+    for (vtkIdType ptId = 0; ptId < marks->GetNumberOfTuples(); ++ptId) {
+      if (marks->GetComponent(ptId, 0) != .0) _ChangedPoints->InsertNextId(ptId);
+    }
+    outputPD->RemoveArray("RemeshingPointMarks");
+  }
+  _PointMarks = NULL;
 }
 
 
@@ -22,6 +22,7 @@
 #include <mirtkMath.h>
 #include <mirtkArray.h>
 #include <mirtkPair.h>
+#include <mirtkMemory.h>
 #include <mirtkRegisteredPointSet.h>
 #include <mirtkPointLocator.h>
 #include <mirtkSparseMatrix.h>
@@ -38,7 +39,9 @@ namespace mirtk {
 // -----------------------------------------------------------------------------
 RobustClosestPoint::RobustClosestPoint()
 :
-  _Sigma(3.0)
+  _Sigma(3.0),
+  _TargetLocator(NULL),
+  _SourceLocator(NULL)
 {
 }
 
@@ -46,7 +49,9 @@ RobustClosestPoint::RobustClosestPoint()
 RobustClosestPoint::RobustClosestPoint(const RegisteredPointSet *target,
                                        const RegisteredPointSet *source)
 :
-  _Sigma(3.0)
+  _Sigma(3.0),
+  _TargetLocator(NULL),
+  _SourceLocator(NULL)
 {
   Target(target);
   Source(source);
@@ -57,7 +62,9 @@ RobustClosestPoint::RobustClosestPoint(const RegisteredPointSet *target,
 RobustClosestPoint::RobustClosestPoint(const RobustClosestPoint &other)
 :
   FuzzyCorrespondence(other),
-  _Sigma(other._Sigma)
+  _Sigma(other._Sigma),
+  _TargetLocator(NULL),
+  _SourceLocator(NULL)
 {
 }
 
@@ -70,6 +77,8 @@ PointCorrespondence *RobustClosestPoint::NewInstance() const
 // -----------------------------------------------------------------------------
 RobustClosestPoint::~RobustClosestPoint()
 {
+  Delete(_TargetLocator);
+  Delete(_SourceLocator);
 }
 
 // -----------------------------------------------------------------------------
@@ -116,15 +125,11 @@ void RobustClosestPoint::CalculateWeights()
   Array<int   > corr12, corr21;
   Array<double> dist12, dist21;
 
-  PointLocator *source_locator;
-  source_locator = PointLocator::New(_Source->PointSet(), _SourceSample, &_SourceFeatures);
-  corr12 = source_locator->FindClosestPoint(_Target->PointSet(), _TargetSample, &_TargetFeatures, &dist12);
-  delete source_locator;
+  PointLocator::Update(_SourceLocator, _Source->PointSet(), _SourceSample, &_SourceFeatures);
+  corr12 = _SourceLocator->FindClosestPoint(_Target->PointSet(), _TargetSample, &_TargetFeatures, &dist12);
 
-  PointLocator *target_locator;
-  target_locator = PointLocator::New(_Target->PointSet(), _TargetSample, &_TargetFeatures);
-  corr21 = target_locator->FindClosestPoint(_Source->PointSet(), _SourceSample, &_SourceFeatures, &dist21);
-  delete target_locator;
+  PointLocator::Update(_TargetLocator, _Target->PointSet(), _TargetSample, &_TargetFeatures);
+  corr21 = _TargetLocator->FindClosestPoint(_Source->PointSet(), _SourceSample, &_SourceFeatures, &dist21);
 
   // Allocate lists for non-zero weight entries
   const int nentries = (_Weight.Layout() == WeightMatrix::CRS ? _M : _N);
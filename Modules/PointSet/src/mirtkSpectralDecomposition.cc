@@ -28,6 +28,7 @@
 #include <mirtkProfiling.h>
 #include <mirtkMatrix.h>
 #include <mirtkSparseMatrix.h>
+#include <mirtkAssignment.h>
 #include <mirtkVector.h>
 #include <mirtkPointSet.h>
 #include <mirtkEdgeTable.h>
@@ -300,7 +301,6 @@ public:
 };
 
 // -----------------------------------------------------------------------------
-// FIXME: Implement hungarian algorithm in C++
 Array<int> WeightedMatching(const Matrix &cost)
 {
   Array<int> match(cost.Rows(), -1); // Maps row index to matching column index
@@ -326,8 +326,7 @@ Array<int> WeightedMatching(const Matrix &cost)
   }
   for (int i = 0; i < nlhs; ++i) mxDestroyArray(lhs[i]);
 #else
-  cerr << "No C/C++ hungarian implementation selected during build configuration" << endl;
-  exit(1);
+  match = MinimumCostAssignment(cost);
 #endif
   MIRTK_DEBUG_TIMING(10, "bipartite matching");
   return match;
@@ -0,0 +1,244 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mirtkMath.h>
+#include <mirtkPair.h>
+#include <mirtkAlgorithm.h>
+#include <mirtkPointLocator.h>
+
+#include <vtkSmartPointer.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkPointData.h>
+#include <vtkDoubleArray.h>
+
+using namespace mirtk;
+
+
+// ===========================================================================
+// Helper
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Deterministic pseudo-random number generator with values in [0, 1)
+class UniformNumbers
+{
+  unsigned int _State;
+
+public:
+
+  UniformNumbers(unsigned int seed = 42u) : _State(seed) {}
+
+  double operator ()()
+  {
+    _State = 1664525u * _State + 1013904223u;
+    return static_cast<double>(_State >> 8) / static_cast<double>(1u << 24);
+  }
+};
+
+// ---------------------------------------------------------------------------
+/// Point set of n random points in [0, 10]^3 with a 3-component point data
+/// array named "feature" of random values in [0, 1)
+vtkSmartPointer<vtkPolyData> MakePointSet(int n, UniformNumbers &rand)
+{
+  vtkSmartPointer<vtkPoints>      points  = vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkDoubleArray> feature = vtkSmartPointer<vtkDoubleArray>::New();
+  points->SetNumberOfPoints(n);
+  feature->SetName("feature");
+  feature->SetNumberOfComponents(3);
+  feature->SetNumberOfTuples(n);
+  for (int i = 0; i < n; ++i) {
+    points->SetPoint(i, 10.0 * rand(), 10.0 * rand(), 10.0 * rand());
+    for (int j = 0; j < 3; ++j) feature->SetComponent(i, j, rand());
+  }
+  vtkSmartPointer<vtkPolyData> pointset = vtkSmartPointer<vtkPolyData>::New();
+  pointset->SetPoints(points);
+  pointset->GetPointData()->AddArray(feature);
+  return pointset;
+}
+
+// ---------------------------------------------------------------------------
+/// Squared distances of query point to all (sample) points, closest first
+Array<Pair<double, int> >
+BruteForceSearch(const double *query, vtkPointSet *dataset, const Array<int> *sample,
+                 const PointLocator::FeatureList *features)
+{
+  const int n = PointLocator::GetNumberOfPoints(dataset, sample);
+  const int d = PointLocator::GetPointDimension(dataset, features);
+  Array<Pair<double, int> > dists(n);
+  Array<double> p(d);
+  for (int i = 0; i < n; ++i) {
+    PointLocator::GetPoint(p.data(), dataset, sample, i, features);
+    dists[i] = MakePair(PointLocator::Distance2BetweenPoints(p.data(), query, d), i);
+  }
+  sort(dists.begin(), dists.end());
+  return dists;
+}
+
+// ---------------------------------------------------------------------------
+/// Compare k-NN and radius queries of point locator to brute force search
+///
+/// Query points are random feature vectors within the bounding box of the
+/// (sample) points, such that both near and far points are found.
+void CompareToBruteForce(PointLocator *locator, vtkPointSet *dataset,
+                         const Array<int> *sample,
+                         const PointLocator::FeatureList *features,
+                         UniformNumbers &rand)
+{
+  const int    d      = locator->PointDimension();
+  const int    k      = 7;
+  const double radius = 1.5;
+  const double tol    = 1e-9;
+
+  const double inf = numeric_limits<double>::infinity();
+  Array<double> lower(d, inf), upper(d, -inf), p(d), query(d);
+  for (int i = 0; i < locator->NumberOfPoints(); ++i) {
+    PointLocator::GetPoint(p.data(), dataset, sample, i, features);
+    for (int j = 0; j < d; ++j) {
+      lower[j] = min(lower[j], p[j]);
+      upper[j] = max(upper[j], p[j]);
+    }
+  }
+
+  Array<int>    indices;
+  Array<double> dist2;
+  double        mind2;
+  for (int n = 0; n < 50; ++n) {
+    for (int j = 0; j < d; ++j) {
+      query[j] = lower[j] + rand() * (upper[j] - lower[j]);
+    }
+    const Array<Pair<double, int> > expected = BruteForceSearch(query.data(), dataset, sample, features);
+
+    // Closest point
+    EXPECT_EQ(expected[0].second, locator->FindClosestPoint(query.data(), &mind2));
+    EXPECT_NEAR(expected[0].first, mind2, tol);
+
+    // k nearest neighbors
+    indices = locator->FindClosestNPoints(k, query.data(), &dist2);
+    ASSERT_EQ(static_cast<size_t>(k), indices.size());
+    ASSERT_EQ(indices.size(), dist2.size());
+    for (int i = 0; i < k; ++i) {
+      EXPECT_EQ(expected[i].second, indices[i]);
+      EXPECT_NEAR(expected[i].first, dist2[i], tol);
+    }
+
+    // Points within radius
+    size_t m = 0;
+    while (m < expected.size() && expected[m].first <= radius * radius) ++m;
+    indices = locator->FindPointsWithinRadius(radius, query.data(), &dist2);
+    ASSERT_EQ(m, indices.size());
+    ASSERT_EQ(indices.size(), dist2.size());
+    for (size_t i = 0; i < m; ++i) {
+      EXPECT_EQ(expected[i].second, indices[i]);
+      EXPECT_NEAR(expected[i].first, dist2[i], tol);
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+/// Move points of dataset by random displacements of at most the given length
+void MovePoints(vtkPointSet *dataset, double length, UniformNumbers &rand)
+{
+  double p[3];
+  vtkPoints *points = dataset->GetPoints();
+  for (vtkIdType ptId = 0; ptId < points->GetNumberOfPoints(); ++ptId) {
+    points->GetPoint(ptId, p);
+    for (int j = 0; j < 3; ++j) p[j] += length * (2.0 * rand() - 1.0);
+    points->SetPoint(ptId, p);
+  }
+  points->Modified();
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(PointLocator, SpatialPoints)
+{
+  UniformNumbers rand;
+  vtkSmartPointer<vtkPolyData> pointset = MakePointSet(1000, rand);
+  unique_ptr<PointLocator> locator(PointLocator::New(pointset));
+  EXPECT_EQ(1000, locator->NumberOfPoints());
+  EXPECT_EQ(3, locator->PointDimension());
+  CompareToBruteForce(locator.get(), pointset, NULL, NULL, rand);
+}
+
+// ---------------------------------------------------------------------------
+TEST(PointLocator, SampleAndFeatures)
+{
+  UniformNumbers rand;
+  vtkSmartPointer<vtkPolyData> pointset = MakePointSet(1000, rand);
+
+  Array<int> sample;
+  for (int i = 0; i < 1000; i += 3) sample.push_back(i);
+
+  // Rescaled 3-component point data array, with dimension not exceeding
+  // three such that the native k-d tree is used also when FLANN is available
+  PointLocator::FeatureList features;
+  features.push_back(PointLocator::FeatureInfo("feature", 5.0, 2.0, -1.0));
+
+  unique_ptr<PointLocator> locator(PointLocator::New(pointset, &sample, &features));
+  EXPECT_EQ(static_cast<int>(sample.size()), locator->NumberOfPoints());
+  EXPECT_EQ(3, locator->PointDimension());
+  CompareToBruteForce(locator.get(), pointset, &sample, &features, rand);
+}
+
+// ---------------------------------------------------------------------------
+TEST(PointLocator, UpdateAfterMovingPoints)
+{
+  UniformNumbers rand;
+  vtkSmartPointer<vtkPolyData> pointset = MakePointSet(1000, rand);
+
+  Array<int> sample;
+  for (int i = 0; i < 1000; i += 2) sample.push_back(i);
+
+  PointLocator::FeatureList features;
+  features.push_back(PointLocator::FeatureInfo(-1, 1.0, .5, 2.0));
+
+  PointLocator *locator = PointLocator::New(pointset, &sample, &features);
+  CompareToBruteForce(locator, pointset, &sample, &features, rand);
+
+  // Small displacements such that the k-d tree is refit
+  MovePoints(pointset, .1, rand);
+  locator->Update();
+  CompareToBruteForce(locator, pointset, &sample, &features, rand);
+
+  // Large displacements such that the k-d tree is rebuilt
+  MovePoints(pointset, 20.0, rand);
+  PointLocator *previous = locator;
+  PointLocator::Update(locator, pointset, &sample, &features);
+  EXPECT_EQ(previous, locator);
+  CompareToBruteForce(locator, pointset, &sample, &features, rand);
+
+  delete locator;
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
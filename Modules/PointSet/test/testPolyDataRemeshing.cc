@@ -0,0 +1,143 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mirtkPolyDataRemeshing.h>
+
+#include <vtkSmartPointer.h>
+#include <vtkPoints.h>
+#include <vtkCellArray.h>
+#include <vtkPolyData.h>
+#include <vtkIdList.h>
+
+using namespace mirtk;
+
+
+// ===========================================================================
+// Helper
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Triangulated planar grid of n x n points with unit spacing, where the
+/// x coordinate of the points with grid index i >= i0 is shifted by dx
+vtkSmartPointer<vtkPolyData> MakeGrid(int n, int i0 = 0, double dx = .0)
+{
+  vtkSmartPointer<vtkPoints>    points = vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkCellArray> polys  = vtkSmartPointer<vtkCellArray>::New();
+  for (int j = 0; j < n; ++j)
+  for (int i = 0; i < n; ++i) {
+    points->InsertNextPoint(i < i0 ? i : i + dx, j, .0);
+  }
+  vtkIdType tri[3];
+  for (int j = 0; j < n - 1; ++j)
+  for (int i = 0; i < n - 1; ++i) {
+    const vtkIdType p = i + j * n;
+    tri[0] = p, tri[1] = p + 1, tri[2] = p + n + 1;
+    polys->InsertNextCell(3, tri);
+    tri[0] = p, tri[1] = p + n + 1, tri[2] = p + n;
+    polys->InsertNextCell(3, tri);
+  }
+  vtkSmartPointer<vtkPolyData> surface = vtkSmartPointer<vtkPolyData>::New();
+  surface->SetPoints(points);
+  surface->SetPolys(polys);
+  return surface;
+}
+
+// ---------------------------------------------------------------------------
+/// Remesh surface such that edge lengths are within [.5, 2]
+void Remesh(PolyDataRemeshing &remesher, vtkPolyData *surface)
+{
+  remesher.Input(surface);
+  remesher.MeltingOrder(PolyDataRemeshing::AREA);
+  remesher.MeltNodesOff();
+  remesher.MeltTrianglesOn();
+  remesher.MinEdgeLength(.5);
+  remesher.MaxEdgeLength(2.0);
+  remesher.Run();
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(PolyDataRemeshing, UnchangedSurface)
+{
+  vtkSmartPointer<vtkPolyData> surface = MakeGrid(12);
+  PolyDataRemeshing remesher;
+  Remesh(remesher, surface);
+  EXPECT_TRUE(remesher.Output() == remesher.Input());
+  EXPECT_EQ(0, remesher.ChangedPoints()->GetNumberOfIds());
+  EXPECT_EQ(0, remesher.NumberOfBisections()  + remesher.NumberOfTrisections() +
+               remesher.NumberOfQuadsections() + remesher.NumberOfMeltedEdges() +
+               remesher.NumberOfMeltedCells()  + remesher.NumberOfInversions());
+}
+
+// ---------------------------------------------------------------------------
+TEST(PolyDataRemeshing, ChangedPointsOfLocalStretch)
+{
+  // Stretch the edges between the grid columns 8 and 9 to a length of 4
+  const int    n  = 12;
+  const int    i0 = 9;
+  const double dx = 3.0;
+  vtkSmartPointer<vtkPolyData> surface = MakeGrid(n, i0, dx);
+  PolyDataRemeshing remesher;
+  Remesh(remesher, surface);
+  vtkPolyData * const output  = remesher.Output();
+  vtkIdList   * const changed = remesher.ChangedPoints();
+  ASSERT_TRUE(output != remesher.Input());
+  EXPECT_GT(output->GetNumberOfPoints(), surface->GetNumberOfPoints());
+  ASSERT_GT(changed->GetNumberOfIds(), 0);
+
+  // Only points of the stretched grid cells are modified or inserted
+  double p[3];
+  for (vtkIdType i = 0; i < changed->GetNumberOfIds(); ++i) {
+    const vtkIdType ptId = changed->GetId(i);
+    ASSERT_GE(ptId, 0);
+    ASSERT_LT(ptId, output->GetNumberOfPoints());
+    output->GetPoint(ptId, p);
+    EXPECT_GE(p[0], i0 - 1.0 - 1e-6);
+    EXPECT_LE(p[0], i0 + dx  + 1e-6);
+  }
+
+  // Output points outside the stretched cells are unchanged and all
+  // points inserted by the subdivision are reported as changed
+  Array<bool> is_changed(output->GetNumberOfPoints(), false);
+  for (vtkIdType i = 0; i < changed->GetNumberOfIds(); ++i) {
+    is_changed[changed->GetId(i)] = true;
+  }
+  for (vtkIdType ptId = 0; ptId < output->GetNumberOfPoints(); ++ptId) {
+    output->GetPoint(ptId, p);
+    if (i0 - 1.0 < p[0] && p[0] < i0 + dx) {
+      EXPECT_TRUE(is_changed[ptId]);
+    }
+  }
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -25,6 +25,7 @@
 #include <vtkSmartPointer.h>
 #include <vtkPointSet.h>
 #include <vtkPolyData.h>
+#include <vtkAbstractPointLocator.h>
 
 
 namespace mirtk {
@@ -37,12 +38,33 @@ namespace mirtk {
  * This implementation is based on the currents distance similarity
  * computations of the Deformetrica registration software package.
  *
+ * The sums of Gaussian kernels are by default evaluated directly, i.e., by
+ * summing over all centers within 2.5 sigma found by a point locator. For
+ * large data sets, they can instead be approximated on a regular lattice
+ * with spacing GridSpacing * sigma, or by the improved fast Gauss transform
+ * whose absolute error is bounded by FGTError times the sum of weight norms.
+ * When the lattice would be too large, e.g., because the grid spacing is
+ * small compared to the extent of the data, the fast Gauss transform is
+ * used instead.
+ *
  * \sa http://www.deformetrica.org/
  */
 class CurrentsDistance : public PointSetDistance
 {
   mirtkEnergyTermMacro(CurrentsDistance, EM_CurrentsDistance);
 
+  // ---------------------------------------------------------------------------
+  // Types
+public:
+
+  /// Enumeration of methods used to evaluate sums of Gaussian kernels
+  enum KernelSumMethod
+  {
+    KS_Direct, ///< Sum over centers within 2.5 sigma found by point locator
+    KS_Grid,   ///< Splat weights onto lattice, convolve, and interpolate
+    KS_FGT     ///< Improved fast Gauss transform with error bound
+  };
+
   // ---------------------------------------------------------------------------
   // Attributes
 
@@ -52,12 +74,27 @@ class CurrentsDistance : public PointSetDistance
   /// Current representation of source data set
   mirtkAttributeMacro(vtkSmartPointer<vtkPolyData>, SourceCurrent);
 
+  /// Point locator of target current used by KS_Direct kernel sums
+  mirtkAttributeMacro(vtkSmartPointer<vtkAbstractPointLocator>, TargetLocator);
+
+  /// Point locator of source current used by KS_Direct kernel sums
+  mirtkAttributeMacro(vtkSmartPointer<vtkAbstractPointLocator>, SourceLocator);
+
   /// Sigma value of currents kernel
   mirtkPublicAttributeMacro(double, Sigma);
 
   /// Whether to ensure symmetry of currents dot product
   mirtkPublicAttributeMacro(bool, Symmetric);
 
+  /// Method used to evaluate sums of Gaussian kernels
+  mirtkPublicAttributeMacro(enum KernelSumMethod, KernelSum);
+
+  /// Lattice spacing of KS_Grid method relative to sigma
+  mirtkPublicAttributeMacro(double, GridSpacing);
+
+  /// Bound of KS_FGT approximation error relative to sum of weight norms
+  mirtkPublicAttributeMacro(double, FGTError);
+
   /// Sum of squared norm of fixed (i.e., untransformed) data set(s)
   mirtkAttributeMacro(double, TargetNormSquared);
 
@@ -71,6 +108,17 @@ protected:
   /// Convert surface mesh to current
   static vtkSmartPointer<vtkPolyData> SurfaceToCurrent(vtkPolyData *);
 
+  /// Build point locators of target and source currents if required
+  void InitializeLocators();
+
+public:
+
+  /// Build point locator of current for KS_Direct evaluation of kernel sums
+  static vtkSmartPointer<vtkAbstractPointLocator> NewLocator(vtkPolyData *);
+
+  /// Get point locator of target or source current or NULL if none was built
+  vtkAbstractPointLocator *Locator(const vtkPolyData *) const;
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 public:
@@ -149,6 +197,35 @@ public:
 
 };
 
+// -----------------------------------------------------------------------------
+/// Convert kernel sum method enumeration value to string
+template <>
+inline string ToString(const enum CurrentsDistance::KernelSumMethod &m, int w, char c, bool left)
+{
+  const char *str;
+  switch (m) {
+    case CurrentsDistance::KS_Direct: str = "Direct"; break;
+    case CurrentsDistance::KS_Grid:   str = "Grid";   break;
+    case CurrentsDistance::KS_FGT:    str = "FGT";    break;
+    default:                          str = "Unknown"; break;
+  }
+  return ToString(str, w, c, left);
+}
+
+// -----------------------------------------------------------------------------
+/// Convert kernel sum method string to enumeration value
+template <>
+inline bool FromString(const char *str, enum CurrentsDistance::KernelSumMethod &value)
+{
+  const string lstr = ToLower(str);
+  if      (lstr == "direct") value = CurrentsDistance::KS_Direct;
+  else if (lstr == "grid")   value = CurrentsDistance::KS_Grid;
+  else if (lstr == "fgt")    value = CurrentsDistance::KS_FGT;
+  else if (lstr == "ifgt")   value = CurrentsDistance::KS_FGT;
+  else return false;
+  return true;
+}
+
 
 } // namespace mirtk
 
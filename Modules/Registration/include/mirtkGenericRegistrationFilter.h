@@ -30,6 +30,7 @@
 #include <mirtkBaseImage.h>
 #include <mirtkGenericImage.h>
 #include <mirtkRegisteredImage.h>
+#include <mirtkTransformedCoordinates.h>
 #include <mirtkInterpolationMode.h>
 #include <mirtkExtrapolationMode.h>
 
@@ -244,6 +245,10 @@ public:
   /// Whether to precompute image derivatives or compute them on the fly
   mirtkPublicAttributeMacro(bool, PrecomputeDerivatives);
 
+  /// Whether to store input image derivatives and displacement caches of
+  /// registered images in single precision
+  mirtkPublicAttributeMacro(bool, SinglePrecision);
+
   /// Default similarity measure
   mirtkPublicAttributeMacro(enum SimilarityMeasure, SimilarityMeasure);
 
@@ -360,6 +365,9 @@ protected:
   Array<DisplacementInfo>        _DisplacementInfo;
   Array<DisplacementImageType *> _DisplacementField;
 
+  /// Transformed voxel coordinates shared by registered images
+  Array<TransformedCoordinates *> _TransformedCoordinates;
+
   // ---------------------------------------------------------------------------
   // Access to managed data objects and their attributes
 
@@ -106,6 +106,16 @@ public:
   /// measure implements the NonParametricGradient function
   mirtkPublicAttributeMacro(bool, UseApproximateGradient);
 
+  /// Whether to approximate the gradient w.r.t. the control point parameters
+  /// of a free-form deformation for independent sets of control points.
+  /// Control points are grouped such that their support regions in the image
+  /// domain do not overlap (i.e., a coloring of the control point lattice).
+  /// The perturbed intensities of each control point are computed once and
+  /// exchanged within its support region, which saves one region update per
+  /// parameter. The evaluation is nevertheless serial (cf. ColoredApproximateGradient).
+  /// Disabled by default.
+  mirtkPublicAttributeMacro(bool, UseColoredApproximateGradient);
+
   /// Voxel-wise gradient preconditioning sigma used to supress noise.
   /// A non-positive value disables the voxel-wise preconditioning all together.
   ///
@@ -181,6 +191,10 @@ public:
   /// Update moving input image(s) and internal state of similarity measure
   virtual void Update(bool = true);
 
+  /// Whether the gradient is approximated using finite differences, which
+  /// perturbs the parameters of the transformation of the registered images
+  virtual bool ModifiesTransformation() const;
+
   /// Whether to evaluate similarity at specified voxel
   bool IsForeground(int) const;
 
@@ -247,6 +261,13 @@ protected:
   virtual bool NonParametricGradient(const RegisteredImage *image,
                                      GradientImageType     *gradient);
 
+  /// Whether NonParametricGradient computes the voxel-wise similarity gradient
+  ///
+  /// Must be overridden by subclasses which implement NonParametricGradient
+  /// such that it is known before the gradient evaluation whether it is
+  /// approximated using finite differences instead.
+  virtual bool HasNonParametricGradient() const;
+
   /// Normalize voxel-wise non-parametric similarity gradient
   ///
   /// Zikic, D., Baust, M., Kamen, A., & Navab, N. A General Preconditioning
@@ -291,6 +312,34 @@ protected:
                            double                  step,
                            double                  weight);
 
+  /// Approximate similarity gradient using finite differences
+  ///
+  /// Same as ApproximateGradient, but the control points of the free-form
+  /// deformation are partitioned into sets of independent control points
+  /// whose bounding boxes in the image domain do not overlap. The transformed
+  /// image is updated within the bounding box of each control point of a set
+  /// for the positive and negative perturbation of its parameter, and the
+  /// resulting intensities are saved. The similarity is then evaluated for each
+  /// control point of the set by exchanging only the intensities within its
+  /// bounding box using Exclude and Include.
+  ///
+  /// The cost remains serial in the number of active parameters: each one still
+  /// requires two region updates of the transformed image (instead of three),
+  /// two full Evaluate calls and six Exclude/Include calls, because the
+  /// similarity measures accumulate their statistics in shared state.
+  ///
+  /// \param[in]     image    Transformed image.
+  /// \param[in]     ffd      Free-form deformation.
+  /// \param[in,out] gradient Gradient to which the computed parametric gradient
+  ///                         is added, after multiplication by the given \p weight.
+  /// \param[in]     step     Step size to use for finite differences.
+  /// \param[in]     weight   Weight of image similarity.
+  void ColoredApproximateGradient(RegisteredImage        *image,
+                                  FreeFormTransformation *ffd,
+                                  double                 *gradient,
+                                  double                  step,
+                                  double                  weight);
+
   /// Approximate similarity gradient using finite differences
   ///
   /// If the image similarity does not provide an implementation of the
@@ -108,7 +108,7 @@ private:
   // Construction/Destruction
 
   /// Create 1D Gaussian kernel with given standard deviation
-  static RealImage *CreateGaussianKernel(double);
+  static KernelImage *CreateGaussianKernel(double);
 
   /// Reset local window kernel
   virtual void ClearKernel();
@@ -177,12 +177,19 @@ protected:
                                  const RegisteredImage *,
                                  RealImage *, RealImage *);
 
+  /// Compute dot products of local box window intensities using
+  /// summed-volume tables such that each local sum is obtained in O(1)
+  virtual void ComputeBoxWindowStatistics(const blocked_range3d<int> &);
+
   /// Evaluate similarity of images
   virtual double Evaluate();
 
   /// Evaluate non-parametric similarity gradient w.r.t the given image
   virtual bool NonParametricGradient(const RegisteredImage *, GradientImageType *);
 
+  /// Whether NonParametricGradient computes the similarity gradient
+  virtual bool HasNonParametricGradient() const;
+
   // ---------------------------------------------------------------------------
   // Debugging
 public:
@@ -60,6 +60,9 @@ protected:
   /// Evaluate non-parametric similarity gradient w.r.t the given image
   virtual bool NonParametricGradient(const RegisteredImage *, GradientImageType *);
 
+  /// Whether NonParametricGradient computes the similarity gradient
+  virtual bool HasNonParametricGradient() const;
+
   // ---------------------------------------------------------------------------
   // Debugging
 public:
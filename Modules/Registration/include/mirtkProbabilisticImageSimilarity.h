@@ -23,6 +23,7 @@
 #include <mirtkImageSimilarity.h>
 
 #include <mirtkHistogram2D.h>
+#include <mirtkBSpline.h>
 #include <mirtkParallel.h>
 
 
@@ -63,6 +64,15 @@ public:
   /// Number of histogram bins for source image intensities
   mirtkPublicAttributeMacro(int, NumberOfSourceBins);
 
+  /// Whether to add samples to the joint histogram using cubic B-spline
+  /// Parzen windows instead of nearest bins followed by smoothing
+  ///
+  /// Each sample is distributed over the 4x4 bins within the support of the
+  /// cubic B-spline centered at the sample intensities (Mattes et al., 2003).
+  /// The similarity gradient is then the exact derivative of the histogram
+  /// based similarity w.r.t. the transformed image intensities.
+  mirtkPublicAttributeMacro(bool, UseParzenWindow);
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 protected:
@@ -118,6 +128,35 @@ public:
   /// the transformed image is updated.
   virtual void Include(const blocked_range3d<int> &);
 
+  /// Get cubic B-spline Parzen window weights of intensity sample
+  ///
+  /// \param[in]  value Intensity value.
+  /// \param[in]  min   Lower limit of histogram intensity range.
+  /// \param[in]  width Width of histogram bins.
+  /// \param[in]  nbins Number of histogram bins.
+  /// \param[out] bin   Indices of histogram bins within support of Parzen window.
+  /// \param[out] w     Parzen window weights of histogram bins.
+  /// \param[out] dw    Derivatives of weights w.r.t. intensity value.
+  static void ParzenWindow(double value, double min, double width, int nbins,
+                           int bin[4], double w[4], double *dw = NULL);
+
+protected:
+
+  /// Evaluate voxel-wise similarity gradient w.r.t. transformed image intensities
+  ///
+  /// Given the derivatives of the similarity w.r.t. the joint histogram bins,
+  /// this function applies the chain rule using the derivatives of the cubic
+  /// B-spline Parzen windows w.r.t. the intensities of the given image.
+  ///
+  /// \param[in]  image    Transformed image.
+  /// \param[in]  dh       Derivatives of similarity w.r.t. joint histogram bins,
+  ///                      where bin (i, j) is at index j * NumberOfBinsX() + i.
+  /// \param[out] gradient Similarity gradient w.r.t. image intensities.
+  void ParzenWindowGradient(const RegisteredImage *image, const double *dh,
+                            GradientImageType *gradient) const;
+
+public:
+
   // ---------------------------------------------------------------------------
   // Debugging
 
@@ -129,6 +168,32 @@ public:
 
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+////////////////////////////////////////////////////////////////////////////////
+
+// -----------------------------------------------------------------------------
+inline void ProbabilisticImageSimilarity
+::ParzenWindow(double value, double min, double width, int nbins,
+               int bin[4], double w[4], double *dw)
+{
+  // Continuous bin coordinate, bin centers at integral values
+  const double umax = static_cast<double>(nbins - 1);
+  double u = (value - min) / width - .5;
+  bool clamped = false;
+  if      (u < .0)   u = .0,   clamped = true;
+  else if (u > umax) u = umax, clamped = true;
+  const int i = static_cast<int>(floor(u)) - 1;
+  for (int a = 0; a < 4; ++a) {
+    const double t = u - static_cast<double>(i + a);
+    bin[a] = i + a;
+    if      (bin[a] < 0)      bin[a] = 0;
+    else if (bin[a] >= nbins) bin[a] = nbins - 1;
+    w[a] = BSpline<double>::B(t);
+    if (dw) dw[a] = (clamped ? .0 : BSpline<double>::B_I(t) / width);
+  }
+}
+
 
 } // namespace mirtk
 
@@ -78,6 +78,17 @@ private:
   /// Scheme for Difference Measures in Deformable Registration. In ICCV 2011.
   mirtkPublicAttributeMacro(double, Preconditioning);
 
+  /// Whether to update and evaluate independent energy terms concurrently
+  ///
+  /// Each energy term parallelizes its computations internally, but terms with
+  /// little work such as point set distances or constraints do not keep all
+  /// cores busy. When enabled, the terms are executed as concurrent tasks and
+  /// each energy term gradient is summed into a private buffer before these
+  /// are added up. The terms are evaluated sequentially, however, when the
+  /// transformation requires caching of displacements, as the evaluation of
+  /// these transformations may modify auxiliary data members.
+  mirtkPublicAttributeMacro(bool, ParallelTerms);
+
   /// Forward events of energy terms to observers of the energy function
   EventDelegate _EventDelegate;
 
@@ -128,6 +139,12 @@ public:
   /// Get the n-th energy term
   EnergyTerm *Term(int);
 
+  /// Whether energy terms with non-zero weight are evaluated concurrently
+  ///
+  /// Terms are only evaluated concurrently when none of them modifies the
+  /// transformation during the gradient evaluation (cf. EnergyTerm::ModifiesTransformation).
+  bool ConcurrentTerms() const;
+
   // ---------------------------------------------------------------------------
   // Settings
 
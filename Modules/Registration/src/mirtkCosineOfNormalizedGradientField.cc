@@ -132,8 +132,8 @@ public:
     _z         (2 * _y)
   {}
 
-  template <class T>
-  void operator()(int i, int j, int k, int, const T *dF, const T *dM, T *g)
+  template <class T, class TGradient>
+  void operator()(int i, int j, int k, int, const T *dF, const T *dM, TGradient *g)
   {
     if (_Similarity->IsForeground(i, j, k)) {
       const int    power = _Similarity->Power();
@@ -249,6 +249,12 @@ bool CosineOfNormalizedGradientField
   return true;
 }
 
+// -----------------------------------------------------------------------------
+bool CosineOfNormalizedGradientField::HasNonParametricGradient() const
+{
+  return true;
+}
+
 // =============================================================================
 // Debugging
 // =============================================================================
@@ -19,6 +19,9 @@
 
 #include <mirtkCurrentsDistance.h>
 
+#include <mirtkMath.h>
+#include <mirtkArray.h>
+#include <mirtkPair.h>
 #include <mirtkMemory.h>
 #include <mirtkVector3D.h>
 #include <mirtkParallel.h>
@@ -57,6 +60,9 @@ CurrentsDistance::CurrentsDistance(const char *name, double weight)
   PointSetDistance(name, weight),
   _Sigma(-0.05),
   _Symmetric(true),
+  _KernelSum(KS_Direct),
+  _GridSpacing(.5),
+  _FGTError(1e-3),
   _TargetNormSquared(.0)
 {
 }
@@ -65,6 +71,11 @@ CurrentsDistance::CurrentsDistance(const char *name, double weight)
 CurrentsDistance::CurrentsDistance(const CurrentsDistance &other)
 :
   PointSetDistance(other),
+  _Sigma(other._Sigma),
+  _Symmetric(other._Symmetric),
+  _KernelSum(other._KernelSum),
+  _GridSpacing(other._GridSpacing),
+  _FGTError(other._FGTError),
   _TargetNormSquared(other._TargetNormSquared)
 {
   if (other._TargetCurrent) {
@@ -75,12 +86,18 @@ CurrentsDistance::CurrentsDistance(const CurrentsDistance &other)
     _SourceCurrent = vtkSmartPointer<vtkPolyData>::New();
     _SourceCurrent->DeepCopy(other._SourceCurrent);
   }
+  InitializeLocators();
 }
 
 // -----------------------------------------------------------------------------
 CurrentsDistance &CurrentsDistance::operator =(const CurrentsDistance &other)
 {
   PointSetDistance::operator =(other);
+  _Sigma             = other._Sigma;
+  _Symmetric         = other._Symmetric;
+  _KernelSum         = other._KernelSum;
+  _GridSpacing       = other._GridSpacing;
+  _FGTError          = other._FGTError;
   _TargetNormSquared = other._TargetNormSquared;
   if (other._TargetCurrent) {
     _TargetCurrent = vtkSmartPointer<vtkPolyData>::New();
@@ -94,6 +111,7 @@ CurrentsDistance &CurrentsDistance::operator =(const CurrentsDistance &other)
   } else {
     _SourceCurrent = NULL;
   }
+  InitializeLocators();
   return *this;
 }
 
@@ -164,6 +182,588 @@ vtkSmartPointer<vtkPolyData> CurrentsDistance::ToCurrent(vtkPointSet *data)
   return SurfaceToCurrent(surface);
 }
 
+// -----------------------------------------------------------------------------
+vtkSmartPointer<vtkAbstractPointLocator> CurrentsDistance::NewLocator(vtkPolyData *current)
+{
+  vtkSmartPointer<vtkAbstractPointLocator> locator;
+  locator = vtkSmartPointer<vtkOctreePointLocator>::New();
+  locator->SetDataSet(current);
+  locator->BuildLocator();
+  return locator;
+}
+
+// -----------------------------------------------------------------------------
+void CurrentsDistance::InitializeLocators()
+{
+  _TargetLocator = _SourceLocator = NULL;
+  if (_KernelSum == KS_Direct) {
+    if (_TargetCurrent) _TargetLocator = NewLocator(_TargetCurrent);
+    if (_SourceCurrent) _SourceLocator = NewLocator(_SourceCurrent);
+  }
+}
+
+// -----------------------------------------------------------------------------
+vtkAbstractPointLocator *CurrentsDistance::Locator(const vtkPolyData *current) const
+{
+  if (current == _TargetCurrent.GetPointer()) return _TargetLocator;
+  if (current == _SourceCurrent.GetPointer()) return _SourceLocator;
+  return NULL;
+}
+
+// =============================================================================
+// Gaussian kernel sums
+// =============================================================================
+
+namespace CurrentsDistanceUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Approximates the sum of Gaussian kernels weighted by vectors w_j and
+/// centered at points x_j, i.e., f(y) = sum_j exp(-|y - x_j|^2 / sigma^2) w_j,
+/// and its spatial derivatives at arbitrary query points y
+class GaussianKernelSum
+{
+protected:
+
+  double _Sigma;
+
+public:
+
+  GaussianKernelSum(double sigma) : _Sigma(sigma) {}
+
+  virtual ~GaussianKernelSum() {}
+
+  /// Precompute data structure for given centers and weights
+  ///
+  /// In case of point clouds, the weights are scalars which are treated as
+  /// first component of a weight vector whose other two components are zero.
+  virtual void Initialize(vtkPoints *x, vtkDataArray *w, bool gradient) = 0;
+
+  /// Evaluate kernel sum f and optionally its derivatives df[d][c] = d f_c / d y_d
+  virtual void Evaluate(const double y[3], double f[3], double df[3][3] = NULL) const = 0;
+};
+
+// -----------------------------------------------------------------------------
+/// Convolves the 3-vector valued lattice data along the lines of one dimension
+struct ConvolveLatticeLines
+{
+  const double *_Input;
+  double       *_Output;
+  const double *_Kernel;
+  int           _Radius;
+  const int    *_Size;
+  int           _Dim;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int    n      = _Size[_Dim];
+    const size_t nx     = static_cast<size_t>(_Size[0]);
+    const size_t nxy    = nx * static_cast<size_t>(_Size[1]);
+    const size_t stride = 3 * (_Dim == 0 ? 1 : (_Dim == 1 ? nx : nxy));
+    size_t offset;
+    double s[3], w;
+    const double *v;
+    for (int l = re.begin(); l != re.end(); ++l) {
+      switch (_Dim) {
+        case 0:  offset = static_cast<size_t>(l) * nx; break;
+        case 1:  offset = (l % _Size[0]) + (l / _Size[0]) * nxy; break;
+        default: offset = static_cast<size_t>(l); break;
+      }
+      const double *in  = _Input  + 3 * offset;
+      double       *out = _Output + 3 * offset;
+      for (int i = 0; i < n; ++i, out += stride) {
+        s[0] = s[1] = s[2] = .0;
+        const int k1 = min(_Radius, i);
+        for (int k = max(-_Radius, i - n + 1); k <= k1; ++k) {
+          w = _Kernel[k + _Radius];
+          v = in + (i - k) * stride;
+          s[0] += w * v[0], s[1] += w * v[1], s[2] += w * v[2];
+        }
+        out[0] = s[0], out[1] = s[1], out[2] = s[2];
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Splats the weights of the centers trilinearly onto the lattice
+///
+/// The centers are sorted by the slab k <= z < k + 1 of lattice planes which
+/// contains them. The centers of slab k only modify the nodes of the planes
+/// k and k + 1, such that slabs of the same parity can be splatted in parallel.
+struct SplatLatticeSlabs
+{
+  vtkPoints       *_Points;
+  vtkDataArray    *_Weights;
+  const vtkIdType *_Index;  ///< Indices of centers sorted by slab
+  const vtkIdType *_Offset; ///< Position of first center of each slab in _Index
+  const double    *_Origin;
+  double           _Spacing;
+  const int       *_Size;
+  double          *_Lattice;
+  int              _Parity;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const size_t nx = static_cast<size_t>(_Size[0]);
+    const size_t ny = static_cast<size_t>(_Size[1]);
+    double p[3], v[3] = {1.0, .0, .0}, u[3], wx, wy, wz;
+    int    i0[3];
+    for (int l = re.begin(); l != re.end(); ++l) {
+      const int k = 2 * l + _Parity;
+      for (vtkIdType n = _Offset[k]; n < _Offset[k + 1]; ++n) {
+        const vtkIdType j = _Index[n];
+        _Points ->GetPoint(j, p);
+        _Weights->GetTuple(j, v);
+        for (int d = 0; d < 3; ++d) {
+          u [d] = (p[d] - _Origin[d]) / _Spacing;
+          i0[d] = ifloor(u[d]);
+          u [d] -= i0[d];
+        }
+        for (int c = 0; c < 2; ++c) {
+          wz = (c == 0 ? 1.0 - u[2] : u[2]);
+          for (int b = 0; b < 2; ++b) {
+            wy = wz * (b == 0 ? 1.0 - u[1] : u[1]);
+            for (int a = 0; a < 2; ++a) {
+              wx = wy * (a == 0 ? 1.0 - u[0] : u[0]);
+              double *s = _Lattice + 3 * ((i0[0] + a) + nx * ((i0[1] + b) + ny * (i0[2] + c)));
+              s[0] += wx * v[0], s[1] += wx * v[1], s[2] += wx * v[2];
+            }
+          }
+        }
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Kernel sum evaluated by splatting the weights onto a regular lattice,
+/// separable convolution with a discrete Gaussian, and trilinear interpolation
+///
+/// The trilinear splatting and interpolation each correspond to a convolution
+/// with a tent function of variance h^2/6 along each axis. The width of the
+/// discrete Gaussian is reduced accordingly such that the variance and
+/// integral of the effective kernel match those of the continuous kernel.
+class GridGaussianKernelSum : public GaussianKernelSum
+{
+  double        _Spacing;
+  double        _Origin[3];
+  int           _Size[3];
+  Array<double> _Field[4]; ///< Kernel sum and its partial derivatives
+
+public:
+
+  /// Maximum number of lattice nodes, i.e., about 1.4 GB of memory for
+  /// the lattices of the kernel sum and its derivatives and temporaries
+  static double MaxNumberOfNodes() { return 8388608.0; }
+
+  GridGaussianKernelSum(double sigma, double spacing)
+  :
+    GaussianKernelSum(sigma), _Spacing(spacing * sigma)
+  {
+    // Discrete kernel variance sigma'^2 / 2 must remain positive
+    _Spacing = min(_Spacing, sigma);
+    _Size[0] = _Size[1] = _Size[2] = 0;
+  }
+
+  /// Radius of discrete kernel in number of lattice nodes
+  int Radius() const
+  {
+    return iceil(3.0 * _Sigma / _Spacing);
+  }
+
+  /// Number of nodes of lattice which covers the support of the kernel sum
+  double NumberOfNodes(vtkPoints *x) const
+  {
+    const int radius = Radius();
+    double bounds[6], n = 1.0;
+    x->GetBounds(bounds);
+    for (int d = 0; d < 3; ++d) {
+      n *= ceil((bounds[2*d+1] - bounds[2*d]) / _Spacing) + 2 * radius + 3;
+    }
+    return n;
+  }
+
+  void Convolve(const Array<double> &in, Array<double> &out,
+                const Array<double> &kernel, int dim) const
+  {
+    ConvolveLatticeLines conv;
+    conv._Input  = in.data();
+    conv._Output = out.data();
+    conv._Kernel = kernel.data();
+    conv._Radius = static_cast<int>(kernel.size() / 2);
+    conv._Size   = _Size;
+    conv._Dim    = dim;
+    const int nlines = _Size[0] * _Size[1] * _Size[2] / _Size[dim];
+    parallel_for(blocked_range<int>(0, nlines), conv);
+  }
+
+  void Initialize(vtkPoints *x, vtkDataArray *w, bool gradient)
+  {
+    const int    radius = Radius();
+    const double sigma2 = _Sigma * _Sigma - 2.0 * _Spacing * _Spacing / 3.0;
+    const double scale  = _Sigma / sqrt(sigma2);
+
+    // Discrete kernel and its derivative
+    Array<double> kernel(2 * radius + 1), derivative(2 * radius + 1);
+    for (int k = -radius; k <= radius; ++k) {
+      const double t = k * _Spacing;
+      kernel    [k + radius] = scale * exp(- t * t / sigma2);
+      derivative[k + radius] = -2.0 * t / sigma2 * kernel[k + radius];
+    }
+
+    // Lattice which covers the support of the kernel sum
+    double bounds[6];
+    x->GetBounds(bounds);
+    for (int d = 0; d < 3; ++d) {
+      _Origin[d] = bounds[2*d] - (radius + 1) * _Spacing;
+      _Size  [d] = iceil((bounds[2*d+1] - bounds[2*d]) / _Spacing) + 2 * radius + 3;
+    }
+    const size_t nvox = static_cast<size_t>(_Size[0]) * _Size[1] * _Size[2];
+
+    // Sort centers by the lattice slab containing them
+    const vtkIdType npoints = x->GetNumberOfPoints();
+    const int       nslabs  = _Size[2] - 1;
+    Array<int>       slab  (npoints);
+    Array<vtkIdType> offset(nslabs + 1, 0);
+    Array<vtkIdType> index (npoints);
+    double p[3];
+    for (vtkIdType j = 0; j < npoints; ++j) {
+      x->GetPoint(j, p);
+      slab[j] = ifloor((p[2] - _Origin[2]) / _Spacing);
+      ++offset[slab[j] + 1];
+    }
+    for (int k = 0; k < nslabs; ++k) offset[k + 1] += offset[k];
+    Array<vtkIdType> next(offset.begin(), offset.end() - 1);
+    for (vtkIdType j = 0; j < npoints; ++j) index[next[slab[j]]++] = j;
+
+    // Splat weights onto lattice, where the centers of every other slab
+    // modify disjoint lattice nodes and are thus processed concurrently
+    Array<double> splat(3 * nvox, .0);
+    SplatLatticeSlabs splat_slabs;
+    splat_slabs._Points  = x;
+    splat_slabs._Weights = w;
+    splat_slabs._Index   = index.data();
+    splat_slabs._Offset  = offset.data();
+    splat_slabs._Origin  = _Origin;
+    splat_slabs._Spacing = _Spacing;
+    splat_slabs._Size    = _Size;
+    splat_slabs._Lattice = splat.data();
+    for (int parity = 0; parity < 2; ++parity) {
+      splat_slabs._Parity = parity;
+      parallel_for(blocked_range<int>(0, (nslabs - parity + 1) / 2), splat_slabs);
+    }
+
+    // Separable convolution, where the derivative along dimension d
+    // replaces the kernel of this dimension by its derivative
+    Array<double> tmp1(3 * nvox), tmp2(3 * nvox);
+    for (int i = 0; i < 4; ++i) _Field[i].clear();
+    _Field[0].resize(3 * nvox);
+    Convolve(splat, tmp1, kernel, 2);
+    Convolve(tmp1,  tmp2, kernel, 1);
+    Convolve(tmp2,  _Field[0], kernel, 0);
+    if (gradient) {
+      for (int i = 1; i < 4; ++i) _Field[i].resize(3 * nvox);
+      Convolve(tmp2,  _Field[1], derivative, 0);
+      Convolve(tmp1,  tmp2, derivative, 1);
+      Convolve(tmp2,  _Field[2], kernel, 0);
+      Convolve(splat, tmp1, derivative, 2);
+      Convolve(tmp1,  tmp2, kernel, 1);
+      Convolve(tmp2,  _Field[3], kernel, 0);
+    }
+  }
+
+  void Evaluate(const double y[3], double f[3], double df[3][3] = NULL) const
+  {
+    f[0] = f[1] = f[2] = .0;
+    if (df) memset(df, 0, 9 * sizeof(double));
+    double u[3];
+    int    i0[3];
+    for (int d = 0; d < 3; ++d) {
+      u [d] = (y[d] - _Origin[d]) / _Spacing;
+      i0[d] = ifloor(u[d]);
+      // Kernel sum is zero outside the lattice
+      if (i0[d] < 0 || i0[d] >= _Size[d] - 1) return;
+      u [d] -= i0[d];
+    }
+    const int nfields = (df && !_Field[1].empty() ? 4 : 1);
+    double wx, wy, wz;
+    for (int c = 0; c < 2; ++c) {
+      wz = (c == 0 ? 1.0 - u[2] : u[2]);
+      for (int b = 0; b < 2; ++b) {
+        wy = wz * (b == 0 ? 1.0 - u[1] : u[1]);
+        for (int a = 0; a < 2; ++a) {
+          wx = wy * (a == 0 ? 1.0 - u[0] : u[0]);
+          const size_t idx = 3 * ((i0[0] + a) + static_cast<size_t>(_Size[0]) * ((i0[1] + b) + static_cast<size_t>(_Size[1]) * (i0[2] + c)));
+          const double *v = _Field[0].data() + idx;
+          f[0] += wx * v[0], f[1] += wx * v[1], f[2] += wx * v[2];
+          for (int i = 1; i < nfields; ++i) {
+            v = _Field[i].data() + idx;
+            df[i-1][0] += wx * v[0], df[i-1][1] += wx * v[1], df[i-1][2] += wx * v[2];
+          }
+        }
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Kernel sum evaluated by the improved fast Gauss transform
+///
+/// The centers are clustered by a uniform grid whose cells have a circumradius
+/// of r_x * sigma. The kernels of each cluster are replaced by a truncated
+/// Taylor expansion of order p about the cell center, and clusters whose
+/// centers are farther than r_y * sigma from a query point are ignored
+/// (cf. Yang et al., Improved fast Gauss transform and efficient kernel
+/// density estimation, ICCV 2003, and Raykar et al., Fast computation of
+/// sums of Gaussians in high dimensions, UMIACS-TR-2005-69). The parameters
+/// are chosen to minimize the evaluation cost subject to the error bound
+///   (2^p / p!) (r_x r_y)^p <= eps / 2  and  exp(-(r_y - r_x)^2) <= eps / 2,
+/// which limits the absolute error of each kernel sum to eps times the sum
+/// of the weight norms.
+class FastGaussTransform : public GaussianKernelSum
+{
+  static const int MaxOrder     = 16;
+  static const int MaxMonomials = 816; ///< Number of monomials of degree < MaxOrder
+
+  double        _Error;
+  int           _Order;
+  int           _NumberOfTerms;
+  double        _CellSize;
+  double        _Cutoff;
+  double        _Origin[3];
+  int           _Size[3];
+  Array<int>    _Cluster;      ///< Index of cluster coefficients of each cell
+  Array<double> _Coefficients; ///< Expansion coefficients of each cluster
+  Array<int>    _Exponent[3];  ///< Exponents of the monomials
+  Array<int>    _Parent;       ///< Monomial divided by _Variable
+  Array<int>    _Variable;     ///< Last variable of monomial
+  Array<int>    _Lower[3];     ///< Monomial divided by the respective variable
+
+public:
+
+  FastGaussTransform(double sigma, double eps)
+  :
+    GaussianKernelSum(sigma), _Error(eps),
+    _Order(0), _NumberOfTerms(0), _CellSize(.0), _Cutoff(.0)
+  {
+    _Size[0] = _Size[1] = _Size[2] = 0;
+  }
+
+  /// Choose cluster radius, cutoff radius, and truncation order
+  void ChooseParameters()
+  {
+    const double cutoff = sqrt(log(2.0 / _Error));
+    double min_cost = numeric_limits<double>::infinity();
+    for (double rx = 1.0; rx > .1; rx *= .75) {
+      const double ry = rx + cutoff;
+      double bound = 1.0;
+      int    p     = 0;
+      while (bound > .5 * _Error && p < MaxOrder) {
+        ++p, bound *= 2.0 * rx * ry / p;
+      }
+      if (bound > .5 * _Error) continue;
+      // Number of terms times number of clusters near a surface point
+      const double cost = (p * (p + 1) * (p + 2) / 6) * pow((ry + rx) / rx, 2);
+      if (cost < min_cost) {
+        min_cost      = cost;
+        _Order        = p;
+        _CellSize     = 2.0 * rx / sqrt(3.0);
+        _Cutoff       = ry;
+      }
+    }
+    if (_Order == 0) {
+      cerr << "CurrentsDistance: FGT error bound " << _Error << " too small" << endl;
+      exit(1);
+    }
+    _NumberOfTerms = _Order * (_Order + 1) * (_Order + 2) / 6;
+  }
+
+  /// Enumerate monomials of degree less than the truncation order
+  void InitializeMonomials()
+  {
+    for (int m = 0; m < 3; ++m) {
+      _Exponent[m].assign(1, 0);
+      _Lower   [m].assign(1, -1);
+    }
+    _Parent  .assign(1, -1);
+    _Variable.assign(1, 0);
+    // Index of monomial given its exponents
+    const int n = _Order;
+    Array<int> index(n * n * n, -1);
+    index[0] = 0;
+    for (int begin = 0, end = 1; end < _NumberOfTerms; ) {
+      for (int i = begin; i < end; ++i)
+      for (int m = _Variable[i]; m < 3; ++m) {
+        int e[3] = {_Exponent[0][i], _Exponent[1][i], _Exponent[2][i]};
+        ++e[m];
+        index[e[0] + n * (e[1] + n * e[2])] = static_cast<int>(_Parent.size());
+        for (int k = 0; k < 3; ++k) _Exponent[k].push_back(e[k]);
+        _Parent  .push_back(i);
+        _Variable.push_back(m);
+      }
+      begin = end, end = static_cast<int>(_Parent.size());
+    }
+    for (int k = 0; k < 3; ++k) _Lower[k].resize(_NumberOfTerms);
+    for (int i = 1; i < _NumberOfTerms; ++i) {
+      for (int k = 0; k < 3; ++k) {
+        int e[3] = {_Exponent[0][i], _Exponent[1][i], _Exponent[2][i]};
+        if (e[k] > 0) {
+          --e[k];
+          _Lower[k][i] = index[e[0] + n * (e[1] + n * e[2])];
+        } else {
+          _Lower[k][i] = -1;
+        }
+      }
+    }
+  }
+
+  /// Evaluate monomials d^alpha for all terms
+  void EvaluateMonomials(const double d[3], double *mono) const
+  {
+    mono[0] = 1.0;
+    for (int i = 1; i < _NumberOfTerms; ++i) {
+      mono[i] = mono[_Parent[i]] * d[_Variable[i]];
+    }
+  }
+
+  void Initialize(vtkPoints *x, vtkDataArray *w, bool)
+  {
+    ChooseParameters();
+    InitializeMonomials();
+
+    // Cluster centers by uniform grid
+    const double h = _CellSize * _Sigma;
+    double bounds[6];
+    x->GetBounds(bounds);
+    for (int d = 0; d < 3; ++d) {
+      _Origin[d] = bounds[2*d];
+      _Size  [d] = ifloor((bounds[2*d+1] - bounds[2*d]) / h) + 1;
+    }
+    const vtkIdType npoints = x->GetNumberOfPoints();
+    Array<int> cell(npoints);
+    _Cluster.assign(_Size[0] * _Size[1] * _Size[2], -1);
+    int nclusters = 0;
+    double p[3];
+    for (vtkIdType j = 0; j < npoints; ++j) {
+      x->GetPoint(j, p);
+      int i[3];
+      for (int d = 0; d < 3; ++d) {
+        i[d] = min(ifloor((p[d] - _Origin[d]) / h), _Size[d] - 1);
+      }
+      cell[j] = i[0] + _Size[0] * (i[1] + _Size[1] * i[2]);
+      if (_Cluster[cell[j]] == -1) _Cluster[cell[j]] = nclusters++;
+    }
+
+    // Taylor expansion coefficients of each cluster
+    //   C_k^alpha = 2^|alpha| / alpha! sum_j w_j exp(-|e_j|^2) e_j^alpha,
+    // where e_j = (x_j - c_k) / sigma
+    Array<double> constant(_NumberOfTerms);
+    constant[0] = 1.0;
+    for (int i = 1; i < _NumberOfTerms; ++i) {
+      const int m = _Variable[i];
+      constant[i] = constant[_Parent[i]] * 2.0 / _Exponent[m][i];
+    }
+    _Coefficients.assign(3 * _NumberOfTerms * nclusters, .0);
+    double v[3] = {1.0, .0, .0}, c[3], e[3], mono[MaxMonomials];
+    for (vtkIdType j = 0; j < npoints; ++j) {
+      x->GetPoint(j, p);
+      w->GetTuple(j, v);
+      int idx = cell[j];
+      c[0] = _Origin[0] + (idx % _Size[0] + .5) * h, idx /= _Size[0];
+      c[1] = _Origin[1] + (idx % _Size[1] + .5) * h, idx /= _Size[1];
+      c[2] = _Origin[2] + (idx            + .5) * h;
+      for (int d = 0; d < 3; ++d) e[d] = (p[d] - c[d]) / _Sigma;
+      const double g = exp(-(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]));
+      EvaluateMonomials(e, mono);
+      double *C = _Coefficients.data() + 3 * _NumberOfTerms * _Cluster[cell[j]];
+      for (int i = 0; i < _NumberOfTerms; ++i, C += 3) {
+        const double t = constant[i] * g * mono[i];
+        C[0] += t * v[0], C[1] += t * v[1], C[2] += t * v[2];
+      }
+    }
+  }
+
+  void Evaluate(const double y[3], double f[3], double df[3][3] = NULL) const
+  {
+    f[0] = f[1] = f[2] = .0;
+    if (df) memset(df, 0, 9 * sizeof(double));
+    const double h  = _CellSize * _Sigma;
+    const double r  = _Cutoff * _Sigma;
+    const double r2 = _Cutoff * _Cutoff;
+    int i0[3], i1[3];
+    for (int d = 0; d < 3; ++d) {
+      i0[d] = max(ifloor((y[d] - r - _Origin[d]) / h), 0);
+      i1[d] = min(ifloor((y[d] + r - _Origin[d]) / h), _Size[d] - 1);
+      if (i0[d] > i1[d]) return;
+    }
+    double c[3], d[3], mono[MaxMonomials], t, g[3];
+    for (int k = i0[2]; k <= i1[2]; ++k)
+    for (int j = i0[1]; j <= i1[1]; ++j)
+    for (int i = i0[0]; i <= i1[0]; ++i) {
+      const int cluster = _Cluster[i + _Size[0] * (j + _Size[1] * k)];
+      if (cluster == -1) continue;
+      c[0] = _Origin[0] + (i + .5) * h;
+      c[1] = _Origin[1] + (j + .5) * h;
+      c[2] = _Origin[2] + (k + .5) * h;
+      for (int n = 0; n < 3; ++n) d[n] = (y[n] - c[n]) / _Sigma;
+      const double dist2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+      if (dist2 > r2) continue;
+      const double e = exp(-dist2);
+      EvaluateMonomials(d, mono);
+      const double *C = _Coefficients.data() + 3 * _NumberOfTerms * cluster;
+      for (int a = 0; a < _NumberOfTerms; ++a, C += 3) {
+        t = e * mono[a];
+        f[0] += t * C[0], f[1] += t * C[1], f[2] += t * C[2];
+        if (df) {
+          // d/dy_m exp(-|d|^2) d^alpha = (alpha_m d^(alpha - e_m) - 2 d_m d^alpha) exp(-|d|^2) / sigma
+          for (int m = 0; m < 3; ++m) {
+            g[m] = -2.0 * d[m] * mono[a];
+            if (_Lower[m][a] != -1) g[m] += _Exponent[m][a] * mono[_Lower[m][a]];
+            g[m] *= e / _Sigma;
+            df[m][0] += g[m] * C[0], df[m][1] += g[m] * C[1], df[m][2] += g[m] * C[2];
+          }
+        }
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Create kernel sum approximation of given type or NULL for KS_Direct
+///
+/// When the lattice of the KS_Grid method which covers the centers x would
+/// exceed the maximum number of nodes, the fast Gauss transform is used.
+GaussianKernelSum *NewGaussianKernelSum(enum CurrentsDistance::KernelSumMethod method,
+                                        double sigma, double spacing, double eps,
+                                        vtkPoints *x)
+{
+  switch (method) {
+    case CurrentsDistance::KS_Grid: {
+      GridGaussianKernelSum *grid = new GridGaussianKernelSum(sigma, spacing);
+      if (grid->NumberOfNodes(x) <= GridGaussianKernelSum::MaxNumberOfNodes()) {
+        return grid;
+      }
+      if (debug) {
+        cout << "CurrentsDistance: Lattice of " << grid->NumberOfNodes(x)
+             << " nodes too large, using fast Gauss transform instead" << endl;
+      }
+      delete grid;
+      return new FastGaussTransform(sigma, eps);
+    }
+    case CurrentsDistance::KS_FGT: return new FastGaussTransform(sigma, eps);
+    default:                       return NULL;
+  }
+}
+
+
+} // namespace CurrentsDistanceUtils
+using namespace CurrentsDistanceUtils;
+
+// =============================================================================
+// Dot product and gradient
+// =============================================================================
+
 // -----------------------------------------------------------------------------
 class CurrentsDistanceDotProduct
 {
@@ -174,21 +774,50 @@ private:
   vtkPoints               *_CentersB;
   vtkFloatArray           *_WeightsB;
   vtkAbstractPointLocator *_LocatorB;
+  const GaussianKernelSum *_SumB;
   double                   _Variance;
   double                   _Radius;
   vtkDataArray            *_Value;
   double                   _Sum;
 
+  const CurrentsDistance                                *_Distance;
+  Array<Pair<vtkPolyData *, const GaussianKernelSum *> > _KernelSums;
+
 public:
 
-  CurrentsDistanceDotProduct(double sigma)
+  CurrentsDistanceDotProduct(const CurrentsDistance *distance)
   :
     _CentersA(NULL), _WeightsA(NULL),
-    _CentersB(NULL), _WeightsB(NULL), _LocatorB(NULL),
-    _Variance(sigma * sigma), _Radius(2.5 * sigma),
-    _Value(NULL), _Sum(.0)
+    _CentersB(NULL), _WeightsB(NULL), _LocatorB(NULL), _SumB(NULL),
+    _Variance(distance->Sigma() * distance->Sigma()),
+    _Radius(2.5 * distance->Sigma()),
+    _Value(NULL), _Sum(.0), _Distance(distance)
   {}
 
+  ~CurrentsDistanceDotProduct()
+  {
+    for (size_t i = 0; i < _KernelSums.size(); ++i) {
+      delete _KernelSums[i].second;
+    }
+  }
+
+  /// Get approximation of kernel sums of current b, which is reused by
+  /// subsequent dot products with the same unmodified current
+  const GaussianKernelSum *KernelSum(vtkPolyData *b)
+  {
+    for (size_t i = 0; i < _KernelSums.size(); ++i) {
+      if (_KernelSums[i].first == b) return _KernelSums[i].second;
+    }
+    GaussianKernelSum *sum = NewGaussianKernelSum(_Distance->KernelSum(),
+                                                  _Distance->Sigma(),
+                                                  _Distance->GridSpacing(),
+                                                  _Distance->FGTError(),
+                                                  _CentersB);
+    if (sum) sum->Initialize(_CentersB, _WeightsB, false);
+    _KernelSums.push_back(MakePair(b, static_cast<const GaussianKernelSum *>(sum)));
+    return sum;
+  }
+
   inline double Evaluate(vtkPolyData *a, vtkPolyData *b, vtkDataArray *value = NULL)
   {
     MIRTK_START_TIMING();
@@ -214,17 +843,22 @@ public:
       cerr << "Cannot compute inner product between different types of currents" << endl;
       exit(1);
     }
-    // Initialize point locator
-    _LocatorB = vtkOctreePointLocator::New();
-    _LocatorB->SetDataSet(b);
-    _LocatorB->BuildLocator();
+    // Initialize kernel sum approximation or get point locator
+    vtkSmartPointer<vtkAbstractPointLocator> locator;
+    _SumB = KernelSum(b);
+    if (!_SumB) {
+      _LocatorB = _Distance->Locator(b);
+      if (!_LocatorB) {
+        locator   = CurrentsDistance::NewLocator(b);
+        _LocatorB = locator;
+      }
+    }
     // Evaluate inner product
     _Value = value;
     _Sum   = .0;
     blocked_range<vtkIdType> cellsA(0, _CentersA->GetNumberOfPoints());
     parallel_reduce(cellsA, *this);
-    // Free point locator
-    _LocatorB->Delete(), _LocatorB = NULL;
+    _LocatorB = NULL;
     MIRTK_DEBUG_TIMING(3, "evaluation of dot product of currents");
     return _Sum;
   }
@@ -238,10 +872,12 @@ public:
     _CentersB(other._CentersB),
     _WeightsB(other._WeightsB),
     _LocatorB(other._LocatorB),
+    _SumB    (other._SumB),
     _Variance(other._Variance),
     _Radius  (other._Radius),
     _Value   (other._Value),
-    _Sum     (.0)
+    _Sum     (.0),
+    _Distance(other._Distance)
   {}
 
   void join(CurrentsDistanceDotProduct &other)
@@ -265,13 +901,18 @@ public:
     for (vtkIdType i = re.begin(); i != re.end(); ++i) {
       _CentersA->GetPoint(i, ca);
       _WeightsA->GetTuple(i, da);
-      _LocatorB->FindPointsWithinRadius(_Radius, ca, ids);
       double value = .0;
-      for (vtkIdType k = 0; k < ids->GetNumberOfIds(); ++k) {
-        vtkIdType j = ids->GetId(k);
-        _CentersB->GetPoint(j, cb);
-        _WeightsB->GetTuple(j, db);
-        value += EvaluateKernel(ca, cb) * vtkMath::Dot(da, db);
+      if (_SumB) {
+        _SumB->Evaluate(ca, db);
+        value = vtkMath::Dot(da, db);
+      } else {
+        _LocatorB->FindPointsWithinRadius(_Radius, ca, ids);
+        for (vtkIdType k = 0; k < ids->GetNumberOfIds(); ++k) {
+          vtkIdType j = ids->GetId(k);
+          _CentersB->GetPoint(j, cb);
+          _WeightsB->GetTuple(j, db);
+          value += EvaluateKernel(ca, cb) * vtkMath::Dot(da, db);
+        }
       }
       if (_Value) _Value->SetTuple1(i, _Value->GetTuple1(i) + value);
       _Sum += value;
@@ -292,17 +933,22 @@ private:
   vtkPoints               *_CentersB;
   vtkFloatArray           *_WeightsB;
   vtkAbstractPointLocator *_LocatorB;
+  GaussianKernelSum       *_SumA;
+  GaussianKernelSum       *_SumB;
   double                   _Variance;
   double                   _Radius;
   Vector3D<double>        *_Gradient;
+  const CurrentsDistance  *_Distance;
 
 public:
 
-  CurrentsDistanceGradient(double sigma)
+  CurrentsDistanceGradient(const CurrentsDistance *distance)
   :
     _SurfaceA(NULL), _CentersA(NULL), _WeightsA(NULL), _LocatorA(NULL),
     _SurfaceB(NULL), _CentersB(NULL), _WeightsB(NULL), _LocatorB(NULL),
-    _Variance(sigma * sigma), _Radius(2.5 * sigma), _Gradient(NULL)
+    _SumA(NULL), _SumB(NULL),
+    _Variance(distance->Sigma() * distance->Sigma()),
+    _Radius(2.5 * distance->Sigma()), _Gradient(NULL), _Distance(distance)
   {}
 
   inline void EvaluateGradient(vtkPointSet *sa, vtkPolyData *ca,
@@ -334,13 +980,23 @@ public:
       cerr << "Cannot compute inner product between different types of currents" << endl;
       exit(1);
     }
-    // Initialize point locators
-    _LocatorA = vtkOctreePointLocator::New();
-    _LocatorA->SetDataSet(ca);
-    _LocatorA->BuildLocator();
-    _LocatorB = vtkOctreePointLocator::New();
-    _LocatorB->SetDataSet(cb);
-    _LocatorB->BuildLocator();
+    // Initialize kernel sum approximations or get point locators
+    vtkSmartPointer<vtkAbstractPointLocator> locatorA, locatorB;
+    _SumA = NewGaussianKernelSum(_Distance->KernelSum(), _Distance->Sigma(),
+                                 _Distance->GridSpacing(), _Distance->FGTError(),
+                                 _CentersA);
+    _SumB = NewGaussianKernelSum(_Distance->KernelSum(), _Distance->Sigma(),
+                                 _Distance->GridSpacing(), _Distance->FGTError(),
+                                 _CentersB);
+    if (_SumA) {
+      _SumA->Initialize(_CentersA, _WeightsA, true);
+      _SumB->Initialize(_CentersB, _WeightsB, true);
+    } else {
+      _LocatorA = _Distance->Locator(ca);
+      _LocatorB = _Distance->Locator(cb);
+      if (!_LocatorA) _LocatorA = locatorA = CurrentsDistance::NewLocator(ca);
+      if (!_LocatorB) _LocatorB = locatorB = CurrentsDistance::NewLocator(cb);
+    }
     // Evaluate gradient of currents distance measure
     _Gradient = g;
     for (int i = 0; i < _SurfaceA->GetNumberOfPoints(); ++i) {
@@ -348,9 +1004,10 @@ public:
     }
     blocked_range<vtkIdType> cellsA(0, _SurfaceA->GetNumberOfCells());
     parallel_reduce(cellsA, *this);
-    // Free point locators
-    _LocatorA->Delete(), _LocatorA = NULL;
-    _LocatorB->Delete(), _LocatorB = NULL;
+    // Free kernel sum approximations
+    delete _SumA, _SumA = NULL;
+    delete _SumB, _SumB = NULL;
+    _LocatorA = _LocatorB = NULL;
     MIRTK_DEBUG_TIMING(3, "evaluation of gradient of currents distance");
   }
 
@@ -366,9 +1023,12 @@ public:
     _CentersB(other._CentersB),
     _WeightsB(other._WeightsB),
     _LocatorB(other._LocatorB),
+    _SumA    (other._SumA),
+    _SumB    (other._SumB),
     _Variance(other._Variance),
     _Radius  (other._Radius),
-    _Gradient(other._Gradient)
+    _Gradient(other._Gradient),
+    _Distance(other._Distance)
   {}
 
   CurrentsDistanceGradient(CurrentsDistanceGradient &lhs, split)
@@ -381,8 +1041,11 @@ public:
     _CentersB(lhs._CentersB),
     _WeightsB(lhs._WeightsB),
     _LocatorB(lhs._LocatorB),
+    _SumA    (lhs._SumA),
+    _SumB    (lhs._SumB),
     _Variance(lhs._Variance),
-    _Radius  (lhs._Radius)
+    _Radius  (lhs._Radius),
+    _Distance(lhs._Distance)
   {
     CAllocate(_Gradient, _SurfaceA->GetNumberOfPoints());
   }
@@ -444,40 +1107,45 @@ public:
       // Get center and normal
       _CentersA->GetPoint(i, c1);
       _WeightsA->GetTuple(i, n1);
-      // Compute kds = KtauS and dks = gradKtauS.transpose()
-      // (cf. Deformetrica 2.0 OrientedSurfaceMesh::ComputeMatchGradient)
-      _LocatorA->FindPointsWithinRadius(_Radius, c1, ids);
-      memset(kws, 0, 3 * sizeof(double));
-      memset(dks, 0, 9 * sizeof(double));
-      for (vtkIdType k = 0; k < ids->GetNumberOfIds(); ++k) {
-        j = ids->GetId(k);
-        _CentersA->GetPoint(j, c2);
-        _WeightsA->GetTuple(j, n2);
-        w = EvaluateKernel(c1, c2);
-        EvaluateKernelGradient(g, c1, c2);
-        for (int d = 0; d < 3; ++d) {
-          kws   [d] += w    * n2[d];
-          dks[0][d] += g[0] * n2[d];
-          dks[1][d] += g[1] * n2[d];
-          dks[2][d] += g[2] * n2[d];
+      if (_SumA) {
+        _SumA->Evaluate(c1, kws, dks);
+        _SumB->Evaluate(c1, kwt, dkt);
+      } else {
+        // Compute kds = KtauS and dks = gradKtauS.transpose()
+        // (cf. Deformetrica 2.0 OrientedSurfaceMesh::ComputeMatchGradient)
+        _LocatorA->FindPointsWithinRadius(_Radius, c1, ids);
+        memset(kws, 0, 3 * sizeof(double));
+        memset(dks, 0, 9 * sizeof(double));
+        for (vtkIdType k = 0; k < ids->GetNumberOfIds(); ++k) {
+          j = ids->GetId(k);
+          _CentersA->GetPoint(j, c2);
+          _WeightsA->GetTuple(j, n2);
+          w = EvaluateKernel(c1, c2);
+          EvaluateKernelGradient(g, c1, c2);
+          for (int d = 0; d < 3; ++d) {
+            kws   [d] += w    * n2[d];
+            dks[0][d] += g[0] * n2[d];
+            dks[1][d] += g[1] * n2[d];
+            dks[2][d] += g[2] * n2[d];
+          }
         }
-      }
-      // Compute kwt = KtauT and dkt = gradKtauT.transpose()
-      // (cf. Deformetrica 2.0 OrientedSurfaceMesh::ComputeMatchGradient)
-      _LocatorB->FindPointsWithinRadius(_Radius, c1, ids);
-      memset(kwt, 0, 3 * sizeof(double));
-      memset(dkt, 0, 9 * sizeof(double));
-      for (vtkIdType k = 0; k < ids->GetNumberOfIds(); ++k) {
-        j = ids->GetId(k);
-        _CentersB->GetPoint(j, c2);
-        _WeightsB->GetTuple(j, n2);
-        w = EvaluateKernel(c1, c2);
-        EvaluateKernelGradient(g, c1, c2);
-        for (int d = 0; d < 3; ++d) {
-          kwt   [d] += w    * n2[d];
-          dkt[0][d] += g[0] * n2[d];
-          dkt[1][d] += g[1] * n2[d];
-          dkt[2][d] += g[2] * n2[d];
+        // Compute kwt = KtauT and dkt = gradKtauT.transpose()
+        // (cf. Deformetrica 2.0 OrientedSurfaceMesh::ComputeMatchGradient)
+        _LocatorB->FindPointsWithinRadius(_Radius, c1, ids);
+        memset(kwt, 0, 3 * sizeof(double));
+        memset(dkt, 0, 9 * sizeof(double));
+        for (vtkIdType k = 0; k < ids->GetNumberOfIds(); ++k) {
+          j = ids->GetId(k);
+          _CentersB->GetPoint(j, c2);
+          _WeightsB->GetTuple(j, n2);
+          w = EvaluateKernel(c1, c2);
+          EvaluateKernelGradient(g, c1, c2);
+          for (int d = 0; d < 3; ++d) {
+            kwt   [d] += w    * n2[d];
+            dkt[0][d] += g[0] * n2[d];
+            dkt[1][d] += g[1] * n2[d];
+            dkt[2][d] += g[2] * n2[d];
+          }
         }
       }
       // Add gradient
@@ -525,9 +1193,13 @@ void CurrentsDistance::Init()
   _TargetCurrent = ToCurrent(_Target->InputPointSet());
   _SourceCurrent = ToCurrent(_Source->InputPointSet());
 
+  // Build point locators of currents once, the one of a fixed current
+  // is reused by all subsequent evaluations
+  InitializeLocators();
+
   // Compute squared norm of fixed current(s)
   _TargetNormSquared = .0;
-  CurrentsDistanceDotProduct dot_product(_Sigma);
+  CurrentsDistanceDotProduct dot_product(this);
   if (!_Target->Transformation()) {
     _TargetNormSquared += dot_product.Evaluate(_TargetCurrent, _TargetCurrent);
   }
@@ -567,6 +1239,15 @@ bool CurrentsDistance::SetWithPrefix(const char *param, const char *value)
   if (strcmp(param, "Symmetric currents distance") == 0) {
     return FromString(value, _Symmetric);
   }
+  if (strcmp(param, "Currents kernel sum") == 0) {
+    return FromString(value, _KernelSum);
+  }
+  if (strcmp(param, "Currents grid spacing") == 0) {
+    return FromString(value, _GridSpacing) && _GridSpacing > .0;
+  }
+  if (strcmp(param, "Currents FGT error") == 0) {
+    return FromString(value, _FGTError) && _FGTError > .0 && _FGTError < 1.0;
+  }
   return PointSetDistance::SetWithPrefix(param, value);
 }
 
@@ -579,6 +1260,15 @@ bool CurrentsDistance::SetWithoutPrefix(const char *param, const char *value)
   if (strcmp(param, "Symmetric") == 0) {
     return FromString(value, _Symmetric);
   }
+  if (strcmp(param, "Kernel sum") == 0) {
+    return FromString(value, _KernelSum);
+  }
+  if (strcmp(param, "Grid spacing") == 0) {
+    return FromString(value, _GridSpacing) && _GridSpacing > .0;
+  }
+  if (strcmp(param, "FGT error") == 0) {
+    return FromString(value, _FGTError) && _FGTError > .0 && _FGTError < 1.0;
+  }
   return PointSetDistance::SetWithoutPrefix(param, value);
 }
 
@@ -588,6 +1278,9 @@ ParameterList CurrentsDistance::Parameter() const
   ParameterList params = PointSetDistance::Parameter();
   InsertWithPrefix(params, "Kernel width", _Sigma);
   InsertWithPrefix(params, "Symmetric",    _Symmetric);
+  InsertWithPrefix(params, "Kernel sum",   _KernelSum);
+  InsertWithPrefix(params, "Grid spacing", _GridSpacing);
+  InsertWithPrefix(params, "FGT error",    _FGTError);
   return params;
 }
 
@@ -601,10 +1294,12 @@ void CurrentsDistance::Update(bool)
   if (_Target->Transformation()) {
     _Target->Update();
     _TargetCurrent = ToCurrent(_Target->PointSet());
+    if (_KernelSum == KS_Direct) _TargetLocator = NewLocator(_TargetCurrent);
   }
   if (_Source->Transformation()) {
     _Source->Update();
     _SourceCurrent = ToCurrent(_Source->PointSet());
+    if (_KernelSum == KS_Direct) _SourceLocator = NewLocator(_SourceCurrent);
   }
 }
 
@@ -613,7 +1308,7 @@ double CurrentsDistance::Evaluate()
 {
   MIRTK_START_TIMING();
   double d = _TargetNormSquared;
-  CurrentsDistanceDotProduct dot_product(_Sigma);
+  CurrentsDistanceDotProduct dot_product(this);
   if (_Target->Transformation()) {
     d += dot_product.Evaluate(_TargetCurrent, _TargetCurrent);
   }
@@ -639,7 +1334,7 @@ void CurrentsDistance::NonParametricGradient(const RegisteredPointSet *target,
   vtkPointSet *sb = _Source->PointSet();
   vtkPolyData *cb = _SourceCurrent;
   if (target == _Source) swap(sa, sb), swap(ca, cb);
-  CurrentsDistanceGradient d(_Sigma);
+  CurrentsDistanceGradient d(this);
   d.EvaluateGradient(sa, ca, sb, cb, gradient);
 }
 
@@ -666,7 +1361,7 @@ void CurrentsDistance::WriteDataSets(const char *p, const char *suffix, bool all
   if (_Target->Transformation() || all) {
     vtkSmartPointer<vtkFloatArray> dist;
     if (_Target->Transformation()) {
-      CurrentsDistanceDotProduct dot_product(_Sigma);
+      CurrentsDistanceDotProduct dot_product(this);
       dist = vtkSmartPointer<vtkFloatArray>::New();
       dist->SetName("distance");
       dist->SetNumberOfComponents(1);
@@ -683,7 +1378,7 @@ void CurrentsDistance::WriteDataSets(const char *p, const char *suffix, bool all
   if (_Source->Transformation() || all) {
     vtkSmartPointer<vtkFloatArray> dist;
     if (_Source->Transformation()) {
-      CurrentsDistanceDotProduct dot_product(_Sigma);
+      CurrentsDistanceDotProduct dot_product(this);
       dist = vtkSmartPointer<vtkFloatArray>::New();
       dist->SetName("distance");
       dist->SetNumberOfComponents(1);
@@ -673,6 +673,10 @@ void GenericRegistrationFilter::Reset()
   }
   _DisplacementInfo.clear();
   _DisplacementField.clear();
+  for (size_t i = 0; i < _TransformedCoordinates.size(); ++i) {
+    Delete(_TransformedCoordinates[i]);
+  }
+  _TransformedCoordinates.clear();
   Delete(_Transformation);
   Delete(_Optimizer);
   for (size_t l = 0; l < _Mask.size(); ++l) {
@@ -688,6 +692,7 @@ void GenericRegistrationFilter::Reset()
   _InterpolationMode                   = Interpolation_FastLinear;
   _ExtrapolationMode                   = Extrapolation_Default;
   _PrecomputeDerivatives               = false;
+  _SinglePrecision                     = false;
   _SimilarityMeasure                   = SIM_NMI;
   _PointSetDistanceMeasure             = PDM_FRE;
   _OptimizationMethod                  = OM_ConjugateGradientDescent;
@@ -1139,6 +1144,8 @@ bool GenericRegistrationFilter::Set(const char *name, const char *value, int lev
     return FromString(value, _ExtrapolationMode);
   } else if (strcmp(name, "Precompute image derivatives") == 0) {
     return FromString(value, _PrecomputeDerivatives);
+  } else if (strcmp(name, "Single precision image caches") == 0) {
+    return FromString(value, _SinglePrecision);
 
   // (Default) Similarity measure
   } else if (strcmp(name, "Image (dis-)similarity measure") == 0 ||
@@ -1520,6 +1527,7 @@ ParameterList GenericRegistrationFilter::Parameter(int level) const
     Insert(params, "Interpolation mode",                    _InterpolationMode);
     Insert(params, "Extrapolation mode",                    _ExtrapolationMode);
     Insert(params, "Precompute image derivatives",          _PrecomputeDerivatives);
+    Insert(params, "Single precision image caches",         _SinglePrecision);
     Insert(params, "Normalize weights of energy terms",     _NormalizeWeights);
     Insert(params, "Downsample images with padding",        _DownsampleWithPadding);
     Insert(params, "Crop/pad images",                       _CropPadImages);
@@ -3480,6 +3488,7 @@ void GenericRegistrationFilter::SetInputOf(RegisteredImage *output, const struct
   output->InterpolationMode    (_InterpolationMode);
   output->ExtrapolationMode    (_ExtrapolationMode);
   output->PrecomputeDerivatives(_PrecomputeDerivatives);
+  output->SinglePrecision      (_SinglePrecision);
   output->Transformation       (this->OutputTransformation(ti));
 
   // Add/Amend displacement cache entry
@@ -3617,6 +3626,8 @@ void GenericRegistrationFilter::AddImageSimilarityTerm()
 {
   ImageSimilarity *similarity;
   struct ImageAttributes  attr;
+  Array<RegisteredImage *>       output;
+  Array<struct ImageAttributes>  domain;
   Array<ImageSimilarityInfo>::const_iterator sim;
   for (sim = _ImageSimilarityInfo.begin(); sim != _ImageSimilarityInfo.end(); ++sim) {
     // Determine common attributes of output images
@@ -3649,9 +3660,33 @@ void GenericRegistrationFilter::AddImageSimilarityTerm()
     // Set input of registered images
     this->SetInputOf(similarity->Target(), attr, sim->_TargetIndex, sim->_TargetTransformation);
     this->SetInputOf(similarity->Source(), attr, sim->_SourceIndex, sim->_SourceTransformation);
+    output.push_back(similarity->Target());
+    output.push_back(similarity->Source());
+    domain.push_back(attr);
+    domain.push_back(attr);
     // Add similarity term to energy function
     _Energy.Add(similarity);
   }
+  // Share transformed voxel coordinates among moving images which are resampled
+  // on the same domain, e.g., the channels of a multi-channel registration,
+  // unless their transformation is already evaluated once by PreUpdateCallback
+  for (size_t i = 0; i < output.size(); ++i) {
+    if (!output[i]->Transformation() || output[i]->ExternalDisplacement() ||
+        output[i]->TransformedCoordinates()) continue;
+    TransformedCoordinates *coords;
+    coords = new TransformedCoordinates(domain[i], output[i]->InputImage()->Attributes(),
+                                        output[i]->Transformation());
+    for (size_t j = i + 1; j < output.size(); ++j) {
+      if (!output[j]->ExternalDisplacement() && !output[j]->TransformedCoordinates() &&
+          coords->Matches(domain[j], output[j]->InputImage()->Attributes(),
+                          output[j]->Transformation())) {
+        output[i]->TransformedCoordinates(coords);
+        output[j]->TransformedCoordinates(coords);
+      }
+    }
+    if (output[i]->TransformedCoordinates()) _TransformedCoordinates.push_back(coords);
+    else                                     delete coords;
+  }
 }
 
 // -----------------------------------------------------------------------------
@@ -3818,6 +3853,14 @@ void GenericRegistrationFilter::PreUpdateCallback(bool gradient)
           // deformed surface mesh such that for each point in the remeshed
           // surface we know the untransformed coordinates needed for gradient
           // computation in Transformation::ParametricGradient.
+          //
+          // The edge table of the input surface is kept by the registered point
+          // set until the surface was remeshed. The remesher leaves the surface
+          // unmodified when no deformed edge is outside the desired length range,
+          // in which case the list of changed points is empty and neither the
+          // point set nor the energy terms need to be reinitialized. Otherwise,
+          // only the terms evaluated on this point set are reinitialized, because
+          // the output points are renumbered when unused points are removed.
           const int    j    = _PointSetOutputInfo[i]._InputIndex;
           const double dmin = _MinEdgeLength[_CurrentLevel][j];
           const double dmax = _MaxEdgeLength[_CurrentLevel][j];
@@ -3825,6 +3868,7 @@ void GenericRegistrationFilter::PreUpdateCallback(bool gradient)
             MIRTK_START_TIMING();
             PolyDataRemeshing remesher;
             remesher.Input(vtkPolyData::SafeDownCast(_PointSetOutput[i]->InputPointSet()));
+            remesher.EdgeTable(_PointSetOutput[i]->Edges());
             remesher.Transformation(_PointSetOutput[i]->Transformation());
             remesher.MeltingOrder(PolyDataRemeshing::AREA);
             remesher.MeltNodesOff();
@@ -3832,11 +3876,15 @@ void GenericRegistrationFilter::PreUpdateCallback(bool gradient)
             remesher.MinEdgeLength(dmin);
             remesher.MaxEdgeLength(dmax);
             remesher.Run();
-            _PointSetOutput[i]->InputPointSet(remesher.Output());
-            _PointSetOutput[i]->Initialize();
-            MIRTK_DEBUG_TIMING(7, "remeshing moving surface");
-            remeshed[i] = true;
-            reinit_pointset_terms = true;
+            if (remesher.ChangedPoints()->GetNumberOfIds() > 0) {
+              _PointSetOutput[i]->InputPointSet(remesher.Output());
+              _PointSetOutput[i]->Initialize();
+              _PointSetOutput[i]->BuildEdgeTables();
+              remeshed[i] = true;
+              reinit_pointset_terms = true;
+            }
+            MIRTK_DEBUG_TIMING(7, "remeshing moving surface"
+                << " (" << remesher.ChangedPoints()->GetNumberOfIds() << " points changed)");
           }
         }
         _PointSetOutput[i]->Update(true);
@@ -3973,6 +4021,10 @@ void GenericRegistrationFilter::Finalize()
   }
   _DisplacementField.clear();
   _DisplacementInfo .clear();
+  for (size_t i = 0; i < _TransformedCoordinates.size(); ++i) {
+    Delete(_TransformedCoordinates[i]);
+  }
+  _TransformedCoordinates.clear();
 
   // Include centering transformations in final linear transformation
   HomogeneousTransformation *lin = NULL;
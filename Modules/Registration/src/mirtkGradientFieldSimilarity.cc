@@ -361,6 +361,16 @@ public:
 
 }; // AddOtherPartialDerivativesOfFFD
 
+// -----------------------------------------------------------------------------
+/// Copy transformed gradient channels of registered image
+void CopyTransformedGradient(GenericImage<double> &copy, const RegisteredImage *image)
+{
+  const RegisteredImage::VoxelType *dI = image->Data(0, 0, 0, 1);
+  double *out = copy.Data();
+  const int n = copy.NumberOfVoxels();
+  for (int idx = 0; idx < n; ++idx) out[idx] = static_cast<double>(dI[idx]);
+}
+
 
 } // namespace GradientFieldSimilarityUtils
 using namespace GradientFieldSimilarityUtils;
@@ -629,7 +639,7 @@ void GradientFieldSimilarity::Update(bool hessian)
       if (_InitialUpdate) {
         _TargetTransformedGradient.Initialize(_Target->Attributes(), 3);
       }
-      _TargetTransformedGradient.CopyFrom(_Target->Data(0, 0, 0, 1));
+      CopyTransformedGradient(_TargetTransformedGradient, _Target);
     }
 
     // Reorient gradient and hessian (if needed) of the target image according
@@ -645,7 +655,7 @@ void GradientFieldSimilarity::Update(bool hessian)
       if (_InitialUpdate) {
         _SourceTransformedGradient.Initialize(_Source->Attributes(), 3);
       }
-      _SourceTransformedGradient.CopyFrom(_Source->Data(0, 0, 0, 1));
+      CopyTransformedGradient(_SourceTransformedGradient, _Source);
     }
 
     // Reorient gradient and hessian (if needed) of the source image according
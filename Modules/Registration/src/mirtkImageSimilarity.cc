@@ -22,6 +22,7 @@
 #include <mirtkAssert.h>
 #include <mirtkMath.h>
 #include <mirtkMemory.h>
+#include <mirtkArray.h>
 #include <mirtkParallel.h>
 #include <mirtkProfiling.h>
 #include <mirtkVoxelFunction.h>
@@ -266,6 +267,68 @@ public:
 };
 
 
+// -----------------------------------------------------------------------------
+/// Copy intensities within image region to/from contiguous buffer
+class CopyRegionIntensities
+{
+  typedef RegisteredImage::VoxelType VoxelType;
+
+  RegisteredImage      *_Image;
+  blocked_range3d<int>  _Region;
+  VoxelType            *_Buffer;
+  bool                  _ToBuffer;
+
+public:
+
+  /// Constructor
+  CopyRegionIntensities(RegisteredImage *image, const blocked_range3d<int> &region,
+                        VoxelType *buffer, bool to_buffer)
+  :
+    _Image(image), _Region(region), _Buffer(buffer), _ToBuffer(to_buffer)
+  {}
+
+  /// Copy intensities of image rows within range of slices
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int    i1 = _Region.cols().begin();
+    const int    nx = _Region.cols().end() - i1;
+    const int    ny = _Region.rows().end() - _Region.rows().begin();
+    const size_t nbytes = nx * sizeof(VoxelType);
+    VoxelType *buf;
+    for (int k = re.begin(); k != re.end(); ++k) {
+      buf = _Buffer + (k - _Region.pages().begin()) * ny * nx;
+      for (int j = _Region.rows().begin(); j != _Region.rows().end(); ++j, buf += nx) {
+        VoxelType *row = _Image->GetPointerToVoxels(i1, j, k);
+        if (_ToBuffer) memcpy(buf, row, nbytes);
+        else           memcpy(row, buf, nbytes);
+      }
+    }
+  }
+
+  /// Number of buffer elements needed to store intensities of image region
+  static int Size(const blocked_range3d<int> &region)
+  {
+    return (region.pages().end() - region.pages().begin()) *
+           (region.rows ().end() - region.rows ().begin()) *
+           (region.cols ().end() - region.cols ().begin());
+  }
+
+  /// Copy intensities from image region to buffer
+  static void Get(RegisteredImage *image, const blocked_range3d<int> &region, VoxelType *buffer)
+  {
+    CopyRegionIntensities body(image, region, buffer, true);
+    parallel_for(blocked_range<int>(region.pages().begin(), region.pages().end()), body);
+  }
+
+  /// Copy intensities from buffer to image region
+  static void Put(RegisteredImage *image, const blocked_range3d<int> &region, const VoxelType *buffer)
+  {
+    CopyRegionIntensities body(image, region, const_cast<VoxelType *>(buffer), false);
+    parallel_for(blocked_range<int>(region.pages().begin(), region.pages().end()), body);
+  }
+};
+
+
 } // namespace ImageSimilarityUtils
 using namespace ImageSimilarityUtils;
 
@@ -284,6 +347,7 @@ ImageSimilarity::ImageSimilarity(const char *name, double weight)
   _Gradient                (NULL),
   _NumberOfVoxels          (0),
   _UseApproximateGradient  (false),
+  _UseColoredApproximateGradient(false),
   _VoxelWisePreconditioning(.0),
   _NodeBasedPreconditioning(.0),
   _InitialUpdate           (false)
@@ -307,6 +371,7 @@ ImageSimilarity::ImageSimilarity(const ImageSimilarity &other)
   _Gradient                (NULL),
   _NumberOfVoxels          (other._NumberOfVoxels),
   _UseApproximateGradient  (other._UseApproximateGradient),
+  _UseColoredApproximateGradient(other._UseColoredApproximateGradient),
   _VoxelWisePreconditioning(other._VoxelWisePreconditioning),
   _NodeBasedPreconditioning(other._NodeBasedPreconditioning),
   _InitialUpdate           (other._InitialUpdate)
@@ -326,6 +391,7 @@ ImageSimilarity &ImageSimilarity::operator =(const ImageSimilarity &other)
   _Source = other._Source ? new RegisteredImage(*other._Source) : NULL;
   _NumberOfVoxels           = other._NumberOfVoxels;
   _UseApproximateGradient   = other._UseApproximateGradient;
+  _UseColoredApproximateGradient = other._UseColoredApproximateGradient;
   _VoxelWisePreconditioning = other._VoxelWisePreconditioning;
   _NodeBasedPreconditioning = other._NodeBasedPreconditioning;
   _InitialUpdate            = other._InitialUpdate;
@@ -402,6 +468,9 @@ bool ImageSimilarity::SetWithoutPrefix(const char *param, const char *value)
   if (strcmp(param, "Approximate gradient") == 0) {
     return FromString(value, _UseApproximateGradient);
   }
+  if (strcmp(param, "Approximate gradient coloring") == 0) {
+    return FromString(value, _UseColoredApproximateGradient);
+  }
   if (strcmp(param, "Preconditioning (voxel-wise)") == 0) {
     return FromString(value, _VoxelWisePreconditioning);
   }
@@ -435,6 +504,7 @@ ParameterList ImageSimilarity::Parameter() const
 {
   ParameterList params = DataFidelity::Parameter();
   InsertWithPrefix(params, "Approximate gradient",         _UseApproximateGradient);
+  InsertWithPrefix(params, "Approximate gradient coloring", _UseColoredApproximateGradient);
   InsertWithPrefix(params, "Preconditioning (voxel-wise)", _VoxelWisePreconditioning);
   InsertWithPrefix(params, "Preconditioning (node-based)", _NodeBasedPreconditioning);
   InsertWithPrefix(params, "Blurring of image gradient",   _Target->GradientSigma());
@@ -458,6 +528,13 @@ void ImageSimilarity::Update(bool gradient)
   _InitialUpdate = false;
 }
 
+// -----------------------------------------------------------------------------
+bool ImageSimilarity::ModifiesTransformation() const
+{
+  if (!_Target->Transformation() && !_Source->Transformation()) return false;
+  return _UseApproximateGradient || !this->HasNonParametricGradient();
+}
+
 // -----------------------------------------------------------------------------
 void ImageSimilarity::Exclude(const blocked_range3d<int> &)
 {
@@ -492,6 +569,12 @@ bool ImageSimilarity::NonParametricGradient(const RegisteredImage *,
   return false; // By default, ApproximateGradient using finite differences
 }
 
+// -----------------------------------------------------------------------------
+bool ImageSimilarity::HasNonParametricGradient() const
+{
+  return false;
+}
+
 // -----------------------------------------------------------------------------
 void ImageSimilarity::NormalizeGradient(GradientImageType *gradient)
 {
@@ -531,6 +614,10 @@ void ImageSimilarity::ApproximateGradient(RegisteredImage        *image,
                                           double *gradient, double step,
                                           double weight)
 {
+  if (_UseColoredApproximateGradient) {
+    this->ColoredApproximateGradient(image, ffd, gradient, step, weight);
+    return;
+  }
   weight /= 2.0 * step;
   double a, b, value;
   int i1, j1, k1, i2, j2, k2, dof[3];
@@ -567,6 +654,152 @@ void ImageSimilarity::ApproximateGradient(RegisteredImage        *image,
   }
 }
 
+// -----------------------------------------------------------------------------
+void ImageSimilarity::ColoredApproximateGradient(RegisteredImage        *image,
+                                                 FreeFormTransformation *ffd,
+                                                 double *gradient, double step,
+                                                 double weight)
+{
+  MIRTK_START_TIMING();
+
+  weight /= 2.0 * step;
+
+  // Lattice stride between control points of same color such that the
+  // support regions of control points of the same color do not overlap
+  const int s       = ffd->KernelSize() + 1;
+  const int ncolors = s * s * s * (ffd->T() > 1 ? s : 1);
+
+  // Active control points with non-empty support region in image domain
+  Array<int> cps;
+  cps.reserve(ffd->NumberOfCPs());
+  int i1, j1, k1, i2, j2, k2;
+  for (int cp = 0; cp < ffd->NumberOfCPs(); ++cp) {
+    if (ffd->IsActive(cp) && ffd->BoundingBox(image, cp, i1, j1, k1, i2, j2, k2)) {
+      cps.push_back(cp);
+    }
+  }
+
+  // Index of last set of independent control points that claimed a voxel
+  const int nx = image->X(), ny = image->Y();
+  Array<int> label(image->NumberOfSpatialVoxels(), -1);
+
+  Array<Array<int> >          colors(ncolors);
+  Array<int>                  deferred, members, offset;
+  Array<blocked_range3d<int> > regions;
+  Array<double>               values;
+  Array<VoxelType>            orig, plus, minus;
+  int i, j, k, l, dof[3], nsets = 0;
+  double a, b;
+
+  while (!cps.empty()) {
+    // Group remaining control points by color
+    for (int c = 0; c < ncolors; ++c) colors[c].clear();
+    for (size_t n = 0; n < cps.size(); ++n) {
+      ffd->IndexToLattice(cps[n], i, j, k, l);
+      colors[((l % s * s + k % s) * s + j % s) * s + i % s].push_back(cps[n]);
+    }
+    deferred.clear();
+    for (int c = 0; c < ncolors; ++c) {
+      // Collect control points of this color whose support regions in the
+      // image domain do not overlap, defer others to the next iteration
+      members.clear(), regions.clear(), offset.clear();
+      int size = 0;
+      for (size_t n = 0; n < colors[c].size(); ++n) {
+        const int cp = colors[c][n];
+        ffd->BoundingBox(image, cp, i1, j1, k1, i2, j2, k2);
+        bool overlap = false;
+        for (k = k1; k <= k2 && !overlap; ++k)
+        for (j = j1; j <= j2 && !overlap; ++j)
+        for (i = i1; i <= i2 && !overlap; ++i) {
+          overlap = (label[(k * ny + j) * nx + i] == nsets);
+        }
+        if (overlap) {
+          deferred.push_back(cp);
+          continue;
+        }
+        for (k = k1; k <= k2; ++k)
+        for (j = j1; j <= j2; ++j)
+        for (i = i1; i <= i2; ++i) {
+          label[(k * ny + j) * nx + i] = nsets;
+        }
+        members.push_back(cp);
+        regions.push_back(blocked_range3d<int>(k1, k2+1, j1, j2+1, i1, i2+1));
+        offset .push_back(size);
+        size += CopyRegionIntensities::Size(regions.back());
+      }
+      if (members.empty()) continue;
+      ++nsets;
+      // Save intensities of transformed image for unperturbed parameters
+      values.resize(members.size());
+      orig  .resize(size);
+      plus  .resize(size);
+      minus .resize(size);
+      for (size_t m = 0; m < members.size(); ++m) {
+        CopyRegionIntensities::Get(image, regions[m], orig.data() + offset[m]);
+      }
+      for (int d = 0; d < 3; ++d) {
+        // Perturb parameters of all control points of this set at once
+        // and update transformed image within their support regions
+        for (size_t m = 0; m < members.size(); ++m) {
+          ffd->IndexToDOFs(members[m], dof[0], dof[1], dof[2]);
+          if (ffd->GetStatus(dof[d]) == Active) {
+            values[m] = ffd->Get(dof[d]);
+            ffd->Put(dof[d], values[m] + step);
+            image->Update(regions[m]);
+            CopyRegionIntensities::Get(image, regions[m], plus.data() + offset[m]);
+          }
+        }
+        for (size_t m = 0; m < members.size(); ++m) {
+          ffd->IndexToDOFs(members[m], dof[0], dof[1], dof[2]);
+          if (ffd->GetStatus(dof[d]) == Active) {
+            ffd->Put(dof[d], values[m] - step);
+            image->Update(regions[m]);
+            CopyRegionIntensities::Get(image, regions[m], minus.data() + offset[m]);
+          }
+        }
+        for (size_t m = 0; m < members.size(); ++m) {
+          ffd->IndexToDOFs(members[m], dof[0], dof[1], dof[2]);
+          if (ffd->GetStatus(dof[d]) == Active) {
+            ffd->Put(dof[d], values[m]);
+            CopyRegionIntensities::Put(image, regions[m], orig.data() + offset[m]);
+          }
+        }
+        // Evaluate similarity for each perturbed control point separately,
+        // exchanging only the intensities within its support region
+        for (size_t m = 0; m < members.size(); ++m) {
+          ffd->IndexToDOFs(members[m], dof[0], dof[1], dof[2]);
+          if (ffd->GetStatus(dof[d]) == Active) {
+            const blocked_range3d<int> &region = regions[m];
+
+            ffd->Put(dof[d], values[m] + step);
+            this->Exclude(region);
+            CopyRegionIntensities::Put(image, region, plus.data() + offset[m]);
+            this->Include(region);
+            a = this->Evaluate();
+
+            ffd->Put(dof[d], values[m] - step);
+            this->Exclude(region);
+            CopyRegionIntensities::Put(image, region, minus.data() + offset[m]);
+            this->Include(region);
+            b = this->Evaluate();
+
+            ffd->Put(dof[d], values[m]);
+            this->Exclude(region);
+            CopyRegionIntensities::Put(image, region, orig.data() + offset[m]);
+            this->Include(region);
+
+            gradient[dof[d]] += weight * (a - b);
+          }
+        }
+      }
+    }
+    cps.swap(deferred);
+  }
+
+  MIRTK_DEBUG_TIMING(3, "approximation of similarity gradient using "
+                        << nsets << " sets of independent control points");
+}
+
 // -----------------------------------------------------------------------------
 void ImageSimilarity::ApproximateGradient(RegisteredImage *image,
                                           double *gradient, double step,
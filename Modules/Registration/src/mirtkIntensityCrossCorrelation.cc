@@ -94,5 +94,11 @@ bool IntensityCrossCorrelation
   return true;
 }
 
+// -----------------------------------------------------------------------------
+bool IntensityCrossCorrelation::HasNonParametricGradient() const
+{
+  return true;
+}
+
 
 } // namespace mirtk
@@ -19,6 +19,9 @@
 
 #include <mirtkMutualImageInformation.h>
 
+#include <mirtkMath.h>
+#include <mirtkArray.h>
+#include <mirtkProfiling.h>
 #include <mirtkObjectFactory.h>
 
 
@@ -74,14 +77,53 @@ double MutualImageInformation::RawValue(double value) const
 bool MutualImageInformation
 ::NonParametricGradient(const RegisteredImage *image, GradientImageType *gradient)
 {
-  // TODO Implement gradient computation of MI, using NMI as reference
-  cerr << "MutualImageInformation::NonParametricGradient: Not implemented" << endl;
-  exit(1);
+  // Use finite differences unless histogram is filled using Parzen windows
+  if (!_UseParzenWindow) return false;
+
+  MIRTK_START_TIMING();
+
+  const int     nx = _Histogram->NumberOfBinsX();
+  const int     ny = _Histogram->NumberOfBinsY();
+  const double  n  = _Histogram->NumberOfSamples();
+  const double *h  = _Histogram->RawPointer();
+  if (n <= .0) {
+    memset(gradient->Data(), 0, 3 * _NumberOfVoxels * sizeof(GradientType));
+    return true;
+  }
+
+  // Marginal histogram of transformed image
+  const bool wrt_target = (image == Target());
+  Array<double> hm(wrt_target ? nx : ny, .0);
+  for (int j = 0, idx = 0; j < ny; ++j)
+  for (int i = 0; i < nx; ++i, ++idx) {
+    hm[wrt_target ? i : j] += h[idx];
+  }
+
+  // Derivatives of 2 - MI w.r.t. joint histogram bins, where constant
+  // terms cancel out because the Parzen window weights sum up to one
+  Array<double> dh(nx * ny, .0);
+  for (int j = 0, idx = 0; j < ny; ++j)
+  for (int i = 0; i < nx; ++i, ++idx) {
+    if (h[idx] > .0) {
+      dh[idx] = (log(hm[wrt_target ? i : j]) - log(h[idx])) / n;
+    }
+  }
+
+  // Evaluate similarity gradient w.r.t given transformed image
+  ParzenWindowGradient(image, dh.data(), gradient);
 
   // Apply chain rule to obtain gradient w.r.t y = T(x)
   MultiplyByImageGradient(image, gradient);
+
+  MIRTK_DEBUG_TIMING(2, "similarity gradient computation (MI)");
   return true;
 }
 
+// -----------------------------------------------------------------------------
+bool MutualImageInformation::HasNonParametricGradient() const
+{
+  return _UseParzenWindow;
+}
+
 
 } // namespace mirtk
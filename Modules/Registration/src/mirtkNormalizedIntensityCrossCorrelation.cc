@@ -29,7 +29,7 @@
 #include <mirtkBinaryVoxelFunction.h>
 #include <mirtkScalarFunctionToImage.h>
 #include <mirtkConvolutionFunction.h>
-#include <mirtkGenericImageIterator.h>
+#include <mirtkArray.h>
 #include <mirtkScalarGaussian.h>
 #include <mirtkObjectFactory.h>
 
@@ -219,7 +219,7 @@ struct GenerateLNCCImage : public VoxelFunction
       (*cc) = -0.01; // i.e., background
     } else {
       if (*b >= .01 && *c >= .01) {
-        (*cc) = min(1.0, abs(*a) / ((*b) * (*c)));
+        (*cc) = min(1.0, abs(static_cast<double>(*a)) / ((*b) * (*c)));
       } else if (*b < .01 && *c < .01) {
         (*cc) = 1.0; // i.e., both regions (approx.) constant-valued
       } else {
@@ -252,7 +252,7 @@ struct EvaluateLNCC : public VoxelReduction
   {
     if (!IsNaN(*a)) {
       if (*b >= .01 && *c >= .01) {
-        _Sum += min(1.0, abs(*a) / ((*b) * (*c)));
+        _Sum += min(1.0, abs(static_cast<double>(*a)) / ((*b) * (*c)));
       } else if (*b < .01 && *c < .01) {
         _Sum += 1.0; // i.e., both regions (approx.) constant-valued
       }
@@ -265,7 +265,7 @@ struct EvaluateLNCC : public VoxelReduction
   {
     if (!IsNaN(*a)) {
       if (*b >= .01 && *c >= .01) {
-        _Sum += min(1.0, abs(*a) / ((*b) * (*c)));
+        _Sum += min(1.0, abs(static_cast<double>(*a)) / ((*b) * (*c)));
       } else if (*b < .01 && *c < .01) {
         _Sum += 1.0; // i.e., both regions (approx.) constant-valued
       }
@@ -304,8 +304,8 @@ struct EvaluateLNCCGradient : public VoxelFunction
     }
   }
 
-  template <class TImage, class T1, class T2>
-  void operator()(const TImage &, int, const T1 *tgt, const T1 *src, const T2 *g1, const T2 *g2, const T2 *g3, T2 *g)
+  template <class TImage, class T1, class T2, class T3>
+  void operator()(const TImage &, int, const T1 *tgt, const T1 *src, const T2 *g1, const T2 *g2, const T2 *g3, T3 *g)
   {
     (*g) = (*g1) * (*tgt) - (*g2) * (*src) + (*g3);
   }
@@ -315,51 +315,205 @@ struct EvaluateLNCCGradient : public VoxelFunction
 // Kernel: Box window
 // -----------------------------------------------------------------------------
 
+// -----------------------------------------------------------------------------
+/// Summed-volume tables (i.e., 3D integral images) of T, S, T^2, S^2, and T*S
+///
+/// The tables are computed for a box-shaped image region. Each table has one
+/// additional leading element of zero padding in each dimension such that the
+/// sum of values within any box window inside this region can be computed in
+/// constant time from the table entries at the eight corners of the window.
+class BoxWindowSums
+{
+public:
+
+  /// Sums of intensities and products of intensities
+  struct Sums
+  {
+    double t, s, tt, ss, ts;
+
+    Sums() : t(.0), s(.0), tt(.0), ss(.0), ts(.0) {}
+
+    Sums &operator +=(const Sums &rhs)
+    {
+      t += rhs.t, s += rhs.s, tt += rhs.tt, ss += rhs.ss, ts += rhs.ts;
+      return *this;
+    }
+
+    Sums &operator -=(const Sums &rhs)
+    {
+      t -= rhs.t, s -= rhs.s, tt -= rhs.tt, ss -= rhs.ss, ts -= rhs.ts;
+      return *this;
+    }
+  };
+
+private:
+
+  typedef RegisteredImage::VoxelType VoxelType;
+
+  const VoxelType *_Target;  ///< First channel of fixed image
+  const VoxelType *_Source;  ///< First channel of moving image
+  int              _X, _Y;   ///< Size of input images in x and y dimensions
+  int              _I, _J, _K;          ///< First voxel of table region
+  int              _StrideY, _StrideZ;  ///< Strides of table entries
+  Array<Sums>      _Table;              ///< Summed-volume table entries
+
+  // ---------------------------------------------------------------------------
+  /// Compute 2D summed-area tables of each page
+  struct ComputeSliceSums
+  {
+    BoxWindowSums *_This;
+    int            _NumberOfRows;
+    int            _NumberOfCols;
+
+    void operator ()(const blocked_range<int> &re) const
+    {
+      int  idx;
+      Sums row, *p;
+      for (int k = re.begin(); k != re.end(); ++k) {
+        p = _This->_Table.data() + (k + 1) * _This->_StrideZ;
+        for (int j = 0; j < _NumberOfRows; ++j) {
+          p  += _This->_StrideY;
+          idx = _This->_I + _This->_X * ((_This->_J + j) + _This->_Y * (_This->_K + k));
+          row = Sums();
+          for (int i = 1; i <= _NumberOfCols; ++i, ++idx) {
+            const double &t = _This->_Target[idx];
+            const double &s = _This->_Source[idx];
+            row.t  += t;
+            row.s  += s;
+            row.tt += t * t;
+            row.ss += s * s;
+            row.ts += t * s;
+            p[i]  = p[i - _This->_StrideY];
+            p[i] += row;
+          }
+        }
+      }
+    }
+  };
+
+  // ---------------------------------------------------------------------------
+  /// Accumulate summed-area tables of pages along z axis
+  struct AccumulatePageSums
+  {
+    BoxWindowSums *_This;
+    int            _NumberOfPages;
+    int            _NumberOfCols;
+
+    void operator ()(const blocked_range<int> &re) const
+    {
+      Sums *p;
+      for (int j = re.begin(); j != re.end(); ++j) {
+        for (int k = 2; k <= _NumberOfPages; ++k) {
+          p = _This->_Table.data() + k * _This->_StrideZ + (j + 1) * _This->_StrideY;
+          for (int i = 1; i <= _NumberOfCols; ++i) {
+            p[i] += p[i - _This->_StrideZ];
+          }
+        }
+      }
+    }
+  };
+
+public:
+
+  /// Constructor
+  BoxWindowSums(const RegisteredImage *tgt, const RegisteredImage *src)
+  :
+    _Target(tgt->Data()), _Source(src->Data()),
+    _X(tgt->X()), _Y(tgt->Y()),
+    _I(0), _J(0), _K(0), _StrideY(0), _StrideZ(0)
+  {}
+
+  /// Compute summed-volume tables for specified image region
+  void Compute(const blocked_range3d<int> &region)
+  {
+    const int nx = region.cols ().end() - region.cols ().begin();
+    const int ny = region.rows ().end() - region.rows ().begin();
+    const int nz = region.pages().end() - region.pages().begin();
+    _I = region.cols ().begin();
+    _J = region.rows ().begin();
+    _K = region.pages().begin();
+    _StrideY = nx + 1;
+    _StrideZ = _StrideY * (ny + 1);
+    // Zero padding of first row/column of each page and first page
+    _Table.assign(static_cast<size_t>(_StrideZ) * (nz + 1), Sums());
+    // Compute integral image of each page
+    ComputeSliceSums slices;
+    slices._This         = this;
+    slices._NumberOfRows = ny;
+    slices._NumberOfCols = nx;
+    parallel_for(blocked_range<int>(0, nz), slices);
+    // Accumulate integral images of pages
+    if (nz > 1) {
+      AccumulatePageSums pages;
+      pages._This          = this;
+      pages._NumberOfPages = nz;
+      pages._NumberOfCols  = nx;
+      parallel_for(blocked_range<int>(0, ny), pages);
+    }
+  }
+
+  /// Sums of values within box window [i1, i2) x [j1, j2) x [k1, k2)
+  ///
+  /// The window must be contained within the region for which the
+  /// summed-volume tables were last computed.
+  Sums Sum(int i1, int j1, int k1, int i2, int j2, int k2) const
+  {
+    i1 -= _I, i2 -= _I;
+    j1 -= _J, j2 -= _J;
+    k1 -= _K, k2 -= _K;
+    const Sums *p1 = _Table.data() + k1 * _StrideZ;
+    const Sums *p2 = _Table.data() + k2 * _StrideZ;
+    j1 *= _StrideY, j2 *= _StrideY;
+    Sums sum = p2[j2 + i2];
+    sum -= p2[j2 + i1];
+    sum -= p2[j1 + i2];
+    sum += p2[j1 + i1];
+    sum -= p1[j2 + i2];
+    sum += p1[j2 + i1];
+    sum += p1[j1 + i2];
+    sum -= p1[j1 + i1];
+    return sum;
+  }
+};
+
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 struct UpdateBoxWindowLNCC : public VoxelFunction
 {
   NormalizedIntensityCrossCorrelation *_This;
+  const BoxWindowSums                 *_Sums;
 
   // ---------------------------------------------------------------------------
-  UpdateBoxWindowLNCC(NormalizedIntensityCrossCorrelation *_this)
+  UpdateBoxWindowLNCC(NormalizedIntensityCrossCorrelation *_this, const BoxWindowSums *sums)
   :
-    _This(_this)
+    _This(_this), _Sums(sums)
   {}
 
   // ---------------------------------------------------------------------------
   void operator()(int i, int j, int k, int, const VoxelType *tgt, const VoxelType *src,
                   VoxelType *a, VoxelType *b, VoxelType *c, VoxelType *s, VoxelType *t)
   {
-    int    cnt  =  0;
-    double sumt = .0, sums = .0, sumss = .0, sumts = .0, sumtt = .0;
-
     if (_This->IsForeground(i, j, k)) {
       const Vector3D<int> &radius = _This->NeighborhoodRadius();
-      GenericImageIterator<VoxelType> _TargetNeighborhood(_This->Target());
-      GenericImageIterator<VoxelType> _SourceNeighborhood(_This->Source());
-      _TargetNeighborhood.SetNeighborhood(i, j, k, radius._x, radius._y, radius._z);
-      _SourceNeighborhood.SetNeighborhood(i, j, k, radius._x, radius._y, radius._z);
-      _TargetNeighborhood.GoToBegin();
-      _SourceNeighborhood.GoToBegin();
-      while (!_TargetNeighborhood.IsAtEnd()) {
-        sums  += _SourceNeighborhood.Value();
-        sumt  += _TargetNeighborhood.Value();
-        sumss += _SourceNeighborhood.Value() * _SourceNeighborhood.Value();
-        sumts += _TargetNeighborhood.Value() * _SourceNeighborhood.Value();
-        sumtt += _TargetNeighborhood.Value() * _TargetNeighborhood.Value();
-        ++_TargetNeighborhood;
-        ++_SourceNeighborhood;
-        ++cnt;
-      }
-    }
-
-    if (cnt) {
-      const double ms = sums / cnt;
-      const double mt = sumt / cnt;
-      *a = voxel_cast<VoxelType>(sumts - ms * sumt - mt * sums + cnt * ms * mt); // <T, S>
-      *b = voxel_cast<VoxelType>(sumss -       2.0 * ms * sums + cnt * ms * ms); // <S, S>
-      *c = voxel_cast<VoxelType>(sumtt -       2.0 * mt * sumt + cnt * mt * mt); // <T, T>
+      const ImageAttributes &domain = _This->Domain();
+      const int i1 = max(0, i - radius._x), i2 = min(domain._x, i + radius._x + 1);
+      const int j1 = max(0, j - radius._y), j2 = min(domain._y, j + radius._y + 1);
+      const int k1 = max(0, k - radius._z), k2 = min(domain._z, k + radius._z + 1);
+      const int cnt = (i2 - i1) * (j2 - j1) * (k2 - k1);
+      const BoxWindowSums::Sums sum = _Sums->Sum(i1, j1, k1, i2, j2, k2);
+      const double ms = sum.s / cnt;
+      const double mt = sum.t / cnt;
+      double ts = sum.ts - ms * sum.t - mt * sum.s + cnt * ms * mt; // <T, S>
+      double ss = sum.ss -       2.0 * ms * sum.s + cnt * ms * ms; // <S, S>
+      double tt = sum.tt -       2.0 * mt * sum.t + cnt * mt * mt; // <T, T>
+      // Suppress round-off errors of the table differences in regions of
+      // (approximately) constant intensity, i.e., zero local variance
+      const double eps = cnt * 1e-12;
+      if (ss < eps) ss = .0;
+      if (tt < eps) tt = .0;
+      *a = voxel_cast<VoxelType>(ts);
+      *b = voxel_cast<VoxelType>(ss);
+      *c = voxel_cast<VoxelType>(tt);
       *s = voxel_cast<VoxelType>((*src) - ms);
       *t = voxel_cast<VoxelType>((*tgt) - mt);
     } else {
@@ -446,8 +600,8 @@ private:
 // -----------------------------------------------------------------------------
 struct EvaluateBoxWindowLNCCGradient : public VoxelFunction
 {
-  template <class TImage, class T>
-  void operator()(const TImage &, int, const T *a, const T *b, const T *c, const T *s, const T *t, T *g)
+  template <class TImage, class T, class TOut>
+  void operator()(const TImage &, int, const T *a, const T *b, const T *c, const T *s, const T *t, TOut *g)
   {
     (*g) = 2.0 * ((*a) / ((*b) * (*c))) * ((*t) - ((*a) / (*b)) * (*s));
     if (IsNaN(*g) || IsInf(*g)) (*g) = .0;
@@ -539,9 +693,9 @@ NormalizedIntensityCrossCorrelation
 :
   ImageSimilarity(other),
   _KernelType(other._KernelType),
-  _KernelX(other._KernelX ? new RealImage(*other._KernelX) : NULL),
-  _KernelY(other._KernelY ? new RealImage(*other._KernelY) : NULL),
-  _KernelZ(other._KernelZ ? new RealImage(*other._KernelZ) : NULL),
+  _KernelX(other._KernelX ? new KernelImage(*other._KernelX) : NULL),
+  _KernelY(other._KernelY ? new KernelImage(*other._KernelY) : NULL),
+  _KernelZ(other._KernelZ ? new KernelImage(*other._KernelZ) : NULL),
   _A      (other._A       ? new RealImage(*other._A      ) : NULL),
   _B      (other._B       ? new RealImage(*other._B      ) : NULL),
   _C      (other._C       ? new RealImage(*other._C      ) : NULL),
@@ -801,7 +955,7 @@ void NormalizedIntensityCrossCorrelation::ClearKernel()
 }
 
 // -----------------------------------------------------------------------------
-NormalizedIntensityCrossCorrelation::RealImage *
+NormalizedIntensityCrossCorrelation::KernelImage *
 NormalizedIntensityCrossCorrelation::CreateGaussianKernel(double sigma)
 {
   // Ignore sign of standard deviation parameter (negative --> voxel units)
@@ -811,11 +965,11 @@ NormalizedIntensityCrossCorrelation::CreateGaussianKernel(double sigma)
   ScalarGaussian func(sigma, 1, 1, 0, 0, 0);
 
   // Create filter kernel for 1D Gaussian function
-  const int  size   = 2 * static_cast<int>(3.0 * sigma) + 1;
-  RealImage *kernel = new RealImage(size, 1, 1);
+  const int    size   = 2 * static_cast<int>(3.0 * sigma) + 1;
+  KernelImage *kernel = new KernelImage(size, 1, 1);
 
   // Sample scalar function at discrete kernel positions
-  ScalarFunctionToImage<RealType> sampler;
+  ScalarFunctionToImage<RealPixel> sampler;
   sampler.Input (&func);
   sampler.Output(kernel);
   sampler.Run();
@@ -828,16 +982,16 @@ void NormalizedIntensityCrossCorrelation
 ::ComputeWeightedAverage(const blocked_range3d<int> &region, RealImage *image)
 {
   // Average along x axis
-  ConvolveTruncatedForegroundInX<RealType> convX(image, _KernelX->Data(), _KernelX->X());
+  ConvolveTruncatedForegroundInX<RealPixel> convX(image, _KernelX->Data(), _KernelX->X());
   ParallelForEachVoxel(region, image, &_Temp, convX);
 
   // Average along y axis
-  ConvolveTruncatedForegroundInY<RealType> convY(image, _KernelY->Data(), _KernelY->X());
+  ConvolveTruncatedForegroundInY<RealPixel> convY(image, _KernelY->Data(), _KernelY->X());
   ParallelForEachVoxel(region, &_Temp, image, convY);
 
   // Average along z axis
   if (_KernelZ) {
-    ConvolveTruncatedForegroundInZ<RealType> convZ(image, _KernelZ->Data(), _KernelZ->X());
+    ConvolveTruncatedForegroundInZ<RealPixel> convZ(image, _KernelZ->Data(), _KernelZ->X());
     ParallelForEachVoxel(region, image, &_Temp, convZ);
     ParallelForEachVoxel(BinaryVoxelFunction::Copy(), region, &_Temp, image);
   }
@@ -868,6 +1022,26 @@ void NormalizedIntensityCrossCorrelation
   ParallelForEachVoxel(TakeSquareRoot(image), region, sigma);
 }
 
+// -----------------------------------------------------------------------------
+void NormalizedIntensityCrossCorrelation
+::ComputeBoxWindowStatistics(const blocked_range3d<int> &region)
+{
+  // Maximum number of pages processed at once to bound the memory needed
+  // for the summed-volume tables when the entire image domain is updated
+  const int max_slab_size = 16;
+
+  BoxWindowSums sums(_Target, _Source);
+  UpdateBoxWindowLNCC<RealType> update(this, &sums);
+
+  for (int k1 = region.pages().begin(), k2; k1 < region.pages().end(); k1 = k2) {
+    k2 = min(k1 + max_slab_size, region.pages().end());
+    blocked_range3d<int> slab(k1, k2, region.rows ().begin(), region.rows ().end(),
+                                      region.cols ().begin(), region.cols ().end());
+    sums.Compute(ExtendedRegion(slab, _Domain, _NeighborhoodRadius));
+    ParallelForEachVoxel(slab, _Target, _Source, _A, _B, _C, _S, _T, update);
+  }
+}
+
 // -----------------------------------------------------------------------------
 void NormalizedIntensityCrossCorrelation::Initialize()
 {
@@ -961,8 +1135,7 @@ void NormalizedIntensityCrossCorrelation::Update(bool gradient)
   if (_KernelType == BoxWindow) {
 
     // Compute dot products
-    UpdateBoxWindowLNCC<RealType> update(this);
-    ParallelForEachVoxel(domain, _Target, _Source, _A, _B, _C, _S, _T, update);
+    ComputeBoxWindowStatistics(domain);
     // Evaluate LNCC value
     EvaluateBoxWindowLNCC cc;
     ParallelForEachVoxel(domain, _A, _B, _C, cc);
@@ -1031,8 +1204,7 @@ void NormalizedIntensityCrossCorrelation::Include(const blocked_range3d<int> &re
   if (_KernelType == BoxWindow) {
 
     // Compute dot products
-    UpdateBoxWindowLNCC<RealType> update(this);
-    ParallelForEachVoxel(region, _Target, _Source, _A, _B, _C, _S, _T, update);
+    ComputeBoxWindowStatistics(region);
     // Add LNCC values for specified region
     EvaluateBoxWindowLNCC cc;
     ParallelForEachVoxel(region, _A, _B, _C, cc);
@@ -1138,6 +1310,12 @@ bool NormalizedIntensityCrossCorrelation
   return true;
 }
 
+// -----------------------------------------------------------------------------
+bool NormalizedIntensityCrossCorrelation::HasNonParametricGradient() const
+{
+  return true;
+}
+
 // =============================================================================
 // Debugging
 // =============================================================================
@@ -21,6 +21,7 @@
 
 #include <mirtkMath.h>
 #include <mirtkMemory.h>
+#include <mirtkArray.h>
 #include <mirtkBSpline.h>
 #include <mirtkHistogram1D.h>
 #include <mirtkParallel.h>
@@ -167,6 +168,53 @@ bool NormalizedMutualImageInformation
 {
   MIRTK_START_TIMING();
 
+  // Exact derivative of histogram filled using cubic B-spline Parzen windows
+  if (_UseParzenWindow) {
+    const int     nx = _Histogram->NumberOfBinsX();
+    const int     ny = _Histogram->NumberOfBinsY();
+    const double  n  = _Histogram->NumberOfSamples();
+    const double *h  = _Histogram->RawPointer();
+    if (n <= .0) {
+      memset(gradient->Data(), 0, 3 * _NumberOfVoxels * sizeof(GradientType));
+      return true;
+    }
+
+    // Marginal histograms and entropies
+    Array<double> hx(nx, .0), hy(ny, .0);
+    double sx = .0, sy = .0, sxy = .0;
+    for (int j = 0, idx = 0; j < ny; ++j)
+    for (int i = 0; i < nx; ++i, ++idx) {
+      hx[i] += h[idx];
+      hy[j] += h[idx];
+      if (h[idx] > .0) sxy += h[idx] * log(h[idx]);
+    }
+    for (int i = 0; i < nx; ++i) if (hx[i] > .0) sx += hx[i] * log(hx[i]);
+    for (int j = 0; j < ny; ++j) if (hy[j] > .0) sy += hy[j] * log(hy[j]);
+    const double je  = log(n) - sxy / n;
+    const double nmi = (2.0 * log(n) - (sx + sy) / n) / je;
+
+    // Derivatives of 2 - NMI w.r.t. joint histogram bins, where constant
+    // terms cancel out because the Parzen window weights sum up to one
+    const bool wrt_target = (image == Target());
+    Array<double> dh(nx * ny, .0);
+    for (int j = 0, idx = 0; j < ny; ++j)
+    for (int i = 0; i < nx; ++i, ++idx) {
+      if (h[idx] > .0) {
+        const double hm = (wrt_target ? hx[i] : hy[j]);
+        dh[idx] = (log(hm) - nmi * log(h[idx])) / (n * je);
+      }
+    }
+
+    // Evaluate similarity gradient w.r.t given transformed image
+    ParzenWindowGradient(image, dh.data(), gradient);
+
+    // Apply chain rule to obtain gradient w.r.t y = T(x)
+    MultiplyByImageGradient(image, gradient);
+
+    MIRTK_DEBUG_TIMING(2, "similarity gradient computation (NMI)");
+    return true;
+  }
+
   // Swap target and source if similarity derived w.r.t transformed "target"
   RegisteredImage *fixed = Target();
   int tbin = Histogram()->NumberOfBinsX();
@@ -225,5 +273,11 @@ bool NormalizedMutualImageInformation
   return true;
 }
 
+// -----------------------------------------------------------------------------
+bool NormalizedMutualImageInformation::HasNonParametricGradient() const
+{
+  return true;
+}
+
 
 } // namespace
@@ -23,6 +23,7 @@
 #include <mirtkDeallocate.h>
 #include <mirtkParallel.h>
 #include <mirtkProfiling.h>
+#include <mirtkVoxelFunction.h>
 
 
 namespace mirtk {
@@ -35,6 +36,23 @@ namespace mirtk {
 namespace ProbabilisticImageSimilarityUtils {
 
 
+// -----------------------------------------------------------------------------
+/// Add (or remove if weight is negative) cubic B-spline Parzen window sample
+inline void AddParzenWindowSample(ProbabilisticImageSimilarity::JointHistogramType *hist,
+                                  double tgt, double src, double weight = 1.0)
+{
+  int    i[4], j[4];
+  double wi[4], wj[4];
+  ProbabilisticImageSimilarity::ParzenWindow(tgt, hist->MinX(), hist->WidthX(), hist->NumberOfBinsX(), i, wi);
+  ProbabilisticImageSimilarity::ParzenWindow(src, hist->MinY(), hist->WidthY(), hist->NumberOfBinsY(), j, wj);
+  for (int b = 0; b < 4; ++b) {
+    const double w = weight * wj[b];
+    for (int a = 0; a < 4; ++a) (*hist)(i[a], j[b]) += w * wi[a];
+  }
+  hist->NumberOfSamples(hist->NumberOfSamples() + weight);
+}
+
+
 // -----------------------------------------------------------------------------
 /// Add samples to joint histogram (no rescaling required)
 class FillHistogram
@@ -85,14 +103,69 @@ public:
   {
     const RegisteredImage::VoxelType *tgt = _Similarity->Target()->Data(re.begin());
     const RegisteredImage::VoxelType *src = _Similarity->Source()->Data(re.begin());
-    for (int idx = re.begin(); idx != re.end(); ++idx, ++tgt, ++src) {
-      if (_Similarity->IsForeground(idx)) {
-        _Histogram->Add(_Histogram->ValToBinX(*tgt), _Histogram->ValToBinY(*src));
+    if (_Similarity->UseParzenWindow()) {
+      for (int idx = re.begin(); idx != re.end(); ++idx, ++tgt, ++src) {
+        if (_Similarity->IsForeground(idx)) {
+          AddParzenWindowSample(_Histogram, *tgt, *src);
+        }
+      }
+    } else {
+      for (int idx = re.begin(); idx != re.end(); ++idx, ++tgt, ++src) {
+        if (_Similarity->IsForeground(idx)) {
+          _Histogram->Add(_Histogram->ValToBinX(*tgt), _Histogram->ValToBinY(*src));
+        }
       }
     }
   }
 };
 
+// -----------------------------------------------------------------------------
+/// Apply chain rule to derivatives of similarity w.r.t. joint histogram bins
+class EvaluateParzenWindowGradient : public VoxelFunction
+{
+  typedef ProbabilisticImageSimilarity::JointHistogramType JointHistogramType;
+  typedef ProbabilisticImageSimilarity::GradientType       GradientType;
+
+  const ProbabilisticImageSimilarity *_Similarity;
+  const JointHistogramType           *_Histogram;
+  const double                       *_Derivatives;
+  bool                                _WrtTarget;
+
+public:
+
+  EvaluateParzenWindowGradient(const ProbabilisticImageSimilarity *sim,
+                               const JointHistogramType           *hist,
+                               const double                       *dh,
+                               bool                                wrt_target)
+  :
+    _Similarity(sim), _Histogram(hist), _Derivatives(dh), _WrtTarget(wrt_target)
+  {}
+
+  template <class TIntensity>
+  void operator ()(int i1, int j1, int k1, int, const TIntensity *tgt, const TIntensity *src, GradientType *deriv)
+  {
+    if (_Similarity->IsForeground(i1, j1, k1)) {
+      const int nx = _Histogram->NumberOfBinsX();
+      int    i[4], j[4];
+      double wi[4], wj[4], dwi[4], dwj[4];
+      ProbabilisticImageSimilarity::ParzenWindow(*tgt, _Histogram->MinX(), _Histogram->WidthX(), nx, i, wi, dwi);
+      ProbabilisticImageSimilarity::ParzenWindow(*src, _Histogram->MinY(), _Histogram->WidthY(), _Histogram->NumberOfBinsY(), j, wj, dwj);
+      const double *wx = (_WrtTarget ? dwi : wi);
+      const double *wy = (_WrtTarget ? wj  : dwj);
+      double g = .0;
+      for (int b = 0; b < 4; ++b) {
+        const double *dh = _Derivatives + j[b] * nx;
+        double gx = .0;
+        for (int a = 0; a < 4; ++a) gx += wx[a] * dh[i[a]];
+        g += wy[b] * gx;
+      }
+      *deriv = static_cast<GradientType>(g);
+    } else {
+      *deriv = GradientType(0);
+    }
+  }
+};
+
 
 } // namespace ProbabilisticImageSimilarityUtils
 using namespace ProbabilisticImageSimilarityUtils;
@@ -108,7 +181,8 @@ ProbabilisticImageSimilarity::ProbabilisticImageSimilarity(const char *name, dou
   _Samples           (NULL),
   _Histogram         (NULL),
   _NumberOfTargetBins(0),
-  _NumberOfSourceBins(0)
+  _NumberOfSourceBins(0),
+  _UseParzenWindow   (false)
 {
 }
 
@@ -119,7 +193,8 @@ ProbabilisticImageSimilarity::ProbabilisticImageSimilarity(const ProbabilisticIm
   _Samples           (other._Samples   ? new JointHistogramType(*other._Samples)   : NULL),
   _Histogram         (other._Histogram ? new JointHistogramType(*other._Histogram) : NULL),
   _NumberOfTargetBins(other._NumberOfTargetBins),
-  _NumberOfSourceBins(other._NumberOfSourceBins)
+  _NumberOfSourceBins(other._NumberOfSourceBins),
+  _UseParzenWindow   (other._UseParzenWindow)
 {
 }
 
@@ -131,6 +206,7 @@ ProbabilisticImageSimilarity &ProbabilisticImageSimilarity::operator =(const Pro
   _Histogram          = other._Histogram ? new JointHistogramType(*other._Histogram) : NULL;
   _NumberOfTargetBins = other._NumberOfTargetBins;
   _NumberOfSourceBins = other._NumberOfSourceBins;
+  _UseParzenWindow    = other._UseParzenWindow;
   return *this;
 }
 
@@ -159,6 +235,9 @@ bool ProbabilisticImageSimilarity::SetWithPrefix(const char *param, const char *
   if (strcmp(param, "No. of source bins") == 0) {
     return FromString(value, _NumberOfSourceBins) && _NumberOfSourceBins > 0;
   }
+  if (strcmp(param, "Parzen window") == 0) {
+    return FromString(value, _UseParzenWindow);
+  }
   return ImageSimilarity::SetWithPrefix(param, value);
 }
 
@@ -172,6 +251,7 @@ ParameterList ProbabilisticImageSimilarity::Parameter() const
     Insert(params, "No. of target bins", _NumberOfTargetBins);
     Insert(params, "No. of source bins", _NumberOfSourceBins);
   }
+  Insert(params, "Parzen window", _UseParzenWindow);
   return params;
 }
 
@@ -255,13 +335,13 @@ void ProbabilisticImageSimilarity::Update(bool gradient)
   FillHistogram add(this, _Samples);
   parallel_reduce(voxels, add);
 
-  // Smooth histogram
+  // Smooth histogram unless samples were added using Parzen windows
   //
   // Note that the _Samples cannot be smoothed directly because of the
   // Include/Exclude functions needed for the (optional) finite difference
   // approximation of the gradient.
   _Histogram->Reset(*_Samples);
-  _Histogram->Smooth();
+  if (!_UseParzenWindow) _Histogram->Smooth();
 
   MIRTK_DEBUG_TIMING(2, "update of joint histogram");
 }
@@ -273,8 +353,12 @@ void ProbabilisticImageSimilarity::Exclude(const blocked_range3d<int> &region)
   for (int j = region.rows ().begin(); j < region.rows ().end(); ++j)
   for (int i = region.cols ().begin(); i < region.cols ().end(); ++i) {
     if (IsForeground(i, j, k)) {
-      _Samples->Delete(_Samples->ValToBinX(_Target->Get(i, j, k)),
-                       _Samples->ValToBinY(_Source->Get(i, j, k)));
+      if (_UseParzenWindow) {
+        AddParzenWindowSample(_Samples, _Target->Get(i, j, k), _Source->Get(i, j, k), -1.0);
+      } else {
+        _Samples->Delete(_Samples->ValToBinX(_Target->Get(i, j, k)),
+                         _Samples->ValToBinY(_Source->Get(i, j, k)));
+      }
     }
   }
 }
@@ -287,17 +371,30 @@ void ProbabilisticImageSimilarity::Include(const blocked_range3d<int> &region)
   for (int j = region.rows ().begin(); j < region.rows ().end(); ++j)
   for (int i = region.cols ().begin(); i < region.cols ().end(); ++i) {
     if (IsForeground(i, j, k)) {
-      _Samples->Add(_Samples->ValToBinX(_Target->Get(i, j, k)),
-                    _Samples->ValToBinY(_Source->Get(i, j, k)));
+      if (_UseParzenWindow) {
+        AddParzenWindowSample(_Samples, _Target->Get(i, j, k), _Source->Get(i, j, k));
+      } else {
+        _Samples->Add(_Samples->ValToBinX(_Target->Get(i, j, k)),
+                      _Samples->ValToBinY(_Source->Get(i, j, k)));
+      }
       changed = true;
     }
   }
   if (changed) {
     _Histogram->Reset(*_Samples);
-    _Histogram->Smooth();
+    if (!_UseParzenWindow) _Histogram->Smooth();
   }
 }
 
+// -----------------------------------------------------------------------------
+void ProbabilisticImageSimilarity
+::ParzenWindowGradient(const RegisteredImage *image, const double *dh,
+                       GradientImageType *gradient) const
+{
+  EvaluateParzenWindowGradient eval(this, _Histogram, dh, image == Target());
+  ParallelForEachVoxel(_Domain, Target(), Source(), gradient, eval);
+}
+
 // =============================================================================
 // Debugging
 // =============================================================================
@@ -142,6 +142,135 @@ public:
   }
 };
 
+// -----------------------------------------------------------------------------
+/// Update energy terms with non-zero weight
+class UpdateEnergyTerms
+{
+private:
+
+  const Array<EnergyTerm *> &_Term;
+  bool                       _Gradient;
+
+public:
+
+  /// Constructor
+  UpdateEnergyTerms(const Array<EnergyTerm *> &terms, bool gradient)
+  :
+    _Term(terms), _Gradient(gradient)
+  {}
+
+  /// Update energy terms, each range element being a separate task
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      if (_Term[i]->Weight() != .0) {
+        _Term[i]->Update(_Gradient);
+        _Term[i]->ResetValue(); // in case energy term does not do this
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Evaluate values of energy terms with non-zero weight
+class EvaluateEnergyTerms
+{
+private:
+
+  const Array<EnergyTerm *> &_Term;
+  double                    *_Value;
+
+public:
+
+  /// Constructor
+  EvaluateEnergyTerms(const Array<EnergyTerm *> &terms, double *value)
+  :
+    _Term(terms), _Value(value)
+  {}
+
+  /// Evaluate energy terms, each range element being a separate task
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      _Value[i] = (_Term[i]->Weight() != .0 ? _Term[i]->Value() : .0);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Evaluate gradients of energy terms, each into its own gradient vector
+class EvaluateEnergyTermGradients
+{
+private:
+
+  const Array<EnergyTerm *> &_Term;
+  const Array<double *>     &_Gradient; ///< NULL for terms which are skipped
+  double                     _Step;
+  double                     _Sum;      ///< Sum of weights used for normalization
+
+public:
+
+  /// Constructor
+  ///
+  /// \param[in] terms    Energy terms.
+  /// \param[in] gradient Zero-initialized gradient vector of each energy term.
+  /// \param[in] step     Step length for finite differences.
+  /// \param[in] sum      Sum of energy term weights when normalized energy term
+  ///                     gradients are requested and zero otherwise.
+  EvaluateEnergyTermGradients(const Array<EnergyTerm *> &terms,
+                              const Array<double *>     &gradient,
+                              double step, double sum)
+  :
+    _Term(terms), _Gradient(gradient), _Step(step), _Sum(sum)
+  {}
+
+  /// Evaluate gradients, each range element being a separate task
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      if (_Gradient[i] == NULL) continue;
+      if (_Sum > .0) {
+        const double w = _Term[i]->Weight();
+        _Term[i]->Weight(w / _Sum);
+        _Term[i]->NormalizedGradient(_Gradient[i], _Step);
+        _Term[i]->Weight(w);
+      } else {
+        _Term[i]->Gradient(_Gradient[i], _Step);
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Add gradients of energy terms in the order of the terms
+class SumEnergyTermGradients
+{
+private:
+
+  const Array<double *> &_Gradient;
+  double                *_Sum;
+
+public:
+
+  /// Constructor
+  SumEnergyTermGradients(const Array<double *> &gradient, double *sum)
+  :
+    _Gradient(gradient), _Sum(sum)
+  {}
+
+  /// Add energy term gradients w.r.t. specified range of parameters
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (size_t i = 0; i < _Gradient.size(); ++i) {
+      const double *g = _Gradient[i];
+      if (g == NULL || g == _Sum) continue;
+      for (int dof = re.begin(); dof != re.end(); ++dof) {
+        _Sum[dof] += g[dof];
+      }
+    }
+  }
+};
+
 // =============================================================================
 // Construction/Destruction
 // =============================================================================
@@ -151,7 +280,8 @@ RegistrationEnergy::RegistrationEnergy()
 :
   _Transformation    (NULL),
   _NormalizeGradients(false),
-  _Preconditioning   (.0)
+  _Preconditioning   (.0),
+  _ParallelTerms     (true)
 {
   // Bind broadcast method to energy term events
   _EventDelegate.Bind(LogEvent, MakeDelegate(this, &Observable::Broadcast));
@@ -282,6 +412,22 @@ EnergyTerm *RegistrationEnergy::Term(int i)
   return _Term[i];
 }
 
+// -----------------------------------------------------------------------------
+bool RegistrationEnergy::ConcurrentTerms() const
+{
+  if (!_ParallelTerms || !_Transformation) return false;
+  if (_Transformation->RequiresCachingOfDisplacements()) return false;
+  if (NumberOfActiveTerms() < 2) return false;
+  // Terms which perturb the shared transformation, e.g., to approximate
+  // their gradient using finite differences, are not independent
+  for (size_t i = 0; i < _Term.size(); ++i) {
+    if (_Term[i]->Weight() != .0 && _Term[i]->ModifiesTransformation()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // =============================================================================
 // Parameters
 // =============================================================================
@@ -295,6 +441,10 @@ bool RegistrationEnergy::Set(const char *name, const char *value)
   } else if (strcmp(name, "Energy preconditioning") == 0) {
     return FromString(value, _Preconditioning);
   }
+  // Concurrent evaluation of energy terms
+  if (strcmp(name, "Parallel evaluation of energy terms") == 0) {
+    return FromString(value, _ParallelTerms);
+  }
   // Default length of gradient approximation steps
   if (strcmp(name, "Length of steps")         == 0 ||
       strcmp(name, "Maximum length of steps") == 0) {
@@ -317,6 +467,7 @@ ParameterList RegistrationEnergy::Parameter() const
   }
   Insert(params, "Normalize energy gradients (experimental)", ToString(_NormalizeGradients));
   Insert(params, "Energy preconditioning",                    ToString(_Preconditioning));
+  Insert(params, "Parallel evaluation of energy terms",       ToString(_ParallelTerms));
   return params;
 }
 
@@ -349,23 +500,22 @@ void RegistrationEnergy::Update(bool gradient)
   // all together instead of each individually which involves duplicate inside
   // interpolation domain checks and coordinate transformations.
   //
-  // Another way to make this more efficient could be to cache the transformed
-  // voxel coordinates, i.e., for each output voxel the coordinate of the
-  // respective input coordinate or NaN if outside the interpolation domain.
-  // This cache should then be only updated once. However, how can you tell
-  // which of the propagated RegisteredImage::Update calls is the first and
-  // thus has to update the cache? This requires some modification and update
-  // time stamps as they are used by the ITK pipeline. It probably is simpler
-  // to just use an external update handler which has a reference to all the
-  // input moving images and updates them all at once in predefined order.
+  // Otherwise, the registered images can share a cache of transformed voxel
+  // coordinates, i.e., for each output voxel the respective input coordinate
+  // or NaN if outside the interpolation domain (see TransformedCoordinates).
+  // This cache is versioned by the modification time stamp of the
+  // transformation, such that whichever of the propagated RegisteredImage::Update
+  // calls comes first updates the cache and the others only interpolate.
+  //
+  // The terms are independent of each other and are thus updated as concurrent
+  // tasks when possible, such that small terms such as point set distances
+  // are executed alongside of the image similarity terms.
   if (_Transformation->Changed() || gradient) {
     MIRTK_START_TIMING();
-    for (size_t i = 0; i < _Term.size(); ++i) {
-      if (_Term[i]->Weight() != .0) {
-        _Term[i]->Update(gradient);
-        _Term[i]->ResetValue(); // in case energy term does not do this
-      }
-    }
+    const int nterms = static_cast<int>(_Term.size());
+    UpdateEnergyTerms update(_Term, gradient);
+    if (ConcurrentTerms()) parallel_for(blocked_range<int>(0, nterms, 1), update);
+    else                   update(blocked_range<int>(0, nterms));
     // Mark transformation as unchanged
     _Transformation->Changed(false);
     MIRTK_DEBUG_TIMING(3, "update of energy function");
@@ -466,16 +616,24 @@ double RegistrationEnergy::Value()
 {
   MIRTK_START_TIMING();
 
-  double value, sum = .0;
-  for (size_t i = 0; i < _Term.size(); ++i) {
-    value = (_Term[i]->Weight() != .0 ? _Term[i]->Value() : .0);
-    if (IsNaN(value)) {
+  const int nterms = static_cast<int>(_Term.size());
+  Array<double> value(nterms, .0);
+  if (nterms > 0) {
+    EvaluateEnergyTerms eval(_Term, &value[0]);
+    if (ConcurrentTerms()) parallel_for(blocked_range<int>(0, nterms, 1), eval);
+    else                   eval(blocked_range<int>(0, nterms));
+  }
+
+  // Sum values in fixed order of terms
+  double sum = .0;
+  for (int i = 0; i < nterms; ++i) {
+    if (IsNaN(value[i])) {
       string name = _Term[i]->Name();
       if (name.empty()) name = ToString(i + 1);
       cerr << "RegistrationEnergy::Value: Value of term " << name << " is NaN!" << endl;
       exit(1);
     }
-    sum += value;
+    sum += value[i];
   }
 
   MIRTK_DEBUG_TIMING(3, "evaluation of energy function");
@@ -552,8 +710,13 @@ void RegistrationEnergy::Gradient(double *gradient, double step, bool *sgn_chg)
   // excl. sparsity constraint which has to be added last,
   // such that it can determine whether or not the sparsity
   // gradient changes the sign of the energy gradient.
+  //
+  // When the terms are evaluated concurrently, each term computes its gradient
+  // in a private zero-initialized vector, except for the first term which
+  // writes directly to the output gradient. These vectors are added up in
+  // the order of the terms afterwards.
+  double W = .0;
   if (_NormalizeGradients) {
-    double w, W = .0;
     for (size_t i = 0; i < _Term.size(); ++i) {
       sparsity = dynamic_cast<SparsityConstraint *>(_Term[i]);
       if (sparsity) continue;
@@ -563,23 +726,34 @@ void RegistrationEnergy::Gradient(double *gradient, double step, bool *sgn_chg)
       cerr << "RegistrationEnergy::Gradient: All energy terms have zero weight!" << endl;
       exit(1);
     }
-    for (size_t i = 0; i < _Term.size(); ++i) {
-      w = _Term[i]->Weight();
-      if (w != .0) {
-        sparsity = dynamic_cast<SparsityConstraint *>(_Term[i]);
-        if (sparsity) continue;
-        _Term[i]->Weight(w / W);
-        _Term[i]->NormalizedGradient(gradient, step);
-        _Term[i]->Weight(w);
-      }
+  }
+
+  const int  nterms     = static_cast<int>(_Term.size());
+  const bool concurrent = ConcurrentTerms();
+  Array<double *> term_gradient(nterms, NULL);
+  bool            first = true;
+  for (int i = 0; i < nterms; ++i) {
+    if (_Term[i]->Weight() != .0) {
+      sparsity = dynamic_cast<SparsityConstraint *>(_Term[i]);
+      if (sparsity) continue;
+      if (concurrent && !first) term_gradient[i] = CAllocate<double>(ndofs);
+      else                      term_gradient[i] = gradient;
+      first = false;
     }
-  } else {
-    for (size_t i = 0; i < _Term.size(); ++i) {
-      if (_Term[i]->Weight() != .0) {
-        sparsity = dynamic_cast<SparsityConstraint *>(_Term[i]);
-        if (sparsity) continue;
-        _Term[i]->Gradient(gradient, step);
+  }
+  if (nterms > 0) {
+    EvaluateEnergyTermGradients eval(_Term, term_gradient, step, W);
+    if (concurrent) {
+      parallel_for(blocked_range<int>(0, nterms, 1), eval);
+      SumEnergyTermGradients sum(term_gradient, gradient);
+      parallel_for(blocked_range<int>(0, ndofs), sum);
+      for (int i = 0; i < nterms; ++i) {
+        if (term_gradient[i] && term_gradient[i] != gradient) {
+          Deallocate(term_gradient[i]);
+        }
       }
+    } else {
+      eval(blocked_range<int>(0, nterms));
     }
   }
 
@@ -205,5 +205,11 @@ bool SumOfSquaredIntensityDifferences
   return true;
 }
 
+// -----------------------------------------------------------------------------
+bool SumOfSquaredIntensityDifferences::HasNonParametricGradient() const
+{
+  return true;
+}
+
 
 } // namespace mirtk
@@ -0,0 +1,193 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mirtkMath.h>
+#include <mirtkMemory.h>
+#include <mirtkAffineTransformation.h>
+#include <mirtkRegisteredPointSet.h>
+#include <mirtkCurrentsDistance.h>
+
+#include <vtkSmartPointer.h>
+#include <vtkPoints.h>
+#include <vtkCellArray.h>
+#include <vtkPolyData.h>
+
+using namespace mirtk;
+
+
+// ===========================================================================
+// Helper
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Triangulated height field surface of n x n points with unit spacing
+vtkSmartPointer<vtkPolyData> MakeSurface(int n, double phase)
+{
+  vtkSmartPointer<vtkPoints>    points = vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkCellArray> polys  = vtkSmartPointer<vtkCellArray>::New();
+  for (int j = 0; j < n; ++j)
+  for (int i = 0; i < n; ++i) {
+    points->InsertNextPoint(i, j, 2.0 * sin(.4 * i + phase) * cos(.3 * j));
+  }
+  vtkIdType tri[3];
+  for (int j = 0; j < n - 1; ++j)
+  for (int i = 0; i < n - 1; ++i) {
+    const vtkIdType p = i + j * n;
+    tri[0] = p, tri[1] = p + 1, tri[2] = p + n + 1;
+    polys->InsertNextCell(3, tri);
+    tri[0] = p, tri[1] = p + n + 1, tri[2] = p + n;
+    polys->InsertNextCell(3, tri);
+  }
+  vtkSmartPointer<vtkPolyData> surface = vtkSmartPointer<vtkPolyData>::New();
+  surface->SetPoints(points);
+  surface->SetPolys(polys);
+  return surface;
+}
+
+// ---------------------------------------------------------------------------
+/// Evaluate currents distance between two surfaces and its gradient w.r.t.
+/// the parameters of the affine transformation of the source surface
+double EvaluateCurrentsDistance(CurrentsDistance::KernelSumMethod method,
+                                double spacing, double eps, double tx,
+                                double *gradient = NULL)
+{
+  vtkSmartPointer<vtkPolyData> target_surface = MakeSurface(15, .0);
+  vtkSmartPointer<vtkPolyData> source_surface = MakeSurface(15, .8);
+  AffineTransformation T;
+  T.PutTranslationX(tx);
+  T.PutRotationZ(4.0);
+  T.PutScaleY(105.0);
+  RegisteredPointSet target(target_surface);
+  RegisteredPointSet source(source_surface, &T);
+  target.Initialize();
+  source.Initialize();
+
+  CurrentsDistance dist;
+  dist.Target(&target);
+  dist.Source(&source);
+  dist.Transformation(&T);
+  dist.Sigma(2.0);
+  dist.KernelSum(method);
+  dist.GridSpacing(spacing);
+  dist.FGTError(eps);
+  dist.Initialize();
+  dist.Update(true);
+  const double value = dist.Value();
+  if (gradient) {
+    memset(gradient, 0, T.NumberOfDOFs() * sizeof(double));
+    dist.Gradient(gradient, 1.0);
+  }
+  return value;
+}
+
+// ---------------------------------------------------------------------------
+/// Compare approximate kernel sums to direct summation
+void CompareToDirect(CurrentsDistance::KernelSumMethod method,
+                     double spacing, double eps, double tol)
+{
+  const int ndofs = AffineTransformation().NumberOfDOFs();
+  double *expected = Allocate<double>(ndofs);
+  double *gradient = Allocate<double>(ndofs);
+
+  // Value of distance without overlap of the surfaces, i.e., the sum of their
+  // squared norms, used to scale the tolerance of the approximation error
+  const double scale = EvaluateCurrentsDistance(CurrentsDistance::KS_Direct, .5, 1e-3, 100.0);
+  ASSERT_GT(scale, .0);
+
+  const double direct = EvaluateCurrentsDistance(CurrentsDistance::KS_Direct, .5, 1e-3, .5, expected);
+  const double value  = EvaluateCurrentsDistance(method, spacing, eps, .5, gradient);
+  EXPECT_NEAR(value, direct, tol * scale);
+
+  double norm = .0, error = .0;
+  for (int dof = 0; dof < ndofs; ++dof) {
+    norm  += expected[dof] * expected[dof];
+    error += pow(gradient[dof] - expected[dof], 2);
+  }
+  ASSERT_GT(norm, .0);
+  EXPECT_LE(sqrt(error), 5.0 * tol * sqrt(norm));
+
+  Deallocate(expected);
+  Deallocate(gradient);
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(CurrentsDistance, GridKernelSum)
+{
+  CompareToDirect(CurrentsDistance::KS_Grid, .25, 1e-3, .02);
+}
+
+// ---------------------------------------------------------------------------
+TEST(CurrentsDistance, FastGaussTransform)
+{
+  CompareToDirect(CurrentsDistance::KS_FGT, .5, 1e-5, 2e-3);
+}
+
+// ---------------------------------------------------------------------------
+TEST(CurrentsDistance, GridKernelSumFallback)
+{
+  // Lattice with this spacing exceeds the maximum number of nodes,
+  // such that the fast Gauss transform is used instead
+  CompareToDirect(CurrentsDistance::KS_Grid, 1e-3, 1e-5, 2e-3);
+}
+
+// ---------------------------------------------------------------------------
+TEST(CurrentsDistance, DirectLocatorUpdate)
+{
+  vtkSmartPointer<vtkPolyData> target_surface = MakeSurface(15, .0);
+  vtkSmartPointer<vtkPolyData> source_surface = MakeSurface(15, .8);
+  AffineTransformation T;
+  RegisteredPointSet target(target_surface);
+  RegisteredPointSet source(source_surface, &T);
+  target.Initialize();
+  source.Initialize();
+
+  CurrentsDistance dist;
+  dist.Target(&target);
+  dist.Source(&source);
+  dist.Transformation(&T);
+  dist.Sigma(2.0);
+  dist.Initialize();
+  dist.Update(true);
+  dist.Value();
+
+  // Point locator of moving current must be rebuilt upon update
+  T.PutTranslationX(.5);
+  T.PutRotationZ(4.0);
+  T.PutScaleY(105.0);
+  dist.Update(true);
+  dist.ResetValue();
+  EXPECT_DOUBLE_EQ(dist.Value(), EvaluateCurrentsDistance(CurrentsDistance::KS_Direct, .5, 1e-3, .5));
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,175 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mirtkMath.h>
+#include <mirtkGenericImage.h>
+#include <mirtkBSplineFreeFormTransformation3D.h>
+#include <mirtkMultiLevelFreeFormTransformation.h>
+
+using namespace mirtk;
+
+
+// ===========================================================================
+// Helper
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Compare voxel driven to control point driven parametric gradient
+void compare_parametric_gradient(const BSplineFreeFormTransformation3D &ffd,
+                                 const GenericImage<double>  &gradient,
+                                 const WorldCoordsImage      *i2w,
+                                 const WorldCoordsImage      *wc)
+{
+  const int n = ffd.NumberOfDOFs();
+  double *expected = CAllocate<double>(n);
+  double *result   = CAllocate<double>(n);
+  ffd.FreeFormTransformation3D::ParametricGradient(&gradient, expected, i2w, wc, -1, .5);
+  ffd.ParametricGradient(&gradient, result, i2w, wc, -1, .5);
+  double max_abs = .0;
+  for (int dof = 0; dof < n; ++dof) max_abs = max(max_abs, abs(expected[dof]));
+  ASSERT_GT(max_abs, .0);
+  for (int dof = 0; dof < n; ++dof) {
+    EXPECT_NEAR(expected[dof], result[dof], 1e-9 * max_abs);
+  }
+  Deallocate(expected);
+  Deallocate(result);
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(BSplineFreeFormTransformation3D, ParametricGradient)
+{
+  ImageAttributes attr;
+  attr._x  = 31,  attr._y  = 27,  attr._z  = 22;
+  attr._dx = 1.0, attr._dy = 1.2, attr._dz = 1.5;
+
+  // Non-parametric gradient with some invalid (zero) voxels
+  GenericImage<double> gradient(attr, 3);
+  for (int k = 0; k < attr._z; ++k)
+  for (int j = 0; j < attr._y; ++j)
+  for (int i = 0; i < attr._x; ++i) {
+    if ((i + 2 * j + 3 * k) % 11 == 0) continue;
+    gradient(i, j, k, 0) = sin(.3 * i) * cos(.2 * j);
+    gradient(i, j, k, 1) = cos(.1 * i + .4 * k);
+    gradient(i, j, k, 2) = sin(.25 * j) - .3 * cos(.5 * k);
+  }
+
+  // FFD with control point spacing not aligned with voxel grid and passive DoFs
+  BSplineFreeFormTransformation3D ffd(attr, 2.5, 2.5, 2.5);
+  for (int cp = 0; cp < ffd.NumberOfCPs(); cp += 7) {
+    ffd.PutStatus(cp, FreeFormTransformation::CPStatus(Active, Passive, Active));
+  }
+
+  // Pre-computed voxel coordinates and transformed world coordinates
+  WorldCoordsImage i2w, wc;
+  gradient.ImageToWorld(i2w);
+  wc = i2w;
+  for (int k = 0; k < attr._z; ++k)
+  for (int j = 0; j < attr._y; ++j)
+  for (int i = 0; i < attr._x; ++i) {
+    wc(i, j, k, 0) += .8 * sin(.2 * j);
+    wc(i, j, k, 1) -= .5 * cos(.3 * k);
+    wc(i, j, k, 2) += .6 * sin(.1 * i);
+  }
+
+  compare_parametric_gradient(ffd, gradient, NULL, NULL);
+  compare_parametric_gradient(ffd, gradient, &i2w, NULL);
+  compare_parametric_gradient(ffd, gradient, &i2w, &wc);
+}
+
+// ---------------------------------------------------------------------------
+TEST(MultiLevelFreeFormTransformation, Compile)
+{
+  ImageAttributes attr;
+  attr._x  = 49,  attr._y  = 31,  attr._z  = 17;
+  attr._dx = 1.0, attr._dy = 1.2, attr._dz = 1.5;
+
+  // Levels with nested control point lattices and global affine component,
+  // where the extent of the image domain is a multiple of the coarsest spacing
+  MultiLevelFreeFormTransformation mffd;
+  mffd.GetGlobalTransformation()->PutTranslationX(2.5);
+  mffd.GetGlobalTransformation()->PutRotationZ(5.0);
+  mffd.GetGlobalTransformation()->PutScaleY(105.0);
+  mffd.GetGlobalTransformation()->PutShearXY(.1);
+  for (int l = 0; l < 3; ++l) {
+    const double ds = 12.0 / pow(2.0, l);
+    BSplineFreeFormTransformation3D *ffd = new BSplineFreeFormTransformation3D(attr, ds, ds, ds);
+    for (int dof = 0; dof < ffd->NumberOfDOFs(); ++dof) {
+      ffd->Put(dof, sin(.7 * dof + l) / (l + 1));
+    }
+    mffd.PushLocalTransformation(ffd);
+  }
+
+  // Compiled transformation with single local transformation
+  MultiLevelFreeFormTransformation compiled(mffd);
+  ASSERT_TRUE(compiled.CompileLocalTransformation());
+  ASSERT_EQ(1, compiled.NumberOfLevels());
+
+  // Single FFD with global component folded into the coefficients
+  BSplineFreeFormTransformation3D *folded = mffd.Compile(true);
+  ASSERT_TRUE(folded != NULL);
+
+  // Compare at points inside and outside the image domain, where the tolerance
+  // accounts for the lookup table used to evaluate the cubic B-spline kernel
+  const double tol = 1e-3;
+  double x1, y1, z1, x2, y2, z2;
+  for (int k = -10; k < attr._z + 10; k += 3)
+  for (int j = -10; j < attr._y + 10; j += 3)
+  for (int i = -10; i < attr._x + 10; i += 3) {
+    x1 = i + .3, y1 = j - .2, z1 = k + .1;
+    attr.LatticeToWorld(x1, y1, z1);
+    x2 = x1, y2 = y1, z2 = z1;
+    mffd    .Transform(x1, y1, z1);
+    compiled.Transform(x2, y2, z2);
+    EXPECT_NEAR(x1, x2, tol);
+    EXPECT_NEAR(y1, y2, tol);
+    EXPECT_NEAR(z1, z2, tol);
+    if (0 <= i && i < attr._x && 0 <= j && j < attr._y && 0 <= k && k < attr._z) {
+      x2 = i + .3, y2 = j - .2, z2 = k + .1;
+      attr.LatticeToWorld(x2, y2, z2);
+      folded->Transform(x2, y2, z2);
+      EXPECT_NEAR(x1, x2, tol);
+      EXPECT_NEAR(y1, y2, tol);
+      EXPECT_NEAR(z1, z2, tol);
+    }
+  }
+  delete folded;
+
+  // Levels whose control points do not coincide cannot be compiled
+  mffd.PushLocalTransformation(new BSplineFreeFormTransformation3D(attr, 5.0, 5.0, 5.0));
+  EXPECT_TRUE(mffd.Compile() == NULL);
+  EXPECT_FALSE(mffd.CompileLocalTransformation());
+  EXPECT_EQ(4, mffd.NumberOfLevels());
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
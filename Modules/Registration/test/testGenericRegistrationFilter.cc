@@ -0,0 +1,138 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mirtkMath.h>
+#include <mirtkGenericImage.h>
+#include <mirtkTransformation.h>
+#include <mirtkRegisteredImage.h>
+#include <mirtkGenericRegistrationFilter.h>
+
+using namespace mirtk;
+
+
+// ===========================================================================
+// Helper
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Translation of source image pattern relative to the target image in mm
+static const double shift[3] = { 1.5, -1.0, .5 };
+
+// ---------------------------------------------------------------------------
+/// Smooth intensity pattern in world coordinates
+double pattern(double x, double y, double z)
+{
+  return 100.0 * sin(.25 * x) * cos(.2 * y) * cos(.15 * z) + 2.0 * x;
+}
+
+// ---------------------------------------------------------------------------
+/// Fill image with smooth intensity pattern translated by the given offset
+void fill_pattern(GenericImage<double> &image, double tx, double ty, double tz)
+{
+  double x, y, z;
+  for (int k = 0; k < image.Z(); ++k)
+  for (int j = 0; j < image.Y(); ++j)
+  for (int i = 0; i < image.X(); ++i) {
+    x = i, y = j, z = k;
+    image.ImageToWorld(x, y, z);
+    image(i, j, k) = pattern(x - tx, y - ty, z - tz);
+  }
+}
+
+// ---------------------------------------------------------------------------
+/// Sum of squared differences between the target image and the analytic
+/// source pattern transformed by the given transformation, evaluated in
+/// double precision within the inner region of the target image domain
+double final_ssd(const GenericImage<double> &target, const Transformation *T)
+{
+  const int margin = 4;
+  double x, y, z, d, ssd = .0;
+  for (int k = margin; k < target.Z() - margin; ++k)
+  for (int j = margin; j < target.Y() - margin; ++j)
+  for (int i = margin; i < target.X() - margin; ++i) {
+    x = i, y = j, z = k;
+    target.ImageToWorld(x, y, z);
+    if (T) T->Transform(x, y, z);
+    d    = target(i, j, k) - pattern(x - shift[0], y - shift[1], z - shift[2]);
+    ssd += d * d;
+  }
+  return ssd;
+}
+
+// ---------------------------------------------------------------------------
+/// Register source to target image and return final SSD of output transformation
+double register_images(const GenericImage<double> &target,
+                       const GenericImage<double> &source,
+                       bool single_precision)
+{
+  Transformation *dofout = NULL;
+  GenericRegistrationFilter registration;
+  registration.Input(&target, &source);
+  registration.Set("Transformation model",          "FFD");
+  registration.Set("Image dissimilarity measure",   "SSD");
+  registration.Set("No. of resolution levels",      "2");
+  registration.Set("Control point spacing",         "8");
+  registration.Set("Maximum no. of iterations",     "20");
+  registration.Set("Single precision image caches", single_precision ? "Yes" : "No");
+  registration.Output(&dofout);
+  registration.Run();
+  EXPECT_TRUE(dofout != NULL);
+  const double ssd = final_ssd(target, dofout);
+  delete dofout;
+  return ssd;
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(GenericRegistrationFilter, SinglePrecisionFinalEnergy)
+{
+  ImageAttributes attr(40, 40, 24);
+  GenericImage<double> target(attr), source(attr);
+  fill_pattern(target, .0, .0, .0);
+  fill_pattern(source, shift[0], shift[1], shift[2]);
+
+  const double initial = final_ssd(target, NULL);
+  ASSERT_GT(initial, .0);
+
+  // Final energies must agree whether or not the image caches and, when
+  // MIRTK_REGISTERED_IMAGE_USE_FLOAT is set, the registered image channels
+  // are stored in single precision, where the rounding of the intensities
+  // changes the exact path taken by the optimizer
+  const double ssd_double = register_images(target, source, false);
+  const double ssd_single = register_images(target, source, true);
+  EXPECT_LT(ssd_double, .1 * initial);
+  EXPECT_LT(ssd_single, .1 * initial);
+  EXPECT_NEAR(ssd_single, ssd_double, .01 * initial);
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
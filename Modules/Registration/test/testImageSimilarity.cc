@@ -0,0 +1,389 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mirtkMath.h>
+#include <mirtkGenericImage.h>
+#include <mirtkBSplineFreeFormTransformation3D.h>
+#include <mirtkMultiLevelFreeFormTransformation.h>
+#include <mirtkTransformedCoordinates.h>
+#include <mirtkSumOfSquaredIntensityDifferences.h>
+#include <mirtkMutualImageInformation.h>
+#include <mirtkNormalizedMutualImageInformation.h>
+#include <mirtkRegistrationEnergy.h>
+
+using namespace mirtk;
+
+
+// ===========================================================================
+// Helper
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Fill test image with smooth intensity pattern
+void fill_smooth_test_image(GenericImage<double> &image, double phase)
+{
+  for (int k = 0; k < image.Z(); ++k)
+  for (int j = 0; j < image.Y(); ++j)
+  for (int i = 0; i < image.X(); ++i) {
+    image(i, j, k) = 100.0 * sin(.3 * i + phase) * cos(.25 * j) + 10.0 * k + 50.0;
+  }
+}
+
+// ---------------------------------------------------------------------------
+/// Initialize similarity of test images, where source is deformed by FFD
+void initialize_similarity(ImageSimilarity &sim,
+                           GenericImage<double> &target,
+                           GenericImage<double> &source,
+                           BSplineFreeFormTransformation3D &ffd)
+{
+  const ImageAttributes &attr = target.Attributes();
+  fill_smooth_test_image(target, .0);
+  fill_smooth_test_image(source, .5);
+  for (int dof = 0; dof < ffd.NumberOfDOFs(); ++dof) {
+    ffd.Put(dof, .5 * sin(.3 * dof));
+  }
+  sim.Target()->InputImage(&target);
+  sim.Source()->InputImage(&source);
+  sim.Source()->Transformation(&ffd);
+  sim.Domain(attr);
+  sim.Mask(NULL);
+}
+
+// ---------------------------------------------------------------------------
+/// Compare finite differences gradient of sets of independent control points
+/// to the one obtained by perturbing one control point at a time
+void compare_approximate_gradient(ImageSimilarity &sim)
+{
+  ImageAttributes                 attr(24, 22, 18);
+  GenericImage<double>            target(attr), source(attr);
+  BSplineFreeFormTransformation3D ffd(attr, 3.0, 3.0, 3.0);
+  initialize_similarity(sim, target, source, ffd);
+  for (int cp = 0; cp < ffd.NumberOfCPs(); cp += 5) {
+    ffd.PutStatus(cp, FreeFormTransformation::CPStatus(Active, Passive, Active));
+  }
+  sim.UseApproximateGradient(true);
+  sim.Initialize();
+  sim.Update(true);
+  const double value = sim.Value();
+
+  // Coloring does not parallelize the evaluation and is thus disabled by default
+  EXPECT_FALSE(sim.UseColoredApproximateGradient());
+
+  const int n = ffd.NumberOfDOFs();
+  double *serial  = CAllocate<double>(n);
+  double *colored = CAllocate<double>(n);
+  sim.UseColoredApproximateGradient(false);
+  sim.EnergyTerm::Gradient(serial, .1);
+  sim.UseColoredApproximateGradient(true);
+  sim.EnergyTerm::Gradient(colored, .1);
+
+  double max_abs = .0;
+  for (int dof = 0; dof < n; ++dof) {
+    max_abs = max(max_abs, abs(serial[dof]));
+  }
+  ASSERT_GT(max_abs, .0);
+  for (int dof = 0; dof < n; ++dof) {
+    EXPECT_NEAR(colored[dof], serial[dof], 1e-9 * max_abs) << "dof=" << dof;
+  }
+
+  // Similarity must be restored after gradient approximation
+  sim.ResetValue();
+  EXPECT_NEAR(sim.Value(), value, 1e-9 * abs(value));
+  sim.Update(false);
+  EXPECT_NEAR(sim.Value(), value, 1e-9 * abs(value));
+
+  Deallocate(serial);
+  Deallocate(colored);
+}
+
+// ---------------------------------------------------------------------------
+/// Compare analytic gradient of histogram based similarity with cubic B-spline
+/// Parzen windows to finite differences approximation
+void compare_parzen_window_gradient(ProbabilisticImageSimilarity &sim)
+{
+  ImageAttributes                 attr(24, 22, 18);
+  GenericImage<double>            target(attr), source(attr);
+  BSplineFreeFormTransformation3D ffd(attr, 3.0, 3.0, 3.0);
+  initialize_similarity(sim, target, source, ffd);
+  sim.UseParzenWindow(true);
+  sim.Initialize();
+  sim.Update(true);
+
+  const int n = ffd.NumberOfDOFs();
+  double *analytic    = CAllocate<double>(n);
+  double *approximate = CAllocate<double>(n);
+  sim.UseApproximateGradient(false);
+  sim.EnergyTerm::Gradient(analytic, .01);
+  sim.UseApproximateGradient(true);
+  sim.EnergyTerm::Gradient(approximate, .01);
+
+  double dot = .0, norm1 = .0, norm2 = .0;
+  for (int dof = 0; dof < n; ++dof) {
+    dot   += analytic[dof] * approximate[dof];
+    norm1 += analytic[dof] * analytic[dof];
+    norm2 += approximate[dof] * approximate[dof];
+  }
+  ASSERT_GT(norm1, .0);
+  ASSERT_GT(norm2, .0);
+  EXPECT_GT(dot / sqrt(norm1 * norm2), .95);
+  EXPECT_NEAR(sqrt(norm1 / norm2), 1.0, .1);
+
+  Deallocate(analytic);
+  Deallocate(approximate);
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(ProbabilisticImageSimilarity, ParzenWindow)
+{
+  const double min = -10.0, width = 2.5, eps = 1e-6;
+  const int    nbins = 16;
+  int    bin[4], bin2[4];
+  double w[4], dw[4], w2[4];
+  for (double value = -9.9; value < 29.8; value += .37) {
+    ProbabilisticImageSimilarity::ParzenWindow(value, min, width, nbins, bin, w, dw);
+    ProbabilisticImageSimilarity::ParzenWindow(value + eps, min, width, nbins, bin2, w2);
+    double sum = .0, dsum = .0;
+    for (int a = 0; a < 4; ++a) {
+      EXPECT_GE(bin[a], 0);
+      EXPECT_LT(bin[a], nbins);
+      EXPECT_EQ(bin[a], bin2[a]);
+      EXPECT_NEAR(dw[a], (w2[a] - w[a]) / eps, 1e-5);
+      sum += w[a], dsum += dw[a];
+    }
+    EXPECT_NEAR(sum,  1.0, 1e-12);
+    EXPECT_NEAR(dsum, .0,  1e-12);
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(ImageSimilarity, ColoredApproximateGradientSSD)
+{
+  SumOfSquaredIntensityDifferences sim;
+  compare_approximate_gradient(sim);
+}
+
+// ---------------------------------------------------------------------------
+TEST(ImageSimilarity, ColoredApproximateGradientNMI)
+{
+  NormalizedMutualImageInformation sim;
+  compare_approximate_gradient(sim);
+}
+
+// ---------------------------------------------------------------------------
+TEST(ImageSimilarity, ParzenWindowGradientMI)
+{
+  MutualImageInformation sim;
+  compare_parzen_window_gradient(sim);
+}
+
+// ---------------------------------------------------------------------------
+TEST(ImageSimilarity, ParzenWindowGradientNMI)
+{
+  NormalizedMutualImageInformation sim;
+  compare_parzen_window_gradient(sim);
+}
+
+// ---------------------------------------------------------------------------
+TEST(ImageSimilarity, ApproximateGradientSharedCoordinates)
+{
+  ImageAttributes                  attr(24, 22, 18);
+  GenericImage<double>             target(attr), source[2];
+  MultiLevelFreeFormTransformation mffd;
+  BSplineFreeFormTransformation3D *ffd = new BSplineFreeFormTransformation3D(attr, 3.0, 3.0, 3.0);
+  for (int dof = 0; dof < ffd->NumberOfDOFs(); ++dof) {
+    ffd->Put(dof, .5 * sin(.3 * dof));
+  }
+  mffd.GetGlobalTransformation()->PutRotationZ(2.0);
+  mffd.PushLocalTransformation(ffd);
+  fill_smooth_test_image(target, .0);
+
+  // Two channels whose moving images share the transformed coordinates,
+  // where the finite differences perturb the FFD level of the MFFD
+  TransformedCoordinates           coords(attr, attr, &mffd);
+  SumOfSquaredIntensityDifferences shared[2], separate[2];
+  for (int c = 0; c < 2; ++c) {
+    source[c].Initialize(attr);
+    fill_smooth_test_image(source[c], .5 + c);
+    ImageSimilarity *sim[2] = {&shared[c], &separate[c]};
+    for (int i = 0; i < 2; ++i) {
+      sim[i]->Target()->InputImage(&target);
+      sim[i]->Source()->InputImage(&source[c]);
+      sim[i]->Source()->Transformation(&mffd);
+      sim[i]->Domain(attr);
+      sim[i]->Mask(NULL);
+      sim[i]->UseApproximateGradient(true);
+    }
+    shared[c].Source()->TransformedCoordinates(&coords);
+    shared[c].Initialize();
+    separate[c].Initialize();
+  }
+
+  const int n = mffd.NumberOfDOFs();
+  double *expected = Allocate<double>(n);
+  double *result   = Allocate<double>(n);
+  for (int colored = 0; colored < 2; ++colored) {
+    for (int c = 0; c < 2; ++c) {
+      shared  [c].UseColoredApproximateGradient(colored == 1);
+      separate[c].UseColoredApproximateGradient(colored == 1);
+      shared  [c].Update(true);
+      separate[c].Update(true);
+      EXPECT_NEAR(shared[c].Value(), separate[c].Value(), 1e-9 * abs(separate[c].Value()));
+    }
+    for (int c = 0; c < 2; ++c) {
+      memset(expected, 0, n * sizeof(double));
+      memset(result,   0, n * sizeof(double));
+      separate[c].EnergyTerm::Gradient(expected, .1);
+      shared  [c].EnergyTerm::Gradient(result,   .1);
+      double max_abs = .0;
+      for (int dof = 0; dof < n; ++dof) {
+        max_abs = max(max_abs, abs(expected[dof]));
+      }
+      ASSERT_GT(max_abs, .0);
+      for (int dof = 0; dof < n; ++dof) {
+        EXPECT_NEAR(result[dof], expected[dof], 1e-6 * max_abs) << "channel=" << c << ", dof=" << dof;
+      }
+    }
+  }
+  Deallocate(expected);
+  Deallocate(result);
+}
+
+// ---------------------------------------------------------------------------
+TEST(RegistrationEnergy, ConcurrentTerms)
+{
+  ImageAttributes                 attr(24, 22, 18);
+  GenericImage<double>            target(attr), source[2];
+  BSplineFreeFormTransformation3D ffd(attr, 3.0, 3.0, 3.0);
+  source[0].Initialize(attr);
+  source[1].Initialize(attr);
+  RegistrationEnergy energy;
+  for (int i = 0; i < 2; ++i) {
+    ImageSimilarity *sim;
+    if (i == 0) sim = new SumOfSquaredIntensityDifferences();
+    else        sim = new NormalizedMutualImageInformation();
+    initialize_similarity(*sim, target, source[i], ffd);
+    sim->Weight(i == 0 ? 1.0 : 2.0);
+    energy.Add(sim);
+  }
+  fill_smooth_test_image(source[1], 1.2);
+  energy.Transformation(&ffd);
+  energy.Initialize();
+
+  const int n = ffd.NumberOfDOFs();
+  double *gradient[2], value[2];
+  for (int p = 0; p < 2; ++p) {
+    energy.ParallelTerms(p == 1);
+    EXPECT_EQ(p == 1, energy.ConcurrentTerms());
+    ffd.Changed(true);
+    energy.Update(true);
+    value[p] = energy.Value();
+    gradient[p] = CAllocate<double>(n);
+    energy.Gradient(gradient[p], .1);
+  }
+
+  double max_abs = .0;
+  for (int dof = 0; dof < n; ++dof) {
+    max_abs = max(max_abs, abs(gradient[0][dof]));
+  }
+  ASSERT_GT(max_abs, .0);
+  EXPECT_DOUBLE_EQ(value[0], value[1]);
+  for (int dof = 0; dof < n; ++dof) {
+    EXPECT_NEAR(gradient[1][dof], gradient[0][dof], 1e-12 * max_abs) << "dof=" << dof;
+  }
+  Deallocate(gradient[0]);
+  Deallocate(gradient[1]);
+}
+
+// ---------------------------------------------------------------------------
+TEST(RegistrationEnergy, ConcurrentTermsWithApproximateGradient)
+{
+  ImageAttributes                 attr(24, 22, 18);
+  GenericImage<double>            target(attr), source[2];
+  BSplineFreeFormTransformation3D ffd(attr, 3.0, 3.0, 3.0);
+  source[0].Initialize(attr);
+  source[1].Initialize(attr);
+  SumOfSquaredIntensityDifferences *ssd = new SumOfSquaredIntensityDifferences();
+  MutualImageInformation           *mi  = new MutualImageInformation();
+  initialize_similarity(*ssd, target, source[0], ffd);
+  initialize_similarity(*mi,  target, source[1], ffd);
+  fill_smooth_test_image(source[1], 1.2);
+  mi->Weight(2.0);
+  RegistrationEnergy energy;
+  energy.Add(ssd);
+  energy.Add(mi);
+  energy.Transformation(&ffd);
+  energy.Initialize();
+  energy.ParallelTerms(true);
+
+  // Mutual information without Parzen windows uses finite differences
+  mi->UseParzenWindow(false);
+  EXPECT_TRUE(mi->ModifiesTransformation());
+  EXPECT_FALSE(energy.ConcurrentTerms());
+  mi->UseParzenWindow(true);
+  EXPECT_FALSE(mi->ModifiesTransformation());
+  EXPECT_TRUE(energy.ConcurrentTerms());
+  ssd->UseApproximateGradient(true);
+  EXPECT_TRUE(ssd->ModifiesTransformation());
+  EXPECT_FALSE(energy.ConcurrentTerms());
+  ssd->Weight(.0);
+  EXPECT_FALSE(energy.ConcurrentTerms());
+  ssd->Weight(1.0);
+  mi->UseParzenWindow(false);
+
+  // Gradient must not depend on parallel terms option
+  const int n = ffd.NumberOfDOFs();
+  double *gradient[2], value[2];
+  for (int p = 0; p < 2; ++p) {
+    energy.ParallelTerms(p == 1);
+    ffd.Changed(true);
+    energy.Update(true);
+    value[p] = energy.Value();
+    gradient[p] = CAllocate<double>(n);
+    energy.Gradient(gradient[p], .1);
+  }
+
+  double max_abs = .0;
+  for (int dof = 0; dof < n; ++dof) {
+    max_abs = max(max_abs, abs(gradient[0][dof]));
+  }
+  ASSERT_GT(max_abs, .0);
+  EXPECT_DOUBLE_EQ(value[0], value[1]);
+  for (int dof = 0; dof < n; ++dof) {
+    EXPECT_NEAR(gradient[1][dof], gradient[0][dof], 1e-12 * max_abs) << "dof=" << dof;
+  }
+  Deallocate(gradient[0]);
+  Deallocate(gradient[1]);
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -21,11 +21,13 @@
 #include <gtest/gtest.h>
 
 #include <mirtkRegisteredImage.h>
+#include <mirtkTransformedCoordinates.h>
 
 #include <mirtkProfiling.h>
 #include <mirtkGenericImage.h>
 #include <mirtkRigidTransformation.h>
 #include <mirtkBSplineFreeFormTransformation3D.h>
+#include <mirtkBSplineFreeFormTransformationSV.h>
 #include <mirtkMultiLevelFreeFormTransformation.h>
 
 using namespace mirtk;
@@ -51,6 +53,39 @@ void fill_test_image(GenericImage<TVoxel> &image)
   }
 }
 
+// ---------------------------------------------------------------------------
+/// Fill test image with smooth intensity pattern
+template <class TVoxel>
+void fill_smooth_test_image(GenericImage<TVoxel> &image)
+{
+  for (int k = 0; k < image.Z(); ++k)
+  for (int j = 0; j < image.Y(); ++j)
+  for (int i = 0; i < image.X(); ++i) {
+    image(i, j, k) = static_cast<TVoxel>(100.0 * sin(.2 * i) * cos(.15 * j) + 20.0 * k);
+  }
+}
+
+// ---------------------------------------------------------------------------
+/// Sum of squared differences of registered intensities and gradient energy
+void registered_image_energies(const GenericImage<double> &target,
+                               const RegisteredImage &source,
+                               double &ssd, double &grad)
+{
+  const int n = source.NumberOfVoxels();
+  typedef RegisteredImage::VoxelType VoxelType;
+  const double    *T  = target.Data();
+  const VoxelType *I  = source.Data();
+  const VoxelType *Dx = source.Data() + source.Offset(RegisteredImage::Dx);
+  const VoxelType *Dy = source.Data() + source.Offset(RegisteredImage::Dy);
+  const VoxelType *Dz = source.Data() + source.Offset(RegisteredImage::Dz);
+  ssd = grad = .0;
+  for (int idx = 0; idx < n; ++idx) {
+    const double diff = I[idx] - T[idx];
+    ssd  += diff * diff;
+    grad += diff * (Dx[idx] + Dy[idx] + Dz[idx]);
+  }
+}
+
 // ===========================================================================
 // Tests
 // ===========================================================================
@@ -99,6 +134,144 @@ TEST(RegisteredImage, GlobalAndLocalTransformation)
   mffd.PopLocalTransformation();
 }
 
+// ---------------------------------------------------------------------------
+TEST(RegisteredImage, SinglePrecision)
+{
+  // Allocate images
+  ImageAttributes      attr(48, 48, 24);
+  GenericImage<double> target(attr), image(attr);
+  fill_smooth_test_image(target);
+  fill_smooth_test_image(image);
+  // Prepare SV FFD with non-uniform displacements which are always cached
+  BSplineFreeFormTransformationSV ffd(attr, 4.0 * attr._dx, 4.0 * attr._dy, 4.0 * attr._dz);
+  for (int dof = 0; dof < ffd.NumberOfDOFs(); ++dof) {
+    ffd.Put(dof, 1.5 * sin(.7 * dof));
+  }
+  ASSERT_TRUE(ffd.RequiresCachingOfDisplacements());
+  // Compare energies in double and single precision with cached displacements
+  // when image derivatives are either computed on the fly or precomputed
+  for (int p = 0; p < 2; ++p) {
+    RegisteredImage source[2];
+    double ssd[2], grad[2];
+    for (int i = 0; i < 2; ++i) {
+      source[i].InputImage(&image);
+      source[i].Transformation(&ffd);
+      source[i].PrecomputeDerivatives(p == 1);
+      source[i].SinglePrecision(i == 1);
+      source[i].Initialize(attr, 4);
+      source[i].Update(true, true, false, true);
+      registered_image_energies(target, source[i], ssd[i], grad[i]);
+    }
+    EXPECT_TRUE(dynamic_cast<RegisteredImage::SinglePrecisionImageType *>(source[1].InputGradient()) != NULL);
+    EXPECT_GT(ssd[0], .0);
+    EXPECT_NEAR(ssd [1], ssd [0], 1e-5 * fabs(ssd [0]));
+    EXPECT_NEAR(grad[1], grad[0], 1e-5 * fabs(grad[0]));
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(RegisteredImage, FusedCubicBSplineDerivatives)
+{
+  // Linear intensity ramp in world coordinates on anisotropic lattice,
+  // which is reproduced exactly by cubic B-spline away from the boundary
+  ImageAttributes      attr(40, 40, 40, 1.0, 1.5, 2.0);
+  GenericImage<double> image(attr);
+  const double a = 2.0, b = -1.0, c = .5;
+  for (int k = 0; k < attr._z; ++k)
+  for (int j = 0; j < attr._y; ++j)
+  for (int i = 0; i < attr._x; ++i) {
+    double x = i, y = j, z = k;
+    image.ImageToWorld(x, y, z);
+    image(i, j, k) = a * x + b * y + c * z;
+  }
+  // Translate image by a fraction of a voxel
+  RigidTransformation dof;
+  dof.PutTranslationX(.3);
+  dof.PutTranslationY(.2);
+  dof.PutTranslationZ(-.7);
+  // Evaluate intensities, 1st and 2nd order derivatives at once
+  RegisteredImage source;
+  source.InputImage(&image);
+  source.Transformation(&dof);
+  source.InterpolationMode(Interpolation_FastCubicBSpline);
+  source.PrecomputeDerivatives(false);
+  ASSERT_TRUE(source.FusedDerivatives());
+  source.Initialize(attr, 13);
+  source.Update(true, true, true, true);
+  // Compare to analytic values inside region not affected by boundary
+  const int margin = 10;
+  for (int k = margin; k < attr._z - margin; ++k)
+  for (int j = margin; j < attr._y - margin; ++j)
+  for (int i = margin; i < attr._x - margin; ++i) {
+    double x = i, y = j, z = k;
+    source.ImageToWorld(x, y, z);
+    dof.Transform(x, y, z);
+    EXPECT_NEAR(source(i, j, k, RegisteredImage::I),  a * x + b * y + c * z, 1e-3);
+    EXPECT_NEAR(source(i, j, k, RegisteredImage::Dx), a, 1e-3);
+    EXPECT_NEAR(source(i, j, k, RegisteredImage::Dy), b, 1e-3);
+    EXPECT_NEAR(source(i, j, k, RegisteredImage::Dz), c, 1e-3);
+    for (int l = RegisteredImage::Dxx; l <= RegisteredImage::Dzz; ++l) {
+      EXPECT_NEAR(source(i, j, k, l), .0, 1e-3);
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(RegisteredImage, SharedTransformedCoordinates)
+{
+  // Two input channels on the same lattice
+  ImageAttributes      attr(40, 36, 20);
+  GenericImage<double> image[2];
+  image[0].Initialize(attr);
+  image[1].Initialize(attr);
+  fill_smooth_test_image(image[0]);
+  fill_test_image       (image[1]);
+  // Transformation with non-uniform displacements
+  RigidTransformation global;
+  global.PutRotationZ(3.0);
+  BSplineFreeFormTransformation3D local(attr, 4.0 * attr._dx, 4.0 * attr._dy, 4.0 * attr._dz);
+  for (int dof = 0; dof < local.NumberOfDOFs(); ++dof) {
+    local.Put(dof, sin(.3 * dof));
+  }
+  MultiLevelFreeFormTransformation mffd(global);
+  mffd.PushLocalTransformation(&local);
+  // Moving images which share the transformed voxel coordinates
+  TransformedCoordinates coords(attr, attr, &mffd);
+  RegisteredImage shared[2], source[2];
+  for (int c = 0; c < 2; ++c) {
+    shared[c].InputImage(&image[c]);
+    shared[c].Transformation(&mffd);
+    shared[c].TransformedCoordinates(&coords);
+    shared[c].Initialize(attr, 4);
+    source[c].InputImage(&image[c]);
+    source[c].Transformation(&mffd);
+    source[c].Initialize(attr, 4);
+  }
+  for (int iter = 0; iter < 2; ++iter) {
+    // Coordinates are only computed by the update of the first channel
+    for (int c = 0; c < 2; ++c) {
+      shared[c].Update(true, true, false, true);
+      source[c].Update(true, true, false, true);
+      EXPECT_TRUE(coords.UpToDate());
+      EXPECT_EQ(mffd.ModificationTime(), coords.ModificationTime());
+    }
+    EXPECT_FALSE(coords.Update());
+    // Compare to registered images which transform voxels themselves
+    for (int c = 0; c < 2; ++c) {
+      for (int l = 0; l < 4; ++l)
+      for (int k = 0; k < attr._z; ++k)
+      for (int j = 0; j < attr._y; ++j)
+      for (int i = 0; i < attr._x; ++i) {
+        EXPECT_NEAR(source[c](i, j, k, l), shared[c](i, j, k, l), 1e-6);
+      }
+    }
+    // Modify transformation such that cache must be recomputed
+    mffd.Put(0, mffd.Get(0) + 1.3);
+    EXPECT_FALSE(coords.UpToDate());
+  }
+  mffd.PopLocalTransformation();
+}
+
 // ===========================================================================
 // Main
 // ===========================================================================
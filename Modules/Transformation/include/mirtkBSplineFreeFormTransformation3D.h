@@ -265,6 +265,7 @@ public:
   using FreeFormTransformation3D::LocalJacobian;
   using FreeFormTransformation3D::LocalHessian;
   using FreeFormTransformation3D::JacobianDOFs;
+  using FreeFormTransformation3D::ParametricGradient;
 
   /// Calculates the Jacobian of the transformation w.r.t either control point displacements or velocities
   virtual void FFDJacobianWorld(Matrix &, double, double, double, double = 0, double = -1) const;
@@ -281,6 +282,16 @@ public:
   /// Calculates the Jacobian of the local transformation
   virtual void JacobianDetDerivative(Matrix *, int, int, int) const;
 
+  /// Applies the chain rule to convert spatial non-parametric gradient
+  /// to a gradient w.r.t the parameters of this transformation
+  ///
+  /// This implementation visits each voxel only once and scatters its
+  /// contribution to the 4x4x4 control points with non-zero B-spline weight.
+  virtual void ParametricGradient(const GenericImage<double> *, double *,
+                                  const WorldCoordsImage *,
+                                  const WorldCoordsImage *,
+                                  double = -1, double = 1) const;
+
   /// Calculates the derivative of the Jacobian of the transformation (w.r.t. world coordinates) w.r.t. a transformation parameter
   virtual void DeriveJacobianWrtDOF(Matrix &, int, double, double, double, double = 0, double = -1) const;
 
@@ -157,6 +157,13 @@ public:
   /// \param[in,out] max      Maximum step length.
   virtual void GradientStep(const double *gradient, double &min, double &max) const;
 
+  /// Whether the evaluation of the energy gradient modifies the parameters of
+  /// the transformation, e.g., to approximate it using finite differences
+  ///
+  /// Such energy terms must not be evaluated concurrently with other terms
+  /// which depend on the same transformation.
+  virtual bool ModifiesTransformation() const;
+
 protected:
 
   /// Evaluate unweighted energy term
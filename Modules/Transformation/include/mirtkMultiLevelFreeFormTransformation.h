@@ -27,6 +27,9 @@
 namespace mirtk {
 
 
+class BSplineFreeFormTransformation3D;
+
+
 /**
  * Class for multi-level FFD where global and local transformations are summed up.
  *
@@ -60,8 +63,43 @@ public:
   // Levels
 
   /// Combine local transformations on stack
+  ///
+  /// Local cubic B-spline FFDs defined on nested control point lattices are
+  /// combined exactly by CompileLocalTransformation. Otherwise, the coefficients
+  /// of local transformations with equal number of DoFs are summed up.
   virtual void CombineLocalTransformation();
 
+  /// Compile local transformations into a single cubic B-spline FFD
+  ///
+  /// The control point lattices of the coarser levels are refined by knot
+  /// insertion (cf. BSplineFreeFormTransformation3D::Subdivide) until their
+  /// control point spacing equals the one of the finest level. The resulting
+  /// coefficients are then summed up on a common lattice which is large enough
+  /// to represent the sum of the local displacements exactly everywhere. The
+  /// local transformations can only be compiled when these are all instances
+  /// of BSplineFreeFormTransformation3D with constant (zero) extrapolation,
+  /// with equal orientation, and with control point spacings which are power
+  /// of two multiples of the finest spacing such that the control points of
+  /// each level coincide with those of the refined lattice.
+  ///
+  /// \param[in] global Whether to also add the displacements of the global
+  ///                   transformation to the coefficients. The affine displacement
+  ///                   is then represented exactly only at points which are at
+  ///                   least one control point spacing inside the lattice boundary.
+  ///
+  /// \returns New FFD which must be deleted by the caller or NULL if the local
+  ///          transformations cannot be compiled.
+  BSplineFreeFormTransformation3D *Compile(bool global = false) const;
+
+  /// Replace local transformations by the FFD returned by Compile
+  ///
+  /// The global transformation is not modified. The resulting transformation is
+  /// identical to this multi-level transformation, but only a single level has
+  /// to be evaluated, e.g., when the transformation is applied to an image.
+  ///
+  /// \returns Whether the transformation has at most one local transformation.
+  bool CompileLocalTransformation();
+
   /// Convert the global transformation from a matrix representation to a
   /// FFD and incorporate it with any existing local transformation
   virtual void MergeGlobalIntoLocalDisplacement();
@@ -185,6 +185,11 @@ public:
   /// Get number of transformation parameters
   virtual int NumberOfDOFs() const;
 
+  /// Modification time stamp which also advances when the global or any of
+  /// the local transformations are modified directly, e.g., when a control
+  /// point of a FFD level is perturbed to approximate the gradient
+  virtual unsigned long ModificationTime() const;
+
   /// Put value of transformation parameter
   virtual void Put(int, double);
 
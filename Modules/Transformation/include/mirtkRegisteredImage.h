@@ -24,6 +24,7 @@
 
 #include <mirtkParallel.h>
 #include <mirtkTransformation.h>
+#include <mirtkTransformedCoordinates.h>
 #include <mirtkInterpolationMode.h>
 #include <mirtkExtrapolationMode.h>
 
@@ -33,6 +34,14 @@
 namespace mirtk {
 
 
+/// Voxel type of the channels of a registered image
+#if MIRTK_REGISTERED_IMAGE_USE_FLOAT
+typedef float  RegisteredPixel;
+#else
+typedef double RegisteredPixel;
+#endif
+
+
 /**
  * Registered image such as fixed target image or transformed source image
  *
@@ -66,15 +75,19 @@ namespace mirtk {
  * - t=7: Transformed 2nd order derivative w.r.t yy
  * - t=8: Transformed 2nd order derivative w.r.t yz
  * - t=9: Transformed 2nd order derivative w.r.t zz
+ *
+ * The channels are stored in single precision when MIRTK is built with
+ * MIRTK_REGISTERED_IMAGE_USE_FLOAT, which halves the memory footprint and
+ * bandwidth of the most frequently updated images during the registration.
  */
-class RegisteredImage : public GenericImage<double>
+class RegisteredImage : public GenericImage<RegisteredPixel>
 {
   mirtkObjectMacro(RegisteredImage);
 
 public:
 
   // Do not override other base class overloads
-  using GenericImage<double>::ImageToWorld;
+  using GenericImage<RegisteredPixel>::ImageToWorld;
 
   // ---------------------------------------------------------------------------
   // Types
@@ -95,6 +108,10 @@ public:
   /// Type of cached displacement fields
   typedef GenericImage<double>   DisplacementImageType;
 
+  /// Type of untransformed derivatives and cached displacements
+  /// when these are stored in single precision
+  typedef GenericImage<float>    SinglePrecisionImageType;
+
   // ---------------------------------------------------------------------------
   // Attributes
 
@@ -102,10 +119,16 @@ public:
   mirtkPublicAggregateMacro(InputImageType, InputImage);
 
   /// Untransformed input gradient image
-  mirtkPublicComponentMacro(GradientImageType, InputGradient);
+  ///
+  /// This image is of type GradientImageType or, if SinglePrecision is
+  /// enabled, of type SinglePrecisionImageType.
+  mirtkPublicComponentMacro(BaseImage, InputGradient);
 
   /// Untransformed input Hessian image
-  mirtkPublicComponentMacro(HessianImageType, InputHessian);
+  ///
+  /// This image is of type HessianImageType or, if SinglePrecision is
+  /// enabled, of type SinglePrecisionImageType.
+  mirtkPublicComponentMacro(BaseImage, InputHessian);
 
   /// Current transformation estimate
   mirtkPublicAggregateMacro(const class Transformation, Transformation);
@@ -125,11 +148,21 @@ public:
   /// Externally pre-computed displacements to use
   mirtkPublicAggregateMacro(DisplacementImageType, ExternalDisplacement);
 
+  /// Transformed voxel coordinates shared with other registered images
+  ///
+  /// When multiple input images are transformed by the same transformation and
+  /// resampled on the same discrete domain, e.g., the channels of a multi-channel
+  /// registration, the input voxel coordinates of the output voxels are only
+  /// computed by the first update of any of these images after a change of
+  /// the transformation. The cache is ignored when it does not match the
+  /// attributes of this image, its input image, or its transformation.
+  mirtkPublicAggregateMacro(class TransformedCoordinates, TransformedCoordinates);
+
   /// Pre-computed fixed displacements
-  mirtkComponentMacro(DisplacementImageType, FixedDisplacement);
+  mirtkComponentMacro(BaseImage, FixedDisplacement);
 
   /// Pre-computed displacements
-  mirtkComponentMacro(DisplacementImageType, Displacement);
+  mirtkComponentMacro(BaseImage, Displacement);
 
   /// Whether to use pre-computed world coordinates
   mirtkAttributeMacro(bool, CacheWorldCoordinates);
@@ -160,8 +193,22 @@ public:
   /// Whether to precompute image derivatives
   /// true:  Compute derivatives of input image and transform these
   /// false: Use derivative of interpolation kernel to evaluate image derivative
+  ///
+  /// When no derivatives are precomputed and the interpolation mode is
+  /// Interpolation_FastCubicBSpline, the intensities, 1st and 2nd order
+  /// derivatives are evaluated at once from the cubic B-spline coefficients
+  /// of the input image (see FusedDerivatives).
   mirtkPublicAttributeMacro(bool, PrecomputeDerivatives);
 
+  /// Whether to store untransformed input derivatives and cached displacements
+  /// in single precision to halve their memory footprint and bandwidth
+  ///
+  /// The precision of the registered output channels is instead determined
+  /// by MIRTK_REGISTERED_IMAGE_USE_FLOAT. Externally provided displacement
+  /// fields are used with the precision they are given.
+  /// This option must be set before the image is initialized.
+  mirtkPublicAttributeMacro(bool, SinglePrecision);
+
 protected:
 
   /// Number of active levels
@@ -173,6 +220,9 @@ protected:
   /// Offsets of the different registered image channels
   int _Offset[13];
 
+  /// Whether the shared transformed coordinates can be used for the update
+  bool UseTransformedCoordinates() const;
+
   /// (Pre-)compute gradient of input image
   /// \param[in] sigma Standard deviation of Gaussian smoothing filter in voxels.
   void ComputeInputGradient(double sigma);
@@ -212,6 +262,10 @@ public:
   // ---------------------------------------------------------------------------
   // Initialization/Update
 
+  /// Whether intensities and derivatives are evaluated at once from the cubic
+  /// B-spline coefficients of the input image instead of separate images
+  bool FusedDerivatives() const;
+
   /// Initialize image
   ///
   /// This function is called by the image similarity to set the attributes
@@ -82,6 +82,9 @@ protected:
   /// Status of each transformation parameter (Active or Passive)
   DOFStatus *_Status;
 
+  /// Modification time stamp (cf. ModificationTime)
+  unsigned long _ModificationTime;
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 
@@ -140,6 +143,19 @@ public:
   /// Get norm of the gradient vector
   virtual double DOFGradientNorm(const double *) const;
 
+  using Observable::Changed;
+
+  /// Set whether transformation has changed and advance its modification time
+  virtual void Changed(bool);
+
+  /// Modification time stamp which is advanced whenever this transformation
+  /// is marked as changed, i.e., when its parameters are modified
+  ///
+  /// Unlike the Changed flag, which is reset once the dependent objects were
+  /// notified, the time stamp can be used to tell whether data derived from
+  /// this transformation, such as cached transformed coordinates, is outdated.
+  virtual unsigned long ModificationTime() const;
+
   /// Put value of transformation parameter
   virtual void Put(int, double);
 
@@ -675,6 +691,19 @@ inline double Transformation::DOFGradientNorm(const double *gradient) const
   return max;
 }
 
+// -----------------------------------------------------------------------------
+inline void Transformation::Changed(bool changed)
+{
+  Observable::Changed(changed);
+  if (changed) ++_ModificationTime;
+}
+
+// -----------------------------------------------------------------------------
+inline unsigned long Transformation::ModificationTime() const
+{
+  return _ModificationTime;
+}
+
 // -----------------------------------------------------------------------------
 inline void Transformation::Put(int idx, double x)
 {
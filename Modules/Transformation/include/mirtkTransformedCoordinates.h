@@ -0,0 +1,162 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_TransformedCoordinates_H
+#define MIRTK_TransformedCoordinates_H
+
+#include <mirtkObject.h>
+
+#include <mirtkParallel.h>
+#include <mirtkGenericImage.h>
+#include <mirtkImageAttributes.h>
+#include <mirtkTransformation.h>
+
+
+namespace mirtk {
+
+
+/**
+ * Cache of transformed voxel coordinates shared by registered images
+ *
+ * In case of a multi-channel registration, the registered images of the
+ * different channels are transformed by the same transformation and resampled
+ * on the same discrete domain. Instead of mapping each output voxel and checking
+ * whether it is inside the interpolation domain separately for each channel,
+ * an instance of this class stores for each voxel of the output domain the
+ * corresponding voxel coordinates in the input image lattice, or NaN if the
+ * voxel is mapped outside the interpolation domain of RegisteredImage.
+ *
+ * The cache is versioned by the modification time of the transformation
+ * (cf. Transformation::ModificationTime). It is hence recomputed only by the
+ * first Update call after a change of the transformation, regardless of which
+ * of the registered images which share the cache is updated first.
+ *
+ * \sa RegisteredImage::TransformedCoordinates
+ */
+class TransformedCoordinates : public Object
+{
+  mirtkObjectMacro(TransformedCoordinates);
+
+public:
+
+  /// Type of image storing the transformed voxel coordinates
+  typedef GenericImage<double> CoordinatesImageType;
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Discrete output domain whose voxels are transformed
+  mirtkReadOnlyAttributeMacro(ImageAttributes, Domain);
+
+  /// Attributes of input image lattice onto which output voxels are mapped
+  mirtkReadOnlyAttributeMacro(ImageAttributes, InputDomain);
+
+  /// Transformation which maps output voxels to input image lattice
+  mirtkReadOnlyAggregateMacro(const class Transformation, Transformation);
+
+  /// Input voxel coordinates of output voxels in consecutive channels,
+  /// i.e., x, y, and z coordinates, or NaN if outside interpolation domain
+  mirtkReadOnlyAttributeMacro(CoordinatesImageType, Coordinates);
+
+  /// Modification time of transformation at last update of coordinates
+  mirtkReadOnlyAttributeMacro(unsigned long, ModificationTime);
+
+  /// Whether coordinates were computed at least once since initialization
+  mirtkReadOnlyAttributeMacro(bool, Valid);
+
+private:
+
+  /// Serializes updates of registered images sharing this cache which
+  /// are executed concurrently (cf. RegistrationEnergy::ParallelTerms)
+  mutex _Mutex;
+
+  /// Copy constructor
+  /// \note Intentionally not implemented.
+  TransformedCoordinates(const TransformedCoordinates &);
+
+  /// Assignment operator
+  /// \note Intentionally not implemented.
+  TransformedCoordinates &operator =(const TransformedCoordinates &);
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+public:
+
+  /// Constructor
+  ///
+  /// \param[in] domain Discrete output domain. The _torigin attribute is the
+  ///                   time point of the output, i.e., of the initial condition
+  ///                   of velocity based transformations.
+  /// \param[in] input  Attributes of input image lattice. The _torigin attribute
+  ///                   is the time point of the untransformed input image.
+  /// \param[in] dof    Transformation mapping output voxels to the input.
+  TransformedCoordinates(const ImageAttributes &domain,
+                         const ImageAttributes &input,
+                         const class Transformation *dof);
+
+  /// Destructor
+  virtual ~TransformedCoordinates();
+
+  // ---------------------------------------------------------------------------
+  // Update
+
+  /// Whether these transformed coordinates can be used to resample an input
+  /// image with the given attributes on the given domain after transformation
+  bool Matches(const ImageAttributes &domain,
+               const ImageAttributes &input,
+               const class Transformation *dof) const;
+
+  /// Whether cached coordinates are up-to-date with the transformation
+  bool UpToDate() const;
+
+  /// Force recomputation of coordinates upon next update
+  void Invalidate();
+
+  /// Recompute coordinates if transformation was modified since last update
+  ///
+  /// This function may be called concurrently by the registered images which
+  /// share this cache. Only the first call recomputes the coordinates.
+  ///
+  /// \param[in] i2w Pre-computed world coordinates of output voxels or NULL.
+  ///
+  /// \returns Whether the coordinates were recomputed.
+  bool Update(const WorldCoordsImage *i2w = NULL);
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+////////////////////////////////////////////////////////////////////////////////
+
+// -----------------------------------------------------------------------------
+inline bool TransformedCoordinates::UpToDate() const
+{
+  return _Valid && _ModificationTime == _Transformation->ModificationTime();
+}
+
+// -----------------------------------------------------------------------------
+inline void TransformedCoordinates::Invalidate()
+{
+  _Valid = false;
+}
+
+
+} // namespace mirtk
+
+#endif // MIRTK_TransformedCoordinates_H
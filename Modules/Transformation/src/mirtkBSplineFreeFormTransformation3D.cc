@@ -22,6 +22,7 @@
 
 #include <mirtkMath.h>
 #include <mirtkMemory.h>
+#include <mirtkParallel.h>
 #include <mirtkProfiling.h>
 #include <mirtkImageToInterpolationCoefficients.h>
 
@@ -1160,6 +1161,161 @@ void BSplineFreeFormTransformation3D
   }
 }
 
+// -----------------------------------------------------------------------------
+/// (Multi-threaded) body of BSplineFreeFormTransformation3D::ParametricGradient
+///
+/// Unlike FreeFormTransformation3DParametricGradientBody, which iterates over
+/// the control points and revisits each voxel within the support region of
+/// every one of the 4x4x4 control points affecting it, this body visits each
+/// voxel only once. The separable cubic B-spline weights are evaluated once
+/// per voxel and the weighted non-parametric gradient is scattered to the
+/// control points in the neighborhood of the voxel. Each split of the body
+/// accumulates the gradient in a private buffer, which is added by join.
+class BSplineFreeFormTransformation3DParametricGradientBody
+{
+  typedef BSplineFreeFormTransformation3D::Kernel Kernel;
+
+public:
+
+  const BSplineFreeFormTransformation3D *_FFD;
+  const GenericImage<double>            *_Input;
+  const WorldCoordsImage                *_Image2World;
+  const WorldCoordsImage                *_WorldCoords;
+  double                                *_Output;
+  double                                 _Weight;
+  int                                    _NumberOfDOFs;
+
+  // ---------------------------------------------------------------------------
+  /// Default constructor
+  BSplineFreeFormTransformation3DParametricGradientBody()
+  :
+    _FFD(NULL), _Input(NULL), _Image2World(NULL), _WorldCoords(NULL),
+    _Output(NULL), _Weight(1.0), _NumberOfDOFs(0)
+  {}
+
+  // ---------------------------------------------------------------------------
+  /// Split constructor
+  BSplineFreeFormTransformation3DParametricGradientBody(
+    BSplineFreeFormTransformation3DParametricGradientBody &rhs, split
+  ) :
+    _FFD(rhs._FFD), _Input(rhs._Input),
+    _Image2World(rhs._Image2World), _WorldCoords(rhs._WorldCoords),
+    _Weight(rhs._Weight), _NumberOfDOFs(rhs._NumberOfDOFs)
+  {
+    _Output = CAllocate<double>(_NumberOfDOFs);
+  }
+
+  // ---------------------------------------------------------------------------
+  /// Join results of right-hand body with this body
+  void join(BSplineFreeFormTransformation3DParametricGradientBody &rhs)
+  {
+    for (int dof = 0; dof < _NumberOfDOFs; ++dof) {
+      _Output[dof] += rhs._Output[dof];
+    }
+    Deallocate(rhs._Output);
+  }
+
+  // ---------------------------------------------------------------------------
+  /// Scatter gradient of voxels in the specified range of image slices
+  void operator ()(const blocked_range<int> &re)
+  {
+    const int X = _Input->X();
+    const int Y = _Input->Y();
+    const int N = _Input->NumberOfSpatialVoxels();
+
+    const bool lattice2D = (_FFD->Z() == 1);
+
+    double x, y, z, wx[4], wy[4], wz[4] = {1.0, .0, .0, .0}, wyz, w;
+    int    i0, j0, k0 = 1, ci, cj, ck, cp, xdof, ydof, zdof;
+    FreeFormTransformation3D::CPStatus status;
+
+    for (int k = re.begin(); k != re.end(); ++k)
+    for (int j = 0; j < Y; ++j)
+    for (int i = 0; i < X; ++i) {
+      const int     idx = i + X * (j + Y * k);
+      const double *g   = _Input->Data() + idx;
+      // Check whether reference point is valid
+      if (g[0] == .0 && g[N] == .0 && g[2*N] == .0) continue;
+      // Lattice coordinates of voxel
+      if (_WorldCoords) {
+        const double *wc = _WorldCoords->Data() + idx;
+        x = wc[0], y = wc[N], z = wc[2*N];
+      } else if (_Image2World) {
+        const double *wc = _Image2World->Data() + idx;
+        x = wc[0], y = wc[N], z = wc[2*N];
+      } else {
+        x = i, y = j, z = k;
+        _Input->ImageToWorld(x, y, z);
+      }
+      _FFD->WorldToLattice(x, y, z);
+      // Separable B-spline weights of control points in neighborhood
+      i0 = ifloor(x);
+      j0 = ifloor(y);
+      Kernel::Weights(x - i0, wx);
+      Kernel::Weights(y - j0, wy);
+      if (!lattice2D) {
+        k0 = ifloor(z);
+        Kernel::Weights(z - k0, wz);
+      }
+      // Scatter gradient to control points
+      for (int c = 0; c < (lattice2D ? 1 : 4); ++c) {
+        ck = k0 - 1 + c;
+        if (ck < 0 || ck >= _FFD->Z()) continue;
+        for (int b = 0; b < 4; ++b) {
+          cj = j0 - 1 + b;
+          if (cj < 0 || cj >= _FFD->Y()) continue;
+          wyz = _Weight * wy[b] * wz[c];
+          for (int a = 0; a < 4; ++a) {
+            ci = i0 - 1 + a;
+            if (ci < 0 || ci >= _FFD->X()) continue;
+            w = wx[a] * wyz;
+            if (w == .0) continue;
+            cp = _FFD->LatticeToIndex(ci, cj, ck);
+            _FFD->GetStatus(cp, status);
+            _FFD->IndexToDOFs(cp, xdof, ydof, zdof);
+            if (status._x == Active) _Output[xdof] += w * g[0];
+            if (status._y == Active) _Output[ydof] += w * g[N];
+            if (status._z == Active) _Output[zdof] += w * g[2*N];
+          }
+        }
+      }
+    }
+  }
+
+}; // BSplineFreeFormTransformation3DParametricGradientBody
+
+// -----------------------------------------------------------------------------
+void BSplineFreeFormTransformation3D
+::ParametricGradient(const GenericImage<double> *in, double *out,
+                     const WorldCoordsImage *i2w, const WorldCoordsImage *wc,
+                     double t0, double w) const
+{
+  // Fall back to control point driven implementation when support is reduced
+  if (this->SpeedupFactor() != 1.0) {
+    FreeFormTransformation3D::ParametricGradient(in, out, i2w, wc, t0, w);
+    return;
+  }
+  if (i2w && (i2w->X() != in->X() || i2w->Y() != in->Y() || i2w->Z() != in->Z() || i2w->T() != 3)) {
+    cerr << "BSplineFreeFormTransformation3D::ParametricGradient: Invalid voxel coordinates map" << endl;
+    exit(1);
+  }
+  if (wc && (wc->X() != in->X() || wc->Y() != in->Y() || wc->Z() != in->Z() || wc->T() != 3)) {
+    cerr << "BSplineFreeFormTransformation3D::ParametricGradient: Invalid world coordinates map" << endl;
+    exit(1);
+  }
+  MIRTK_START_TIMING();
+  BSplineFreeFormTransformation3DParametricGradientBody body;
+  body._FFD          = this;
+  body._Input        = in;
+  body._Output       = out;
+  body._Weight       = w;
+  body._Image2World  = i2w;
+  body._WorldCoords  = wc;
+  body._NumberOfDOFs = 3 * this->NumberOfCPs();
+  parallel_reduce(blocked_range<int>(0, in->Z()), body);
+  MIRTK_DEBUG_TIMING(2, "parametric gradient computation (3D B-spline FFD)");
+}
+
 // =============================================================================
 // Properties
 // =============================================================================
@@ -251,6 +251,12 @@ void EnergyTerm::GradientStep(const double *, double &, double &) const
   // By default, step length range chosen by user/optimizer
 }
 
+// -----------------------------------------------------------------------------
+bool EnergyTerm::ModifiesTransformation() const
+{
+  return false;
+}
+
 // =============================================================================
 // Debugging
 // =============================================================================
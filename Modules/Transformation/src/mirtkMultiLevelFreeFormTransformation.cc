@@ -20,13 +20,105 @@
 
 #include <mirtkMultiLevelFreeFormTransformation.h>
 
+#include <mirtkMath.h>
+#include <mirtkArray.h>
 #include <mirtkMemory.h>
 #include <mirtkTransformationUtils.h>
+#include <mirtkBSplineFreeFormTransformation3D.h>
 
 
 namespace mirtk {
 
 
+// =============================================================================
+// Auxiliary functions
+// =============================================================================
+
+namespace MultiLevelFreeFormTransformationUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Refine cubic B-spline FFD by knot insertion along the specified dimensions
+///
+/// The lattice is first extended by a control point with zero coefficient at
+/// each side such that the coefficients of the refined lattice which are
+/// non-zero because of the constant extrapolation of the input are retained.
+BSplineFreeFormTransformation3D *
+Refine(const BSplineFreeFormTransformation3D *ffd, bool rx, bool ry, bool rz)
+{
+  if (ffd->X() == 1) rx = false;
+  if (ffd->Y() == 1) ry = false;
+  if (ffd->Z() == 1) rz = false;
+
+  const int di = (rx ? 1 : 0);
+  const int dj = (ry ? 1 : 0);
+  const int dk = (rz ? 1 : 0);
+
+  ImageAttributes attr = ffd->Attributes();
+  attr._x += 2 * di;
+  attr._y += 2 * dj;
+  attr._z += 2 * dk;
+
+  BSplineFreeFormTransformation3D *refined = new BSplineFreeFormTransformation3D();
+  refined->Initialize(attr);
+
+  double dx, dy, dz;
+  for (int k = 0; k < ffd->Z(); ++k)
+  for (int j = 0; j < ffd->Y(); ++j)
+  for (int i = 0; i < ffd->X(); ++i) {
+    ffd->Get(i, j, k, dx, dy, dz);
+    refined->Put(i + di, j + dj, k + dk, dx, dy, dz);
+  }
+
+  refined->Subdivide(rx, ry, rz);
+  return refined;
+}
+
+// -----------------------------------------------------------------------------
+/// Determine number of subdivisions of coarse lattice to match finer spacing
+bool NumberOfSubdivisions(double coarse, double fine, int &n)
+{
+  const double ratio = coarse / fine;
+  n = iround(log(ratio) / log(2.0));
+  return n >= 0 && fequal(ratio, pow(2.0, n), 1e-6 * ratio);
+}
+
+// -----------------------------------------------------------------------------
+/// Determine offset of refined lattice in finest lattice and check alignment
+bool LatticeOffset(const BSplineFreeFormTransformation3D *ffd,
+                   const BSplineFreeFormTransformation3D *ref,
+                   int &i0, int &j0, int &k0)
+{
+  const double tol = 1e-4;
+  double x = .0, y = .0, z = .0;
+  ffd->LatticeToWorld(x, y, z);
+  ref->WorldToLattice(x, y, z);
+  i0 = iround(x), j0 = iround(y), k0 = iround(z);
+  if (!fequal(x, i0, tol) || !fequal(y, j0, tol) || !fequal(z, k0, tol)) {
+    return false;
+  }
+  // Control points must be equally spaced along the same axes
+  const int naxes = (ref->Z() == 1 ? 2 : 3);
+  for (int d = 0; d < naxes; ++d) {
+    x = (d == 0 ? 1. : .0);
+    y = (d == 1 ? 1. : .0);
+    z = (d == 2 ? 1. : .0);
+    ffd->LatticeToWorld(x, y, z);
+    ref->WorldToLattice(x, y, z);
+    if (!fequal(x - i0, (d == 0 ? 1. : .0), tol) ||
+        !fequal(y - j0, (d == 1 ? 1. : .0), tol) ||
+        !fequal(z - k0, (d == 2 ? 1. : .0), tol)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+} // namespace MultiLevelFreeFormTransformationUtils
+
+using namespace MultiLevelFreeFormTransformationUtils;
+
 // =============================================================================
 // Construction/Destruction
 // =============================================================================
@@ -69,6 +161,8 @@ MultiLevelFreeFormTransformation::~MultiLevelFreeFormTransformation()
 // -----------------------------------------------------------------------------
 void MultiLevelFreeFormTransformation::CombineLocalTransformation()
 {
+  if (this->CompileLocalTransformation()) return;
+
   FreeFormTransformation *first = NULL, *second = NULL;
   while (_NumberOfLevels > 1) {
     first  = this->PopLocalTransformation();
@@ -117,6 +211,107 @@ void MultiLevelFreeFormTransformation::MergeGlobalIntoLocalDisplacement()
   delete ffdCopy;
 }
 
+// -----------------------------------------------------------------------------
+BSplineFreeFormTransformation3D *MultiLevelFreeFormTransformation::Compile(bool global) const
+{
+  if (_NumberOfLevels == 0) return NULL;
+
+  // Choose level with smallest control point spacing as reference
+  const BSplineFreeFormTransformation3D *ref = NULL, *ffd;
+  double vol, min_vol = numeric_limits<double>::infinity();
+  for (int l = 0; l < _NumberOfLevels; ++l) {
+    if (_LocalTransformation[l]->TypeOfClass() != TRANSFORMATION_BSPLINE_FFD_3D ||
+        _LocalTransformation[l]->ExtrapolationMode() != Extrapolation_Const) {
+      return NULL;
+    }
+    ffd = static_cast<const BSplineFreeFormTransformation3D *>(_LocalTransformation[l]);
+    vol = ffd->GetXSpacing() * ffd->GetYSpacing();
+    if (ffd->Z() > 1) vol *= ffd->GetZSpacing();
+    if (vol < min_vol) ref = ffd, min_vol = vol;
+  }
+
+  // Refine coarser levels to spacing of reference lattice
+  Array<BSplineFreeFormTransformation3D *> level(_NumberOfLevels, NULL);
+  Array<int> i0(_NumberOfLevels), j0(_NumberOfLevels), k0(_NumberOfLevels);
+  int  i1 = 0, j1 = 0, k1 = 0, i2 = ref->X() - 1, j2 = ref->Y() - 1, k2 = ref->Z() - 1;
+  int  nx, ny, nz = 0;
+  bool ok = true;
+
+  for (int l = 0; l < _NumberOfLevels; ++l) {
+    ffd = static_cast<const BSplineFreeFormTransformation3D *>(_LocalTransformation[l]);
+    ok = ((ffd->Z() == 1) == (ref->Z() == 1)) &&
+         NumberOfSubdivisions(ffd->GetXSpacing(), ref->GetXSpacing(), nx) &&
+         NumberOfSubdivisions(ffd->GetYSpacing(), ref->GetYSpacing(), ny) &&
+         (ref->Z() == 1 || NumberOfSubdivisions(ffd->GetZSpacing(), ref->GetZSpacing(), nz));
+    if (!ok) break;
+    level[l] = new BSplineFreeFormTransformation3D(*ffd);
+    for (int n = 0; n < max(max(nx, ny), nz); ++n) {
+      BSplineFreeFormTransformation3D *refined = Refine(level[l], n < nx, n < ny, n < nz);
+      delete level[l];
+      level[l] = refined;
+    }
+    ok = LatticeOffset(level[l], ref, i0[l], j0[l], k0[l]);
+    if (!ok) break;
+    i1 = min(i1, i0[l]), i2 = max(i2, i0[l] + level[l]->X() - 1);
+    j1 = min(j1, j0[l]), j2 = max(j2, j0[l] + level[l]->Y() - 1);
+    k1 = min(k1, k0[l]), k2 = max(k2, k0[l] + level[l]->Z() - 1);
+  }
+
+  // Sum coefficients of refined levels on common lattice
+  BSplineFreeFormTransformation3D *compiled = NULL;
+  if (ok) {
+    ImageAttributes attr = ref->Attributes();
+    attr._x = i2 - i1 + 1;
+    attr._y = j2 - j1 + 1;
+    attr._z = k2 - k1 + 1;
+    double x = .5 * (i1 + i2), y = .5 * (j1 + j2), z = .5 * (k1 + k2);
+    ref->LatticeToWorld(x, y, z);
+    attr._xorigin = x, attr._yorigin = y, attr._zorigin = z;
+
+    compiled = new BSplineFreeFormTransformation3D();
+    compiled->Initialize(attr);
+
+    double dx, dy, dz, vx, vy, vz;
+    for (int l = 0; l < _NumberOfLevels; ++l) {
+      const int di = i0[l] - i1, dj = j0[l] - j1, dk = k0[l] - k1;
+      for (int k = 0; k < level[l]->Z(); ++k)
+      for (int j = 0; j < level[l]->Y(); ++j)
+      for (int i = 0; i < level[l]->X(); ++i) {
+        level[l]->Get(i, j, k, dx, dy, dz);
+        compiled->Get(i + di, j + dj, k + dk, vx, vy, vz);
+        compiled->Put(i + di, j + dj, k + dk, vx + dx, vy + dy, vz + dz);
+      }
+    }
+
+    // Cubic B-spline coefficients of linear displacement are its samples
+    if (global && !_GlobalTransformation.IsIdentity()) {
+      for (int k = 0; k < compiled->Z(); ++k)
+      for (int j = 0; j < compiled->Y(); ++j)
+      for (int i = 0; i < compiled->X(); ++i) {
+        x = i, y = j, z = k;
+        compiled->LatticeToWorld(x, y, z);
+        _GlobalTransformation.Displacement(x, y, z);
+        compiled->Get(i, j, k, vx, vy, vz);
+        compiled->Put(i, j, k, vx + x, vy + y, vz + z);
+      }
+    }
+  }
+
+  for (int l = 0; l < _NumberOfLevels; ++l) delete level[l];
+  return compiled;
+}
+
+// -----------------------------------------------------------------------------
+bool MultiLevelFreeFormTransformation::CompileLocalTransformation()
+{
+  if (_NumberOfLevels < 2) return true;
+  BSplineFreeFormTransformation3D *ffd = this->Compile(false);
+  if (ffd == NULL) return false;
+  while (_NumberOfLevels > 0) delete this->PopLocalTransformation();
+  this->PushLocalTransformation(ffd);
+  return true;
+}
+
 // =============================================================================
 // Approximation
 // =============================================================================
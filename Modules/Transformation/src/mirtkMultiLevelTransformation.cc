@@ -80,9 +80,14 @@ MultiLevelTransformation::MultiLevelTransformation(const AffineTransformation &t
 // -----------------------------------------------------------------------------
 MultiLevelTransformation::MultiLevelTransformation(const MultiLevelTransformation &t)
 :
-  Transformation(t),
+  Transformation(t, 0),
+  _GlobalTransformation(t._GlobalTransformation),
   _NumberOfLevels(t._NumberOfLevels)
 {
+  for (int l = _NumberOfLevels; l < MAX_TRANS; ++l) {
+    _LocalTransformation      [l] = NULL;
+    _LocalTransformationStatus[l] = Passive;
+  }
   for (int l = 0; l < _NumberOfLevels; ++l) {
     _LocalTransformation[l] = dynamic_cast<FreeFormTransformation *>(Transformation::New(t._LocalTransformation[l]));
     if (_LocalTransformation[l] == NULL) {
@@ -259,6 +264,18 @@ int MultiLevelTransformation::NumberOfDOFs() const
   return ndofs;
 }
 
+// -----------------------------------------------------------------------------
+unsigned long MultiLevelTransformation::ModificationTime() const
+{
+  // Sum of monotonically increasing time stamps, where the time stamps of
+  // removed levels are added to the own one (cf. PopLocalTransformation)
+  unsigned long mtime = _ModificationTime + _GlobalTransformation.ModificationTime();
+  for (int l = 0; l < _NumberOfLevels; ++l) {
+    mtime += _LocalTransformation[l]->ModificationTime();
+  }
+  return mtime;
+}
+
 // -----------------------------------------------------------------------------
 void MultiLevelTransformation::Put(int idx, double value)
 {
@@ -396,6 +413,7 @@ void MultiLevelTransformation::Clear()
 {
   _GlobalTransformation.Reset();
   for (int l = 0; l < _NumberOfLevels; ++l) {
+    _ModificationTime += _LocalTransformation[l]->ModificationTime() + 1;
     Delete(_LocalTransformation[l]);
   }
   _NumberOfLevels = 0;
@@ -511,6 +529,7 @@ void MultiLevelTransformation::PushLocalTransformation(FreeFormTransformation *t
   _LocalTransformation      [_NumberOfLevels] = transformation;
   _LocalTransformationStatus[_NumberOfLevels] = Active;
   _NumberOfLevels++;
+  ++_ModificationTime;
 }
 
 // -----------------------------------------------------------------------------
@@ -528,6 +547,7 @@ void MultiLevelTransformation::InsertLocalTransformation(FreeFormTransformation
   }
   _LocalTransformation      [pos] = transformation;
   _LocalTransformationStatus[pos] = Passive;
+  ++_ModificationTime;
 }
 
 // -----------------------------------------------------------------------------
@@ -549,6 +569,7 @@ FreeFormTransformation *MultiLevelTransformation::PopLocalTransformation()
     localTransformation = _LocalTransformation[_NumberOfLevels];
     _LocalTransformation      [_NumberOfLevels] = NULL;
     _LocalTransformationStatus[_NumberOfLevels] = Passive;
+    _ModificationTime += localTransformation->ModificationTime() + 1;
   }
   return localTransformation;
 }
@@ -566,6 +587,7 @@ FreeFormTransformation *MultiLevelTransformation::RemoveLocalTransformation(int
     _NumberOfLevels--;
     _LocalTransformation      [_NumberOfLevels] = NULL;
     _LocalTransformationStatus[_NumberOfLevels] = Passive;
+    _ModificationTime += localTransformation->ModificationTime() + 1;
   } else {
     cerr << "MultiLevelTransformation::RemoveLocalTransformation: No such transformation: " << pos << endl;
     exit(1);
@@ -36,11 +36,89 @@
 
 #include <mirtkLinearInterpolateImageFunction.hxx>  // incl. inline definitions
 #include <mirtkFastLinearImageGradientFunction.hxx> // incl. inline definitions
+#include <mirtkFastCubicBSplineInterpolateImageFunction2D.hxx> // incl. inline definitions
+#include <mirtkFastCubicBSplineInterpolateImageFunction3D.hxx> // incl. inline definitions
 
 
 namespace mirtk {
 
 
+// =============================================================================
+// Auxiliary functions
+// =============================================================================
+
+namespace RegisteredImageUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Allocate new (empty) displacement cache of requested precision
+BaseImage *NewDisplacementCache(bool single_precision)
+{
+  if (single_precision) return new RegisteredImage::SinglePrecisionImageType();
+  return new RegisteredImage::DisplacementImageType();
+}
+
+// -----------------------------------------------------------------------------
+/// Convert image to single precision if requested
+///
+/// \param[in] image            Double precision image. Deleted when converted.
+/// \param[in] single_precision Whether to convert image to single precision.
+///
+/// \returns Either input image or its single precision copy.
+BaseImage *ToPrecision(GenericImage<double> *image, bool single_precision)
+{
+  if (!single_precision) return image;
+  BaseImage *copy = new RegisteredImage::SinglePrecisionImageType(*image);
+  delete image;
+  return copy;
+}
+
+// -----------------------------------------------------------------------------
+/// Copy displacement cache of same precision
+void CopyDisplacement(BaseImage *dst, const BaseImage *src)
+{
+  typedef RegisteredImage::SinglePrecisionImageType SingleImage;
+  typedef RegisteredImage::DisplacementImageType    DoubleImage;
+  SingleImage *fdst = dynamic_cast<SingleImage *>(dst);
+  if (fdst) *fdst = *dynamic_cast<const SingleImage *>(src);
+  else      *dynamic_cast<DoubleImage *>(dst) = *dynamic_cast<const DoubleImage *>(src);
+}
+
+// -----------------------------------------------------------------------------
+/// Compute displacements using the typed overload matching the cache precision
+void ComputeDisplacement(const Transformation *dof, BaseImage *disp,
+                         double t, double t0, const WorldCoordsImage *i2w)
+{
+  typedef RegisteredImage::SinglePrecisionImageType SingleImage;
+  typedef RegisteredImage::DisplacementImageType    DoubleImage;
+  SingleImage *fdisp = dynamic_cast<SingleImage *>(disp);
+  if (fdisp) dof->Displacement(*fdisp, t, t0, i2w);
+  else       dof->Displacement(*dynamic_cast<DoubleImage *>(disp), t, t0, i2w);
+}
+
+// -----------------------------------------------------------------------------
+/// Compute displacements of MFFD levels [m, n) using the typed overload
+/// matching the cache precision
+void ComputeDisplacement(const MultiLevelTransformation *mffd, int m, int n,
+                         BaseImage *disp, double t, double t0,
+                         const WorldCoordsImage *i2w)
+{
+  typedef RegisteredImage::SinglePrecisionImageType SingleImage;
+  typedef RegisteredImage::DisplacementImageType    DoubleImage;
+  SingleImage *fdisp = dynamic_cast<SingleImage *>(disp);
+  if (fdisp) mffd->Displacement(m, n, *fdisp, t, t0, i2w);
+  else       mffd->Displacement(m, n, *dynamic_cast<DoubleImage *>(disp), t, t0, i2w);
+}
+
+
+} // namespace RegisteredImageUtils
+
+using namespace RegisteredImageUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
 // -----------------------------------------------------------------------------
 RegisteredImage::RegisteredImage()
 :
@@ -53,6 +131,7 @@ RegisteredImage::RegisteredImage()
   _WorldCoordinates      (NULL),
   _ImageToWorld          (NULL),
   _ExternalDisplacement  (NULL),
+  _TransformedCoordinates(NULL),
   _FixedDisplacement     (NULL),
   _Displacement          (NULL),
   _CacheWorldCoordinates (true),  // FIXME: MUST be true to also cache anything else...
@@ -64,6 +143,7 @@ RegisteredImage::RegisteredImage()
   _GradientSigma         (.0),
   _HessianSigma          (.0),
   _PrecomputeDerivatives (false),
+  _SinglePrecision       (false),
   _NumberOfActiveLevels  (0),
   _NumberOfPassiveLevels (0)
 {
@@ -73,18 +153,19 @@ RegisteredImage::RegisteredImage()
 // -----------------------------------------------------------------------------
 RegisteredImage::RegisteredImage(const RegisteredImage &other)
 :
-  GenericImage<double>(other),
+  GenericImage<VoxelType>(other),
   _InputImage            (other._InputImage),
-  _InputGradient         (other._InputGradient  ? new GradientImageType(*other._InputGradient)  : NULL),
-  _InputHessian          (other._InputHessian   ? new GradientImageType(*other._InputHessian)   : NULL),
+  _InputGradient         (other._InputGradient  ? other._InputGradient->Copy() : NULL),
+  _InputHessian          (other._InputHessian   ? other._InputHessian ->Copy() : NULL),
   _Transformation        (other._Transformation),
   _InterpolationMode     (other._InterpolationMode),
   _ExtrapolationMode     (other._ExtrapolationMode),
   _WorldCoordinates      (other._WorldCoordinates),
   _ImageToWorld          (other._ImageToWorld      ? new WorldCoordsImage (*other._ImageToWorld)      : NULL),
   _ExternalDisplacement  (other._ExternalDisplacement),
-  _FixedDisplacement     (other._FixedDisplacement ? new DisplacementImageType(*other._FixedDisplacement) : NULL),
-  _Displacement          (other._Displacement      ? new DisplacementImageType(*other._Displacement)      : NULL),
+  _TransformedCoordinates(other._TransformedCoordinates),
+  _FixedDisplacement     (other._FixedDisplacement ? other._FixedDisplacement->Copy() : NULL),
+  _Displacement          (other._Displacement      ? other._Displacement     ->Copy() : NULL),
   _CacheWorldCoordinates (other._CacheWorldCoordinates),
   _CacheFixedDisplacement(other._CacheFixedDisplacement),
   _CacheDisplacement     (other._CacheDisplacement),
@@ -94,6 +175,7 @@ RegisteredImage::RegisteredImage(const RegisteredImage &other)
   _GradientSigma         (other._GradientSigma),
   _HessianSigma          (other._HessianSigma),
   _PrecomputeDerivatives (other._PrecomputeDerivatives),
+  _SinglePrecision       (other._SinglePrecision),
   _NumberOfActiveLevels  (other._NumberOfActiveLevels),
   _NumberOfPassiveLevels (other._NumberOfPassiveLevels)
 {
@@ -103,18 +185,19 @@ RegisteredImage::RegisteredImage(const RegisteredImage &other)
 // -----------------------------------------------------------------------------
 RegisteredImage &RegisteredImage::operator =(const RegisteredImage &other)
 {
-  GenericImage<double>::operator =(other);
+  GenericImage<VoxelType>::operator =(other);
   _InputImage             = other._InputImage;
-  _InputGradient          = other._InputGradient  ? new GradientImageType(*other._InputGradient)  : NULL;
-  _InputHessian           = other._InputHessian   ? new GradientImageType(*other._InputHessian)   : NULL;
+  _InputGradient          = other._InputGradient  ? other._InputGradient->Copy() : NULL;
+  _InputHessian           = other._InputHessian   ? other._InputHessian ->Copy() : NULL;
   _Transformation         = other._Transformation;
   _InterpolationMode      = other._InterpolationMode;
   _ExtrapolationMode      = other._ExtrapolationMode;
   _WorldCoordinates       = other._WorldCoordinates;
   _ImageToWorld           = other._ImageToWorld      ? new WorldCoordsImage (*other._ImageToWorld)      : NULL;
   _ExternalDisplacement   = other._ExternalDisplacement;
-  _FixedDisplacement      = other._FixedDisplacement ? new DisplacementImageType(*other._FixedDisplacement) : NULL;
-  _Displacement           = other._Displacement      ? new DisplacementImageType(*other._Displacement)      : NULL;
+  _TransformedCoordinates = other._TransformedCoordinates;
+  _FixedDisplacement      = other._FixedDisplacement ? other._FixedDisplacement->Copy() : NULL;
+  _Displacement           = other._Displacement      ? other._Displacement     ->Copy() : NULL;
   _CacheWorldCoordinates  = other._CacheWorldCoordinates;
   _CacheFixedDisplacement = other._CacheFixedDisplacement;
   _CacheDisplacement      = other._CacheDisplacement;
@@ -124,6 +207,7 @@ RegisteredImage &RegisteredImage::operator =(const RegisteredImage &other)
   _GradientSigma          = other._GradientSigma;
   _HessianSigma           = other._HessianSigma;
   _PrecomputeDerivatives  = other._PrecomputeDerivatives;
+  _SinglePrecision        = other._SinglePrecision;
   _NumberOfActiveLevels   = other._NumberOfActiveLevels;
   _NumberOfPassiveLevels  = other._NumberOfPassiveLevels;
   memcpy(_Offset, other._Offset, 13 * sizeof(int));
@@ -137,7 +221,7 @@ RegisteredImage::~RegisteredImage()
   delete _FixedDisplacement;
   delete _Displacement;
   if (_InputGradient != _InputImage) delete _InputGradient;
-  delete _InputHessian;
+  if (_InputHessian  != _InputImage) delete _InputHessian;
 }
 
 // -----------------------------------------------------------------------------
@@ -146,7 +230,10 @@ void RegisteredImage::Initialize(const ImageAttributes &attr, int t)
   MIRTK_START_TIMING();
 
   // Clear possibly previously allocated displacement cache
-  if (!_Transformation) Delete(_Displacement);
+  // or one which does not have the requested precision
+  if (!_Transformation || _SinglePrecision != (dynamic_cast<SinglePrecisionImageType *>(_Displacement) != NULL)) {
+    Delete(_Displacement);
+  }
 
   // Check if input image is set
   if (!_InputImage) {
@@ -164,14 +251,15 @@ void RegisteredImage::Initialize(const ImageAttributes &attr, int t)
     cerr << "RegisteredImage::Initialize: Number of registered image channels must be either 1, 4, 10 or 13" << endl;
     exit(1);
   }
-  GenericImage<double>::Initialize(attr, t);
+  GenericImage<VoxelType>::Initialize(attr, t);
 
-  // Set background value/foreground mask
+  // Set background value/foreground mask, rounded to the voxel type such
+  // that padded voxels compare equal to it in single precision
+  double bg = MIN_GREY;
   if (_InputImage->HasBackgroundValue()) {
-    this->PutBackgroundValueAsDouble(_InputImage->GetBackgroundValueAsDouble());
-  } else {
-    this->PutBackgroundValueAsDouble(MIN_GREY);
+    bg = _InputImage->GetBackgroundValueAsDouble();
   }
+  this->PutBackgroundValueAsDouble(voxel_cast<double>(voxel_cast<VoxelType>(bg)));
 
   // Pre-compute world coordinates
   if (_WorldCoordinates) {
@@ -210,9 +298,12 @@ void RegisteredImage::Initialize(const ImageAttributes &attr, int t)
 
   // Pre-compute fixed displacements
   if (cache_fixed && _NumberOfPassiveLevels >= 0) {
-    if (!_FixedDisplacement) _FixedDisplacement = new DisplacementImageType();
+    Delete(_FixedDisplacement);
+    _FixedDisplacement = NewDisplacementCache(_SinglePrecision);
     _FixedDisplacement->Initialize(attr, 3);
-    mffd->Displacement(-1, _NumberOfPassiveLevels, *_FixedDisplacement, _InputImage->GetTOrigin(), _ImageToWorld);
+    ComputeDisplacement(mffd, -1, _NumberOfPassiveLevels, _FixedDisplacement,
+                        _FixedDisplacement->GetTOrigin(), _InputImage->GetTOrigin(),
+                        _ImageToWorld);
   } else {
     Delete(_FixedDisplacement);
   }
@@ -234,6 +325,13 @@ void RegisteredImage::Initialize(const ImageAttributes &attr, int t)
   MIRTK_DEBUG_TIMING(4, "initialization of " << (_Transformation ? "moving" : "fixed") << " image");
 }
 
+// -----------------------------------------------------------------------------
+bool RegisteredImage::FusedDerivatives() const
+{
+  return !_PrecomputeDerivatives &&
+         InterpolationWithoutPadding(_InterpolationMode) == Interpolation_FastCubicBSpline;
+}
+
 // -----------------------------------------------------------------------------
 void RegisteredImage::ComputeInputGradient(double sigma)
 {
@@ -265,7 +363,7 @@ void RegisteredImage::ComputeInputGradient(double sigma)
     typedef GradientImageFilter<GradientImageType::VoxelType> FilterType;
     FilterType filter(FilterType::GRADIENT_VECTOR);
     filter.Input (blurred_image);
-    filter.Output(_InputGradient ? _InputGradient : new GradientImageType);
+    filter.Output(new GradientImageType);
     // Note that even though the original IRTK nreg2 implementation did divide
     // the image gradient initially by the voxel size, the similarity gradient
     // was reoriented then by ImageRegistration2::EvaluateGradient using the
@@ -279,14 +377,21 @@ void RegisteredImage::ComputeInputGradient(double sigma)
       filter.PaddingValue(this->GetBackgroundValueAsDouble());
     }
     filter.Run();
-    _InputGradient = filter.Output();
+    if (_InputGradient != _InputImage) delete _InputGradient;
+    _InputGradient = ToPrecision(filter.Output(), _SinglePrecision);
     _InputGradient->PutTSize(.0);
     _InputGradient->PutBackgroundValueAsDouble(.0);
     if (blurred_image != _InputImage) delete blurred_image;
     MIRTK_DEBUG_TIMING(5, "computation of 1st order image derivatives");
   } else {
-    delete _InputGradient;
-    _InputGradient = blurred_image;
+    if (_InputGradient != _InputImage) delete _InputGradient;
+    // Cubic B-spline coefficients of fused derivatives are in double precision
+    if (_SinglePrecision && !FusedDerivatives()) {
+      _InputGradient = new SinglePrecisionImageType(*blurred_image);
+      if (blurred_image != _InputImage) delete blurred_image;
+    } else {
+      _InputGradient = blurred_image;
+    }
     MIRTK_DEBUG_TIMING(5, "low-pass filtering of image for 1st order derivatives");
   }
 }
@@ -317,18 +422,25 @@ void RegisteredImage::ComputeInputHessian(double sigma)
       blurring.Run();
     }
   }
+  if (_InputHessian != _InputImage) delete _InputHessian;
+  // Evaluate 2nd order derivatives of cubic B-spline interpolated image
+  if (FusedDerivatives()) {
+    _InputHessian = blurred_image;
+    MIRTK_DEBUG_TIMING(5, "low-pass filtering of image for 2nd order derivatives");
+    return;
+  }
   // Compute 2nd order image derivatives using finite differences
   typedef HessianImageFilter<HessianImageType::VoxelType> FilterType;
   FilterType filter(FilterType::HESSIAN_MATRIX);
   filter.Input(blurred_image);
-  filter.Output(_InputHessian ? _InputHessian : new HessianImageType);
+  filter.Output(new HessianImageType);
   filter.UseVoxelSize  (true);
   filter.UseOrientation(true);
   if (this->HasBackgroundValue()) {
     filter.PaddingValue(this->GetBackgroundValueAsDouble());
   }
   filter.Run();
-  _InputHessian = filter.Output();
+  _InputHessian = ToPrecision(filter.Output(), _SinglePrecision);
   _InputHessian->PutTSize(.0);
   _InputHessian->PutBackgroundValueAsDouble(.0);
   if (blurred_image != _InputImage) delete blurred_image;
@@ -384,7 +496,8 @@ struct Transformer
   }
 
   /// Transform output voxel using pre-computed world coordinates and displacements
-  void operator ()(double &x, double &y, double &z, const CoordType *wc, const double *dx)
+  template <class DispType>
+  void operator ()(double &x, double &y, double &z, const CoordType *wc, const DispType *dx)
   {
     x = wc[_x] + dx[_x];
     y = wc[_y] + dx[_y];
@@ -414,7 +527,8 @@ struct DefaultTransformer : public Transformer
 
   /// As this transformer is only used when no fixed transformation is cached,
   /// this overloaded operator should never be invoked
-  void operator ()(double &, double &, double &, const CoordType *, const double *, const double *)
+  template <class DispType>
+  void operator ()(double &, double &, double &, const CoordType *, const DispType *, const DispType *)
   {
     cerr << "RegisteredImage::DefaultTransformer used even though _FixedDisplacement assumed to be NULL ?!?" << endl;
     exit(1);
@@ -428,7 +542,8 @@ struct AdditiveTransformer : public Transformer
   using Transformer::operator();
 
   /// Transform output voxel using pre-computed world coordinates and displacements
-  void operator ()(double &x, double &y, double &z, const CoordType *wc, const double *d1, const double *d2)
+  template <class DispType>
+  void operator ()(double &x, double &y, double &z, const CoordType *wc, const DispType *d1, const DispType *d2)
   {
     x = wc[_x] + d1[_x] + d2[_x];
     y = wc[_y] + d1[_y] + d2[_y];
@@ -448,7 +563,8 @@ struct FluidTransformer : public Transformer
   /// Because fluid composition of displacement fields would require interpolation,
   /// let Transformation::Displacement handle the fluid composition already when
   /// computing the second displacement field.
-  void operator ()(double &x, double &y, double &z, const CoordType *wc, const double *, const double *dx)
+  template <class DispType>
+  void operator ()(double &x, double &y, double &z, const CoordType *wc, const DispType *, const DispType *dx)
   {
     x = wc[_x] + dx[_x];
     y = wc[_y] + dx[_y];
@@ -457,6 +573,51 @@ struct FluidTransformer : public Transformer
   }
 };
 
+// -----------------------------------------------------------------------------
+// Transformer which looks up shared pre-computed input voxel coordinates
+struct CachedTransformer : public Transformer
+{
+  /// Initialize data members
+  void Initialize(RegisteredImage *o, const BaseImage *i, const Transformation *t)
+  {
+    Transformer::Initialize(o, i, t);
+    _Coordinates = o->TransformedCoordinates()->Coordinates().Data();
+  }
+
+  /// Look up input voxel coordinates of output voxel
+  void operator ()(double &x, double &y, double &z)
+  {
+    const CoordType *c = _Coordinates + _Output->VoxelToIndex(static_cast<int>(x),
+                                                              static_cast<int>(y),
+                                                              static_cast<int>(z));
+    x = c[_x], y = c[_y], z = c[_z];
+  }
+
+  /// Look up input voxel coordinates of output voxel, ignoring world coordinates
+  void operator ()(double &x, double &y, double &z, const CoordType *)
+  {
+    (*this)(x, y, z);
+  }
+
+  /// Look up input voxel coordinates of output voxel, ignoring displacements
+  template <class DispType>
+  void operator ()(double &x, double &y, double &z, const CoordType *, const DispType *)
+  {
+    (*this)(x, y, z);
+  }
+
+  /// Look up input voxel coordinates of output voxel, ignoring displacements
+  template <class DispType>
+  void operator ()(double &x, double &y, double &z, const CoordType *, const DispType *, const DispType *)
+  {
+    (*this)(x, y, z);
+  }
+
+protected:
+
+  const CoordType *_Coordinates;
+};
+
 // -----------------------------------------------------------------------------
 // Transformer used when no transformation is set or custom displacement field given
 struct FixedTransformer : public Transformer
@@ -482,14 +643,16 @@ struct FixedTransformer : public Transformer
   }
 
   /// Transform output voxel using pre-computed world coordinates and displacements
-  void operator ()(double &x, double &y, double &z, const CoordType *wc, const double *dx)
+  template <class DispType>
+  void operator ()(double &x, double &y, double &z, const CoordType *wc, const DispType *dx)
   {
     Transformer::operator()(x, y, z, wc, dx);
   }
 
   /// As this transformer is only used when no transformation is set,
   /// this overloaded operator should never be invoked
-  void operator ()(double &, double &, double &, const CoordType *, const double *, const double *)
+  template <class DispType>
+  void operator ()(double &, double &, double &, const CoordType *, const DispType *, const DispType *)
   {
     cerr << "RegisteredImage::FixedTransformer(..., d1, d2) used even though _Transformation assumed to be NULL ?!?" << endl;
     exit(1);
@@ -691,6 +854,29 @@ public:
     _InputSize = Vector3D<int>(f->X(), f->Y(), f->Z());
   }
 
+  /// Interpolate n channels of multi-component image function inside its domain
+  template <class Function>
+  void EvaluateChannelsInside(const Function *f, double x, double y, double z,
+                              double *o, int offset, int) const
+  {
+    if (_InterpolateWithPadding) f->EvaluateWithPaddingInside(o, x, y, z, offset);
+    else                         f->EvaluateInside           (o, x, y, z, offset);
+  }
+
+  /// Interpolate n channels of multi-component image function inside its domain
+  /// and store these in single precision
+  ///
+  /// The number of channels is passed on explicitly because derivative
+  /// functions may evaluate the derivatives of a single-channel input image.
+  template <class Function>
+  void EvaluateChannelsInside(const Function *f, double x, double y, double z,
+                              float *o, int offset, int n) const
+  {
+    double v[9];
+    EvaluateChannelsInside(f, x, y, z, v, 1, n);
+    for (int c = 0; c < n; ++c, o += offset) *o = static_cast<float>(v[c]);
+  }
+
   /// Determine interpolation mode at given location
   ///
   /// \retval  1 Output channels should be interpolated without boundary checks.
@@ -723,32 +909,34 @@ public:
   /// Interpolate input intensity function
   ///
   /// \return The interpolation mode, i.e., result of inside/outside domain check.
-  int InterpolateIntensity(double x, double y, double z, double *o)
+  int InterpolateIntensity(double x, double y, double z, RegisteredPixel *o)
   {
+    double value;
     // Check if location is inside image domain
     int mode = InterpolationMode(x, y, z, false);
     if (mode == 1) {
       // Either interpolate using the input padding value to exclude background
       if (_InterpolateWithPadding) {
-        *o = _IntensityFunction->EvaluateWithPaddingInside(x, y, z);
+        value = _IntensityFunction->EvaluateWithPaddingInside(x, y, z);
       // or simply ignore the input background value as done by nreg2
       } else {
-        *o = _IntensityFunction->EvaluateInside(x, y, z);
+        value = _IntensityFunction->EvaluateInside(x, y, z);
       }
       // Set background to output padding value
-      if (*o == _IntensityFunction->DefaultValue()) {
-        *o = _PaddingValue;
-        if (_InterpolateWithPadding) return -1;
+      if (value == _IntensityFunction->DefaultValue()) {
+        value = _PaddingValue;
+        if (_InterpolateWithPadding) mode = -1;
       // Rescale foreground to desired [min, max] range
       } else if (_RescaleSlope != 1.0 || _RescaleIntercept != .0) {
-        *o = (*o) * _RescaleSlope + _RescaleIntercept;
-        if      (*o < _MinIntensity) *o = _MinIntensity;
-        else if (*o > _MaxIntensity) *o = _MaxIntensity;
+        value = value * _RescaleSlope + _RescaleIntercept;
+        if      (value < _MinIntensity) value = _MinIntensity;
+        else if (value > _MaxIntensity) value = _MaxIntensity;
       }
     // Otherwise, set output intensity to outside value
     } else {
-      *o = _PaddingValue;
+      value = _PaddingValue;
     }
+    *o = static_cast<RegisteredPixel>(value);
     // Pass inside/outside check result on to derivative interpolation
     // functions such that these boundary checks are only done once.
     // This requires the same interpolation mode for all channels.
@@ -756,17 +944,13 @@ public:
   }
 
   /// Interpolate 1st order derivatives of input intensity function
-  void InterpolateGradient(double x, double y, double z, double *o, int mode = 0)
+  void InterpolateGradient(double x, double y, double z, RegisteredPixel *o, int mode = 0)
   {
     o += _NumberOfVoxels;
     switch (mode) {
       // Inside
       case 1:
-        if (_InterpolateWithPadding) {
-          _GradientFunction->EvaluateWithPaddingInside(o, x, y, z, _NumberOfVoxels);
-        } else {
-          _GradientFunction->EvaluateInside(o, x, y, z, _NumberOfVoxels);
-        }
+        EvaluateChannelsInside(_GradientFunction, x, y, z, o, _NumberOfVoxels, 3);
         break;
       // Outside/Boundary
       default: for (int c = 1; c <= 3; ++c, o += _NumberOfVoxels) *o = .0;
@@ -774,17 +958,13 @@ public:
   }
 
   /// Interpolate 2nd order derivatives of input intensity function
-  void InterpolateHessian(double x, double y, double z, double *o, int mode = 0)
+  void InterpolateHessian(double x, double y, double z, RegisteredPixel *o, int mode = 0)
   {
     o += 4 * _NumberOfVoxels;
     switch (mode) {
       // Inside
       case 1:
-        if (_InterpolateWithPadding) {
-          _HessianFunction->EvaluateWithPaddingInside(o, x, y, z, _NumberOfVoxels);
-        } else {
-          _HessianFunction->EvaluateInside(o, x, y, z, _NumberOfVoxels);
-        }
+        EvaluateChannelsInside(_HessianFunction, x, y, z, o, _NumberOfVoxels, _NumberOfChannels - 4);
         break;
       // Outside/Boundary
       default: for (int c = 4; c < _NumberOfChannels; ++c, o += _NumberOfVoxels) *o = .0;
@@ -797,7 +977,7 @@ public:
 template <class IntensityFunction, class GradientFunction, class HessianFunction>
 struct IntensityInterpolator : public Interpolator<IntensityFunction, GradientFunction, HessianFunction>
 {
-  void operator()(double x, double y, double z, double *o)
+  void operator()(double x, double y, double z, RegisteredPixel *o)
   {
     this->InterpolateIntensity(x, y, z, o);
   }
@@ -808,7 +988,7 @@ struct IntensityInterpolator : public Interpolator<IntensityFunction, GradientFu
 template <class IntensityFunction, class GradientFunction, class HessianFunction>
 struct GradientInterpolator : public Interpolator<IntensityFunction, GradientFunction, HessianFunction>
 {
-  void operator()(double x, double y, double z, double *o)
+  void operator()(double x, double y, double z, RegisteredPixel *o)
   {
     int mode = this->InterpolationMode  (x, y, z);
     this           ->InterpolateGradient(x, y, z, o, mode);
@@ -820,7 +1000,7 @@ struct GradientInterpolator : public Interpolator<IntensityFunction, GradientFun
 template <class IntensityFunction, class GradientFunction, class HessianFunction>
 struct HessianInterpolator : public Interpolator<IntensityFunction, GradientFunction, HessianFunction>
 {
-  void operator()(double x, double y, double z, double *o)
+  void operator()(double x, double y, double z, RegisteredPixel *o)
   {
     int mode = this->InterpolationMode (x, y, z);
     this           ->InterpolateHessian(x, y, z, o, mode);
@@ -832,7 +1012,7 @@ struct HessianInterpolator : public Interpolator<IntensityFunction, GradientFunc
 template <class IntensityFunction, class GradientFunction, class HessianFunction>
 struct IntensityAndGradientInterpolator : public Interpolator<IntensityFunction, GradientFunction, HessianFunction>
 {
-  void operator()(double x, double y, double z, double *o)
+  void operator()(double x, double y, double z, RegisteredPixel *o)
   {
     int mode = this->InterpolateIntensity(x, y, z, o);
     this           ->InterpolateGradient (x, y, z, o, mode);
@@ -844,7 +1024,7 @@ struct IntensityAndGradientInterpolator : public Interpolator<IntensityFunction,
 template <class IntensityFunction, class GradientFunction, class HessianFunction>
 struct IntensityAndHessianInterpolator : public Interpolator<IntensityFunction, GradientFunction, HessianFunction>
 {
-  void operator()(double x, double y, double z, double *o)
+  void operator()(double x, double y, double z, RegisteredPixel *o)
   {
     int mode = this->InterpolateIntensity(x, y, z, o);
     this           ->InterpolateHessian  (x, y, z, o, mode);
@@ -856,7 +1036,7 @@ struct IntensityAndHessianInterpolator : public Interpolator<IntensityFunction,
 template <class IntensityFunction, class GradientFunction, class HessianFunction>
 struct GradientAndHessianInterpolator : public Interpolator<IntensityFunction, GradientFunction, HessianFunction>
 {
-  void operator()(double x, double y, double z, double *o)
+  void operator()(double x, double y, double z, RegisteredPixel *o)
   {
     int mode = this->InterpolationMode  (x, y, z);
     this           ->InterpolateGradient(x, y, z, o, mode);
@@ -869,7 +1049,7 @@ struct GradientAndHessianInterpolator : public Interpolator<IntensityFunction, G
 template <class IntensityFunction, class GradientFunction, class HessianFunction>
 struct IntensityAndGradientAndHessianInterpolator : public Interpolator<IntensityFunction, GradientFunction, HessianFunction>
 {
-  void operator()(double x, double y, double z, double *o)
+  void operator()(double x, double y, double z, RegisteredPixel *o)
   {
     int mode = this->InterpolateIntensity(x, y, z, o);
     this           ->InterpolateGradient (x, y, z, o, mode);
@@ -877,6 +1057,261 @@ struct IntensityAndGradientAndHessianInterpolator : public Interpolator<Intensit
   }
 };
 
+// -----------------------------------------------------------------------------
+// Interpolates intensity, 1st and 2nd order derivatives at once from the cubic
+// B-spline coefficients of the input image(s) instead of interpolating each
+// channel of separately precomputed derivative images
+template <class BSplineFunction>
+class FusedBSplineInterpolator
+{
+protected:
+
+  BSplineFunction *_IntensityFunction;
+  BSplineFunction *_GradientFunction; ///< May be identical to _IntensityFunction
+  BSplineFunction *_HessianFunction;  ///< May be identical to any of the above
+  bool             _InterpolateWithPadding;
+  double           _PaddingValue;
+  double           _MinIntensity;
+  double           _MaxIntensity;
+  double           _RescaleSlope;
+  double           _RescaleIntercept;
+  int              _NumberOfVoxels;
+  int              _NumberOfChannels;
+  Vector3D<int>    _InputSize;
+  double           _ToWorld[3][3]; ///< Maps derivatives w.r.t. lattice to world
+
+  /// Allocate and initialize B-spline image function of image which is not
+  /// yet interpolated by one of the other given image functions
+  static BSplineFunction *NewFunction(const BaseImage *image, InterpolationMode interp,
+                                      ExtrapolationMode extrap, bool intensity,
+                                      const BaseImage *a = NULL, BSplineFunction *fa = NULL,
+                                      const BaseImage *b = NULL, BSplineFunction *fb = NULL)
+  {
+    if (!image)     return NULL;
+    if (image == a) return fa;
+    if (image == b) return fb;
+    BSplineFunction *f = NULL;
+    if (intensity) {
+      const double bg = (image->HasBackgroundValue() ? image->GetBackgroundValueAsDouble() : MIN_GREY);
+      New<BSplineFunction>(f, image, interp, extrap, bg, bg);
+    } else {
+      const double bg = (image->HasBackgroundValue() ? image->GetBackgroundValueAsDouble() : .0);
+      New<BSplineFunction>(f, image, interp, extrap, bg, .0);
+    }
+    return f;
+  }
+
+  /// Evaluate value and derivatives w.r.t. lattice of given image function
+  void Evaluate(const BSplineFunction *f, double x, double y, double z,
+                double &v, double d1[3], double *d2) const
+  {
+    if (_InputSize._z == 1) {
+      double h[3];
+      f->EvaluateWithDerivatives2D(v, d1, d2 ? h : NULL, x, y, z);
+      d1[2] = .0;
+      if (d2) d2[0] = h[0], d2[1] = h[1], d2[2] = .0, d2[3] = h[2], d2[4] = d2[5] = .0;
+    } else {
+      f->EvaluateWithDerivatives3D(v, d1, d2, x, y, z);
+    }
+  }
+
+public:
+
+  /// Constructor
+  FusedBSplineInterpolator()
+  :
+    _IntensityFunction     (NULL),
+    _GradientFunction      (NULL),
+    _HessianFunction       (NULL),
+    _InterpolateWithPadding(false),
+    _PaddingValue          (-1),
+    _MinIntensity          (numeric_limits<double>::quiet_NaN()),
+    _MaxIntensity          (numeric_limits<double>::quiet_NaN()),
+    _RescaleSlope          (1.0),
+    _RescaleIntercept      (.0),
+    _NumberOfVoxels        (0),
+    _NumberOfChannels      (0)
+  {}
+
+  /// Copy constructor
+  FusedBSplineInterpolator(const FusedBSplineInterpolator &other)
+  :
+    _IntensityFunction     (NULL),
+    _GradientFunction      (NULL),
+    _HessianFunction       (NULL),
+    _InterpolateWithPadding(other._InterpolateWithPadding),
+    _PaddingValue          (other._PaddingValue),
+    _MinIntensity          (other._MinIntensity),
+    _MaxIntensity          (other._MaxIntensity),
+    _RescaleSlope          (other._RescaleSlope),
+    _RescaleIntercept      (other._RescaleIntercept),
+    _NumberOfVoxels        (other._NumberOfVoxels),
+    _NumberOfChannels      (other._NumberOfChannels),
+    _InputSize             (other._InputSize)
+  {
+    memcpy(_ToWorld, other._ToWorld, 9 * sizeof(double));
+    const BaseImage *f = (other._IntensityFunction ? other._IntensityFunction->Input() : NULL);
+    const BaseImage *g = (other._GradientFunction  ? other._GradientFunction ->Input() : NULL);
+    const BaseImage *h = (other._HessianFunction   ? other._HessianFunction  ->Input() : NULL);
+    const InterpolationMode interp = Interpolation_FastCubicBSpline;
+    if (other._IntensityFunction) {
+      _IntensityFunction = NewFunction(f, interp, other._IntensityFunction->ExtrapolationMode(), true);
+    }
+    _GradientFunction = NewFunction(g, interp, Extrapolation_Default, false, f, _IntensityFunction);
+    _HessianFunction  = NewFunction(h, interp, Extrapolation_Default, false, f, _IntensityFunction,
+                                                                             g, _GradientFunction);
+  }
+
+  /// Destructor
+  ~FusedBSplineInterpolator()
+  {
+    if (_HessianFunction  != _IntensityFunction &&
+        _HessianFunction  != _GradientFunction) Delete(_HessianFunction);
+    if (_GradientFunction != _IntensityFunction) Delete(_GradientFunction);
+    Delete(_IntensityFunction);
+  }
+
+  /// Initialize data members
+  void Initialize(RegisteredImage *o, const BaseImage *f,
+                  const BaseImage *g, const BaseImage *h,
+                  double omin = numeric_limits<double>::quiet_NaN(),
+                  double omax = numeric_limits<double>::quiet_NaN())
+  {
+    _InterpolateWithPadding = (ToString(o->InterpolationMode()).find("with padding") != string::npos);
+    if (o->HasBackgroundValue()) _PaddingValue = o->GetBackgroundValueAsDouble();
+    _NumberOfVoxels   = o->X() * o->Y() * o->Z();
+    _NumberOfChannels = o->T();
+    const InterpolationMode interp = o->InterpolationMode();
+    _IntensityFunction = NewFunction(f, interp, o->ExtrapolationMode(), true);
+    _GradientFunction  = NewFunction(g, interp, Extrapolation_Default, false, f, _IntensityFunction);
+    _HessianFunction   = NewFunction(h, interp, Extrapolation_Default, false, f, _IntensityFunction,
+                                                                              g, _GradientFunction);
+    _MinIntensity = omin;
+    _MaxIntensity = omax;
+    if (f && (!IsNaN(omin) || !IsNaN(omax))) {
+      double imin, imax;
+      f->GetMinMaxAsDouble(imin, imax);
+      if (IsNaN(omin)) omin = imin;
+      if (IsNaN(omax)) omax = imax;
+      _RescaleSlope     = (omax - omin) / (imax - imin);
+      _RescaleIntercept = omin - _RescaleSlope * imin;
+    } else {
+      _RescaleSlope     = 1.0;
+      _RescaleIntercept = 0.0;
+    }
+    const BaseImage *input = (f ? f : (g ? g : h));
+    _InputSize = Vector3D<int>(input->X(), input->Y(), input->Z());
+    // Derivatives w.r.t. world coordinates are given by the derivatives
+    // w.r.t. the lattice coordinates multiplied by R / voxel size, where
+    // R is the world to image orientation matrix (cf. ImageGradientFunction)
+    const Matrix R = input->Attributes().GetWorldToImageOrientation();
+    const double ds[3] = { input->GetXSize() == .0 ? 1.0 : input->GetXSize(),
+                           input->GetYSize() == .0 ? 1.0 : input->GetYSize(),
+                           input->GetZSize() == .0 ? 1.0 : input->GetZSize() };
+    for (int r = 0; r < 3; ++r)
+    for (int c = 0; c < 3; ++c) {
+      _ToWorld[r][c] = R(r, c) / ds[r];
+    }
+  }
+
+  /// Interpolate requested channels at given location
+  void operator()(double x, double y, double z, RegisteredPixel *o)
+  {
+    // Check if location is inside image domain
+    // (same bounds as used by Interpolator::InterpolationMode)
+    bool inside = (.5 < x && x < _InputSize._x - 1.5 &&
+                   .5 < y && y < _InputSize._y - 1.5);
+    if (inside) {
+      if (_InputSize._z == 1) inside = fequal(z, .0, 1e-3);
+      else inside = (.5 < z && z < _InputSize._z - 1.5);
+    }
+    double value = _PaddingValue;
+    if (inside && _InterpolateWithPadding) {
+      const BSplineFunction *f = (_IntensityFunction ? _IntensityFunction : _GradientFunction);
+      if (!f) f = _HessianFunction;
+      value = f->EvaluateWithPaddingInside(x, y, z);
+      if (value == f->DefaultValue()) inside = false;
+    }
+
+    // Evaluate each distinct B-spline function only once
+    double v, d1[3], d2[6], tmp_v, tmp_d1[3];
+    if (inside) {
+      if (_IntensityFunction) {
+        Evaluate(_IntensityFunction, x, y, z, v, d1, _HessianFunction == _IntensityFunction ? d2 : NULL);
+      }
+      if (_GradientFunction && _GradientFunction != _IntensityFunction) {
+        Evaluate(_GradientFunction, x, y, z, tmp_v, d1, _HessianFunction == _GradientFunction ? d2 : NULL);
+      }
+      if (_HessianFunction && _HessianFunction != _IntensityFunction
+                           && _HessianFunction != _GradientFunction) {
+        Evaluate(_HessianFunction, x, y, z, tmp_v, tmp_d1, d2);
+      }
+    }
+
+    // Intensity
+    if (_IntensityFunction) {
+      if (inside) {
+        if (!_InterpolateWithPadding) value = v;
+        if (value == _IntensityFunction->DefaultValue()) {
+          value = _PaddingValue;
+          if (_InterpolateWithPadding) inside = false;
+        } else if (_RescaleSlope != 1.0 || _RescaleIntercept != .0) {
+          value = value * _RescaleSlope + _RescaleIntercept;
+          if      (value < _MinIntensity) value = _MinIntensity;
+          else if (value > _MaxIntensity) value = _MaxIntensity;
+        }
+      } else {
+        value = _PaddingValue;
+      }
+      *o = static_cast<RegisteredPixel>(value);
+    }
+
+    // 1st order derivatives w.r.t. world coordinates, i.e., transpose(A) * g
+    if (_GradientFunction) {
+      RegisteredPixel *g = o + _NumberOfVoxels;
+      for (int c = 0; c < 3; ++c, g += _NumberOfVoxels) {
+        if (inside) {
+          *g = _ToWorld[0][c] * d1[0] + _ToWorld[1][c] * d1[1] + _ToWorld[2][c] * d1[2];
+        } else {
+          *g = .0;
+        }
+      }
+    }
+
+    // 2nd order derivatives w.r.t. world coordinates, i.e., transpose(A) * H * A
+    if (_HessianFunction) {
+      RegisteredPixel *h = o + 4 * _NumberOfVoxels;
+      double H[3][3], AH[3][3], W[3][3];
+      if (inside) {
+        H[0][0] = d2[0], H[0][1] = d2[1], H[0][2] = d2[2];
+        H[1][0] = d2[1], H[1][1] = d2[3], H[1][2] = d2[4];
+        H[2][0] = d2[2], H[2][1] = d2[4], H[2][2] = d2[5];
+        for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c) {
+          AH[r][c] = _ToWorld[0][r] * H[0][c] + _ToWorld[1][r] * H[1][c] + _ToWorld[2][r] * H[2][c];
+        }
+        for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c) {
+          W[r][c] = AH[r][0] * _ToWorld[0][c] + AH[r][1] * _ToWorld[1][c] + AH[r][2] * _ToWorld[2][c];
+        }
+      } else {
+        memset(W, 0, 9 * sizeof(double));
+      }
+      if (_NumberOfChannels - 4 == 9) {
+        for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c, h += _NumberOfVoxels) {
+          *h = W[r][c];
+        }
+      } else {
+        for (int r = 0; r < 3; ++r)
+        for (int c = r; c < 3; ++c, h += _NumberOfVoxels) {
+          *h = W[r][c];
+        }
+      }
+    }
+  }
+};
+
 // -----------------------------------------------------------------------------
 // Voxel update function
 template <class Transformer, class Interpolator>
@@ -905,7 +1340,7 @@ public:
   }
 
   /// Resample input without pre-computed maps
-  void operator ()(int i, int j, int k, int, double *o)
+  void operator ()(int i, int j, int k, int, RegisteredPixel *o)
   {
     double x = i, y = j, z = k;
     _Transform  (x, y, z);
@@ -913,7 +1348,7 @@ public:
   }
 
   /// Resample input using pre-computed world coordinates
-  void operator ()(int i, int j, int k, int, const CoordType *wc, double *o)
+  void operator ()(int i, int j, int k, int, const CoordType *wc, RegisteredPixel *o)
   {
     double x = i, y = j, z = k;
     _Transform  (x, y, z, wc);
@@ -921,7 +1356,8 @@ public:
   }
 
   /// Resample input using pre-computed world coordinates and displacements
-  void operator ()(int i, int j, int k, int, const CoordType *wc, const double *dx, double *o)
+  template <class DispType>
+  void operator ()(int i, int j, int k, int, const CoordType *wc, const DispType *dx, RegisteredPixel *o)
   {
     double x = i, y = j, z = k;
     _Transform  (x, y, z, wc, dx);
@@ -929,7 +1365,8 @@ public:
   }
 
   /// Resample input using pre-computed world coordinates and additive displacements
-  void operator ()(int i, int j, int k, int, const CoordType *wc, const double *d1, const double *d2, double *o)
+  template <class DispType>
+  void operator ()(int i, int j, int k, int, const CoordType *wc, const DispType *d1, const DispType *d2, RegisteredPixel *o)
   {
     double x = i, y = j, z = k;
     _Transform  (x, y, z, wc, d1, d2);
@@ -952,10 +1389,20 @@ void RegisteredImage::Update3(const blocked_range3d<int> &region,
     if (_ExternalDisplacement) {
       ParallelForEachVoxel(region, _ImageToWorld, _ExternalDisplacement, this, f);
     } else if (_Displacement) {
+      // Displacement caches are either both in single or double precision
+      SinglePrecisionImageType *fdisp = dynamic_cast<SinglePrecisionImageType *>(_Displacement);
+      DisplacementImageType    *ddisp = dynamic_cast<DisplacementImageType    *>(_Displacement);
       if (_FixedDisplacement) {
-        ParallelForEachVoxel(region, _ImageToWorld, _FixedDisplacement, _Displacement, this, f);
+        if (fdisp) {
+          SinglePrecisionImageType *fixed = dynamic_cast<SinglePrecisionImageType *>(_FixedDisplacement);
+          ParallelForEachVoxel(region, _ImageToWorld, fixed, fdisp, this, f);
+        } else {
+          DisplacementImageType *fixed = dynamic_cast<DisplacementImageType *>(_FixedDisplacement);
+          ParallelForEachVoxel(region, _ImageToWorld, fixed, ddisp, this, f);
+        }
       } else {
-        ParallelForEachVoxel(region, _ImageToWorld, _Displacement, this, f);
+        if (fdisp) ParallelForEachVoxel(region, _ImageToWorld, fdisp, this, f);
+        else       ParallelForEachVoxel(region, _ImageToWorld, ddisp, this, f);
       }
     } else {
       ParallelForEachVoxel(region, _ImageToWorld, this, f);
@@ -1016,21 +1463,45 @@ void RegisteredImage::Update1(const blocked_range3d<int> &region,
 {
   enum InterpolationMode interpolation = InterpolationWithoutPadding(_InterpolationMode);
 
+  // Evaluate intensities and derivatives at once from cubic B-spline coefficients
+  if (FusedDerivatives()) {
+    if (this->GetZ() == 1) {
+      typedef GenericFastCubicBSplineInterpolateImageFunction2D<InputImageType> BSplineFunction;
+      Update3<Transformer, FusedBSplineInterpolator<BSplineFunction> >(region, intensity, gradient, hessian);
+    } else {
+      typedef GenericFastCubicBSplineInterpolateImageFunction3D<InputImageType> BSplineFunction;
+      Update3<Transformer, FusedBSplineInterpolator<BSplineFunction> >(region, intensity, gradient, hessian);
+    }
+    return;
+  }
+
+  // Untransformed derivatives are either all stored in single or double precision
+  const bool single_precision = (dynamic_cast<SinglePrecisionImageType *>(_InputGradient) != NULL ||
+                                 dynamic_cast<SinglePrecisionImageType *>(_InputHessian)  != NULL);
+
   if (_PrecomputeDerivatives) {
     // Instantiate image functions for commonly used interpolation methods
     // to allow the compiler to generate optimized code for these
     if (interpolation == Interpolation_Linear ||
         interpolation == Interpolation_FastLinear) {
       // Auxiliary macro -- undefined again at the end of this body
-      #define _update_using(InterpolatorType)                                  \
+      #define _update_using(InterpolatorType, DerivativeImageType)             \
         Update2<Transformer, InterpolatorType<InputImageType>,                 \
-                             InterpolatorType<GradientImageType>,              \
-                             InterpolatorType<HessianImageType> >              \
+                             InterpolatorType<DerivativeImageType>,            \
+                             InterpolatorType<DerivativeImageType> >           \
             (region, intensity, gradient, hessian)
-      if (this->GetZ() == 1) {
-        _update_using(GenericLinearInterpolateImageFunction2D);
+      if (single_precision) {
+        if (this->GetZ() == 1) {
+          _update_using(GenericLinearInterpolateImageFunction2D, SinglePrecisionImageType);
+        } else {
+          _update_using(GenericLinearInterpolateImageFunction3D, SinglePrecisionImageType);
+        }
       } else {
-        _update_using(GenericLinearInterpolateImageFunction3D);
+        if (this->GetZ() == 1) {
+          _update_using(GenericLinearInterpolateImageFunction2D, GradientImageType);
+        } else {
+          _update_using(GenericLinearInterpolateImageFunction3D, GradientImageType);
+        }
       }
       #undef _update_using
     // Otherwise use generic interpolate image function interface
@@ -1043,29 +1514,56 @@ void RegisteredImage::Update1(const blocked_range3d<int> &region,
   } else {
     // Auxiliary macro -- undefined again at the end of this body
     // TODO: Use also some HessianInterpolatorType
-    #define _update_using(InterpolatorType, GradientInterpolatorType)          \
+    #define _update_using(InterpolatorType, GradientInterpolatorType, DerivativeImageType) \
       Update2<Transformer, InterpolatorType<InputImageType>,                   \
-                           GradientInterpolatorType<InputImageType>,           \
-                           InterpolatorType<HessianImageType> >                \
+                           GradientInterpolatorType<DerivativeImageType>,      \
+                           InterpolatorType<DerivativeImageType> >             \
           (region, intensity, gradient, hessian)
     // Instantiate image functions for commonly used interpolation methods
     // to allow the compiler to generate optimized code for these
     if (interpolation == Interpolation_Linear) {
-
-      if (this->GetZ() == 1) {
-        _update_using(GenericLinearInterpolateImageFunction2D,
-                      GenericLinearImageGradientFunction2D);
+      if (single_precision) {
+        if (this->GetZ() == 1) {
+          _update_using(GenericLinearInterpolateImageFunction2D,
+                        GenericLinearImageGradientFunction2D,
+                        SinglePrecisionImageType);
+        } else {
+          _update_using(GenericLinearInterpolateImageFunction3D,
+                        GenericLinearImageGradientFunction3D,
+                        SinglePrecisionImageType);
+        }
       } else {
-        _update_using(GenericLinearInterpolateImageFunction3D,
-                      GenericLinearImageGradientFunction3D);
+        if (this->GetZ() == 1) {
+          _update_using(GenericLinearInterpolateImageFunction2D,
+                        GenericLinearImageGradientFunction2D,
+                        InputImageType);
+        } else {
+          _update_using(GenericLinearInterpolateImageFunction3D,
+                        GenericLinearImageGradientFunction3D,
+                        InputImageType);
+        }
       }
     } else if (interpolation == Interpolation_FastLinear) {
-      if (this->GetZ() == 1) {
-        _update_using(GenericLinearInterpolateImageFunction2D,
-                      GenericFastLinearImageGradientFunction2D);
+      if (single_precision) {
+        if (this->GetZ() == 1) {
+          _update_using(GenericLinearInterpolateImageFunction2D,
+                        GenericFastLinearImageGradientFunction2D,
+                        SinglePrecisionImageType);
+        } else {
+          _update_using(GenericLinearInterpolateImageFunction3D,
+                        GenericFastLinearImageGradientFunction3D,
+                        SinglePrecisionImageType);
+        }
       } else {
-        _update_using(GenericLinearInterpolateImageFunction3D,
-                      GenericFastLinearImageGradientFunction3D);
+        if (this->GetZ() == 1) {
+          _update_using(GenericLinearInterpolateImageFunction2D,
+                        GenericFastLinearImageGradientFunction2D,
+                        InputImageType);
+        } else {
+          _update_using(GenericLinearInterpolateImageFunction3D,
+                        GenericFastLinearImageGradientFunction3D,
+                        InputImageType);
+        }
       }
     // Otherwise use generic interpolate image function interface
     // TODO: Implement and use ImageHessianFunction
@@ -1109,6 +1607,23 @@ void CopyChannels(GenericImage<RegisteredImage::VoxelType> *tgt, int l,
          src->GetNumberOfVoxels() * sizeof(RegisteredImage::VoxelType));
 }
 
+// -----------------------------------------------------------------------------
+inline void CopyChannels(GenericImage<RegisteredImage::VoxelType> *tgt, int l,
+                         const BaseImage *src)
+{
+  typedef RegisteredImage::SinglePrecisionImageType SingleImage;
+  const SingleImage *fsrc = dynamic_cast<const SingleImage *>(src);
+  if (fsrc) CopyChannels(tgt, l, fsrc);
+  else      CopyChannels(tgt, l, dynamic_cast<const GenericImage<double> *>(src));
+}
+
+// -----------------------------------------------------------------------------
+bool RegisteredImage::UseTransformedCoordinates() const
+{
+  return _TransformedCoordinates && _Transformation && _NumberOfActiveLevels > 0 &&
+         _TransformedCoordinates->Matches(_attr, _InputImage->Attributes(), _Transformation);
+}
+
 // -----------------------------------------------------------------------------
 void RegisteredImage::Update(const blocked_range3d<int> &region,
                              bool intensity, bool gradient, bool hessian,
@@ -1135,6 +1650,19 @@ void RegisteredImage::Update(const blocked_range3d<int> &region,
     // Always use provided externally updated displacement field if given
     Update1<DefaultTransformer>(region, intensity, gradient, hessian);
 
+  } else if (region.cols ().begin() == 0 && region.cols ().end() == this->X() &&
+             region.rows ().begin() == 0 && region.rows ().end() == this->Y() &&
+             region.pages().begin() == 0 && region.pages().end() == this->Z() &&
+             UseTransformedCoordinates()) {
+
+    // Use input voxel coordinates shared with other registered images, which
+    // are only recomputed by the first update after a transformation change.
+    // Updates of a subregion, e.g., after perturbing a single control point
+    // for a finite differences gradient approximation, transform only the
+    // voxels of this region instead of recomputing the whole cache.
+    _TransformedCoordinates->Update(_ImageToWorld);
+    Update1<CachedTransformer>(region, intensity, gradient, hessian);
+
   } else {
 
     // End time point of deformation and initial time for velocity-based
@@ -1149,7 +1677,7 @@ void RegisteredImage::Update(const blocked_range3d<int> &region,
       // For some transformations, it is faster to compute the displacements
       // all at once such as those which are represented by velocity fields.
       const bool cache = _CacheDisplacement || _Transformation->RequiresCachingOfDisplacements();
-      if (cache && !_Displacement) _Displacement = new DisplacementImageType();
+      if (cache && !_Displacement) _Displacement = NewDisplacementCache(_SinglePrecision);
 
       // If we pre-computed the fixed displacement of the passive MFFD levels
       const MultiLevelTransformation *mffd;
@@ -1158,9 +1686,9 @@ void RegisteredImage::Update(const blocked_range3d<int> &region,
         if (dynamic_cast<const FluidFreeFormTransformation *>(mffd)) {
 
           if (_Displacement) {
-            *_Displacement = *_FixedDisplacement;
-            mffd->Displacement(_NumberOfPassiveLevels, -1,
-                               *_Displacement, t, t0, _ImageToWorld);
+            CopyDisplacement(_Displacement, _FixedDisplacement);
+            ComputeDisplacement(mffd, _NumberOfPassiveLevels, -1,
+                                _Displacement, t, t0, _ImageToWorld);
           }
           Update1<FluidTransformer>(region, intensity, gradient, hessian);
 
@@ -1168,8 +1696,8 @@ void RegisteredImage::Update(const blocked_range3d<int> &region,
 
           if (_Displacement) {
             _Displacement->Initialize(_attr, 3);
-            mffd->Displacement(_NumberOfPassiveLevels, -1,
-                               *_Displacement, t, t0, _ImageToWorld);
+            ComputeDisplacement(mffd, _NumberOfPassiveLevels, -1,
+                                _Displacement, t, t0, _ImageToWorld);
           }
           Update1<AdditiveTransformer>(region, intensity, gradient, hessian);
 
@@ -1180,7 +1708,7 @@ void RegisteredImage::Update(const blocked_range3d<int> &region,
 
         if (_Displacement) {
           _Displacement->Initialize(_attr, 3);
-          _Transformation->Displacement(*_Displacement, t, t0, _ImageToWorld);
+          ComputeDisplacement(_Transformation, _Displacement, t, t0, _ImageToWorld);
         }
         Update1<DefaultTransformer>(region, intensity, gradient, hessian);
 
@@ -1253,8 +1781,8 @@ void RegisteredImage::Update(const blocked_range3d<int> &region,
         if (_Transformation) {
           const bool cache = _CacheDisplacement || _Transformation->RequiresCachingOfDisplacements();
           if (cache && !_Displacement) {
-            _Displacement = new DisplacementImageType();
-            _Transformation->Displacement(*_Displacement, t, t0, _ImageToWorld);
+            _Displacement = NewDisplacementCache(_SinglePrecision);
+            ComputeDisplacement(_Transformation, _Displacement, t, t0, _ImageToWorld);
           }
         }
         Update1<FixedTransformer>(region, intensity, gradient, hessian);
@@ -1297,8 +1825,8 @@ void RegisteredImage::Update(const blocked_range3d<int>  &region,
   }
 
   // Keep pointers to own displacement fields
-  DisplacementImageType * const _disp  = _Displacement;
-  DisplacementImageType * const _fixed = _FixedDisplacement;
+  BaseImage * const _disp  = _Displacement;
+  BaseImage * const _fixed = _FixedDisplacement;
 
   // Replace displacement fields by user arguments
   _Displacement      = const_cast<DisplacementImageType *>(disp);
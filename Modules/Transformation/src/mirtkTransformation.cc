@@ -338,9 +338,10 @@ Transformation *Transformation::New(const char *name)
 // -----------------------------------------------------------------------------
 Transformation::Transformation(int ndofs)
 :
-  _NumberOfDOFs(0),
-  _Param       (NULL),
-  _Status      (NULL)
+  _NumberOfDOFs    (0),
+  _Param           (NULL),
+  _Status          (NULL),
+  _ModificationTime(0)
 {
   InitializeDOFs(ndofs);
 }
@@ -348,9 +349,10 @@ Transformation::Transformation(int ndofs)
 // -----------------------------------------------------------------------------
 Transformation::Transformation(const Transformation &t)
 :
-  _NumberOfDOFs(0),
-  _Param       (NULL),
-  _Status      (NULL)
+  _NumberOfDOFs    (0),
+  _Param           (NULL),
+  _Status          (NULL),
+  _ModificationTime(0)
 {
   InitializeDOFs(t);
 }
@@ -358,9 +360,10 @@ Transformation::Transformation(const Transformation &t)
 // -----------------------------------------------------------------------------
 Transformation::Transformation(const Transformation &t, int ndofs)
 :
-  _NumberOfDOFs(0),
-  _Param       (NULL),
-  _Status      (NULL)
+  _NumberOfDOFs    (0),
+  _Param           (NULL),
+  _Status          (NULL),
+  _ModificationTime(0)
 {
   InitializeDOFs(t, ndofs);
 }
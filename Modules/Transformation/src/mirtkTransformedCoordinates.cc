@@ -0,0 +1,192 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mirtkTransformedCoordinates.h>
+
+#include <mirtkMath.h>
+#include <mirtkMatrix.h>
+#include <mirtkProfiling.h>
+#include <mirtkVoxelFunction.h>
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Auxiliary functions
+// =============================================================================
+
+namespace TransformedCoordinatesUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Map output voxels to input image lattice and mark those outside the
+/// interpolation domain of RegisteredImage by NaN coordinates
+class ComputeTransformedCoordinates : public VoxelFunction
+{
+  const Transformation *_Transformation; ///< NULL if displacements are given
+  Matrix                _ImageToWorld;   ///< Output lattice to world coordinates
+  Matrix                _WorldToImage;   ///< World to input lattice coordinates
+  double                _t;              ///< Time point of input image
+  double                _t0;             ///< Time point of output image
+  int                   _X, _Y, _Z;      ///< Size of input image lattice
+  int                   _y, _z;          ///< Offsets of y and z components
+
+public:
+
+  /// Constructor
+  ComputeTransformedCoordinates(const ImageAttributes &domain,
+                                const ImageAttributes &input,
+                                const Transformation  *dof)
+  :
+    _Transformation(dof),
+    _ImageToWorld  (domain.GetImageToWorldMatrix()),
+    _WorldToImage  (input .GetWorldToImageMatrix()),
+    _t (input ._torigin),
+    _t0(domain._torigin),
+    _X(input._x), _Y(input._y), _Z(input._z),
+    _y(domain.NumberOfSpatialPoints()), _z(2 * _y)
+  {}
+
+  /// Map transformed world coordinates to input lattice
+  void ToInput(double x, double y, double z, double *c) const
+  {
+    const double a = _WorldToImage(0, 0) * x + _WorldToImage(0, 1) * y + _WorldToImage(0, 2) * z + _WorldToImage(0, 3);
+    const double b = _WorldToImage(1, 0) * x + _WorldToImage(1, 1) * y + _WorldToImage(1, 2) * z + _WorldToImage(1, 3);
+    const double d = _WorldToImage(2, 0) * x + _WorldToImage(2, 1) * y + _WorldToImage(2, 2) * z + _WorldToImage(2, 3);
+    // Same bounds as used by RegisteredImage interpolators, which are
+    // suitable also for the interpolation of the image derivatives
+    bool inside = (.5 < a && a < _X - 1.5 && .5 < b && b < _Y - 1.5);
+    if (inside) {
+      if (_Z == 1) inside = fequal(d, .0, 1e-3);
+      else         inside = (.5 < d && d < _Z - 1.5);
+    }
+    if (inside) {
+      c[0] = a, c[_y] = b, c[_z] = d;
+    } else {
+      c[0] = c[_y] = c[_z] = numeric_limits<double>::quiet_NaN();
+    }
+  }
+
+  /// Transform output voxel
+  void operator ()(int i, int j, int k, int, double *c) const
+  {
+    double x = i, y = j, z = k;
+    Transform(_ImageToWorld, x, y, z);
+    if (_Transformation) {
+      _Transformation->Transform(x, y, z, _t, _t0);
+    } else {
+      x += c[0], y += c[_y], z += c[_z];
+    }
+    ToInput(x, y, z, c);
+  }
+
+  /// Transform output voxel using pre-computed world coordinates
+  void operator ()(int, int, int, int, const double *wc, double *c) const
+  {
+    double x = wc[0], y = wc[_y], z = wc[_z];
+    if (_Transformation) {
+      _Transformation->Transform(x, y, z, _t, _t0);
+    } else {
+      x += c[0], y += c[_y], z += c[_z];
+    }
+    ToInput(x, y, z, c);
+  }
+};
+
+
+} // namespace TransformedCoordinatesUtils
+
+using namespace TransformedCoordinatesUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+TransformedCoordinates::TransformedCoordinates(const ImageAttributes &domain,
+                                               const ImageAttributes &input,
+                                               const class Transformation *dof)
+:
+  _Domain          (domain),
+  _InputDomain     (input),
+  _Transformation  (dof),
+  _ModificationTime(0),
+  _Valid           (false)
+{
+  _Domain._t = 1, _Domain._dt = .0;
+}
+
+// -----------------------------------------------------------------------------
+TransformedCoordinates::~TransformedCoordinates()
+{
+}
+
+// =============================================================================
+// Update
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+bool TransformedCoordinates::Matches(const ImageAttributes &domain,
+                                     const ImageAttributes &input,
+                                     const class Transformation *dof) const
+{
+  return dof == _Transformation &&
+         domain.EqualInSpace(_Domain)      && fequal(domain._torigin, _Domain._torigin, 1e-9) &&
+         input .EqualInSpace(_InputDomain) && fequal(input ._torigin, _InputDomain._torigin, 1e-9);
+}
+
+// -----------------------------------------------------------------------------
+bool TransformedCoordinates::Update(const WorldCoordsImage *i2w)
+{
+  // Images which share the cache may be updated by concurrent energy terms,
+  // in which case the first one recomputes the coordinates and the others wait
+  mutex::scoped_lock lock(_Mutex);
+  if (UpToDate()) return false;
+
+  MIRTK_START_TIMING();
+
+  // Remember modification time before evaluating the transformation as the
+  // evaluation of some transformations may update auxiliary members
+  const unsigned long mtime = _Transformation->ModificationTime();
+
+  // Allocate cache upon first update such that unused instances are cheap
+  if (_Coordinates.IsEmpty()) _Coordinates.Initialize(_Domain, 3);
+
+  // For some transformations, it is faster to compute the displacements
+  // all at once such as those which are represented by velocity fields
+  const class Transformation *dof = _Transformation;
+  if (_Transformation->RequiresCachingOfDisplacements()) {
+    _Transformation->Displacement(_Coordinates, _InputDomain._torigin, _Domain._torigin, i2w);
+    dof = NULL;
+  }
+
+  ComputeTransformedCoordinates map(_Domain, _InputDomain, dof);
+  if (i2w) ParallelForEachVoxel(_Domain, i2w, &_Coordinates, map);
+  else     ParallelForEachVoxel(_Domain,      &_Coordinates, map);
+
+  _ModificationTime = mtime;
+  _Valid            = true;
+
+  MIRTK_DEBUG_TIMING(4, "update of transformed coordinates");
+  return true;
+}
+
+
+} // namespace mirtk